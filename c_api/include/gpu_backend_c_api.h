@@ -17,6 +17,6 @@ extern "C"
 	// Command queue
 	GS_EXPORT GSCommandQueue gs_create_command_queue(GSGraphicsDevice graphicsDevice);
 	GS_EXPORT void gs_destroy_command_queue(GSCommandQueue commandQueue);
-	GS_EXPORT void gs_execute_command_buffer(GSCommandQueue commandQueue, GSCommandBuffer commandBuffer);
+	GS_EXPORT uint64_t gs_execute_command_buffer(GSCommandQueue commandQueue, GSCommandBuffer commandBuffer);
 	GS_EXPORT void gs_flush_command_queue(GSCommandQueue commandQueue);
 }
\ No newline at end of file
@@ -60,11 +60,11 @@ void gs_destroy_command_queue(GSCommandQueue commandQueue)
     command_queue::destroy_command_queue(cmdq_internal);
 }
 
-void gs_execute_command_buffer(GSCommandQueue commandQueue, GSCommandBuffer commandBuffer)
+uint64_t gs_execute_command_buffer(GSCommandQueue commandQueue, GSCommandBuffer commandBuffer)
 {
     CommandQueue cmdq_internal = (CommandQueue)commandQueue;
     CommandBuffer cmdb_internal = (CommandQueue)commandBuffer;
-    command_queue::execute_command_buffer(cmdq_internal, cmdb_internal);
+    return command_queue::execute_command_buffer(cmdq_internal, cmdb_internal);
 }
 
 void gs_flush_command_queue(GSCommandQueue commandQueue)
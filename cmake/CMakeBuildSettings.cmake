@@ -30,6 +30,15 @@ macro(define_plaform_settings)
 		replace_linker_flags("/machine:x64" "/MACHINE:X64")
 		add_compile_options(-D_SCL_SECURE_NO_WARNINGS -D_CRT_SECURE_NO_WARNINGS -D_CRT_SECURE_NO_DEPRECATE)
 		add_compile_options(-DSECURITY_WIN32)
+	elseif( PLATFORM_LINUX )
+		set(CMAKE_CXX_STANDARD 14)
+		add_compile_options(-g)
+		add_compile_options($<$<CONFIG:DEBUG>:-O0> $<$<NOT:$<CONFIG:DEBUG>>:-O3>)
+		add_compile_options(-ffast-math)
+		add_compile_options(-fno-rtti)
+		add_compile_options(-fno-exceptions)
+		add_compile_options(-pthread)
+		add_exe_linker_flags(-pthread)
 	else()
 		message(FATAL_ERROR "Unknown platform!")
 	endif()
@@ -0,0 +1,143 @@
+#pragma once
+
+// bento includes
+#include <bento_math/types.h>
+
+// Library includes
+#include "gpu_backend/gpu_types.h"
+#include "gpu_backend/settings.h"
+#include "gpu_backend/compute_shader_descriptor.h"
+#include "gpu_backend/graphics_buffer_type.h"
+#include "gpu_backend/constant_buffer_type.h"
+#include "gpu_backend/buffer_copy_list.h"
+#include "gpu_backend/readback_ring.h"
+#include "tools/timeline.h"
+
+// System includes
+#include <functional>
+
+namespace graphics_sandbox
+{
+    namespace cpu
+    {
+        // Maximal number of resources of each type that can be bound to a kernel
+        #define CPU_MAX_BOUND_RESOURCES 16
+
+        // View on a buffer bound to a kernel slot
+        struct CPUBufferView
+        {
+            char* data;
+            uint64_t bufferSize;
+            uint32_t elementSize;
+        };
+
+        // Everything a kernel needs to know about the current dispatch
+        struct CPUKernelContext
+        {
+            CPUBufferView srv[CPU_MAX_BOUND_RESOURCES];
+            CPUBufferView uav[CPU_MAX_BOUND_RESOURCES];
+            CPUBufferView cbv[CPU_MAX_BOUND_RESOURCES];
+            const uint32_t* rootConstants[CPU_MAX_BOUND_RESOURCES];
+            CPUBufferView rootCbv[CPU_MAX_BOUND_RESOURCES];
+            uint32_t groupSize[3];
+            uint32_t dispatchSize[3];
+        };
+
+        // A kernel processes the thread groups [groupBegin, groupEnd). Groups are linearized in X, then Y, then Z order, so a batch covers
+        // (groupEnd - groupBegin) * groupSize contiguous threads that the kernel can process in a single vectorizable loop.
+        typedef std::function<void(const CPUKernelContext& context, uint32_t groupBegin, uint32_t groupEnd)> CPUKernelFunction;
+
+        // Graphics Device API
+        namespace graphics_device
+        {
+            // A worker count of 0 uses every available hardware thread
+            GraphicsDevice create_graphics_device(uint32_t numWorkers = 0);
+            void destroy_graphics_device(GraphicsDevice graphicsDevice);
+        }
+
+        // Command Queue API
+        namespace command_queue
+        {
+            // Creation and destruction
+            CommandQueue create_command_queue(GraphicsDevice graphicsDevice);
+            void destroy_command_queue(CommandQueue commandQueue);
+
+            // Operation, the returned point is reached once the command buffer has been executed
+            uint64_t execute_command_buffer(CommandQueue commandQueue, CommandBuffer commandBuffer);
+            void flush(CommandQueue commandQueue);
+
+            // Timeline, the timeouts are in milliseconds
+            bool is_complete(CommandQueue commandQueue, uint64_t point);
+            bool wait(CommandQueue commandQueue, uint64_t point, uint64_t timeoutMS = TIMELINE_WAIT_INFINITE);
+            uint32_t wait_any(const CommandQueue* commandQueues, const uint64_t* points, uint32_t count, uint64_t timeoutMS = TIMELINE_WAIT_INFINITE);
+            bool wait_all(const CommandQueue* commandQueues, const uint64_t* points, uint32_t count, uint64_t timeoutMS = TIMELINE_WAIT_INFINITE);
+            void add_completion_callback(CommandQueue commandQueue, uint64_t point, TimelineCallback callback, void* userData);
+
+            // Asynchronous readbacks, same contract as the GPU backends (the bytes are available as soon as the command buffer is executed)
+            uint64_t request_readback(CommandQueue commandQueue, CommandBuffer commandBuffer, GraphicsBuffer graphicsBuffer, uint64_t offset, uint64_t size, ReadbackCallback callback = nullptr, void* userData = nullptr);
+            ReadbackStatus readback_status(CommandQueue commandQueue, uint64_t ticket);
+            const char* map_readback(CommandQueue commandQueue, uint64_t ticket, uint64_t& size);
+            void release_readback(CommandQueue commandQueue, uint64_t ticket);
+        }
+
+        // Command Buffer API
+        namespace command_buffer
+        {
+            // Creation and Destruction
+            CommandBuffer create_command_buffer(GraphicsDevice graphicsDevice);
+            void destroy_command_buffer(CommandBuffer command_buffer);
+
+            // Operations
+            void reset(CommandBuffer commandBuffer);
+            void close(CommandBuffer commandBuffer);
+            void copy_graphics_buffer(CommandBuffer commandBuffer, GraphicsBuffer inputBuffer, GraphicsBuffer outputBuffer);
+            void copy_constant_buffer(CommandBuffer commandBuffer, ConstantBuffer inputBuffer, ConstantBuffer outputBuffer);
+            void copy_buffer_region(CommandBuffer commandBuffer, GraphicsBuffer inputBuffer, uint64_t inputOffset, GraphicsBuffer outputBuffer, uint64_t outputOffset, uint64_t size);
+            void copy_buffer_regions(CommandBuffer commandBuffer, GraphicsBuffer inputBuffer, GraphicsBuffer outputBuffer, const BufferCopyRegion* regions, uint32_t numRegions);
+            void uav_barrier(CommandBuffer commandBuffer, GraphicsBuffer targetBuffer);
+
+            // Compute operations
+            void set_compute_graphics_buffer_uav(CommandBuffer commandBuffer, ComputeShader computeShader, uint32_t slot, GraphicsBuffer graphicsBuffer);
+            void set_compute_graphics_buffer_srv(CommandBuffer commandBuffer, ComputeShader computeShader, uint32_t slot, GraphicsBuffer graphicsBuffer);
+            void set_compute_graphics_buffer_cbv(CommandBuffer commandBuffer, ComputeShader computeShader, uint32_t slot, ConstantBuffer constantBuffer);
+            void set_compute_constants(CommandBuffer commandBuffer, ComputeShader computeShader, uint32_t slot, const void* data, uint32_t size);
+            void set_compute_cbv_address(CommandBuffer commandBuffer, ComputeShader computeShader, uint32_t slot, ConstantBuffer constantBuffer, uint64_t offset = 0);
+            void dispatch(CommandBuffer commandBuffer, ComputeShader computeShader, uint32_t sizeX, uint32_t sizeY, uint32_t sizeZ);
+
+            // Profiling
+            void enable_profiling_scope(CommandBuffer commandBuffer, ProfilingScope scope);
+            void disable_profiling_scope(CommandBuffer commandBuffer, ProfilingScope scope);
+        }
+
+        namespace graphics_resources
+        {
+            // Graphics Buffers
+            GraphicsBuffer create_graphics_buffer(GraphicsDevice graphicsDevice, uint64_t bufferSize, uint32_t elementSize, GraphicsBufferType bufferType);
+            void destroy_graphics_buffer(GraphicsBuffer graphicsBuffer);
+            void set_data(GraphicsBuffer graphicsBuffer, char* buffer, uint64_t bufferSize);
+            char* allocate_cpu_buffer(GraphicsBuffer graphicsBuffer);
+            void release_cpu_buffer(GraphicsBuffer graphicsBuffer);
+
+            // Constant Buffers
+            ConstantBuffer create_constant_buffer(GraphicsDevice graphicsDevice, uint64_t bufferSize, uint32_t elementSize, ConstantBufferType bufferType);
+            void destroy_constant_buffer(ConstantBuffer constantBuffer);
+            void upload_constant_buffer(ConstantBuffer constantBuffer, const char* bufferData, uint32_t bufferSize);
+        }
+
+        namespace compute_shader
+        {
+            // Kernels are looked up by the descriptor's kernel name, the group size plays the role of the [numthreads] attribute
+            void register_kernel(const char* kernelName, uint32_t groupSizeX, uint32_t groupSizeY, uint32_t groupSizeZ, const CPUKernelFunction& kernel);
+
+            ComputeShader create_compute_shader(GraphicsDevice graphicsDevice, const ComputeShaderDescriptor& computeShaderDescriptor);
+            void destroy_compute_shader(ComputeShader computeShader);
+        }
+
+        namespace profiling_scope
+        {
+            ProfilingScope create_profiling_scope(GraphicsDevice graphicsDevice, CommandQueue commandQueue);
+            void destroy_profiling_scope(ProfilingScope profilingScope);
+            uint64_t get_duration_us(ProfilingScope profilingScope);
+        }
+    }
+}
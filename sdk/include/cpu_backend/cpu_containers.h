@@ -0,0 +1,162 @@
+#pragma once
+
+// Bento includes
+#include <bento_base/platform.h>
+#include <bento_collection/vector.h>
+
+// SDK includes
+#include "cpu_backend/cpu_backend.h"
+#include "gpu_backend/graphics_buffer_type.h"
+#include "tools/work_stealing_pool.h"
+#include "tools/timeline.h"
+
+// System includes
+#include <mutex>
+
+namespace graphics_sandbox
+{
+	namespace cpu
+	{
+		// Global CPU Constants
+		#define CPU_BUFFER_ALIGNEMENT_SIZE 64
+		#define CPU_CONSTANT_BUFFER_ALIGNEMENT_SIZE 256
+		#define CPU_BATCHES_PER_THREAD 8
+		#define CPU_MIN_THREADS_PER_BATCH 256
+		#define CPU_MAX_ROOT_CONSTANTS 64
+		#define CPU_READBACK_RING_SIZE (4ull << 20)
+
+		struct CPUCommandQueue;
+
+		struct CPUGraphicsDevice
+		{
+			ALLOCATOR_BASED;
+
+			CPUGraphicsDevice(bento::IAllocator& allocator)
+			: _allocator(allocator)
+			, pool(nullptr)
+			, queues(allocator)
+			{
+			}
+
+			WorkStealingPool* pool;
+
+			// Live queues, a command buffer that is reset or destroyed cancels the readbacks it recorded on them
+			bento::Vector<CPUCommandQueue*> queues;
+			std::mutex queuesLock;
+			bento::IAllocator& _allocator;
+		};
+
+		struct CPUCommandQueue
+		{
+			ALLOCATOR_BASED;
+
+			CPUCommandQueue(bento::IAllocator& allocator)
+			: _allocator(allocator)
+			, deviceI(nullptr)
+			, timeline(nullptr)
+			, readbackBuffer(0)
+			, readbackRing(allocator)
+			{
+			}
+
+			CPUGraphicsDevice* deviceI;
+
+			// Signaled by the submitting thread, execution is synchronous
+			Timeline* timeline;
+
+			// Staging memory of the readbacks, like on the GPU backends
+			GraphicsBuffer readbackBuffer;
+			ReadbackRing readbackRing;
+			std::mutex readbackLock;
+			bento::IAllocator& _allocator;
+		};
+
+		struct CPUGraphicsBuffer
+		{
+			char* data;
+			uint64_t bufferSize;
+			uint32_t elementSize;
+			GraphicsBufferType type;
+		};
+
+		struct CPUComputeShader
+		{
+			// Kernel and its [numthreads]
+			CPUKernelFunction kernel;
+			uint32_t groupSize[3];
+
+			// Number of resources
+			uint32_t srvCount;
+			uint32_t uavCount;
+			uint32_t cbvCount;
+
+			// Root constant ranges, the context points into the storage
+			uint32_t rootConstantCount;
+			uint32_t rootConstantOffset[CPU_MAX_BOUND_RESOURCES];
+			uint32_t rootConstantSize[CPU_MAX_BOUND_RESOURCES];
+			uint32_t rootConstantData[CPU_MAX_ROOT_CONSTANTS];
+			uint32_t rootCbvCount;
+
+			// Resources bound at execution time
+			CPUKernelContext context;
+		};
+
+		struct CPUQuery
+		{
+			uint64_t timestamps[2];
+		};
+
+		enum class CPUCommandType
+		{
+			CopyBuffer,
+			CopyBufferRegions,
+			SetSRV,
+			SetUAV,
+			SetCBV,
+			SetConstants,
+			SetRootCBV,
+			Dispatch,
+			BeginProfiling,
+			EndProfiling
+		};
+
+		// Commands are recorded and only executed when the command buffer is submitted, like on a GPU
+		struct CPUCommand
+		{
+			CPUCommandType type;
+			CPUComputeShader* shader;
+			CPUGraphicsBuffer* source;
+			CPUGraphicsBuffer* destination;
+			CPUQuery* query;
+			uint32_t slot;
+			uint32_t size[3];
+			uint64_t offset;
+		};
+
+		struct CPUCommandBuffer
+		{
+			ALLOCATOR_BASED;
+
+			CPUCommandBuffer(bento::IAllocator& allocator)
+			: _allocator(allocator)
+			, deviceI(nullptr)
+			, commands(allocator)
+			, constantData(allocator)
+			, copyRegions(allocator)
+			, closed(false)
+			{
+			}
+
+			CPUGraphicsDevice* deviceI;
+			bento::Vector<CPUCommand> commands;
+
+			// Root constants are captured at record time
+			bento::Vector<uint32_t> constantData;
+
+			// Regions of the buffer copies, already coalesced
+			bento::Vector<BufferCopyRegion> copyRegions;
+			bool closed;
+			bento::IAllocator& _allocator;
+		};
+	}
+}
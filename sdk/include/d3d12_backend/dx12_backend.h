@@ -11,6 +11,14 @@
 #include "gpu_backend/compute_shader_descriptor.h"
 #include "gpu_backend/graphics_buffer_type.h"
 #include "gpu_backend/constant_buffer_type.h"
+#include "tools/timeline.h"
+#include "gpu_backend/shader_cache.h"
+#include "gpu_backend/shader_reflection.h"
+#include "gpu_backend/shader_permutation.h"
+#include "gpu_backend/dispatch_autotuner.h"
+#include "gpu_backend/upload_ring.h"
+#include "gpu_backend/buffer_copy_list.h"
+#include "gpu_backend/readback_ring.h"
 
 namespace graphics_sandbox
 {
@@ -33,6 +41,31 @@ namespace graphics_sandbox
         {
             GraphicsDevice create_graphics_device(bool enableDebug = false, uint32_t preferred_adapter = UINT32_MAX, bool stable_power_state = false);
             void destroy_graphics_device(GraphicsDevice graphicsDevice);
+
+            // Compute shaders created after this call skip the compilation if their bytecode is in the cache (nullptr disables it)
+            void set_shader_cache(GraphicsDevice graphicsDevice, ShaderCache* shaderCache);
+
+            // Pipeline state objects created after this call are stored in a driver pipeline library backed by the file, which is
+            // written when the device is destroyed. Returns true if the file was produced by the same adapter and driver and its
+            // pipelines are reused, otherwise the library starts empty.
+            bool set_pipeline_library(GraphicsDevice graphicsDevice, const char* path);
+
+            // Compute shaders created after this call are compiled with the parameters tuned for this adapter, if the cache (owned by the
+            // application) has them. The adapter id identifies the adapter and its driver in the cache.
+            void set_autotune_cache(GraphicsDevice graphicsDevice, AutotuneCache* autotuneCache);
+            uint64_t get_adapter_id(GraphicsDevice graphicsDevice);
+
+            // Compute shaders created after this call are recompiled in the background when their source or one of its includes changes.
+            // The new kernels are only swapped in by apply_hot_reloads, which must be called once every recorded command buffer has been
+            // submitted (typically between two frames). The previous pipelines are released once the queues are done with them and a
+            // kernel whose bindings changed keeps its current version.
+            void enable_hot_reload(GraphicsDevice graphicsDevice);
+            void apply_hot_reloads(GraphicsDevice graphicsDevice);
+
+            // Buffers, render textures and compute shaders can be destroyed from any thread while the GPU still uses them, they are released
+            // once every queue has executed what was submitted before their destruction. Each submission collects the objects its queue was
+            // the last one to wait for, this call collects for every queue and returns how many objects were released.
+            uint32_t collect_garbage(GraphicsDevice graphicsDevice);
         }
 
         // Command Queue API
@@ -42,9 +75,33 @@ namespace graphics_sandbox
             CommandQueue create_command_queue(GraphicsDevice graphicsDevice);
             void destroy_command_queue(CommandQueue commandQueue);
 
-            // Operation
-            void execute_command_buffer(CommandQueue commandQueue, CommandBuffer commandBuffer);
+            // Operation, the returned point is reached once the command buffer has been executed
+            uint64_t execute_command_buffer(CommandQueue commandQueue, CommandBuffer commandBuffer);
             void flush(CommandQueue commandQueue);
+
+            // Timeline, the timeouts are in milliseconds
+            bool is_complete(CommandQueue commandQueue, uint64_t point);
+            bool wait(CommandQueue commandQueue, uint64_t point, uint64_t timeoutMS = TIMELINE_WAIT_INFINITE);
+            uint32_t wait_any(const CommandQueue* commandQueues, const uint64_t* points, uint32_t count, uint64_t timeoutMS = TIMELINE_WAIT_INFINITE);
+            bool wait_all(const CommandQueue* commandQueues, const uint64_t* points, uint32_t count, uint64_t timeoutMS = TIMELINE_WAIT_INFINITE);
+            void add_completion_callback(CommandQueue commandQueue, uint64_t point, TimelineCallback callback, void* userData);
+
+            // Fence signaled with the timeline points
+            Fence get_fence(CommandQueue commandQueue);
+
+            // Persistently mapped upload memory owned by the queue, for constant data and small uploads. An allocation can be read by the
+            // command buffers executed on the queue before the next end_upload_frame, which returns the point after which its memory is
+            // reused. Waits for the oldest frame if the ring is full.
+            UploadAllocation allocate_upload(CommandQueue commandQueue, uint64_t size, uint64_t alignment = 256);
+            uint64_t end_upload_frame(CommandQueue commandQueue);
+
+            // Asynchronous readbacks: the range of the buffer is copied by the command buffer into the queue's staging memory, which has to
+            // be executed on this queue. The returned ticket (0 if the staging memory is full) can be polled, or the callback runs on the
+            // timeline's worker once the bytes are available. Only the range of the ticket is mapped, it stays readable until released.
+            uint64_t request_readback(CommandQueue commandQueue, CommandBuffer commandBuffer, GraphicsBuffer graphicsBuffer, uint64_t offset, uint64_t size, ReadbackCallback callback = nullptr, void* userData = nullptr);
+            ReadbackStatus readback_status(CommandQueue commandQueue, uint64_t ticket);
+            const char* map_readback(CommandQueue commandQueue, uint64_t ticket, uint64_t& size);
+            void release_readback(CommandQueue commandQueue, uint64_t ticket);
         }
 
         // Swap Chain API
@@ -54,9 +111,9 @@ namespace graphics_sandbox
             SwapChain create_swap_chain(RenderWindow window, GraphicsDevice graphicsDevice, CommandQueue commandQueue);
             void destroy_swap_chain(SwapChain swapChain);
 
-            // Operations
+            // Operations, present doesn't wait and returns the point reached once the frame is done
             RenderTexture get_current_render_texture(SwapChain swapChain);
-            void present(SwapChain swapChain, CommandQueue commandQueue);
+            uint64_t present(SwapChain swapChain, CommandQueue commandQueue);
         }
 
         // Fence API
@@ -72,7 +129,8 @@ namespace graphics_sandbox
             void wait_for_fence_value(Fence fence, uint64_t fenceValue, FenceEvent fenceEvent, uint64_t maxTime);
         }
 
-        // Command Buffer API
+        // Command Buffer API, different command buffers of a device can be recorded and executed from different threads (a command buffer
+        // itself is only used by one thread at a time)
         namespace command_buffer
         {
             // Creation and Destruction
@@ -87,12 +145,25 @@ namespace graphics_sandbox
             void render_texture_present(CommandBuffer commandBuffer, RenderTexture renderTexture);
             void copy_graphics_buffer(CommandBuffer commandBuffer, GraphicsBuffer inputBuffer, GraphicsBuffer outputBuffer);
             void copy_constant_buffer(CommandBuffer commandBuffer, ConstantBuffer inputBuffer, ConstantBuffer outputBuffer);
+            // Copy a part of a buffer into another one (constant buffers can be passed as graphics buffers). The batched version merges the
+            // regions that are contiguous in both buffers, the regions must not write the same bytes from different sources.
+            void copy_buffer_region(CommandBuffer commandBuffer, GraphicsBuffer inputBuffer, uint64_t inputOffset, GraphicsBuffer outputBuffer, uint64_t outputOffset, uint64_t size);
+            void copy_buffer_regions(CommandBuffer commandBuffer, GraphicsBuffer inputBuffer, GraphicsBuffer outputBuffer, const BufferCopyRegion* regions, uint32_t numRegions);
             void uav_barrier(CommandBuffer commandBuffer, GraphicsBuffer targetBuffer);
 
             // Compute operations
             void set_compute_graphics_buffer_uav(CommandBuffer commandBuffer, ComputeShader computeShader, uint32_t slot, GraphicsBuffer graphicsBuffer);
             void set_compute_graphics_buffer_srv(CommandBuffer commandBuffer, ComputeShader computeShader, uint32_t slot, GraphicsBuffer graphicsBuffer);
             void set_compute_graphics_buffer_cbv(CommandBuffer commandBuffer, ComputeShader computeShader, uint32_t slot, ConstantBuffer constantBuffer);
+            // Bind a slice of the buffer (in elements of the buffer, in bytes for the CBV whose offset must be 256 aligned). The view of
+            // each range is created the first time it is bound, a buffer keeps the views of its 64 most recently bound ranges on top of
+            // the ones a slot still points to.
+            void set_compute_graphics_buffer_uav_range(CommandBuffer commandBuffer, ComputeShader computeShader, uint32_t slot, GraphicsBuffer graphicsBuffer, uint64_t firstElement, uint64_t numElements);
+            void set_compute_graphics_buffer_srv_range(CommandBuffer commandBuffer, ComputeShader computeShader, uint32_t slot, GraphicsBuffer graphicsBuffer, uint64_t firstElement, uint64_t numElements);
+            void set_compute_graphics_buffer_cbv_range(CommandBuffer commandBuffer, ComputeShader computeShader, uint32_t slot, ConstantBuffer constantBuffer, uint64_t byteOffset, uint64_t size);
+            void set_compute_constants(CommandBuffer commandBuffer, ComputeShader computeShader, uint32_t slot, const void* data, uint32_t size);
+            void set_compute_cbv_address(CommandBuffer commandBuffer, ComputeShader computeShader, uint32_t slot, ConstantBuffer constantBuffer, uint64_t offset = 0);
+            void set_compute_cbv_upload(CommandBuffer commandBuffer, ComputeShader computeShader, uint32_t slot, const UploadAllocation& allocation);
             void dispatch(CommandBuffer commandBuffer, ComputeShader computeShader, uint32_t sizeX, uint32_t sizeY, uint32_t sizeZ);
             
             // Profiling
@@ -129,6 +200,27 @@ namespace graphics_sandbox
         {
             ComputeShader create_compute_shader(GraphicsDevice graphicsDevice, const ComputeShaderDescriptor& computeShaderDescriptor);
             void destroy_compute_shader(ComputeShader computeShader);
+
+            // Returns the handles right away, the compilations and pipeline creations run in parallel in the background.
+            // Binding or dispatching a shader that is not ready waits for it.
+            void create_compute_shaders_async(GraphicsDevice graphicsDevice, const ComputeShaderDescriptor* computeShaderDescriptors, uint32_t count, ComputeShader* computeShaders);
+            bool is_ready(ComputeShader computeShader);
+            void wait(ComputeShader computeShader);
+
+            // Variants of a kernel specialized with preprocessor defines, each one is compiled the first time it is requested and owned
+            // by the set
+            PermutationSet* create_permutation_set(GraphicsDevice graphicsDevice, const ComputeShaderDescriptor& baseDescriptor);
+            void destroy_permutation_set(PermutationSet* permutationSet);
+            ComputeShader get_permutation(PermutationSet* permutationSet, const bento::Vector<bento::DynamicString>& defines);
+
+            // What the compiler reported about the kernel, it can be serialized with shader_reflection::serialize
+            const ShaderReflection& get_reflection(ComputeShader computeShader);
+
+            // Compiles the kernel for every candidate of the space and times the workload recorded by the callback on the queue (numSamples
+            // times after a warm up run). The winner is stored in the device's autotune cache, if the cache already has a winner for this
+            // space nothing is measured and result.numMeasured is 0. Returns false if no candidate compiled.
+            bool autotune(GraphicsDevice graphicsDevice, CommandQueue commandQueue, const ComputeShaderDescriptor& computeShaderDescriptor, const AutotuneSpace& space,
+                AutotuneRecordFunction recordFunction, void* userData, uint32_t numSamples, AutotuneResult& result);
         }
 
         namespace profiling_scope
@@ -8,6 +8,31 @@
 #include "gpu_backend/graphics_format.h"
 #include "gpu_backend/graphics_buffer_type.h"
 #include "gpu_backend/render_target_descriptor.h"
+#include "gpu_backend/resource_barrier_batch.h"
+#include "gpu_backend/descriptor_ring.h"
+#include "gpu_backend/descriptor_copy_batch.h"
+#include "gpu_backend/shadow_state_tracker.h"
+#include "gpu_backend/command_allocator_pool.h"
+#include "gpu_backend/shader_cache.h"
+#include "gpu_backend/compute_shader_descriptor.h"
+#include "gpu_backend/shader_reflection.h"
+#include "gpu_backend/object_cache.h"
+#include "gpu_backend/pipeline_library_file.h"
+#include "gpu_backend/hot_reload.h"
+#include "gpu_backend/dispatch_autotuner.h"
+#include "gpu_backend/tlsf_allocator.h"
+#include "gpu_backend/upload_ring.h"
+#include "gpu_backend/deferred_destruction.h"
+#include "gpu_backend/handle_table.h"
+#include "gpu_backend/buffer_view_cache.h"
+#include "gpu_backend/buffer_copy_list.h"
+#include "gpu_backend/readback_ring.h"
+#include "tools/index_allocator.h"
+#include "tools/timeline.h"
+#include "tools/job_batch.h"
+#include "tools/work_stealing_pool.h"
+#include "tools/mapped_file.h"
+#include "tools/file_watcher.h"
 
 // DX12 includes
 #include <d3d12.h>
@@ -15,6 +40,10 @@
 #include <d3dcompiler.h>
 #include <dxcapi.h>
 
+// System includes
+#include <atomic>
+#include <mutex>
+
 namespace graphics_sandbox
 {
 	namespace d3d12
@@ -22,9 +51,25 @@ namespace graphics_sandbox
 		// Global DX12 Constants
 		#define DX12_NUM_BACK_BUFFERS 2
 		#define DX12_CONSTANT_BUFFER_ALIGNEMENT_SIZE 256
+		#define DX12_DESCRIPTOR_RING_SIZE 262144
+		#define DX12_BINDLESS_HEAP_SIZE 65536
+		#define DX12_BUFFER_VIEW_COUNT 3
+		#define DX12_MAX_ROOT_SIGNATURE_SIZE 64
+		#define DX12_MAX_COMMAND_ALLOCATORS 16
+		#define DX12_HEAP_BLOCK_SIZE (64ull << 20)
+		#define DX12_PLACED_RESOURCE_MAX_SIZE (16ull << 20)
+		#define DX12_UPLOAD_RING_SIZE (32ull << 20)
+		#define DX12_READBACK_RING_SIZE (32ull << 20)
+		#define DX12_MAX_GRAPHICS_BUFFERS 65536
+		#define DX12_MAX_RENDER_TEXTURES 4096
+		#define DX12_RANGE_VIEW_HEAP_SIZE 65536
+		#define DX12_MAX_RANGE_VIEWS_PER_BUFFER 64
 
 		// Declarations
 		struct DX12Query;
+		struct DX12ShaderBatch;
+		struct DX12CommandQueue;
+		struct DX12HeapBlock;
 
 		struct DX12Window
 		{
@@ -35,40 +80,266 @@ namespace graphics_sandbox
 
 		struct DX12GraphicsDevice
 		{
+			ALLOCATOR_BASED;
+
+			DX12GraphicsDevice(bento::IAllocator& allocator)
+			: _allocator(allocator)
+			, device(nullptr)
+			, debugLayer(nullptr)
+			, resourceHeap(nullptr)
+			, bindlessIndices(allocator)
+			, bufferViewHeap(nullptr)
+			, bufferViewBlocks(allocator)
+			, rangeViewHeap(nullptr)
+			, rangeViewIndices(allocator)
+			, descriptorRing(allocator)
+			, descriptorRingEvent(nullptr)
+			, commandAllocators(allocator)
+			, commandAllocatorEvent(nullptr)
+			, nextRecording(0)
+			, shaderCache(nullptr)
+			, compilerVersion(0)
+			, rootSignatures(nullptr)
+			, pipelineStates(nullptr)
+			, pipelineLibrary(nullptr)
+			, pipelineLibraryFile(nullptr)
+			, pipelineLibraryPath(allocator)
+			, pipelineLibraryDirty(false)
+			, hotReloader(nullptr)
+			, fileWatcher(nullptr)
+			, queues(allocator)
+			, autotuneCache(nullptr)
+			, adapterId(0)
+			, resourceHeapTier(D3D12_RESOURCE_HEAP_TIER_1)
+			, heapBlocks(allocator)
+			, garbage(nullptr)
+			, workerPool(nullptr)
+			{
+			}
+
 			ID3D12Device2* device;
 			ID3D12Debug* debugLayer;
 			uint32_t descriptorSize[D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES];
+
+			// Shader visible heap shared by all the dispatches. The first DX12_BINDLESS_HEAP_SIZE descriptors hold the views bound to bindless
+			// shaders at a stable index, the rest is the ring where every non bindless dispatch copies its table.
+			ID3D12DescriptorHeap* resourceHeap;
+			D3D12_CPU_DESCRIPTOR_HANDLE bindlessCPU;
+			IndexAllocator bindlessIndices;
+			// Guards the lazy creation of the bindless indices of the buffers
+			std::mutex bindlessLock;
+
+			// Non shader visible heap holding the default views of every buffer, a buffer's srv, uav and cbv are a block of
+			// DX12_BUFFER_VIEW_COUNT contiguous descriptors
+			ID3D12DescriptorHeap* bufferViewHeap;
+			D3D12_CPU_DESCRIPTOR_HANDLE bufferViewCPU;
+			IndexAllocator bufferViewBlocks;
+
+			// Non shader visible heap holding the views of buffer sub-ranges, the ones bound to bindless shaders also get a bindless index
+			ID3D12DescriptorHeap* rangeViewHeap;
+			D3D12_CPU_DESCRIPTOR_HANDLE rangeViewCPU;
+			IndexAllocator rangeViewIndices;
+			// Guards the range view caches of the buffers
+			std::mutex rangeViewLock;
+			D3D12_CPU_DESCRIPTOR_HANDLE descriptorRingCPU;
+			D3D12_GPU_DESCRIPTOR_HANDLE descriptorRingGPU;
+			DescriptorRing descriptorRing;
+			HANDLE descriptorRingEvent;
+			// Command buffers are recorded and submitted from any thread, guards the ring and its event
+			std::mutex descriptorRingLock;
+
+			// Command allocators are only recycled once the GPU has executed their commands
+			CommandAllocatorPool commandAllocators;
+			HANDLE commandAllocatorEvent;
+			std::mutex commandAllocatorLock;
+
+			// Identifier given to the next command buffer recording
+			std::atomic<uint64_t> nextRecording;
+
+			// Optional bytecode cache (owned by the application) and version of the compiler, queried on the first lookup
+			ShaderCache* shaderCache;
+			uint64_t compilerVersion;
+
+			// Root signatures and pipeline state objects shared by the compute shaders
+			ObjectCache* rootSignatures;
+			ObjectCache* pipelineStates;
+
+			// Optional driver side cache of the pipeline state objects, it reads the previous run's pipelines straight from the
+			// mapped file and is written back when the device is destroyed
+			PipelineLibraryIdentity adapterIdentity;
+			ID3D12PipelineLibrary* pipelineLibrary;
+			MappedFile* pipelineLibraryFile;
+			bento::DynamicString pipelineLibraryPath;
+			std::atomic<bool> pipelineLibraryDirty;
+
+			// Optional hot reload of the compute shaders, the pipelines that were swapped out wait for every queue's fence
+			HotReloader* hotReloader;
+			FileWatcher* fileWatcher;
+			bento::Vector<DX12CommandQueue*> queues;
+			std::mutex queuesLock;
+
+			// Optional winners of the dispatch autotuner (owned by the application), looked up with the hash of the adapter identity
+			AutotuneCache* autotuneCache;
+			uint64_t adapterId;
+
+			// Heaps the resources are placed in, grouped by heap type and flags (tier 1 heaps only hold buffers or textures)
+			D3D12_RESOURCE_HEAP_TIER resourceHeapTier;
+			bento::Vector<DX12HeapBlock*> heapBlocks;
+			std::mutex heapLock;
+
+			// Objects destroyed by the application, released once every queue has executed what was submitted before their destruction
+			DeferredDestructionQueue* garbage;
+
+			// Threads that compile the shaders in the background and help the calling thread with the large uploads
+			WorkStealingPool* workerPool;
+			bento::IAllocator& _allocator;
 		};
 
 		struct DX12CommandQueue
 		{
+			ALLOCATOR_BASED;
+
+			DX12CommandQueue(bento::IAllocator& allocator)
+			: _allocator(allocator)
+			, deviceI(nullptr)
+			, queue(nullptr)
+			, fence(nullptr)
+			, timeline(nullptr)
+			, fenceEvent(nullptr)
+			, uploadBuffer(nullptr)
+			, uploadCPU(nullptr)
+			, uploadGPU(0)
+			, uploadRing(allocator)
+			, readbackBuffer(0)
+			, readbackCPU(nullptr)
+			, readbackRing(allocator)
+			{
+			}
+
+			DX12GraphicsDevice* deviceI;
 			ID3D12CommandQueue* queue;
 			ID3D12Fence* fence;
+
+			// The fence is signaled with the timeline points, the event is only used by the timeline's worker
+			Timeline* timeline;
 			HANDLE fenceEvent;
-			uint64_t fenceValue;
+
+			// Executing a command list, taking its point and signaling it is a single step: the fence never goes backwards and the last
+			// submitted point never misses a list that is already executing
+			std::mutex submitLock;
+
+			// Upload heap mapped for the lifetime of the queue, its frames are tagged with timeline points
+			ID3D12Resource* uploadBuffer;
+			char* uploadCPU;
+			uint64_t uploadGPU;
+			UploadRing uploadRing;
+			std::mutex uploadLock;
+
+			// Readback buffer the requested ranges are copied into, each range is only mapped when the application reads it
+			GraphicsBuffer readbackBuffer;
+			char* readbackCPU;
+			ReadbackRing readbackRing;
+			std::mutex readbackLock;
+			bento::IAllocator& _allocator;
 		};
 
 		struct DX12CommandBuffer
 		{
+			ALLOCATOR_BASED;
+
+			DX12CommandBuffer(bento::IAllocator& allocator)
+			: _allocator(allocator)
+			, deviceI(nullptr)
+			, cmdAlloc(nullptr)
+			, cmdList(nullptr)
+			, recording(0)
+			, barrierBatch(allocator)
+			, barrierArray(allocator)
+			, descriptorCopies(allocator)
+			, copyRegions(allocator)
+			{
+			}
+
 			DX12GraphicsDevice* deviceI;
+			// Allocator of the current recording, it goes back to the device's pool when the command buffer is reset
 			ID3D12CommandAllocator* cmdAlloc;
 			ID3D12GraphicsCommandList* cmdList;
-			uint32_t batchIdentifier;
+
+			// Identifier of the current recording and mirror of the state bound on the command list
+			uint64_t recording;
+			ShadowStateTracker shadowState;
+
+			// Barriers waiting for the next command that touches the GPU
+			ResourceBarrierBatch barrierBatch;
+			bento::Vector<D3D12_RESOURCE_BARRIER> barrierArray;
+
+			// Source ranges of the descriptor table copied by the current dispatch
+			DescriptorCopyBatch descriptorCopies;
+
+			// Scratch storage of the batched buffer copies
+			bento::Vector<BufferCopyRegion> copyRegions;
+			bento::IAllocator& _allocator;
+		};
+
+		// Heap resources are placed in, the offsets are handed out by its allocator
+		struct DX12HeapBlock
+		{
+			ALLOCATOR_BASED;
+
+			DX12HeapBlock(bento::IAllocator& allocator)
+			: _allocator(allocator)
+			, deviceI(nullptr)
+			, heap(nullptr)
+			, heapType(D3D12_HEAP_TYPE_DEFAULT)
+			, heapFlags(D3D12_HEAP_FLAG_NONE)
+			, offsets(allocator)
+			{
+			}
+
+			DX12GraphicsDevice* deviceI;
+			ID3D12Heap* heap;
+			D3D12_HEAP_TYPE heapType;
+			D3D12_HEAP_FLAGS heapFlags;
+			TlsfAllocator offsets;
+			bento::IAllocator& _allocator;
 		};
 
+		// Part of a render texture read when commands are recorded
 		struct DX12RenderTexture
 		{
 			// Actual resource
 			ID3D12Resource* resource;
 			D3D12_RESOURCE_STATES state;
 
-			// Descriptor heap and offset (for the view)
+			// Render target view (or depth stencil or unordered access view)
+			D3D12_CPU_DESCRIPTOR_HANDLE rtvCPU;
+
+			// Placed textures start with whatever the heap held, the first command buffer that uses one discards it first
+			bool needsDiscard;
+		};
+
+		// Part of a render texture only used to create and destroy it
+		struct DX12RenderTextureCold
+		{
+			// Device that created the texture
+			DX12GraphicsDevice* deviceI;
+
+			// Heap block and allocation the resource is placed at (nullptr for committed resources)
+			DX12HeapBlock* heapBlock;
+			uint32_t heapAllocation;
+
+			// Descriptor heap of the view, tells us if the heap is owned by the rendertarget or not
 			ID3D12DescriptorHeap* descriptorHeap;
-			uint32_t heapOffset;
-			// Tells us if the heap is owned by the rendertarget or not
 			bool rtOwned;
 		};
 
+		// Contents of a destroyed render texture waiting for the submissions that may still render to it, its handle is already freed
+		struct DX12ReleasedRenderTexture
+		{
+			DX12RenderTexture texture;
+			DX12RenderTextureCold cold;
+		};
+
 		struct DX12SwapChain
 		{
 			// Swap chain
@@ -79,22 +350,21 @@ namespace graphics_sandbox
 			ID3D12DescriptorHeap* descriptorHeap;
 
 			// Back Buffers
-			DX12RenderTexture backBufferRenderTexture[DX12_NUM_BACK_BUFFERS];
+			RenderTexture backBufferRenderTexture[DX12_NUM_BACK_BUFFERS];
 		};
 
-		struct DX12DescriptorHeap
+		struct DX12RootConstantRange
 		{
-			ID3D12DescriptorHeap* descriptorHeap;
-
-			// GPU Handles for every resource type
-			D3D12_GPU_DESCRIPTOR_HANDLE srvGPU;
-			D3D12_GPU_DESCRIPTOR_HANDLE uavGPU;
-			D3D12_GPU_DESCRIPTOR_HANDLE cbvGPU;
+			uint32_t rootIndex;
+			uint32_t offset;
+			uint32_t count;
+		};
 
-			// CPU Handles for every resource type
-			D3D12_CPU_DESCRIPTOR_HANDLE srvCPU;
-			D3D12_CPU_DESCRIPTOR_HANDLE uavCPU;
-			D3D12_CPU_DESCRIPTOR_HANDLE cbvCPU;
+		// Range view a slot points to, its view is pinned in the cache of the buffer until the slot binds something else
+		struct DX12BoundRange
+		{
+			GraphicsBuffer buffer;
+			uint64_t key;
 		};
 
 		struct DX12ComputeShader
@@ -113,9 +383,20 @@ namespace graphics_sandbox
 			, srvIndex(0)
 			, uavIndex(0)
 			, cbvIndex(0)
-			, cmdBatchIndex(0)
-			, nextUsableHeap(0)
-			, descriptorHeaps(allocator)
+			, boundDescriptors(allocator)
+			, tableRecording(UINT64_MAX)
+			, tableGPU(0)
+			, bindless(false)
+			, bindlessIndices(allocator)
+			, boundRanges(allocator)
+			, rootConstantRanges(allocator)
+			, rootConstantData(allocator)
+			, rootCbvIndex(UINT32_MAX)
+			, rootCbvAddresses(allocator)
+			, reflection(allocator)
+			, batch(nullptr)
+			, batchIndex(0)
+			, reloadDescriptor(nullptr)
 			{
 			}
 
@@ -125,6 +406,10 @@ namespace graphics_sandbox
 			ID3D12RootSignature* rootSignature;
 			ID3D12PipelineState* pipelineStateObject;
 
+			// Keys of the shared API objects in the device's caches
+			Hash128 rootSignatureKey;
+			Hash128 pipelineKey;
+
 			// Number of resources
 			uint32_t srvCount;
 			uint32_t uavCount;
@@ -135,21 +420,149 @@ namespace graphics_sandbox
 			uint32_t uavIndex;
 			uint32_t cbvIndex;
 
-			// Set of descriptor heaps that can be used for this
-			uint32_t cmdBatchIndex;
-			uint32_t nextUsableHeap;
-			bento::Vector<DX12DescriptorHeap> descriptorHeaps;
+			// CPU handles of the views bound to every slot (srv, uav then cbv), copied in the descriptor ring at dispatch time
+			bento::Vector<uint64_t> boundDescriptors;
+
+			// Last table copied for these views, it can be reused by the dispatches of the same recording while no view changes
+			uint64_t tableRecording;
+			uint64_t tableGPU;
+
+			// Bindless shaders receive the heap index of every slot as root constants instead
+			bool bindless;
+			bento::Vector<uint32_t> bindlessIndices;
+
+			// Slots bound to a range view (0 for the others)
+			bento::Vector<DX12BoundRange> boundRanges;
+
+			// Root parameters set at dispatch time, the root CBVs use consecutive root indices
+			bento::Vector<DX12RootConstantRange> rootConstantRanges;
+			bento::Vector<uint32_t> rootConstantData;
+			uint32_t rootCbvIndex;
+			bento::Vector<uint64_t> rootCbvAddresses;
+
+			// Bindings and thread group size declared by the kernel
+			ShaderReflection reflection;
+
+			// Asynchronous creation that the shader is part of (nullptr once it has been waited on)
+			DX12ShaderBatch* batch;
+			uint32_t batchIndex;
+
+			// Descriptor the shader is recompiled from when one of its files changes (nullptr if hot reload is disabled)
+			ComputeShaderDescriptor* reloadDescriptor;
+			bento::IAllocator& _allocator;
+		};
+
+		// Kernel recompiled by the hot reloader, waiting to be swapped in (or swapped out and waiting for the GPU)
+		struct DX12ShaderVersion
+		{
+			ALLOCATOR_BASED;
+
+			DX12ShaderVersion(bento::IAllocator& allocator)
+			: _allocator(allocator)
+			, shaderBlob(nullptr)
+			, pipelineStateObject(nullptr)
+			, reflection(allocator)
+			{
+			}
+
+			IDxcBlob* shaderBlob;
+			ID3D12PipelineState* pipelineStateObject;
+			Hash128 pipelineKey;
+			ShaderReflection reflection;
+			bento::IAllocator& _allocator;
+		};
+
+		// Shaders created by a single create_compute_shaders_async call, released when the last one has been waited on
+		struct DX12ShaderBatch
+		{
+			ALLOCATOR_BASED;
+
+			DX12ShaderBatch(bento::IAllocator& allocator)
+			: _allocator(allocator)
+			, deviceI(nullptr)
+			, jobs(nullptr)
+			, descriptors(allocator)
+			, shaders(allocator)
+			, pendingShaders(0)
+			{
+			}
+
+			DX12GraphicsDevice* deviceI;
+			JobBatch* jobs;
+			bento::Vector<ComputeShaderDescriptor*> descriptors;
+			bento::Vector<DX12ComputeShader*> shaders;
+			std::atomic<uint32_t> pendingShaders;
 			bento::IAllocator& _allocator;
 		};
 
+		// Part of a buffer read by the binds and copies, it fits in a cache line with the generation of its slot
 		struct DX12GraphicsBuffer
 		{
 			ID3D12Resource* resource;
-			D3D12_RESOURCE_STATES state;
 			uint64_t bufferSize;
-			uint32_t elementSize;
+
+			// Default views of the buffer, copied by the binds. The handles of the views that can't exist for this buffer type are null.
+			D3D12_CPU_DESCRIPTOR_HANDLE srvCPU;
+			D3D12_CPU_DESCRIPTOR_HANDLE uavCPU;
+			D3D12_CPU_DESCRIPTOR_HANDLE cbvCPU;
+			D3D12_RESOURCE_STATES state;
 			GraphicsBufferType type;
+
+			// Index of the views in the bindless part of the resource heap, only allocated the first time a bindless shader binds the view
+			// (UINT32_MAX until then)
+			uint32_t bindlessSRV;
+			uint32_t bindlessUAV;
+			uint32_t bindlessCBV;
+		};
+
+		// Part of a buffer only used to create, fill and destroy it
+		struct DX12GraphicsBufferCold
+		{
+			DX12GraphicsDevice* deviceI;
+
+			// Heap block and allocation the resource is placed at (nullptr for committed resources)
+			DX12HeapBlock* heapBlock;
+			uint32_t heapAllocation;
+			uint32_t elementSize;
+
+			// Upload buffers stay mapped for their whole lifetime (nullptr for the other types)
+			char* mappedData;
+
+			// Block of the device's buffer view heap holding the default views of the buffer (UINT32_MAX for readback buffers)
+			uint32_t viewBlock;
+
+			// Views of the last DX12_MAX_RANGE_VIEWS_PER_BUFFER sub-ranges bound and of the ones a slot still points to (nullptr until the
+			// first one), the device's range view and bindless indices are packed in the low and high 32 bits (UINT32_MAX until a bindless shader binds the range)
+			BufferViewCache* rangeViews;
+		};
+
+		// Contents of a destroyed buffer waiting for the submissions that may still access it, its handle is already freed
+		struct DX12ReleasedBuffer
+		{
+			DX12GraphicsBuffer buffer;
+			DX12GraphicsBufferCold cold;
+		};
+
+		// Storage of the buffers and render textures, their handles index it. It is shared by every device (a handle doesn't tell which
+		// device created it), created with the first device and released with the last one.
+		struct DX12HandleTables
+		{
+			ALLOCATOR_BASED;
+
+			DX12HandleTables(bento::IAllocator& allocator)
+			: _allocator(allocator)
+			, buffers(allocator)
+			, renderTextures(allocator)
+			, numDevices(0)
+			{
+			}
+
+			HandleTable<DX12GraphicsBuffer, DX12GraphicsBufferCold> buffers;
+			HandleTable<DX12RenderTexture, DX12RenderTextureCold> renderTextures;
+			uint32_t numDevices;
+			bento::IAllocator& _allocator;
 		};
+		extern DX12HandleTables* handleTables;
 
 		struct DX12Query
 		{
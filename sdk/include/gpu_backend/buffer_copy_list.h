@@ -0,0 +1,29 @@
+#pragma once
+
+// Bento includes
+#include <bento_collection/vector.h>
+
+namespace graphics_sandbox
+{
+	// Bytes copied from one buffer to another
+	struct BufferCopyRegion
+	{
+		uint64_t srcOffset;
+		uint64_t dstOffset;
+		uint64_t size;
+	};
+
+	namespace buffer_copy_list
+	{
+		// The region must fit in both buffers, empty regions are valid (and skipped)
+		bool validate_region(uint64_t srcSize, uint64_t dstSize, const BufferCopyRegion& region);
+
+		// Sorts the regions by destination, drops the empty ones and merges the ones that are contiguous (or overlap) in both buffers,
+		// so that the backend emits one copy per merged range. Returns false if two regions write the same bytes from different
+		// sources, the result would depend on the order of the copies.
+		bool coalesce(bento::Vector<BufferCopyRegion>& regions);
+
+		// Total number of bytes copied by the regions
+		uint64_t num_bytes(const bento::Vector<BufferCopyRegion>& regions);
+	}
+}
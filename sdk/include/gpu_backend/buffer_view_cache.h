@@ -0,0 +1,60 @@
+#pragma once
+
+// Bento includes
+#include <bento_memory/common.h>
+#include <bento_collection/vector.h>
+
+namespace graphics_sandbox
+{
+	// Alignment of the offset and size of a constant buffer view
+	#define BUFFER_VIEW_CBV_ALIGNMENT 256
+
+	enum class BufferViewType
+	{
+		SRV,
+		UAV,
+		CBV,
+		Count
+	};
+
+	// Opaque cache structure
+	struct BufferViewCache;
+
+	// Views of sub-ranges of a single buffer (the backend's descriptors packed in a uint64_t), created the first time a range is bound.
+	// The cache holds at most capacity unpinned views, a range that misses a full cache evicts the least recently bound unpinned one.
+	// Views that are still bound to a slot are pinned so that they are never recycled under it, the cache grows past its capacity when
+	// everything is pinned. It is not thread safe, the backend guards it.
+	namespace buffer_view_cache
+	{
+		BufferViewCache* create_cache(bento::IAllocator& allocator, uint32_t capacity);
+		// The caller has to destroy the views first
+		void destroy_cache(BufferViewCache* cache);
+
+		// Element ranges of SRVs and UAVs must be non empty and fit in the buffer. CBV ranges are in bytes, the offset must be aligned and
+		// the size is rounded up to the alignment, which must still fit in the buffer.
+		bool validate_element_range(uint64_t bufferSize, uint32_t elementSize, uint64_t firstElement, uint64_t numElements);
+		bool validate_cbv_range(uint64_t bufferSize, uint64_t byteOffset, uint64_t size);
+		uint64_t aligned_cbv_size(uint64_t size);
+
+		// Identifies a range of a view type, CBV ranges are given in bytes
+		uint64_t view_key(BufferViewType type, uint64_t first, uint64_t count);
+
+		// Returns true if the range already has a view, which becomes the most recently used one
+		bool lookup(BufferViewCache* cache, uint64_t key, uint64_t& view);
+
+		// Adds the view of a range that isn't in the cache. Returns true if the cache was full, the view of the least recently used range
+		// that isn't pinned was evicted and the caller has to destroy it once the GPU is done with it.
+		bool insert(BufferViewCache* cache, uint64_t key, uint64_t view, uint64_t& evictedView);
+
+		// A pinned range can't be evicted, pins are counted
+		void pin(BufferViewCache* cache, uint64_t key);
+		void unpin(BufferViewCache* cache, uint64_t key);
+
+		// Replaces the view of a range that is in the cache
+		void update(BufferViewCache* cache, uint64_t key, uint64_t view);
+
+		// Every view of the cache
+		void views(BufferViewCache* cache, bento::Vector<uint64_t>& views);
+		uint32_t size(BufferViewCache* cache);
+	}
+}
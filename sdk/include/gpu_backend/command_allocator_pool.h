@@ -0,0 +1,59 @@
+#pragma once
+
+// Bento includes
+#include <bento_collection/vector.h>
+
+namespace graphics_sandbox
+{
+	// Allocator whose commands have been submitted, it can only be recycled once its owner let it go and the fence value is reached
+	struct CommandAllocatorEntry
+	{
+		uint64_t allocator;
+		uint64_t fence;
+		uint64_t fenceValue;
+		bool released;
+	};
+
+	// Pool of command allocators shared by the command buffers of a device. Backend allocators are opaque, the pool only decides
+	// when they can be reused so that the CPU can record the next frame while the GPU is still executing the previous ones.
+	struct CommandAllocatorPool
+	{
+		ALLOCATOR_BASED;
+		CommandAllocatorPool(bento::IAllocator& allocator);
+
+		// Allocators that can be reset right away
+		bento::Vector<uint64_t> available;
+
+		// Submitted allocators in submission order
+		bento::Vector<CommandAllocatorEntry> inFlight;
+
+		// Statistics
+		uint32_t numAllocators;
+		uint64_t recycled;
+		bento::IAllocator& _allocator;
+	};
+
+	namespace command_allocator_pool
+	{
+		// Returns false if no allocator is available, the caller either creates one (and adds it) or waits on the oldest fence and reclaims
+		bool acquire(CommandAllocatorPool& pool, uint64_t& allocator);
+
+		// Registers an allocator created by the backend, it belongs to the caller until it is released
+		void add(CommandAllocatorPool& pool, uint64_t allocator);
+
+		// Tags the allocator with the fence value that signals the end of the execution of its commands
+		void submit(CommandAllocatorPool& pool, uint64_t allocator, uint64_t fence, uint64_t fenceValue);
+
+		// The owner won't record or submit with this allocator anymore, it is recycled as soon as the GPU is done with it
+		void release(CommandAllocatorPool& pool, uint64_t allocator);
+
+		// Recycles the released allocators submitted on this fence whose value has been reached
+		void reclaim(CommandAllocatorPool& pool, uint64_t fence, uint64_t completedValue);
+
+		// Considers every allocator submitted on a fence that is about to be destroyed as complete, the caller must have flushed it
+		void forget_fence(CommandAllocatorPool& pool, uint64_t fence);
+
+		// Fence value the oldest released allocator is waiting on, returns false if there is none
+		bool oldest_fence(const CommandAllocatorPool& pool, uint64_t& fence, uint64_t& fenceValue);
+	}
+}
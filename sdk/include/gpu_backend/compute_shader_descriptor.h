@@ -13,10 +13,31 @@ namespace graphics_sandbox
         // Internal data
         bento::DynamicString filename;
         bento::DynamicString kernelname;
+
+        // Number of slots of each type (registers 0..N-1 of space0), left to 0 they are derived from the kernel's reflection
         uint32_t uavCount;
         uint32_t srvCount;
         uint32_t cbvCount;
+
+        // Bindless shaders access the buffers through ResourceDescriptorHeap[] and receive one index per slot (srv, uav then cbv)
+        // as root constants in register b0
+        bool bindless;
+
+        // Small per-dispatch parameters that bypass descriptors. Root constant range i holds rootConstantSizes[i] 32-bit values
+        // and is bound to register b<i> of space1, root CBV i is bound to register b<i> of space2. Both are derived from the
+        // reflection when left empty.
+        bento::Vector<uint32_t> rootConstantSizes;
+        uint32_t rootCbvCount;
         bento::Vector<bento::DynamicString> includeDirectories;
+
+        // Preprocessor defines, "NAME" or "NAME=VALUE"
+        bento::Vector<bento::DynamicString> defines;
         bento::IAllocator& _allocator;
     };
+
+    namespace compute_shader_descriptor
+    {
+        // Deep copy, the destination's vectors are appended to
+        void copy(const ComputeShaderDescriptor& source, ComputeShaderDescriptor& destination);
+    }
 }
\ No newline at end of file
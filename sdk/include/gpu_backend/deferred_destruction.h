@@ -0,0 +1,35 @@
+#pragma once
+
+// Bento includes
+#include <bento_memory/common.h>
+
+namespace graphics_sandbox
+{
+	// Maximal number of fences (one per queue) an object can wait for
+	#define DEFERRED_DESTRUCTION_MAX_FENCES 8
+
+	// Releases an object the GPU is done with, called on the thread that collects
+	typedef void (*DeferredReleaseFunction)(uint64_t object, void* userData);
+
+	// Opaque queue structure
+	struct DeferredDestructionQueue;
+
+	// Objects destroyed while the GPU may still use them. Each one waits for the values its fences had when it was destroyed and is
+	// released by the first collection that sees them all reached, in the order they were enqueued.
+	namespace deferred_destruction
+	{
+		DeferredDestructionQueue* create_queue(bento::IAllocator& allocator);
+		// Releases every object left, the caller must have waited for the GPU
+		void destroy_queue(DeferredDestructionQueue* queue);
+
+		// Lock free, can be called from any thread. An object without fences is released by the next collection.
+		void enqueue(DeferredDestructionQueue* queue, uint64_t object, DeferredReleaseFunction releaseFunction, void* userData, const uint64_t* fences, const uint64_t* fenceValues, uint32_t numFences);
+
+		// Releases the objects whose fences have all reached the given values and returns how many were released. A fence that is
+		// about to be destroyed can be collected with UINT64_MAX. Collections are serialized, a release function must not collect.
+		uint32_t collect(DeferredDestructionQueue* queue, const uint64_t* fences, const uint64_t* completedValues, uint32_t numFences);
+
+		// Objects enqueued and not released yet
+		uint32_t num_pending(DeferredDestructionQueue* queue);
+	}
+}
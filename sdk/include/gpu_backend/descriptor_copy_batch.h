@@ -0,0 +1,30 @@
+#pragma once
+
+// Bento includes
+#include <bento_collection/vector.h>
+
+namespace graphics_sandbox
+{
+	// Source ranges of a descriptor table copy. The sources are CPU descriptor handles that were created once with their resource,
+	// the consecutive slots whose sources are also consecutive in memory are merged so that the copy needs as few ranges as possible.
+	struct DescriptorCopyBatch
+	{
+		ALLOCATOR_BASED;
+		DescriptorCopyBatch(bento::IAllocator& allocator);
+
+		// Start handle and size of every source range, in destination order
+		bento::Vector<uint64_t> rangeStarts;
+		bento::Vector<uint32_t> rangeSizes;
+
+		// Statistics
+		uint64_t copiedDescriptors;
+		uint64_t copiedRanges;
+		bento::IAllocator& _allocator;
+	};
+
+	namespace descriptor_copy_batch
+	{
+		// Builds the source ranges for a table of numSlots descriptors and returns the number of ranges, every slot must have been bound
+		uint32_t build(DescriptorCopyBatch& batch, const uint64_t* sources, uint32_t numSlots, uint32_t descriptorSize);
+	}
+}
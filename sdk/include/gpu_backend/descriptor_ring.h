@@ -0,0 +1,69 @@
+#pragma once
+
+// Bento includes
+#include <bento_collection/vector.h>
+
+namespace graphics_sandbox
+{
+	// Contiguous range of the ring allocated by a single owner (a command buffer)
+	struct DescriptorRingSpan
+	{
+		uint32_t offset;
+		uint32_t count;
+		uint64_t owner;
+
+		// Fence that needs to be passed before the span can be reused (only valid once submitted)
+		bool submitted;
+		uint64_t fence;
+		uint64_t fenceValue;
+	};
+
+	// Linear allocator over a fixed size descriptor heap. Owners allocate at the head while recording, tag their spans with a fence value
+	// when they are submitted and the tail moves forward once the GPU has passed those values. The region recorded by a command buffer
+	// between two submissions ends up in a single span.
+	struct DescriptorRing
+	{
+		ALLOCATOR_BASED;
+		DescriptorRing(bento::IAllocator& allocator);
+
+		// Ring state (in descriptors)
+		uint32_t capacity;
+		uint32_t head;
+		uint32_t tail;
+		uint32_t used;
+
+		// Spans in allocation order, the live ones start at firstSpan
+		bento::Vector<DescriptorRingSpan> spans;
+		uint32_t firstSpan;
+
+		// Statistics
+		uint64_t allocations;
+		uint64_t wraps;
+		uint64_t failedAllocations;
+		bento::IAllocator& _allocator;
+	};
+
+	namespace descriptor_ring
+	{
+		void initialize(DescriptorRing& ring, uint32_t capacity);
+
+		// Returns false if there is not enough contiguous space, the caller is expected to wait on the oldest span and reclaim
+		bool allocate(DescriptorRing& ring, uint64_t owner, uint32_t count, uint32_t& offset);
+
+		// Tags every live span of the owner with the fence value that signals the end of its execution, a command buffer that is
+		// executed again moves all its tables to the new value
+		void submit(DescriptorRing& ring, uint64_t owner, uint64_t fence, uint64_t fenceValue);
+
+		// Frees the spans of an owner that will never be submitted (reset or destroyed while recording)
+		void release(DescriptorRing& ring, uint64_t owner);
+
+		// Frees the oldest spans as long as they were submitted on this fence and the value has been reached
+		void reclaim(DescriptorRing& ring, uint64_t fence, uint64_t completedValue);
+
+		// Frees every span submitted on a fence that is about to be destroyed, the caller must have flushed it
+		void forget_fence(DescriptorRing& ring, uint64_t fence);
+
+		// Fence value the oldest span is waiting on, returns false if the oldest span has not been submitted yet
+		bool oldest_fence(const DescriptorRing& ring, uint64_t& fence, uint64_t& fenceValue);
+	}
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+// Bento includes
+#include <bento_collection/vector.h>
+#include <bento_collection/dynamic_string.h>
+
+// SDK includes
+#include "gpu_backend/gpu_types.h"
+#include "gpu_backend/compute_shader_descriptor.h"
+#include "tools/hash.h"
+
+namespace graphics_sandbox
+{
+	// Cache layout (little endian): an AutotuneCacheHeader followed by numEntries records. A record is an AutotuneCacheEntry
+	// followed by numDefines strings, each one a uint32 length and its characters.
+	#define AUTOTUNE_CACHE_MAGIC 0x54415347 // "GSAT"
+	#define AUTOTUNE_CACHE_VERSION 1
+
+	struct AutotuneCacheHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t numEntries;
+		uint32_t reserved;
+	};
+
+	struct AutotuneCacheEntry
+	{
+		uint64_t adapterId;
+		Hash128 kernelKey;
+		Hash128 spaceKey;
+		double duration;
+		uint32_t numDefines;
+		uint32_t reserved;
+	};
+
+	// Parameters that the kernel receives as defines ("NAME=value") and the values to try for each of them, every combination is a candidate
+	struct AutotuneSpace
+	{
+		ALLOCATOR_BASED;
+		AutotuneSpace(bento::IAllocator& allocator);
+
+		bento::Vector<bento::DynamicString> names;
+		bento::Vector<uint32_t> numValues;
+		bento::Vector<uint32_t> values;
+		bento::IAllocator& _allocator;
+	};
+
+	// Winner of a search, its defines and the median of its durations
+	struct AutotuneResult
+	{
+		ALLOCATOR_BASED;
+		AutotuneResult(bento::IAllocator& allocator);
+
+		uint32_t candidate;
+		bento::Vector<bento::DynamicString> defines;
+		double duration;
+		uint32_t numMeasured;
+		bento::IAllocator& _allocator;
+	};
+
+	// Runs a candidate numSamples times and writes the durations (any unit, the same for every candidate). Returns false if the
+	// candidate can't run on this adapter, it is skipped.
+	typedef bool (*AutotuneMeasureFunction)(const bento::Vector<bento::DynamicString>& defines, uint32_t numSamples, double* durations, void* userData);
+
+	// Records the representative workload of a candidate (bindings and dispatches sized from its defines), the backend times it
+	typedef void (*AutotuneRecordFunction)(CommandBuffer commandBuffer, ComputeShader computeShader, const bento::Vector<bento::DynamicString>& defines, void* userData);
+
+	// Opaque cache structure
+	struct AutotuneCache;
+
+	namespace dispatch_autotuner
+	{
+		// Search space
+		void add_parameter(AutotuneSpace& space, const char* name, const uint32_t* values, uint32_t numValues);
+		uint32_t num_candidates(const AutotuneSpace& space);
+		void candidate_defines(const AutotuneSpace& space, uint32_t candidate, bento::Vector<bento::DynamicString>& defines);
+		void space_key(const AutotuneSpace& space, Hash128& key);
+
+		// Identifies a kernel by its source, entry point and defines, the tuned parameters are not part of it
+		void kernel_key(const ComputeShaderDescriptor& descriptor, Hash128& key);
+
+		// Measures every candidate and keeps the one with the lowest median, ties go to the first one. Returns false if no candidate could run.
+		bool search(const AutotuneSpace& space, AutotuneMeasureFunction measureFunction, void* userData, uint32_t numSamples, AutotuneResult& result);
+
+		// Winners by adapter and kernel. Loaded from the file if it exists and is valid, otherwise the cache starts empty. Thread safe.
+		AutotuneCache* create_cache(bento::IAllocator& allocator, const char* path);
+		// Writes the file if anything was stored
+		void destroy_cache(AutotuneCache* cache);
+		bool save(AutotuneCache* cache);
+
+		// Appends the winner's defines, spaceKey (if not null) must match the space the winner was searched in
+		bool lookup(AutotuneCache* cache, uint64_t adapterId, const Hash128& kernelKey, const Hash128* spaceKey, bento::Vector<bento::DynamicString>& defines);
+		// Replaces the previous winner of the kernel on this adapter
+		void store(AutotuneCache* cache, uint64_t adapterId, const Hash128& kernelKey, const Hash128& spaceKey, const AutotuneResult& result);
+		uint32_t num_entries(AutotuneCache* cache);
+	}
+}
@@ -0,0 +1,193 @@
+#pragma once
+
+// Bento includes
+#include <bento_base/security.h>
+#include <bento_memory/common.h>
+#include <bento_collection/vector.h>
+
+// System includes
+#include <atomic>
+#include <mutex>
+
+namespace graphics_sandbox
+{
+	// Slots per chunk (power of two), a chunk is allocated the first time one of its slots is handed out and never moves
+	#define HANDLE_TABLE_CHUNK_BITS 8
+	#define HANDLE_TABLE_CHUNK_SIZE (1u << HANDLE_TABLE_CHUNK_BITS)
+
+	// The generation is checked on every lookup, it shares the cache line of the hot part
+	template<typename HotT>
+	struct HandleTableSlot
+	{
+		std::atomic<uint32_t> generation;
+		HotT hot;
+	};
+
+	// The hot parts of consecutive slots are contiguous, the cold parts are kept out of their cache lines
+	template<typename HotT, typename ColdT>
+	struct HandleTableChunk
+	{
+		HandleTableSlot<HotT> slots[HANDLE_TABLE_CHUNK_SIZE];
+		ColdT cold[HANDLE_TABLE_CHUNK_SIZE];
+	};
+
+	// Objects of a single type referenced by handles. A handle is the index of its slot in the low 32 bits and the generation of the
+	// slot in the high 32 bits. Generations start at 1 (0 is never a valid handle) and are bumped when the slot is freed, so a stale
+	// handle is detected even once its slot was recycled.
+	template<typename HotT, typename ColdT>
+	struct HandleTable
+	{
+		ALLOCATOR_BASED;
+		HandleTable(bento::IAllocator& allocator)
+		: _allocator(allocator)
+		, chunks(allocator)
+		, capacity(0)
+		, numSlots(0)
+		, freeSlots(allocator)
+		, numFree(0)
+		, numAlive(0)
+		{
+		}
+
+		// Sized once, lookups read it without the lock while slots are allocated
+		bento::Vector<HandleTableChunk<HotT, ColdT>*> chunks;
+		uint32_t capacity;
+
+		// Slots handed out at least once, the freed ones are recycled first (most recent first)
+		uint32_t numSlots;
+		bento::Vector<uint32_t> freeSlots;
+		uint32_t numFree;
+		std::atomic<uint32_t> numAlive;
+
+		// Only taken by the allocations and frees
+		std::mutex lock;
+		bento::IAllocator& _allocator;
+	};
+
+	namespace handle_table
+	{
+		template<typename HotT, typename ColdT>
+		void initialize(HandleTable<HotT, ColdT>& table, uint32_t capacity)
+		{
+			uint32_t numChunks = (capacity + HANDLE_TABLE_CHUNK_SIZE - 1) >> HANDLE_TABLE_CHUNK_BITS;
+			table.chunks.resize(numChunks);
+			for (uint32_t chunkIdx = 0; chunkIdx < numChunks; ++chunkIdx)
+				table.chunks[chunkIdx] = nullptr;
+			table.capacity = capacity;
+			table.numSlots = 0;
+			table.freeSlots.resize(capacity);
+			table.numFree = 0;
+			table.numAlive = 0;
+		}
+
+		// Frees the storage, the handles still alive are invalidated
+		template<typename HotT, typename ColdT>
+		void release(HandleTable<HotT, ColdT>& table)
+		{
+			for (uint32_t chunkIdx = 0; chunkIdx < table.chunks.size(); ++chunkIdx)
+				bento::make_delete<HandleTableChunk<HotT, ColdT>>(table._allocator, table.chunks[chunkIdx]);
+			table.chunks.clear();
+			table.freeSlots.clear();
+			table.capacity = 0;
+			table.numSlots = 0;
+			table.numFree = 0;
+			table.numAlive = 0;
+		}
+
+		// Returns the handle of a slot whose hot and cold parts are value initialized, 0 if the table is full.
+		// Only allocates memory the first time a chunk is used.
+		template<typename HotT, typename ColdT>
+		uint64_t allocate(HandleTable<HotT, ColdT>& table)
+		{
+			std::lock_guard<std::mutex> lock(table.lock);
+			uint32_t slot;
+			if (table.numFree > 0)
+				slot = table.freeSlots[--table.numFree];
+			else if (table.numSlots < table.capacity)
+			{
+				slot = table.numSlots++;
+				HandleTableChunk<HotT, ColdT>*& chunk = table.chunks[slot >> HANDLE_TABLE_CHUNK_BITS];
+				if (chunk == nullptr)
+				{
+					// Slots that were never handed out have no valid generation
+					chunk = bento::make_new<HandleTableChunk<HotT, ColdT>>(table._allocator);
+					for (uint32_t slotIdx = 0; slotIdx < HANDLE_TABLE_CHUNK_SIZE; ++slotIdx)
+						chunk->slots[slotIdx].generation.store(0, std::memory_order_relaxed);
+				}
+				chunk->slots[slot & (HANDLE_TABLE_CHUNK_SIZE - 1)].generation.store(1, std::memory_order_relaxed);
+			}
+			else
+				return 0;
+
+			HandleTableChunk<HotT, ColdT>* chunk = table.chunks[slot >> HANDLE_TABLE_CHUNK_BITS];
+			uint32_t chunkSlot = slot & (HANDLE_TABLE_CHUNK_SIZE - 1);
+			chunk->slots[chunkSlot].hot = HotT();
+			chunk->cold[chunkSlot] = ColdT();
+			table.numAlive.fetch_add(1, std::memory_order_relaxed);
+			return ((uint64_t)chunk->slots[chunkSlot].generation.load(std::memory_order_relaxed) << 32) | slot;
+		}
+
+		template<typename HotT, typename ColdT>
+		bool is_valid(const HandleTable<HotT, ColdT>& table, uint64_t handle)
+		{
+			uint32_t slot = (uint32_t)handle;
+			uint32_t generation = (uint32_t)(handle >> 32);
+			if (generation == 0 || slot >= table.capacity)
+				return false;
+			const HandleTableChunk<HotT, ColdT>* chunk = table.chunks[slot >> HANDLE_TABLE_CHUNK_BITS];
+			return chunk != nullptr && chunk->slots[slot & (HANDLE_TABLE_CHUNK_SIZE - 1)].generation.load(std::memory_order_acquire) == generation;
+		}
+
+		// Invalidates the handle and recycles its slot, returns false for a stale handle
+		template<typename HotT, typename ColdT>
+		bool free(HandleTable<HotT, ColdT>& table, uint64_t handle)
+		{
+			std::lock_guard<std::mutex> lock(table.lock);
+			if (!is_valid(table, handle))
+				return false;
+			uint32_t slot = (uint32_t)handle;
+			std::atomic<uint32_t>& generation = table.chunks[slot >> HANDLE_TABLE_CHUNK_BITS]->slots[slot & (HANDLE_TABLE_CHUNK_SIZE - 1)].generation;
+			uint32_t nextGeneration = generation.load(std::memory_order_relaxed) + 1;
+			generation.store(nextGeneration != 0 ? nextGeneration : 1, std::memory_order_release);
+			table.freeSlots[table.numFree++] = slot;
+			table.numAlive.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+
+		// Lock free lookups, the handle must be valid
+		template<typename HotT, typename ColdT>
+		HotT* hot(HandleTable<HotT, ColdT>& table, uint64_t handle)
+		{
+			assert_msg(is_valid(table, handle), "Invalid or stale handle.");
+			uint32_t slot = (uint32_t)handle;
+			return &table.chunks[slot >> HANDLE_TABLE_CHUNK_BITS]->slots[slot & (HANDLE_TABLE_CHUNK_SIZE - 1)].hot;
+		}
+
+		template<typename HotT, typename ColdT>
+		ColdT* cold(HandleTable<HotT, ColdT>& table, uint64_t handle)
+		{
+			assert_msg(is_valid(table, handle), "Invalid or stale handle.");
+			uint32_t slot = (uint32_t)handle;
+			return &table.chunks[slot >> HANDLE_TABLE_CHUNK_BITS]->cold[slot & (HANDLE_TABLE_CHUNK_SIZE - 1)];
+		}
+
+		// Returns false for a stale handle instead of asserting
+		template<typename HotT, typename ColdT>
+		bool lookup(HandleTable<HotT, ColdT>& table, uint64_t handle, HotT*& hotPart, ColdT*& coldPart)
+		{
+			if (!is_valid(table, handle))
+				return false;
+			uint32_t slot = (uint32_t)handle;
+			HandleTableChunk<HotT, ColdT>* chunk = table.chunks[slot >> HANDLE_TABLE_CHUNK_BITS];
+			hotPart = &chunk->slots[slot & (HANDLE_TABLE_CHUNK_SIZE - 1)].hot;
+			coldPart = &chunk->cold[slot & (HANDLE_TABLE_CHUNK_SIZE - 1)];
+			return true;
+		}
+
+		template<typename HotT, typename ColdT>
+		uint32_t num_alive(const HandleTable<HotT, ColdT>& table)
+		{
+			return table.numAlive.load(std::memory_order_relaxed);
+		}
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+// Bento includes
+#include <bento_collection/vector.h>
+#include <bento_collection/dynamic_string.h>
+
+// System includes
+#include <string>
+
+namespace graphics_sandbox
+{
+	// Recompiles a shader in the background, returns the new version or 0 if the compilation failed
+	typedef uint64_t (*HotReloadCompileFunction)(uint64_t shader, void* userData);
+
+	// Destroys a version that will never be swapped in (a newer one superseded it, or its shader is gone)
+	typedef void (*HotReloadDiscardFunction)(uint64_t version, void* userData);
+
+	// New version of a shader, ready to be swapped in
+	struct HotReloadVersion
+	{
+		uint64_t shader;
+		uint64_t version;
+	};
+
+	// Opaque reloader structure
+	struct HotReloader;
+
+	// Tracks the files every shader was compiled from, recompiles the shaders affected by a change on a background thread and
+	// keeps the objects that were swapped out alive until the GPU is done with them. Shaders, versions, objects and fences
+	// are the backend's opaque values.
+	namespace hot_reload
+	{
+		HotReloader* create_hot_reloader(bento::IAllocator& allocator, HotReloadCompileFunction compileFunction, HotReloadDiscardFunction discardFunction, void* userData);
+		// Waits for the compilation in progress and discards the versions that were not collected. Retired objects must have been reclaimed.
+		void destroy_hot_reloader(HotReloader* reloader);
+
+		// Dependency graph, the paths are normalized ('/' separators, "." and ".." resolved) before being compared
+		void set_dependencies(HotReloader* reloader, uint64_t shader, const bento::Vector<bento::DynamicString>& files);
+		void remove_shader(HotReloader* reloader, uint64_t shader);
+		void affected_shaders(HotReloader* reloader, const bento::Vector<bento::DynamicString>& changedFiles, bento::Vector<uint64_t>& shaders);
+		void watched_directories(HotReloader* reloader, bento::Vector<bento::DynamicString>& directories);
+
+		// Queues the recompilation of every shader that depends on one of the files, a shader is only queued once
+		void notify_changes(HotReloader* reloader, const bento::Vector<bento::DynamicString>& changedFiles);
+		void wait_idle(HotReloader* reloader);
+
+		// To be called at a safe point, hands out the latest version compiled for every shader since the last call
+		void collect_ready(HotReloader* reloader, bento::Vector<HotReloadVersion>& versions);
+
+		// An object that was swapped out can only be destroyed once every fence that may still use it has reached its value
+		void retire(HotReloader* reloader, uint64_t object, const uint64_t* fences, const uint64_t* fenceValues, uint32_t numFences);
+		void reclaim(HotReloader* reloader, uint64_t fence, uint64_t completedValue, bento::Vector<uint64_t>& released);
+		uint32_t num_retired(HotReloader* reloader);
+
+		// The result is a temporary on the global heap, only the normalized dependencies are kept (on the reloader's allocator)
+		std::string normalize_path(const char* path);
+	}
+}
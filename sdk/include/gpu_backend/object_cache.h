@@ -0,0 +1,49 @@
+#pragma once
+
+// Bento includes
+#include <bento_memory/common.h>
+
+// SDK includes
+#include "gpu_backend/compute_shader_descriptor.h"
+#include "tools/hash.h"
+
+namespace graphics_sandbox
+{
+	struct ObjectCacheStats
+	{
+		uint64_t hits;
+		uint64_t misses;
+	};
+
+	// Opaque cache structure
+	struct ObjectCache;
+
+	// Reference counted objects (the backend's opaque pointers) shared by every user of the same key. Thread safe, the objects
+	// are created outside of the cache so that two threads can miss the same key at the same time, only one object is kept.
+	namespace object_cache
+	{
+		ObjectCache* create_cache(bento::IAllocator& allocator);
+		// Every object must have been released
+		void destroy_cache(ObjectCache* cache);
+
+		// Returns true and adds a reference if the key is known
+		bool acquire(ObjectCache* cache, const Hash128& key, uint64_t& object);
+
+		// Adds an object with a single reference and returns it. If another thread inserted the key in the meantime, a reference
+		// to its object is returned instead and the caller has to destroy the one it created.
+		uint64_t insert(ObjectCache* cache, const Hash128& key, uint64_t object);
+
+		// Returns true when the last reference is gone, the caller has to destroy the object
+		bool release(ObjectCache* cache, const Hash128& key, uint64_t& object);
+
+		// Introspection
+		uint32_t size(ObjectCache* cache);
+		uint32_t ref_count(ObjectCache* cache, const Hash128& key);
+		ObjectCacheStats get_stats(ObjectCache* cache);
+
+		// Keys only depend on what ends up in the API objects, the resolved layout of two shaders with the same bindings give the
+		// same root signature key whatever their file, kernel or include directories.
+		void root_signature_key(const ComputeShaderDescriptor& layout, Hash128& key);
+		void pipeline_key(const void* bytecode, uint64_t bytecodeSize, const Hash128& rootSignatureKey, Hash128& key);
+	}
+}
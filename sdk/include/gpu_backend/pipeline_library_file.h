@@ -0,0 +1,54 @@
+#pragma once
+
+// Bento includes
+#include <bento_base/platform.h>
+
+// SDK includes
+#include "tools/hash.h"
+
+namespace graphics_sandbox
+{
+	// File layout (little endian): a PipelineLibraryHeader, then the driver's serialized library at payloadOffset. The payload is
+	// aligned so that it can be handed to the driver straight from a memory mapping.
+	#define PIPELINE_LIBRARY_MAGIC 0x4c505347 // "GSPL"
+	#define PIPELINE_LIBRARY_VERSION 1
+	#define PIPELINE_LIBRARY_PAYLOAD_ALIGNMENT 64
+
+	// The serialized pipelines only make sense for the exact adapter and driver that produced them
+	struct PipelineLibraryIdentity
+	{
+		uint32_t vendorId;
+		uint32_t deviceId;
+		uint32_t subSysId;
+		uint32_t revision;
+		uint64_t driverVersion;
+	};
+
+	struct PipelineLibraryHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		PipelineLibraryIdentity identity;
+		uint64_t payloadOffset;
+		uint64_t payloadSize;
+		Hash128 payloadHash;
+	};
+
+	enum class PipelineLibraryStatus
+	{
+		Valid = 0,
+		Corrupted,
+		VersionMismatch,
+		AdapterMismatch,
+		DriverMismatch
+	};
+
+	namespace pipeline_library_file
+	{
+		// Checks the header and the payload, on success payload points into data
+		PipelineLibraryStatus validate(const char* data, uint64_t size, const PipelineLibraryIdentity& identity, const char*& payload, uint64_t& payloadSize);
+
+		// Writes next to the target and swaps, a crash never leaves a truncated file behind
+		bool write(const char* path, const PipelineLibraryIdentity& identity, const void* payload, uint64_t payloadSize);
+	}
+}
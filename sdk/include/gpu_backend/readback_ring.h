@@ -0,0 +1,99 @@
+#pragma once
+
+// Bento includes
+#include <bento_collection/vector.h>
+
+// SDK includes
+#include "gpu_backend/upload_ring.h"
+
+namespace graphics_sandbox
+{
+	// Alignment of the ranges in the staging memory, enough for any element type the caller may read them as
+	#define READBACK_RING_ALIGNMENT 16
+
+	// Called once the bytes of the ticket can be read, the data stays valid until the ticket is released
+	typedef void (*ReadbackCallback)(uint64_t ticket, const char* data, uint64_t size, void* userData);
+
+	enum class ReadbackStatus
+	{
+		// Unknown or released ticket
+		Invalid,
+		// The copy is recorded in a command buffer that was not executed yet
+		Recorded,
+		// The command buffer was executed, the GPU hasn't reached its point yet
+		InFlight,
+		// The bytes are in the staging memory
+		Ready
+	};
+
+	struct ReadbackTicketState
+	{
+		uint64_t offset;
+		uint64_t size;
+		// Command buffer that records the copy, then the point that signals its execution (UINT64_MAX until it is executed)
+		uint64_t owner;
+		uint64_t point;
+		ReadbackCallback callback;
+		void* userData;
+		bool mapped;
+		bool released;
+	};
+
+	// Staging memory the GPU copies buffer ranges into, each range is identified by a ticket. The space of a ticket is reused once it
+	// has been released and its copy is complete. Tickets are released in any order, the space only moves forward over the oldest ones.
+	struct ReadbackRing
+	{
+		ALLOCATOR_BASED;
+		ReadbackRing(bento::IAllocator& allocator);
+
+		// Every ticket is a frame of the ring tagged with its own number, so reclaiming up to a ticket frees everything before it
+		UploadRing space;
+
+		// Live tickets in request order, the one at index i is firstTicket + i. The ones before firstLive are done.
+		bento::Vector<ReadbackTicketState> tickets;
+		uint64_t firstTicket;
+		uint32_t firstLive;
+		uint64_t nextTicket;
+
+		// Last point the GPU was seen to reach
+		uint64_t completedPoint;
+
+		// Statistics
+		uint64_t requests;
+		uint64_t failedRequests;
+		bento::IAllocator& _allocator;
+	};
+
+	// Not thread safe, the backends guard each ring with a lock
+	namespace readback_ring
+	{
+		void initialize(ReadbackRing& ring, uint64_t capacity);
+
+		// Returns the ticket (never 0) of a range of the staging memory recorded by the owner, 0 if there is not enough space left.
+		// The space only comes back when older tickets are released.
+		uint64_t allocate(ReadbackRing& ring, uint64_t size, uint64_t alignment, uint64_t owner, ReadbackCallback callback, void* userData, uint64_t& offset);
+
+		// Tags the recorded tickets of the owner with the point that signals its execution, returns how many of them have a callback
+		uint32_t submit(ReadbackRing& ring, uint64_t owner, uint64_t point);
+
+		// Releases the recorded tickets of an owner that is reset or destroyed before being executed, they become invalid
+		void cancel(ReadbackRing& ring, uint64_t owner);
+
+		// The GPU has reached the point, frees the space of the released tickets that are complete
+		void signal(ReadbackRing& ring, uint64_t completedPoint);
+
+		ReadbackStatus status(const ReadbackRing& ring, uint64_t ticket);
+
+		// Returns false for an invalid ticket
+		bool get(ReadbackRing& ring, uint64_t ticket, ReadbackTicketState*& state);
+
+		// Tickets of a point that have a callback, in request order
+		void tickets_with_callback(const ReadbackRing& ring, uint64_t point, bento::Vector<uint64_t>& tickets);
+
+		// A ticket can be released before its copy is complete, its space is only reused once it is. Returns false for an invalid ticket.
+		bool release(ReadbackRing& ring, uint64_t ticket);
+
+		// Tickets requested and not released yet
+		uint32_t num_live(const ReadbackRing& ring);
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+// Bento includes
+#include <bento_collection/vector.h>
+
+namespace graphics_sandbox
+{
+	enum class ResourceBarrierType
+	{
+		Transition,
+		UAV
+	};
+
+	// Backend-neutral barrier, the resource is the backend's resource pointer and the states are the backend's state bits
+	struct ResourceBarrier
+	{
+		ResourceBarrierType type;
+		uint64_t resource;
+		uint32_t stateBefore;
+		uint32_t stateAfter;
+	};
+
+	// Barriers requested between two commands that touch the GPU are accumulated here and emitted in a single call
+	// right before the next command is recorded.
+	struct ResourceBarrierBatch
+	{
+		ALLOCATOR_BASED;
+		ResourceBarrierBatch(bento::IAllocator& allocator);
+
+		// Pending barriers, in request order
+		bento::Vector<ResourceBarrier> barriers;
+
+		// Statistics
+		uint64_t requestedBarriers;
+		uint64_t emittedBarriers;
+		uint64_t flushes;
+		bento::IAllocator& _allocator;
+	};
+
+	namespace resource_barrier_batch
+	{
+		// Merges with a pending transition on the same resource (A->B then B->C becomes A->C, A->B then B->A cancels out)
+		void request_transition(ResourceBarrierBatch& batch, uint64_t resource, uint32_t stateBefore, uint32_t stateAfter);
+
+		// Ignored if a UAV barrier on the same resource is already pending
+		void request_uav_barrier(ResourceBarrierBatch& batch, uint64_t resource);
+
+		// Removes the transitions that cancelled out and returns the number of barriers that need to be emitted
+		uint32_t compact(ResourceBarrierBatch& batch);
+
+		// Must be called once the compacted barriers have been emitted
+		void reset(ResourceBarrierBatch& batch);
+
+		// Drops the pending barriers without counting them, for recordings that are abandoned before they are flushed
+		void discard(ResourceBarrierBatch& batch);
+	}
+}
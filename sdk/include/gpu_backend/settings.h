@@ -12,7 +12,8 @@ namespace graphics_sandbox
 	enum class RenderingBackEnd
 	{
 		DX12 = 0,
-		COUNT = 1
+		CPU = 1,
+		COUNT = 2
 	};
 
 	struct TGraphicSettings
@@ -0,0 +1,72 @@
+#pragma once
+
+// Bento includes
+#include <bento_collection/vector.h>
+#include <bento_collection/dynamic_string.h>
+
+// SDK includes
+#include "tools/hash.h"
+
+namespace graphics_sandbox
+{
+	// Pack layout (little endian): a ShaderCacheHeader, numEntries ShaderCacheEntry sorted by key, then the blobs. Every offset
+	// is relative to the start of the file and aligned so that the pack can be used directly from a memory mapping.
+	#define SHADER_CACHE_MAGIC 0x43535347 // "GSSC"
+	#define SHADER_CACHE_VERSION 1
+	#define SHADER_CACHE_BLOB_ALIGNMENT 16
+
+	struct ShaderCacheHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t numEntries;
+		uint32_t reserved;
+		uint64_t fileSize;
+	};
+
+	struct ShaderCacheEntry
+	{
+		Hash128 key;
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	struct ShaderCacheStats
+	{
+		uint64_t hits;
+		uint64_t misses;
+		uint64_t stores;
+
+		// Accumulated durations in nanoseconds, the compilation time is reported by the backend on every miss
+		uint64_t lookupTime;
+		uint64_t compilationTime;
+	};
+
+	// Opaque cache structure
+	struct ShaderCache;
+
+	namespace shader_cache
+	{
+		// Loads the pack if it exists and is valid, otherwise the cache starts empty
+		ShaderCache* create_cache(bento::IAllocator& allocator, const char* path);
+
+		// Writes the pack if anything was stored
+		void destroy_cache(ShaderCache* cache);
+		bool save(ShaderCache* cache);
+
+		// Every file reached through #include directives (the source first), quoted includes are searched next to the includer first
+		void collect_dependencies(const char* filename, const bento::Vector<bento::DynamicString>& includeDirectories, bento::Vector<bento::DynamicString>& dependencies);
+
+		// Hash of the content of the source and its dependencies, the kernel, the target profile, the arguments and the compiler version.
+		// Returns false if the source can't be read.
+		bool compute_key(const char* filename, const bento::Vector<bento::DynamicString>& includeDirectories, const char* kernelName, const char* profile,
+			const char* const* arguments, uint32_t numArguments, uint64_t compilerVersion, Hash128& key);
+
+		// The returned blob points into the mapped pack or the pending blobs, it stays valid until the cache is saved or destroyed
+		bool lookup(ShaderCache* cache, const Hash128& key, const void*& data, uint64_t& size);
+		void store(ShaderCache* cache, const Hash128& key, const void* data, uint64_t size);
+		void record_compilation(ShaderCache* cache, uint64_t duration);
+
+		ShaderCacheStats get_stats(ShaderCache* cache);
+	}
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+// Bento includes
+#include <bento_collection/vector.h>
+#include <bento_collection/dynamic_string.h>
+
+// SDK includes
+#include "gpu_backend/compute_shader_descriptor.h"
+#include "tools/hash.h"
+
+namespace graphics_sandbox
+{
+	// Creates the variant of a kernel for a descriptor (the base one completed with the variant's defines) and destroys it
+	typedef uint64_t (*PermutationCreateFunction)(const ComputeShaderDescriptor& descriptor, void* userData);
+	typedef void (*PermutationDestroyFunction)(uint64_t variant, void* userData);
+
+	// Opaque permutation set structure
+	struct PermutationSet;
+
+	namespace shader_permutation
+	{
+		// Sorts the defines by name and gives them an explicit value, "NAME" becomes "NAME=1". When a name appears several times the
+		// last definition wins, like on the compiler's command line.
+		void canonicalize(const bento::Vector<bento::DynamicString>& defines, bento::Vector<bento::DynamicString>& canonical);
+
+		// Two lists that define the same macros to the same values share their key, whatever their order
+		void compute_key(const bento::Vector<bento::DynamicString>& defines, Hash128& key);
+
+		// Variants of a kernel that are only created the first time they are requested. Thread safe, concurrent requests of a variant
+		// that is being created wait for it.
+		PermutationSet* create_permutation_set(bento::IAllocator& allocator, const ComputeShaderDescriptor& base, PermutationCreateFunction createFunction,
+			PermutationDestroyFunction destroyFunction, void* userData);
+		// Destroys every variant that was created
+		void destroy_permutation_set(PermutationSet* set);
+
+		// The defines are appended to the base descriptor's ones
+		uint64_t get_variant(PermutationSet* set, const bento::Vector<bento::DynamicString>& defines);
+		uint32_t num_variants(PermutationSet* set);
+	}
+}
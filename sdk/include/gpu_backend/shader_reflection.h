@@ -0,0 +1,72 @@
+#pragma once
+
+// Bento includes
+#include <bento_collection/vector.h>
+
+namespace graphics_sandbox
+{
+	// Serialized layout (little endian): a ShaderReflectionHeader followed by numBindings ShaderBinding
+	#define SHADER_REFLECTION_MAGIC 0x52535347 // "GSSR"
+	#define SHADER_REFLECTION_VERSION 1
+
+	// Limits of a compute thread group
+	#define SHADER_REFLECTION_MAX_GROUP_SIZE_XY 1024
+	#define SHADER_REFLECTION_MAX_GROUP_SIZE_Z 64
+	#define SHADER_REFLECTION_MAX_GROUP_THREADS 1024
+
+	enum class ShaderBindingType
+	{
+		SRV = 0,
+		UAV,
+		CBV,
+		Count
+	};
+
+	// Resource declared by a kernel, count is the array size and size the byte size of a constant buffer (0 otherwise)
+	struct ShaderBinding
+	{
+		ShaderBindingType type;
+		uint32_t registerIndex;
+		uint32_t space;
+		uint32_t count;
+		uint32_t size;
+	};
+
+	struct ShaderReflectionHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t groupSize[3];
+		uint32_t numBindings;
+	};
+
+	// What the compiler tells about a kernel, enough to build its root signature without looking at the bytecode again
+	struct ShaderReflection
+	{
+		ALLOCATOR_BASED;
+		ShaderReflection(bento::IAllocator& allocator);
+
+		uint32_t groupSize[3];
+		bento::Vector<ShaderBinding> bindings;
+		bento::IAllocator& _allocator;
+	};
+
+	namespace shader_reflection
+	{
+		void reset(ShaderReflection& reflection);
+		void add_binding(ShaderReflection& reflection, ShaderBindingType type, uint32_t registerIndex, uint32_t space, uint32_t count, uint32_t size = 0);
+
+		// Number of registers of a type, starting at register 0 of the space, that covers every binding of that type
+		uint32_t register_range(const ShaderReflection& reflection, ShaderBindingType type, uint32_t space);
+
+		// Returns nullptr if nothing is bound to that register
+		const ShaderBinding* find_binding(const ShaderReflection& reflection, ShaderBindingType type, uint32_t registerIndex, uint32_t space);
+
+		// Checks the thread group size against the API limits and that no two bindings of a type overlap
+		bool validate(const ShaderReflection& reflection);
+
+		// Serialization, deserialize returns false (and leaves the reflection empty) if the data is truncated or invalid
+		void serialize(const ShaderReflection& reflection, bento::Vector<char>& output);
+		bool deserialize(const char* data, uint64_t size, ShaderReflection& reflection);
+	}
+}
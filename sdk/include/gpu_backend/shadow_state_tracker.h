@@ -0,0 +1,65 @@
+#pragma once
+
+// Bento includes
+#include <bento_base/platform.h>
+
+namespace graphics_sandbox
+{
+	// Maximal size of a root signature (in DWORDs), this also bounds the number of root parameters
+	#define SHADOW_STATE_MAX_ROOT_SIZE 64
+
+	enum class ShadowStateCall
+	{
+		DescriptorHeap = 0,
+		RootSignature,
+		PipelineState,
+		RootParameter,
+		Count
+	};
+
+	// Mirror of the pipeline state bound on a command list. Every set_* function returns true if the call needs to be emitted and
+	// false if the value is already bound. The objects are the backend's opaque pointers and are never dereferenced.
+	struct ShadowStateTracker
+	{
+		uint64_t descriptorHeap;
+		uint64_t rootSignature;
+		uint64_t pipelineState;
+
+		// Root arguments of the current root signature, descriptor tables and root descriptors store their handle/address,
+		// root constants store their values in the constant storage
+		bool rootValid[SHADOW_STATE_MAX_ROOT_SIZE];
+		uint64_t rootValue[SHADOW_STATE_MAX_ROOT_SIZE];
+		uint32_t constantOffset[SHADOW_STATE_MAX_ROOT_SIZE];
+		uint32_t constantCount[SHADOW_STATE_MAX_ROOT_SIZE];
+		uint32_t constants[SHADOW_STATE_MAX_ROOT_SIZE];
+		uint32_t nextConstant;
+
+		// Statistics, they survive the resets
+		uint64_t requestedCalls[(uint32_t)ShadowStateCall::Count];
+		uint64_t elidedCalls[(uint32_t)ShadowStateCall::Count];
+	};
+
+	namespace shadow_state_tracker
+	{
+		// Clears the statistics and the bound state
+		void initialize(ShadowStateTracker& tracker);
+
+		// Must be called whenever the command list is reset, nothing is bound anymore
+		void reset(ShadowStateTracker& tracker);
+
+		bool set_descriptor_heap(ShadowStateTracker& tracker, uint64_t descriptorHeap);
+
+		// Forgets the root arguments so that the next set_* of each one is emitted, without changing the bound objects
+		void invalidate_root_arguments(ShadowStateTracker& tracker);
+
+		// Changing the root signature invalidates all the root arguments
+		bool set_root_signature(ShadowStateTracker& tracker, uint64_t rootSignature);
+		bool set_pipeline_state(ShadowStateTracker& tracker, uint64_t pipelineState);
+
+		// Descriptor table handle or root descriptor address
+		bool set_root_value(ShadowStateTracker& tracker, uint32_t rootIndex, uint64_t value);
+		bool set_root_constants(ShadowStateTracker& tracker, uint32_t rootIndex, const uint32_t* values, uint32_t count);
+
+		uint64_t total_elided_calls(const ShadowStateTracker& tracker);
+	}
+}
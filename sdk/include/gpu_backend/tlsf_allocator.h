@@ -0,0 +1,77 @@
+#pragma once
+
+// Bento includes
+#include <bento_collection/vector.h>
+
+namespace graphics_sandbox
+{
+	// Two level segregated fit: the first level splits the block sizes by power of two, the second one splits every power of two
+	// in TLSF_SL_COUNT linear ranges. Sizes are counted in granules, the ones below TLSF_SL_COUNT granules have an exact list.
+	#define TLSF_SL_BITS 5
+	#define TLSF_SL_COUNT (1 << TLSF_SL_BITS)
+	#define TLSF_FL_COUNT (64 - TLSF_SL_BITS + 1)
+	#define TLSF_INVALID_BLOCK UINT32_MAX
+
+	// Range of the allocator, free or allocated. The physical links chain the blocks by offset, the free links chain the free
+	// blocks of the same size class.
+	struct TlsfBlock
+	{
+		uint64_t offset;
+		uint64_t size;
+		uint32_t prevPhysical;
+		uint32_t nextPhysical;
+		uint32_t prevFree;
+		uint32_t nextFree;
+		bool free;
+	};
+
+	// Placement returned by an allocation, the block identifies it when it is freed
+	struct TlsfAllocation
+	{
+		uint64_t offset;
+		uint64_t size;
+		uint32_t block;
+	};
+
+	// Constant time allocator over a range of offsets, it never touches the memory it manages. Allocations are rounded up to the
+	// granularity and every offset is a multiple of it. Not thread safe.
+	struct TlsfAllocator
+	{
+		ALLOCATOR_BASED;
+		TlsfAllocator(bento::IAllocator& allocator);
+
+		uint64_t capacity;
+		uint64_t granularity;
+
+		// Size class lookup, a bit is raised for every non empty list
+		uint64_t flBitmap;
+		uint32_t slBitmap[TLSF_FL_COUNT];
+		uint32_t freeHeads[TLSF_FL_COUNT][TLSF_SL_COUNT];
+
+		// Block records, the unused ones are chained through nextFree
+		bento::Vector<TlsfBlock> blocks;
+		uint32_t unusedBlocks;
+
+		// Statistics (in bytes)
+		uint64_t used;
+		uint32_t numAllocations;
+		bento::IAllocator& _allocator;
+	};
+
+	namespace tlsf_allocator
+	{
+		// The granularity must be a power of two, the capacity a multiple of it
+		void initialize(TlsfAllocator& allocator, uint64_t capacity, uint64_t granularity);
+
+		// The alignment must be a power of two. Returns false if no free block can hold the allocation.
+		bool allocate(TlsfAllocator& allocator, uint64_t size, uint64_t alignment, TlsfAllocation& allocation);
+		void free(TlsfAllocator& allocator, uint32_t block);
+
+		// Size of the largest allocation that would succeed with the granularity as alignment
+		uint64_t largest_free_block(const TlsfAllocator& allocator);
+		bool is_empty(const TlsfAllocator& allocator);
+
+		// Walks every block and checks the physical chain, the free lists and the bitmaps, returns false on any inconsistency
+		bool validate(const TlsfAllocator& allocator);
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+// Bento includes
+#include <bento_collection/vector.h>
+
+namespace graphics_sandbox
+{
+	// Part of the ring allocated during a frame, reused once the fence has reached the frame's value
+	struct UploadRingFrame
+	{
+		uint64_t end;
+		uint64_t size;
+		uint64_t fenceValue;
+	};
+
+	// Linear allocator over a fixed size upload heap. Allocations are made at the head, end_frame tags everything allocated since the
+	// previous call with a fence value and the tail moves forward once the fence has passed it. An allocation never straddles the end of
+	// the ring, the skipped bytes belong to the frame that wrapped.
+	struct UploadRing
+	{
+		ALLOCATOR_BASED;
+		UploadRing(bento::IAllocator& allocator);
+
+		// Ring state (in bytes)
+		uint64_t capacity;
+		uint64_t head;
+		uint64_t tail;
+		uint64_t used;
+		uint64_t frameSize;
+
+		// Frames waiting for their fence value, the live ones start at firstFrame
+		bento::Vector<UploadRingFrame> frames;
+		uint32_t firstFrame;
+
+		// Statistics
+		uint64_t allocations;
+		uint64_t wraps;
+		uint64_t failedAllocations;
+		bento::IAllocator& _allocator;
+	};
+
+	// Memory handed out by a backend's upload ring
+	struct UploadAllocation
+	{
+		char* cpuAddress;
+		uint64_t gpuAddress;
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	namespace upload_ring
+	{
+		void initialize(UploadRing& ring, uint64_t capacity);
+
+		// The alignment must be a power of two. Returns false if there is not enough contiguous space, the caller is expected to wait for
+		// the oldest frame and reclaim.
+		bool allocate(UploadRing& ring, uint64_t size, uint64_t alignment, uint64_t& offset);
+
+		// Closes the current frame, its allocations are freed once the fence reaches the value. The values must increase.
+		void end_frame(UploadRing& ring, uint64_t fenceValue);
+
+		// Frees the oldest frames as long as their value has been reached
+		void reclaim(UploadRing& ring, uint64_t completedValue);
+
+		// Fence value the oldest frame is waiting on, returns false if no frame is waiting
+		bool oldest_fence_value(const UploadRing& ring, uint64_t& fenceValue);
+	}
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+// Bento includes
+#include <bento_collection/vector.h>
+#include <bento_collection/dynamic_string.h>
+
+namespace graphics_sandbox
+{
+	// Opaque watcher structure
+	struct FileWatcher;
+
+	// Reports the files written, created or moved into a set of directories (not recursive). Uses inotify on Linux and directory
+	// change notifications on Windows, polling never blocks.
+	namespace file_watcher
+	{
+		FileWatcher* create_file_watcher(bento::IAllocator& allocator);
+		void destroy_file_watcher(FileWatcher* watcher);
+
+		// Returns false if the directory can't be watched, watching a directory twice is a no-op
+		bool watch_directory(FileWatcher* watcher, const char* directory);
+
+		// Appends the path (directory + '/' + name) of every file changed since the last poll, a file can appear several times
+		void poll(FileWatcher* watcher, bento::Vector<bento::DynamicString>& changedFiles);
+	}
+}
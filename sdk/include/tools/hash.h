@@ -0,0 +1,27 @@
+#pragma once
+
+// Bento includes
+#include <bento_base/platform.h>
+
+namespace graphics_sandbox
+{
+	// 128-bit digest made of two independent 64-bit hashes, wide enough to address content
+	struct Hash128
+	{
+		uint64_t low;
+		uint64_t high;
+	};
+
+	namespace hash
+	{
+		void begin(Hash128& state);
+		void append(Hash128& state, const void* data, uint64_t size);
+
+		// The length is hashed too so that consecutive strings can't be confused with their concatenation
+		void append_string(Hash128& state, const char* str);
+		void append_uint64(Hash128& state, uint64_t value);
+
+		bool equal(const Hash128& a, const Hash128& b);
+		bool less(const Hash128& a, const Hash128& b);
+	}
+}
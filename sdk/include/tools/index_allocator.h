@@ -0,0 +1,37 @@
+#pragma once
+
+// Bento includes
+#include <bento_collection/vector.h>
+
+// System includes
+#include <mutex>
+
+namespace graphics_sandbox
+{
+	// Hands out stable indices in [0, capacity). Freed indices are reused first (most recently freed first), the never used ones are
+	// handed out in increasing order. All the functions can be called concurrently.
+	struct IndexAllocator
+	{
+		ALLOCATOR_BASED;
+		IndexAllocator(bento::IAllocator& allocator);
+
+		uint32_t capacity;
+		uint32_t nextIndex;
+		uint32_t numAllocated;
+		bento::Vector<uint32_t> freeIndices;
+		std::mutex lock;
+		bento::IAllocator& _allocator;
+	};
+
+	namespace index_allocator
+	{
+		// Must be called before any allocation, not thread safe
+		void initialize(IndexAllocator& allocator, uint32_t capacity);
+
+		// Returns UINT32_MAX if every index is in use
+		uint32_t allocate(IndexAllocator& allocator);
+		void free(IndexAllocator& allocator, uint32_t index);
+
+		uint32_t num_allocated(IndexAllocator& allocator);
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+// Bento includes
+#include <bento_memory/common.h>
+
+// Internal includes
+#include "tools/work_stealing_pool.h"
+
+namespace graphics_sandbox
+{
+	// Processes the job jobIdx of a batch, called from a worker thread
+	typedef void (*JobFunction)(uint32_t jobIdx, void* userData);
+
+	// Opaque batch structure
+	struct JobBatch;
+
+	// Fixed set of independent jobs processed in the background by the workers of a pool. The caller gets control back right away
+	// and can query or wait for every job individually, a thread that waits processes the jobs no worker has started yet.
+	namespace job_batch
+	{
+		// Every worker of the pool takes part in the batch, there are never more of them than jobs
+		JobBatch* launch(bento::IAllocator& allocator, WorkStealingPool* pool, uint32_t count, JobFunction function, void* userData);
+
+		// Waits for every job to be processed
+		void destroy(JobBatch* batch);
+
+		// Job state
+		bool is_complete(JobBatch* batch, uint32_t jobIdx);
+		void wait(JobBatch* batch, uint32_t jobIdx);
+		void wait_all(JobBatch* batch);
+		uint32_t num_workers(const JobBatch* batch);
+	}
+}
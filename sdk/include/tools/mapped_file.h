@@ -0,0 +1,21 @@
+#pragma once
+
+// Bento includes
+#include <bento_memory/common.h>
+
+namespace graphics_sandbox
+{
+	// Opaque read only mapping of a whole file
+	struct MappedFile;
+
+	namespace mapped_file
+	{
+		// Returns nullptr if the file doesn't exist, is empty or can't be mapped
+		MappedFile* open(bento::IAllocator& allocator, const char* path);
+		void close(MappedFile* file);
+
+		// The content stays valid until the file is closed
+		const char* data(const MappedFile* file);
+		uint64_t size(const MappedFile* file);
+	}
+}
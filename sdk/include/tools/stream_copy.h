@@ -0,0 +1,34 @@
+#pragma once
+
+// Bento includes
+#include <bento_base/platform.h>
+
+// Internal includes
+#include "tools/work_stealing_pool.h"
+
+namespace graphics_sandbox
+{
+	// Instruction sets the copy can use (each one includes the previous ones), the best one is detected at runtime
+	enum class StreamCopyPath
+	{
+		Scalar,
+		SSE2,
+		AVX2
+	};
+
+	// Copies meant for write-combined memory (upload heaps) that the CPU never reads back. The stores bypass the caches and go out a full
+	// line at a time, the source can have any alignment. Every copy is fenced, the data is visible to the GPU once the function returns.
+	namespace stream_copy
+	{
+		StreamCopyPath best_path();
+		const char* path_name(StreamCopyPath path);
+
+		// Single threaded, the path must be supported by the CPU
+		void copy(void* destination, const void* source, uint64_t size);
+		void copy(void* destination, const void* source, uint64_t size, StreamCopyPath path);
+
+		// Splits the copy in chunks processed by the threads of the pool (the calling thread included). Copies smaller than a few chunks
+		// stay on the calling thread.
+		void copy_parallel(WorkStealingPool* pool, void* destination, const void* source, uint64_t size);
+	}
+}
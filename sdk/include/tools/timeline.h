@@ -0,0 +1,47 @@
+#pragma once
+
+// Bento includes
+#include <bento_memory/common.h>
+
+namespace graphics_sandbox
+{
+	// Timeout value that never expires
+	#define TIMELINE_WAIT_INFINITE UINT64_MAX
+
+	// Called on the timeline's worker thread once the point has been reached
+	typedef void (*TimelineCallback)(uint64_t point, void* userData);
+
+	// Blocks until the device has reached (at least) value and returns the value it reached
+	typedef uint64_t (*TimelineWaitFunction)(void* userData, uint64_t value);
+
+	// Opaque timeline structure
+	struct Timeline;
+
+	// Monotonic counter of the work submitted to a queue. Every submission gets the next point, the backend reports the completed
+	// points either by calling signal or through a wait function that the worker thread calls while there is pending work.
+	namespace timeline
+	{
+		// Creation and destruction, the destruction waits for the worker to be done with every submitted point
+		Timeline* create_timeline(bento::IAllocator& allocator, TimelineWaitFunction waitFunction = nullptr, void* userData = nullptr);
+		void destroy_timeline(Timeline* timeline);
+
+		// Returns the point that will be reached once the submitted work is complete
+		uint64_t submit(Timeline* timeline);
+		void signal(Timeline* timeline, uint64_t completedValue);
+
+		// Queries
+		uint64_t last_submitted(Timeline* timeline);
+		uint64_t completed_value(Timeline* timeline);
+		bool is_complete(Timeline* timeline, uint64_t point);
+
+		// Return false if the timeout (in milliseconds) expired
+		bool wait(Timeline* timeline, uint64_t point, uint64_t timeoutMS = TIMELINE_WAIT_INFINITE);
+		bool wait_all(Timeline* const* timelines, const uint64_t* points, uint32_t count, uint64_t timeoutMS = TIMELINE_WAIT_INFINITE);
+
+		// Returns the index of a reached point or UINT32_MAX if the timeout expired
+		uint32_t wait_any(Timeline* const* timelines, const uint64_t* points, uint32_t count, uint64_t timeoutMS = TIMELINE_WAIT_INFINITE);
+
+		// The callback runs on the worker thread, it must not destroy the timeline
+		void add_callback(Timeline* timeline, uint64_t point, TimelineCallback callback, void* userData);
+	}
+}
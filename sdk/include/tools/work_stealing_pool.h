@@ -0,0 +1,39 @@
+#pragma once
+
+// Bento includes
+#include <bento_memory/common.h>
+#include <bento_collection/vector.h>
+
+// System includes
+#include <functional>
+
+namespace graphics_sandbox
+{
+	// Function that processes the items [begin, end) of a parallel loop
+	typedef std::function<void(uint32_t begin, uint32_t end)> RangeFunction;
+
+	// Function run once by a worker thread in the background
+	typedef void (*TaskFunction)(void* userData);
+
+	// Opaque pool structure
+	struct WorkStealingPool;
+
+	namespace work_stealing_pool
+	{
+		// Creation and destruction, a worker count of 0 picks one worker per hardware thread (minus the caller)
+		WorkStealingPool* create_pool(bento::IAllocator& allocator, uint32_t numWorkers = 0);
+		void destroy_pool(WorkStealingPool* pool);
+
+		// Number of threads that participate to a parallel loop (the workers and the calling thread)
+		uint32_t num_threads(const WorkStealingPool* pool);
+
+		// Splits [0, count) in batches of batchSize items, spreads them contiguously over the per-thread queues and blocks until all of them
+		// have been processed. Idle threads steal batches from the back of the other queues. Must not be called from inside a RangeFunction.
+		void parallel_for(WorkStealingPool* pool, uint32_t count, uint32_t batchSize, const RangeFunction& function);
+
+		// Queues a task that the next idle worker runs, in submission order, and returns right away. The workers still take part in
+		// the loops submitted meanwhile, once they are done with their task. A pool without workers never runs any task, every task
+		// must have returned before the pool is destroyed.
+		void submit(WorkStealingPool* pool, TaskFunction function, void* userData);
+	}
+}
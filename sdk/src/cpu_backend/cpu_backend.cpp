@@ -0,0 +1,238 @@
+// Bento includes
+#include <bento_base/security.h>
+#include <bento_memory/common.h>
+
+// Internal includes
+#include "cpu_backend/cpu_backend.h"
+#include "cpu_backend/cpu_containers.h"
+
+namespace graphics_sandbox
+{
+	namespace cpu
+	{
+		// Function that may be used and is declared in an other file
+		namespace command_buffer
+		{
+			void execute_commands(CPUCommandBuffer* commandBuffer);
+		}
+
+		namespace graphics_device
+		{
+			GraphicsDevice create_graphics_device(uint32_t numWorkers)
+			{
+				// Grab the allocator
+				bento::IAllocator* allocator = bento::common_allocator();
+				assert(allocator != nullptr);
+
+				// Create the graphics device internal structure
+				CPUGraphicsDevice* cpu_graphicsDevice = bento::make_new<CPUGraphicsDevice>(*allocator, *allocator);
+				cpu_graphicsDevice->pool = work_stealing_pool::create_pool(*allocator, numWorkers);
+				return (GraphicsDevice)cpu_graphicsDevice;
+			}
+
+			void destroy_graphics_device(GraphicsDevice graphicsDevice)
+			{
+				CPUGraphicsDevice* cpu_device = (CPUGraphicsDevice*)graphicsDevice;
+				work_stealing_pool::destroy_pool(cpu_device->pool);
+				bento::make_delete<CPUGraphicsDevice>(*bento::common_allocator(), cpu_device);
+			}
+		}
+
+		namespace command_queue
+		{
+			void run_readback_callbacks(uint64_t point, void* userData)
+			{
+				// Runs on the timeline's worker, the lock isn't held by the callbacks so they can release their ticket
+				CPUCommandQueue* cpu_commandQueue = (CPUCommandQueue*)userData;
+				bento::Vector<uint64_t> tickets(*bento::common_allocator());
+				{
+					std::lock_guard<std::mutex> lock(cpu_commandQueue->readbackLock);
+					readback_ring::tickets_with_callback(cpu_commandQueue->readbackRing, point, tickets);
+				}
+				for (uint32_t ticketIdx = 0; ticketIdx < tickets.size(); ++ticketIdx)
+				{
+					ReadbackCallback callback = nullptr;
+					void* callbackData = nullptr;
+					{
+						std::lock_guard<std::mutex> lock(cpu_commandQueue->readbackLock);
+						ReadbackTicketState* state;
+						if (readback_ring::get(cpu_commandQueue->readbackRing, tickets[ticketIdx], state))
+						{
+							callback = state->callback;
+							callbackData = state->userData;
+						}
+					}
+
+					// The application may have released the ticket in the meantime
+					uint64_t size;
+					const char* data = callback != nullptr ? map_readback((CommandQueue)cpu_commandQueue, tickets[ticketIdx], size) : nullptr;
+					if (data != nullptr)
+						callback(tickets[ticketIdx], data, size, callbackData);
+				}
+			}
+
+			CommandQueue create_command_queue(GraphicsDevice graphicsDevice)
+			{
+				CPUCommandQueue* cpu_commandQueue = bento::make_new<CPUCommandQueue>(*bento::common_allocator(), *bento::common_allocator());
+				cpu_commandQueue->deviceI = (CPUGraphicsDevice*)graphicsDevice;
+				cpu_commandQueue->timeline = timeline::create_timeline(*bento::common_allocator());
+				cpu_commandQueue->readbackBuffer = graphics_resources::create_graphics_buffer(graphicsDevice, CPU_READBACK_RING_SIZE, 1, GraphicsBufferType::Readback);
+				readback_ring::initialize(cpu_commandQueue->readbackRing, CPU_READBACK_RING_SIZE);
+				{
+					std::lock_guard<std::mutex> lock(cpu_commandQueue->deviceI->queuesLock);
+					cpu_commandQueue->deviceI->queues.push_back(cpu_commandQueue);
+				}
+				return (CommandQueue)cpu_commandQueue;
+			}
+
+			void destroy_command_queue(CommandQueue commandQueue)
+			{
+				CPUCommandQueue* cpu_commandQueue = (CPUCommandQueue*)commandQueue;
+				{
+					std::lock_guard<std::mutex> lock(cpu_commandQueue->deviceI->queuesLock);
+					bento::Vector<CPUCommandQueue*>& queues = cpu_commandQueue->deviceI->queues;
+					for (uint32_t queueIdx = 0; queueIdx < queues.size(); ++queueIdx)
+					{
+						if (queues[queueIdx] == cpu_commandQueue)
+						{
+							queues[queueIdx] = queues[queues.size() - 1];
+							queues.resize(queues.size() - 1);
+							break;
+						}
+					}
+				}
+				timeline::destroy_timeline(cpu_commandQueue->timeline);
+				graphics_resources::destroy_graphics_buffer(cpu_commandQueue->readbackBuffer);
+				bento::make_delete<CPUCommandQueue>(*bento::common_allocator(), cpu_commandQueue);
+			}
+
+			uint64_t execute_command_buffer(CommandQueue commandQueue, CommandBuffer commandBuffer)
+			{
+				// Grab the internal structures
+				CPUCommandQueue* cpu_commandQueue = (CPUCommandQueue*)commandQueue;
+				CPUCommandBuffer* cpu_commandBuffer = (CPUCommandBuffer*)commandBuffer;
+				assert_msg(cpu_commandBuffer->closed, "The command buffer must be closed before being executed.");
+
+				// The commands are processed right away, the work of each dispatch is spread over the device's pool
+				uint64_t point = timeline::submit(cpu_commandQueue->timeline);
+				command_buffer::execute_commands(cpu_commandBuffer);
+
+				// The readbacks recorded by the command buffer are already available
+				uint32_t numCallbacks;
+				{
+					std::lock_guard<std::mutex> lock(cpu_commandQueue->readbackLock);
+					numCallbacks = readback_ring::submit(cpu_commandQueue->readbackRing, (uint64_t)cpu_commandBuffer, point);
+					readback_ring::signal(cpu_commandQueue->readbackRing, point);
+				}
+				if (numCallbacks > 0)
+					timeline::add_callback(cpu_commandQueue->timeline, point, run_readback_callbacks, cpu_commandQueue);
+				timeline::signal(cpu_commandQueue->timeline, point);
+				return point;
+			}
+
+			uint64_t request_readback(CommandQueue commandQueue, CommandBuffer commandBuffer, GraphicsBuffer graphicsBuffer, uint64_t offset, uint64_t size, ReadbackCallback callback, void* userData)
+			{
+				CPUCommandQueue* cpu_commandQueue = (CPUCommandQueue*)commandQueue;
+				uint64_t ticket;
+				uint64_t stagingOffset;
+				{
+					std::lock_guard<std::mutex> lock(cpu_commandQueue->readbackLock);
+					ticket = readback_ring::allocate(cpu_commandQueue->readbackRing, size, READBACK_RING_ALIGNMENT, (uint64_t)commandBuffer, callback, userData, stagingOffset);
+				}
+				if (ticket != 0)
+					command_buffer::copy_buffer_region(commandBuffer, graphicsBuffer, offset, cpu_commandQueue->readbackBuffer, stagingOffset, size);
+				return ticket;
+			}
+
+			ReadbackStatus readback_status(CommandQueue commandQueue, uint64_t ticket)
+			{
+				CPUCommandQueue* cpu_commandQueue = (CPUCommandQueue*)commandQueue;
+				std::lock_guard<std::mutex> lock(cpu_commandQueue->readbackLock);
+				return readback_ring::status(cpu_commandQueue->readbackRing, ticket);
+			}
+
+			const char* map_readback(CommandQueue commandQueue, uint64_t ticket, uint64_t& size)
+			{
+				CPUCommandQueue* cpu_commandQueue = (CPUCommandQueue*)commandQueue;
+				std::lock_guard<std::mutex> lock(cpu_commandQueue->readbackLock);
+				ReadbackTicketState* state;
+				if (readback_ring::status(cpu_commandQueue->readbackRing, ticket) != ReadbackStatus::Ready || !readback_ring::get(cpu_commandQueue->readbackRing, ticket, state))
+					return nullptr;
+				size = state->size;
+				return ((CPUGraphicsBuffer*)cpu_commandQueue->readbackBuffer)->data + state->offset;
+			}
+
+			void release_readback(CommandQueue commandQueue, uint64_t ticket)
+			{
+				CPUCommandQueue* cpu_commandQueue = (CPUCommandQueue*)commandQueue;
+				std::lock_guard<std::mutex> lock(cpu_commandQueue->readbackLock);
+				assert_msg(readback_ring::release(cpu_commandQueue->readbackRing, ticket), "Invalid or released readback ticket.");
+			}
+
+			void flush(CommandQueue)
+			{
+				// Execution is synchronous, everything that was submitted is already complete
+			}
+
+			bool is_complete(CommandQueue commandQueue, uint64_t point)
+			{
+				return timeline::is_complete(((CPUCommandQueue*)commandQueue)->timeline, point);
+			}
+
+			bool wait(CommandQueue commandQueue, uint64_t point, uint64_t timeoutMS)
+			{
+				return timeline::wait(((CPUCommandQueue*)commandQueue)->timeline, point, timeoutMS);
+			}
+
+			void gather_timelines(const CommandQueue* commandQueues, uint32_t count, bento::Vector<Timeline*>& timelines)
+			{
+				timelines.resize(count);
+				for (uint32_t queueIdx = 0; queueIdx < count; ++queueIdx)
+					timelines[queueIdx] = ((CPUCommandQueue*)commandQueues[queueIdx])->timeline;
+			}
+
+			uint32_t wait_any(const CommandQueue* commandQueues, const uint64_t* points, uint32_t count, uint64_t timeoutMS)
+			{
+				bento::Vector<Timeline*> timelines(*bento::common_allocator());
+				gather_timelines(commandQueues, count, timelines);
+				return timeline::wait_any(timelines.begin(), points, count, timeoutMS);
+			}
+
+			bool wait_all(const CommandQueue* commandQueues, const uint64_t* points, uint32_t count, uint64_t timeoutMS)
+			{
+				bento::Vector<Timeline*> timelines(*bento::common_allocator());
+				gather_timelines(commandQueues, count, timelines);
+				return timeline::wait_all(timelines.begin(), points, count, timeoutMS);
+			}
+
+			void add_completion_callback(CommandQueue commandQueue, uint64_t point, TimelineCallback callback, void* userData)
+			{
+				timeline::add_callback(((CPUCommandQueue*)commandQueue)->timeline, point, callback, userData);
+			}
+		}
+
+		namespace profiling_scope
+		{
+			ProfilingScope create_profiling_scope(GraphicsDevice, CommandQueue)
+			{
+				CPUQuery* queryI = bento::make_new<CPUQuery>(*bento::common_allocator());
+				queryI->timestamps[0] = 0;
+				queryI->timestamps[1] = 0;
+				return (ProfilingScope)queryI;
+			}
+
+			void destroy_profiling_scope(ProfilingScope profilingScope)
+			{
+				CPUQuery* query = (CPUQuery*)profilingScope;
+				bento::make_delete<CPUQuery>(*bento::common_allocator(), query);
+			}
+
+			uint64_t get_duration_us(ProfilingScope profilingScope)
+			{
+				// Timestamps are in nanoseconds
+				CPUQuery* query = (CPUQuery*)profilingScope;
+				return (query->timestamps[1] - query->timestamps[0]) / 1000;
+			}
+		}
+	}
+}
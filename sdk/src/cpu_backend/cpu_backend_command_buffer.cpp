@@ -0,0 +1,287 @@
+// Bento includes
+#include <bento_base/security.h>
+#include <bento_memory/common.h>
+
+// Internal includes
+#include "cpu_backend/cpu_backend.h"
+#include "cpu_backend/cpu_containers.h"
+
+// System includes
+#include <algorithm>
+#include <chrono>
+
+namespace graphics_sandbox
+{
+	namespace cpu
+	{
+		// Command Buffer API
+		namespace command_buffer
+		{
+			CPUCommand& push_command(CPUCommandBuffer* commandBuffer, CPUCommandType type)
+			{
+				assert_msg(!commandBuffer->closed, "Cannot record in a closed command buffer.");
+				CPUCommand command = {};
+				command.type = type;
+				commandBuffer->commands.push_back(command);
+				return commandBuffer->commands[commandBuffer->commands.size() - 1];
+			}
+
+			CommandBuffer create_command_buffer(GraphicsDevice graphicsDevice)
+			{
+				bento::IAllocator* allocator = bento::common_allocator();
+				assert(allocator != nullptr);
+
+				// Create the command buffer, it starts closed like the GPU ones
+				CPUCommandBuffer* cpu_commandBuffer = bento::make_new<CPUCommandBuffer>(*allocator, *allocator);
+				cpu_commandBuffer->deviceI = (CPUGraphicsDevice*)graphicsDevice;
+				cpu_commandBuffer->closed = true;
+
+				// Convert to the opaque structure
+				return (CommandBuffer)cpu_commandBuffer;
+			}
+
+			void cancel_readbacks(CPUCommandBuffer* commandBuffer)
+			{
+				// The copies recorded since the last execution will never run
+				CPUGraphicsDevice* deviceI = commandBuffer->deviceI;
+				std::lock_guard<std::mutex> lock(deviceI->queuesLock);
+				for (uint32_t queueIdx = 0; queueIdx < deviceI->queues.size(); ++queueIdx)
+				{
+					CPUCommandQueue* commandQueue = deviceI->queues[queueIdx];
+					std::lock_guard<std::mutex> readbackLock(commandQueue->readbackLock);
+					readback_ring::cancel(commandQueue->readbackRing, (uint64_t)commandBuffer);
+				}
+			}
+
+			void destroy_command_buffer(CommandBuffer command_buffer)
+			{
+				CPUCommandBuffer* cpu_commandBuffer = (CPUCommandBuffer*)command_buffer;
+				cancel_readbacks(cpu_commandBuffer);
+				bento::make_delete<CPUCommandBuffer>(*bento::common_allocator(), cpu_commandBuffer);
+			}
+
+			void reset(CommandBuffer commandBuffer)
+			{
+				CPUCommandBuffer* cpu_commandBuffer = (CPUCommandBuffer*)commandBuffer;
+				cancel_readbacks(cpu_commandBuffer);
+				cpu_commandBuffer->commands.clear();
+				cpu_commandBuffer->constantData.clear();
+				cpu_commandBuffer->copyRegions.clear();
+				cpu_commandBuffer->closed = false;
+			}
+
+			void close(CommandBuffer commandBuffer)
+			{
+				CPUCommandBuffer* cpu_commandBuffer = (CPUCommandBuffer*)commandBuffer;
+				cpu_commandBuffer->closed = true;
+			}
+
+			void copy_graphics_buffer(CommandBuffer commandBuffer, GraphicsBuffer inputBuffer, GraphicsBuffer outputBuffer)
+			{
+				CPUCommand& command = push_command((CPUCommandBuffer*)commandBuffer, CPUCommandType::CopyBuffer);
+				command.source = (CPUGraphicsBuffer*)inputBuffer;
+				command.destination = (CPUGraphicsBuffer*)outputBuffer;
+			}
+
+			void copy_constant_buffer(CommandBuffer commandBuffer, ConstantBuffer inputBuffer, ConstantBuffer outputBuffer)
+			{
+				copy_graphics_buffer(commandBuffer, (GraphicsBuffer)inputBuffer, (GraphicsBuffer)outputBuffer);
+			}
+
+			void copy_buffer_regions(CommandBuffer commandBuffer, GraphicsBuffer inputBuffer, GraphicsBuffer outputBuffer, const BufferCopyRegion* regions, uint32_t numRegions)
+			{
+				CPUCommandBuffer* cpu_commandBuffer = (CPUCommandBuffer*)commandBuffer;
+				CPUGraphicsBuffer* source = (CPUGraphicsBuffer*)inputBuffer;
+				CPUGraphicsBuffer* destination = (CPUGraphicsBuffer*)outputBuffer;
+				assert_msg(source != destination, "Copies within a buffer are not supported.");
+
+				// The regions of all the copies share the same array, only the merged ones are kept
+				bento::Vector<BufferCopyRegion> merged(*bento::common_allocator());
+				merged.resize(numRegions);
+				for (uint32_t regionIdx = 0; regionIdx < numRegions; ++regionIdx)
+				{
+					assert_msg(buffer_copy_list::validate_region(source->bufferSize, destination->bufferSize, regions[regionIdx]), "The copy region doesn't fit in the buffers.");
+					merged[regionIdx] = regions[regionIdx];
+				}
+				assert_msg(buffer_copy_list::coalesce(merged), "Copy regions write the same bytes from different sources.");
+				uint32_t offset = cpu_commandBuffer->copyRegions.size();
+				cpu_commandBuffer->copyRegions.resize(offset + merged.size());
+				for (uint32_t regionIdx = 0; regionIdx < merged.size(); ++regionIdx)
+					cpu_commandBuffer->copyRegions[offset + regionIdx] = merged[regionIdx];
+
+				CPUCommand& command = push_command(cpu_commandBuffer, CPUCommandType::CopyBufferRegions);
+				command.source = source;
+				command.destination = destination;
+				command.offset = offset;
+				command.size[0] = merged.size();
+			}
+
+			void copy_buffer_region(CommandBuffer commandBuffer, GraphicsBuffer inputBuffer, uint64_t inputOffset, GraphicsBuffer outputBuffer, uint64_t outputOffset, uint64_t size)
+			{
+				BufferCopyRegion region = { inputOffset, outputOffset, size };
+				copy_buffer_regions(commandBuffer, inputBuffer, outputBuffer, &region, 1);
+			}
+
+			void uav_barrier(CommandBuffer, GraphicsBuffer)
+			{
+				// Every command is complete before the next one starts, nothing to do
+			}
+
+			void set_compute_resource(CommandBuffer commandBuffer, CPUCommandType type, ComputeShader computeShader, uint32_t slot, uint64_t graphicsBuffer)
+			{
+				assert_msg(slot < CPU_MAX_BOUND_RESOURCES, "Invalid resource slot.");
+				CPUCommand& command = push_command((CPUCommandBuffer*)commandBuffer, type);
+				command.shader = (CPUComputeShader*)computeShader;
+				command.source = (CPUGraphicsBuffer*)graphicsBuffer;
+				command.slot = slot;
+			}
+
+			void set_compute_graphics_buffer_uav(CommandBuffer commandBuffer, ComputeShader computeShader, uint32_t slot, GraphicsBuffer graphicsBuffer)
+			{
+				set_compute_resource(commandBuffer, CPUCommandType::SetUAV, computeShader, slot, graphicsBuffer);
+			}
+
+			void set_compute_graphics_buffer_srv(CommandBuffer commandBuffer, ComputeShader computeShader, uint32_t slot, GraphicsBuffer graphicsBuffer)
+			{
+				set_compute_resource(commandBuffer, CPUCommandType::SetSRV, computeShader, slot, graphicsBuffer);
+			}
+
+			void set_compute_graphics_buffer_cbv(CommandBuffer commandBuffer, ComputeShader computeShader, uint32_t slot, ConstantBuffer constantBuffer)
+			{
+				set_compute_resource(commandBuffer, CPUCommandType::SetCBV, computeShader, slot, constantBuffer);
+			}
+
+			void set_compute_constants(CommandBuffer commandBuffer, ComputeShader computeShader, uint32_t slot, const void* data, uint32_t size)
+			{
+				CPUCommandBuffer* cpu_commandBuffer = (CPUCommandBuffer*)commandBuffer;
+				CPUComputeShader* cpu_computeShader = (CPUComputeShader*)computeShader;
+				assert_msg(slot < cpu_computeShader->rootConstantCount, "Invalid root constant slot.");
+				assert_msg(size % sizeof(uint32_t) == 0 && size <= cpu_computeShader->rootConstantSize[slot] * sizeof(uint32_t), "Invalid root constant size.");
+
+				// Capture the values, they are only written in the shader's storage when the command executes
+				uint32_t offset = cpu_commandBuffer->constantData.size();
+				cpu_commandBuffer->constantData.resize(offset + size / sizeof(uint32_t));
+				memcpy(cpu_commandBuffer->constantData.begin() + offset, data, size);
+
+				CPUCommand& command = push_command(cpu_commandBuffer, CPUCommandType::SetConstants);
+				command.shader = cpu_computeShader;
+				command.slot = slot;
+				command.size[0] = offset;
+				command.size[1] = size / sizeof(uint32_t);
+			}
+
+			void set_compute_cbv_address(CommandBuffer commandBuffer, ComputeShader computeShader, uint32_t slot, ConstantBuffer constantBuffer, uint64_t offset)
+			{
+				CPUComputeShader* cpu_computeShader = (CPUComputeShader*)computeShader;
+				CPUGraphicsBuffer* buffer = (CPUGraphicsBuffer*)constantBuffer;
+				assert_msg(slot < cpu_computeShader->rootCbvCount, "Invalid root CBV slot.");
+				assert_msg(offset % CPU_CONSTANT_BUFFER_ALIGNEMENT_SIZE == 0 && offset < buffer->bufferSize, "Invalid root CBV offset.");
+
+				CPUCommand& command = push_command((CPUCommandBuffer*)commandBuffer, CPUCommandType::SetRootCBV);
+				command.shader = cpu_computeShader;
+				command.source = buffer;
+				command.slot = slot;
+				command.offset = offset;
+			}
+
+			void dispatch(CommandBuffer commandBuffer, ComputeShader computeShader, uint32_t sizeX, uint32_t sizeY, uint32_t sizeZ)
+			{
+				CPUCommand& command = push_command((CPUCommandBuffer*)commandBuffer, CPUCommandType::Dispatch);
+				command.shader = (CPUComputeShader*)computeShader;
+				command.size[0] = sizeX;
+				command.size[1] = sizeY;
+				command.size[2] = sizeZ;
+			}
+
+			void enable_profiling_scope(CommandBuffer commandBuffer, ProfilingScope profilingScope)
+			{
+				CPUCommand& command = push_command((CPUCommandBuffer*)commandBuffer, CPUCommandType::BeginProfiling);
+				command.query = (CPUQuery*)profilingScope;
+			}
+
+			void disable_profiling_scope(CommandBuffer commandBuffer, ProfilingScope profilingScope)
+			{
+				CPUCommand& command = push_command((CPUCommandBuffer*)commandBuffer, CPUCommandType::EndProfiling);
+				command.query = (CPUQuery*)profilingScope;
+			}
+
+			void bind_view(CPUBufferView& view, const CPUGraphicsBuffer* buffer, uint64_t offset = 0)
+			{
+				view.data = buffer->data + offset;
+				view.bufferSize = buffer->bufferSize - offset;
+				view.elementSize = buffer->elementSize;
+			}
+
+			void execute_dispatch(CPUGraphicsDevice* deviceI, CPUComputeShader* computeShader, const uint32_t size[3])
+			{
+				CPUKernelContext& context = computeShader->context;
+				memcpy(context.dispatchSize, size, sizeof(context.dispatchSize));
+
+				// Batches need to be long enough for the kernel's inner loop to vectorize and to amortize the stealing, but numerous enough
+				// for every thread of the pool to get a few of them.
+				uint32_t numGroups = size[0] * size[1] * size[2];
+				uint32_t threadsPerGroup = computeShader->groupSize[0] * computeShader->groupSize[1] * computeShader->groupSize[2];
+				uint32_t numThreads = work_stealing_pool::num_threads(deviceI->pool);
+				uint32_t groupsPerBatch = std::max(numGroups / (numThreads * CPU_BATCHES_PER_THREAD), CPU_MIN_THREADS_PER_BATCH / threadsPerGroup);
+				groupsPerBatch = std::max(groupsPerBatch, 1u);
+
+				const CPUKernelFunction& kernel = computeShader->kernel;
+				work_stealing_pool::parallel_for(deviceI->pool, numGroups, groupsPerBatch, [&](uint32_t groupBegin, uint32_t groupEnd)
+				{
+					kernel(context, groupBegin, groupEnd);
+				});
+			}
+
+			uint64_t current_timestamp()
+			{
+				return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+			}
+
+			void execute_commands(CPUCommandBuffer* commandBuffer)
+			{
+				uint32_t numCommands = commandBuffer->commands.size();
+				for (uint32_t commandIdx = 0; commandIdx < numCommands; ++commandIdx)
+				{
+					const CPUCommand& command = commandBuffer->commands[commandIdx];
+					switch (command.type)
+					{
+					case CPUCommandType::CopyBuffer:
+						memcpy(command.destination->data, command.source->data, std::min(command.source->bufferSize, command.destination->bufferSize));
+						break;
+					case CPUCommandType::CopyBufferRegions:
+						for (uint32_t regionIdx = 0; regionIdx < command.size[0]; ++regionIdx)
+						{
+							const BufferCopyRegion& region = commandBuffer->copyRegions[(uint32_t)command.offset + regionIdx];
+							memcpy(command.destination->data + region.dstOffset, command.source->data + region.srcOffset, region.size);
+						}
+						break;
+					case CPUCommandType::SetSRV:
+						bind_view(command.shader->context.srv[command.slot], command.source);
+						break;
+					case CPUCommandType::SetUAV:
+						bind_view(command.shader->context.uav[command.slot], command.source);
+						break;
+					case CPUCommandType::SetCBV:
+						bind_view(command.shader->context.cbv[command.slot], command.source);
+						break;
+					case CPUCommandType::SetConstants:
+						memcpy(command.shader->rootConstantData + command.shader->rootConstantOffset[command.slot], commandBuffer->constantData.begin() + command.size[0], command.size[1] * sizeof(uint32_t));
+						break;
+					case CPUCommandType::SetRootCBV:
+						bind_view(command.shader->context.rootCbv[command.slot], command.source, command.offset);
+						break;
+					case CPUCommandType::Dispatch:
+						execute_dispatch(commandBuffer->deviceI, command.shader, command.size);
+						break;
+					case CPUCommandType::BeginProfiling:
+						command.query->timestamps[0] = current_timestamp();
+						break;
+					case CPUCommandType::EndProfiling:
+						command.query->timestamps[1] = current_timestamp();
+						break;
+					}
+				}
+			}
+		}
+	}
+}
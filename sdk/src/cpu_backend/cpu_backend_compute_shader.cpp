@@ -0,0 +1,88 @@
+// Bento includes
+#include <bento_base/security.h>
+#include <bento_memory/common.h>
+
+// Internal includes
+#include "cpu_backend/cpu_backend.h"
+#include "cpu_backend/cpu_containers.h"
+
+// System includes
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace graphics_sandbox
+{
+	namespace cpu
+	{
+		namespace compute_shader
+		{
+			struct CPUKernelRecord
+			{
+				CPUKernelFunction kernel;
+				uint32_t groupSize[3];
+			};
+
+			// Registry that plays the role of the shader library
+			static std::mutex kernelRegistryLock;
+			static std::unordered_map<std::string, CPUKernelRecord> kernelRegistry;
+
+			void register_kernel(const char* kernelName, uint32_t groupSizeX, uint32_t groupSizeY, uint32_t groupSizeZ, const CPUKernelFunction& kernel)
+			{
+				assert_msg(groupSizeX * groupSizeY * groupSizeZ > 0, "Invalid kernel group size.");
+				CPUKernelRecord record;
+				record.kernel = kernel;
+				record.groupSize[0] = groupSizeX;
+				record.groupSize[1] = groupSizeY;
+				record.groupSize[2] = groupSizeZ;
+
+				std::lock_guard<std::mutex> lock(kernelRegistryLock);
+				kernelRegistry[kernelName] = record;
+			}
+
+			ComputeShader create_compute_shader(GraphicsDevice, const ComputeShaderDescriptor& csd)
+			{
+				assert_msg(csd.srvCount <= CPU_MAX_BOUND_RESOURCES && csd.uavCount <= CPU_MAX_BOUND_RESOURCES && csd.cbvCount <= CPU_MAX_BOUND_RESOURCES, "Too many resources for a CPU kernel.");
+
+				// Find the kernel
+				std::lock_guard<std::mutex> lock(kernelRegistryLock);
+				auto recordIt = kernelRegistry.find(csd.kernelname.c_str());
+				assert_msg(recordIt != kernelRegistry.end(), "Unknown CPU kernel, it needs to be registered before creating the compute shader.");
+
+				// Create and fill our internal structure
+				CPUComputeShader* cS = bento::make_new<CPUComputeShader>(*bento::common_allocator());
+				cS->kernel = recordIt->second.kernel;
+				memcpy(cS->groupSize, recordIt->second.groupSize, sizeof(cS->groupSize));
+				cS->srvCount = csd.srvCount;
+				cS->uavCount = csd.uavCount;
+				cS->cbvCount = csd.cbvCount;
+				memset(&cS->context, 0, sizeof(CPUKernelContext));
+				memcpy(cS->context.groupSize, cS->groupSize, sizeof(cS->groupSize));
+
+				// Lay out the root constant ranges
+				cS->rootConstantCount = csd.rootConstantSizes.size();
+				cS->rootCbvCount = csd.rootCbvCount;
+				assert_msg(cS->rootConstantCount <= CPU_MAX_BOUND_RESOURCES && cS->rootCbvCount <= CPU_MAX_BOUND_RESOURCES, "Too many root parameters for a CPU kernel.");
+				uint32_t totalConstants = 0;
+				for (uint32_t rangeIdx = 0; rangeIdx < cS->rootConstantCount; ++rangeIdx)
+				{
+					cS->rootConstantOffset[rangeIdx] = totalConstants;
+					cS->rootConstantSize[rangeIdx] = csd.rootConstantSizes[rangeIdx];
+					cS->context.rootConstants[rangeIdx] = cS->rootConstantData + totalConstants;
+					totalConstants += csd.rootConstantSizes[rangeIdx];
+				}
+				assert_msg(totalConstants <= CPU_MAX_ROOT_CONSTANTS, "Too many root constants for a CPU kernel.");
+				memset(cS->rootConstantData, 0, sizeof(cS->rootConstantData));
+
+				// Convert to the opaque structure
+				return (ComputeShader)cS;
+			}
+
+			void destroy_compute_shader(ComputeShader computeShader)
+			{
+				CPUComputeShader* cpu_computeShader = (CPUComputeShader*)computeShader;
+				bento::make_delete<CPUComputeShader>(*bento::common_allocator(), cpu_computeShader);
+			}
+		}
+	}
+}
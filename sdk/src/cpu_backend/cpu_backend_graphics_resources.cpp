@@ -0,0 +1,87 @@
+// Bento includes
+#include <bento_base/security.h>
+#include <bento_memory/common.h>
+
+// Internal includes
+#include "cpu_backend/cpu_backend.h"
+#include "cpu_backend/cpu_containers.h"
+
+namespace graphics_sandbox
+{
+	namespace cpu
+	{
+		namespace graphics_resources
+		{
+			GraphicsBuffer create_graphics_buffer(GraphicsDevice, uint64_t bufferSize, uint32_t elementSize, GraphicsBufferType bufferType)
+			{
+				bento::IAllocator* allocator = bento::common_allocator();
+				assert(allocator != nullptr);
+
+				// Every heap type is plain system memory, the alignment keeps the kernels' vector loads on cache lines
+				CPUGraphicsBuffer* cpu_graphicsBuffer = bento::make_new<CPUGraphicsBuffer>(*allocator);
+				cpu_graphicsBuffer->data = (char*)allocator->allocate(bufferSize, CPU_BUFFER_ALIGNEMENT_SIZE);
+				assert_msg(cpu_graphicsBuffer->data != nullptr, "Failed to create the graphics buffer.");
+				memset(cpu_graphicsBuffer->data, 0, bufferSize);
+				cpu_graphicsBuffer->bufferSize = bufferSize;
+				cpu_graphicsBuffer->elementSize = elementSize;
+				cpu_graphicsBuffer->type = bufferType;
+
+				// Return the opaque structure
+				return (GraphicsBuffer)cpu_graphicsBuffer;
+			}
+
+			void destroy_graphics_buffer(GraphicsBuffer graphicsBuffer)
+			{
+				CPUGraphicsBuffer* cpu_buffer = (CPUGraphicsBuffer*)graphicsBuffer;
+				bento::IAllocator* allocator = bento::common_allocator();
+				allocator->deallocate(cpu_buffer->data);
+				bento::make_delete<CPUGraphicsBuffer>(*allocator, cpu_buffer);
+			}
+
+			void set_data(GraphicsBuffer graphicsBuffer, char* buffer, uint64_t bufferSize)
+			{
+				// Convert to the internal structure
+				CPUGraphicsBuffer* cpu_buffer = (CPUGraphicsBuffer*)graphicsBuffer;
+
+				// Same rules as the GPU backends, only upload buffers are writable
+				if (cpu_buffer->type != GraphicsBufferType::Upload)
+					return;
+				memcpy(cpu_buffer->data, buffer, bufferSize);
+			}
+
+			char* allocate_cpu_buffer(GraphicsBuffer graphicsBuffer)
+			{
+				// Same rules as the GPU backends, only readback buffers are readable
+				CPUGraphicsBuffer* cpu_buffer = (CPUGraphicsBuffer*)graphicsBuffer;
+				if (cpu_buffer->type != GraphicsBufferType::Readback)
+					return nullptr;
+				return cpu_buffer->data;
+			}
+
+			void release_cpu_buffer(GraphicsBuffer)
+			{
+				// Nothing to unmap
+			}
+
+			ConstantBuffer create_constant_buffer(GraphicsDevice graphicsDevice, uint64_t bufferSize, uint32_t elementSize, ConstantBufferType bufferType)
+			{
+				// Keep the same size rules as the GPU backends
+				uint64_t alignedSize = (bufferSize + (CPU_CONSTANT_BUFFER_ALIGNEMENT_SIZE - 1)) / CPU_CONSTANT_BUFFER_ALIGNEMENT_SIZE;
+				GraphicsBuffer buffer = create_graphics_buffer(graphicsDevice, alignedSize * CPU_CONSTANT_BUFFER_ALIGNEMENT_SIZE, elementSize, bufferType == ConstantBufferType::Static ? GraphicsBufferType::Upload : GraphicsBufferType::Default);
+				return (ConstantBuffer)buffer;
+			}
+
+			void destroy_constant_buffer(ConstantBuffer constantBuffer)
+			{
+				destroy_graphics_buffer((GraphicsBuffer)constantBuffer);
+			}
+
+			void upload_constant_buffer(ConstantBuffer constantBuffer, const char* bufferData, uint32_t bufferSize)
+			{
+				CPUGraphicsBuffer* buffer = (CPUGraphicsBuffer*)constantBuffer;
+				assert_msg(buffer->type == GraphicsBufferType::Upload, "An upload operation can only be done on an upload constant buffer.");
+				memcpy(buffer->data, bufferData, bufferSize);
+			}
+		}
+	}
+}
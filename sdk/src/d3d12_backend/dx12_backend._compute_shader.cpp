@@ -7,68 +7,231 @@
 #include "d3d12_backend/dx12_backend.h"
 #include "d3d12_backend/dx12_containers.h"
 #include "tools/string_utilities.h"
+#include "gpu_backend/shader_cache.h"
+#include "gpu_backend/shader_reflection.h"
+#include "gpu_backend/object_cache.h"
+#include "gpu_backend/shader_permutation.h"
+#include "gpu_backend/hot_reload.h"
+#include "gpu_backend/dispatch_autotuner.h"
+#include "tools/job_batch.h"
+
+// DX12 includes
+#include <d3d12shader.h>
+
+// System includes
+#include <algorithm>
+#include <chrono>
+#include <cwchar>
 
 namespace graphics_sandbox
 {
     namespace d3d12
     {
+        namespace graphics_device
+        {
+            void defer_release(DX12GraphicsDevice* deviceI, uint64_t object, DeferredReleaseFunction releaseFunction);
+        }
+
+        namespace graphics_resources
+        {
+            void unpin_range_view(GraphicsBuffer graphicsBuffer, uint64_t key);
+        }
+
         namespace compute_shader
         {
-            DX12DescriptorHeap create_desriptor_heap(GraphicsDevice graphicsDevice, uint32_t srvCount, uint32_t uavCount, uint32_t cbvCount)
+            // Appends the root constant ranges and the root CBVs
+            uint32_t append_root_parameters(DX12ComputeShader* computeShader, const ComputeShaderDescriptor& layout, D3D12_ROOT_PARAMETER1* rootParameters, uint32_t paramIdx)
             {
-                DX12GraphicsDevice* deviceI = (DX12GraphicsDevice*)graphicsDevice;
+                uint32_t numRanges = layout.rootConstantSizes.size();
+                computeShader->rootConstantRanges.resize(numRanges);
+                uint32_t totalConstants = 0;
+                for (uint32_t rangeIdx = 0; rangeIdx < numRanges; ++rangeIdx)
+                {
+                    DX12RootConstantRange& range = computeShader->rootConstantRanges[rangeIdx];
+                    range.rootIndex = paramIdx;
+                    range.offset = totalConstants;
+                    range.count = layout.rootConstantSizes[rangeIdx];
+                    totalConstants += range.count;
+
+                    D3D12_ROOT_PARAMETER1& parameter = rootParameters[paramIdx++];
+                    parameter = {};
+                    parameter.ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+                    parameter.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+                    parameter.Constants.ShaderRegister = rangeIdx; // b0..bN
+                    parameter.Constants.RegisterSpace = 1;
+                    parameter.Constants.Num32BitValues = range.count;
+                }
+                computeShader->rootConstantData.resize(totalConstants);
+                for (uint32_t constantIdx = 0; constantIdx < totalConstants; ++constantIdx)
+                    computeShader->rootConstantData[constantIdx] = 0;
+
+                computeShader->rootCbvIndex = layout.rootCbvCount > 0 ? paramIdx : UINT32_MAX;
+                computeShader->rootCbvAddresses.resize(layout.rootCbvCount);
+                for (uint32_t cbvIdx = 0; cbvIdx < layout.rootCbvCount; ++cbvIdx)
+                {
+                    computeShader->rootCbvAddresses[cbvIdx] = 0;
+                    D3D12_ROOT_PARAMETER1& parameter = rootParameters[paramIdx++];
+                    parameter = {};
+                    parameter.ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
+                    parameter.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+                    parameter.Descriptor.ShaderRegister = cbvIdx; // b0..bN
+                    parameter.Descriptor.RegisterSpace = 2;
+                    // The constants can be updated between submissions, but not while a dispatch reads them
+                    parameter.Descriptor.Flags = D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE;
+                }
 
-                // Create the descriptor heap for this compute shader
-                DX12DescriptorHeap descriptorHeap;
-                ID3D12DescriptorHeap* descHeap = (ID3D12DescriptorHeap*)descriptor_heap::create_descriptor_heap(graphicsDevice, srvCount + uavCount + cbvCount, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-                descriptorHeap.descriptorHeap = descHeap;
-
-                // Pre-evaluate the CPU Heap handles
-                uint32_t descSize = deviceI->descriptorSize[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV];
-                descriptorHeap.srvCPU = descHeap->GetCPUDescriptorHandleForHeapStart();
-                descriptorHeap.uavCPU = descriptorHeap.srvCPU;
-                descriptorHeap.uavCPU.ptr += (uint64_t)srvCount * descSize;
-                descriptorHeap.cbvCPU = descriptorHeap.uavCPU;
-                descriptorHeap.cbvCPU.ptr += (uint64_t)uavCount * descSize;
-
-                // Pre-evaluate the GPU Heap handles
-                descriptorHeap.srvGPU = descHeap->GetGPUDescriptorHandleForHeapStart();
-                descriptorHeap.uavGPU = descriptorHeap.srvGPU;
-                descriptorHeap.uavGPU.ptr += (uint64_t)srvCount * descSize;
-                descriptorHeap.cbvGPU = descriptorHeap.uavGPU;
-                descriptorHeap.cbvGPU.ptr += (uint64_t)uavCount * descSize;
-
-                return descriptorHeap;
+                // A root signature is limited to 64 DWORDs, tables cost 1, constants 1 per value and root descriptors 2
+                uint32_t rootSignatureSize = (layout.bindless ? layout.srvCount + layout.uavCount + layout.cbvCount : 0) + totalConstants + 2 * layout.rootCbvCount;
+                rootSignatureSize += (computeShader->srvIndex != UINT32_MAX) + (computeShader->uavIndex != UINT32_MAX) + (computeShader->cbvIndex != UINT32_MAX);
+                assert_msg(rootSignatureSize <= DX12_MAX_ROOT_SIGNATURE_SIZE, "The root signature is too large.");
+                return paramIdx;
             }
 
-            void destroy_descriptor_heap(DX12DescriptorHeap& descriptorHeap)
+            // Appends a descriptor table covering the registers [0, count) of space0, returns the root index or UINT32_MAX if there is nothing to bind
+            uint32_t append_table(D3D12_DESCRIPTOR_RANGE_TYPE rangeType, D3D12_DESCRIPTOR_RANGE_FLAGS flags, uint32_t count, D3D12_ROOT_PARAMETER1* rootParameters, D3D12_DESCRIPTOR_RANGE1* ranges, uint32_t& paramIdx)
             {
-                descriptorHeap.descriptorHeap->Release();
+                if (count == 0)
+                    return UINT32_MAX;
+                D3D12_DESCRIPTOR_RANGE1& range = ranges[paramIdx];
+                range = {};
+                range.RangeType = rangeType;
+                range.NumDescriptors = count;
+                range.BaseShaderRegister = 0;
+                range.RegisterSpace = 0;
+                range.Flags = flags;
+                range.OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
+
+                D3D12_ROOT_PARAMETER1& parameter = rootParameters[paramIdx];
+                parameter = {};
+                parameter.ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+                parameter.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+                parameter.DescriptorTable.NumDescriptorRanges = 1;
+                parameter.DescriptorTable.pDescriptorRanges = &range;
+                return paramIdx++;
             }
 
-            void validate_compute_shader_heap(DX12ComputeShader* computeShader, uint32_t cmdBatchIndex)
+            // Reads the bindings and the thread group size from the DXIL container
+            bool reflect_kernel(IDxcBlob* shaderBlob, ShaderReflection& reflection)
             {
-                // We need to check if we've entered a new frame. If it is the case we just need to:
-                //  - Update the next usable heap to the first one and we're done
-                //  - Update the command buffer batch index accordinly
-                // This is true because we always have at least one allocated heap.
-                if (computeShader->cmdBatchIndex != cmdBatchIndex)
+                IDxcContainerReflection* containerReflection;
+                DxcCreateInstance(CLSID_DxcContainerReflection, IID_PPV_ARGS(&containerReflection));
+                UINT32 partIndex;
+                ID3D12ShaderReflection* shaderReflection = nullptr;
+                bool found = containerReflection->Load(shaderBlob) == S_OK
+                    && containerReflection->FindFirstPartKind(DXC_PART_DXIL, &partIndex) == S_OK
+                    && containerReflection->GetPartReflection(partIndex, IID_PPV_ARGS(&shaderReflection)) == S_OK;
+                containerReflection->Release();
+                if (!found)
+                    return false;
+
+                shader_reflection::reset(reflection);
+                shaderReflection->GetThreadGroupSize(&reflection.groupSize[0], &reflection.groupSize[1], &reflection.groupSize[2]);
+                D3D12_SHADER_DESC shaderDesc;
+                shaderReflection->GetDesc(&shaderDesc);
+                for (uint32_t resourceIdx = 0; resourceIdx < shaderDesc.BoundResources; ++resourceIdx)
                 {
-                    computeShader->nextUsableHeap = 0;
-                    computeShader->cmdBatchIndex = cmdBatchIndex;
-                    return;
+                    D3D12_SHADER_INPUT_BIND_DESC bindDesc;
+                    shaderReflection->GetResourceBindingDesc(resourceIdx, &bindDesc);
+                    assert_msg(bindDesc.BindCount != 0, "Unbounded resource arrays are not supported.");
+                    switch (bindDesc.Type)
+                    {
+                    case D3D_SIT_CBUFFER:
+                    {
+                        // Only keep the bytes that are actually declared, the buffer size is padded to 16 bytes
+                        ID3D12ShaderReflectionConstantBuffer* constantBuffer = shaderReflection->GetConstantBufferByName(bindDesc.Name);
+                        D3D12_SHADER_BUFFER_DESC bufferDesc;
+                        constantBuffer->GetDesc(&bufferDesc);
+                        uint32_t size = 0;
+                        for (uint32_t variableIdx = 0; variableIdx < bufferDesc.Variables; ++variableIdx)
+                        {
+                            D3D12_SHADER_VARIABLE_DESC variableDesc;
+                            constantBuffer->GetVariableByIndex(variableIdx)->GetDesc(&variableDesc);
+                            size = std::max(size, variableDesc.StartOffset + variableDesc.Size);
+                        }
+                        shader_reflection::add_binding(reflection, ShaderBindingType::CBV, bindDesc.BindPoint, bindDesc.Space, bindDesc.BindCount, size);
+                    }
+                    break;
+                    case D3D_SIT_TBUFFER:
+                    case D3D_SIT_TEXTURE:
+                    case D3D_SIT_STRUCTURED:
+                    case D3D_SIT_BYTEADDRESS:
+                        shader_reflection::add_binding(reflection, ShaderBindingType::SRV, bindDesc.BindPoint, bindDesc.Space, bindDesc.BindCount);
+                        break;
+                    case D3D_SIT_UAV_RWTYPED:
+                    case D3D_SIT_UAV_RWSTRUCTURED:
+                    case D3D_SIT_UAV_RWBYTEADDRESS:
+                    case D3D_SIT_UAV_APPEND_STRUCTURED:
+                    case D3D_SIT_UAV_CONSUME_STRUCTURED:
+                    case D3D_SIT_UAV_RWSTRUCTURED_WITH_COUNTER:
+                        shader_reflection::add_binding(reflection, ShaderBindingType::UAV, bindDesc.BindPoint, bindDesc.Space, bindDesc.BindCount);
+                        break;
+                    default:
+                        assert_msg(false, "Unsupported resource type.");
+                        break;
+                    }
+                }
+                shaderReflection->Release();
+                return shader_reflection::validate(reflection);
+            }
+
+            // Fills the counts that the descriptor left to 0 with the reflected ones and checks the others
+            void resolve_layout(const ShaderReflection& reflection, ComputeShaderDescriptor& layout)
+            {
+                // Bindless kernels go through the heap, only b0 (the slot indices) is visible
+                if (!layout.bindless)
+                {
+                    uint32_t* counts[3] = { &layout.srvCount, &layout.uavCount, &layout.cbvCount };
+                    for (uint32_t typeIdx = 0; typeIdx < 3; ++typeIdx)
+                    {
+                        uint32_t reflected = shader_reflection::register_range(reflection, (ShaderBindingType)typeIdx, 0);
+                        assert_msg(*counts[typeIdx] == 0 || *counts[typeIdx] >= reflected, "The descriptor declares fewer resources than the kernel uses.");
+                        if (*counts[typeIdx] == 0)
+                            *counts[typeIdx] = reflected;
+                    }
                 }
 
-                // If we're tracking properly the current batch but a new heap is required, we need to allocate it.
-                if (computeShader->descriptorHeaps.size() == computeShader->nextUsableHeap)
-                    computeShader->descriptorHeaps.push_back(create_desriptor_heap((GraphicsDevice)computeShader->device, computeShader->srvCount, computeShader->uavCount, computeShader->cbvCount));
+                uint32_t numRanges = shader_reflection::register_range(reflection, ShaderBindingType::CBV, 1);
+                if (layout.rootConstantSizes.size() == 0)
+                {
+                    for (uint32_t rangeIdx = 0; rangeIdx < numRanges; ++rangeIdx)
+                    {
+                        const ShaderBinding* binding = shader_reflection::find_binding(reflection, ShaderBindingType::CBV, rangeIdx, 1);
+                        assert_msg(binding != nullptr, "Root constant registers must be contiguous.");
+                        layout.rootConstantSizes.push_back((binding->size + 3) / 4);
+                    }
+                }
+                assert_msg(layout.rootConstantSizes.size() >= numRanges, "The descriptor declares fewer root constant ranges than the kernel uses.");
+
+                uint32_t numRootCbvs = shader_reflection::register_range(reflection, ShaderBindingType::CBV, 2);
+                assert_msg(layout.rootCbvCount == 0 || layout.rootCbvCount >= numRootCbvs, "The descriptor declares fewer root CBVs than the kernel uses.");
+                if (layout.rootCbvCount == 0)
+                    layout.rootCbvCount = numRootCbvs;
             }
 
-            ComputeShader create_compute_shader(GraphicsDevice graphicsDevice, const ComputeShaderDescriptor& csd)
+            uint64_t compiler_version(DX12GraphicsDevice* deviceI)
+            {
+                // Only queried once, it is part of every shader cache key
+                if (deviceI->compilerVersion == 0)
+                {
+                    IDxcCompiler* compiler;
+                    DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&compiler));
+                    IDxcVersionInfo* versionInfo;
+                    assert_msg(compiler->QueryInterface(IID_PPV_ARGS(&versionInfo)) == S_OK, "Failed to query the compiler version.");
+                    UINT32 major, minor;
+                    versionInfo->GetVersion(&major, &minor);
+                    deviceI->compilerVersion = ((uint64_t)major << 32) | minor;
+                    versionInfo->Release();
+                    compiler->Release();
+                }
+                return deviceI->compilerVersion;
+            }
+
+            IDxcBlob* compile_kernel(const ComputeShaderDescriptor& csd, const char* profile, const bento::Vector<std::string>& arguments)
             {
                 // Convert the strings to wide
                 const std::wstring& filename = convert_to_wide(csd.filename.c_str(), csd.filename.size());
                 const std::wstring& kernelName = convert_to_wide(csd.kernelname.c_str(), csd.kernelname.size());
+                const std::wstring& profileW = convert_to_wide(profile);
 
                 // Create the library and the compiler
                 IDxcLibrary* library;
@@ -79,36 +242,27 @@ namespace graphics_sandbox
                 IDxcBlobEncoding* source_blob;
                 assert_msg(library->CreateBlobFromFile(filename.c_str(), &code_page, &source_blob) == S_OK, "Failed to load the shader code.");
 
+                // Create an include handler
+                IDxcIncludeHandler* includeHandler;
+                library->CreateIncludeHandler(&includeHandler);
+
                 // Release the library
                 library->Release();
 
-                // Compilation arguments
-                bento::Vector<std::wstring> includeDirs(*bento::common_allocator());
-                for (uint32_t includeDirIdx = 0; includeDirIdx < csd.includeDirectories.size(); ++includeDirIdx)
-                {
-                    std::wstring includeArg = L"-I ";
-                    auto& includeDir = csd.includeDirectories[includeDirIdx];
-                    includeArg += convert_to_wide(includeDir.c_str(), includeDir.size());
-                    includeDirs.push_back(includeArg.c_str());
-                }
-
-                bento::Vector<LPCWSTR> arguments(*bento::common_allocator());
-                arguments.push_back(L"-O3");
-                arguments.push_back(L"-enable-16bit-types");
-                for (uint32_t includeDirIdx = 0; includeDirIdx < csd.includeDirectories.size(); ++includeDirIdx)
-                    arguments.push_back(includeDirs[includeDirIdx].c_str());
+                bento::Vector<std::wstring> argumentsW(*bento::common_allocator());
+                bento::Vector<LPCWSTR> argumentsPtr(*bento::common_allocator());
+                for (uint32_t argIdx = 0; argIdx < arguments.size(); ++argIdx)
+                    argumentsW.push_back(convert_to_wide(arguments[argIdx]));
+                for (uint32_t argIdx = 0; argIdx < argumentsW.size(); ++argIdx)
+                    argumentsPtr.push_back(argumentsW[argIdx].c_str());
 
                 // Create the compiler
                 IDxcCompiler* compiler;
                 DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&compiler));
 
-                // Create an include handler
-                IDxcIncludeHandler* includeHandler;
-                library->CreateIncludeHandler(&includeHandler);
-            
                 // Compile the shader
                 IDxcOperationResult* result;
-                HRESULT hr = compiler->Compile(source_blob, filename.c_str(), kernelName.c_str(), L"cs_6_4", arguments.begin(), arguments.size(), nullptr, 0, includeHandler, &result);
+                HRESULT hr = compiler->Compile(source_blob, filename.c_str(), kernelName.c_str(), profileW.c_str(), argumentsPtr.begin(), argumentsPtr.size(), nullptr, 0, includeHandler, &result);
                 if (SUCCEEDED(hr))
                     result->GetStatus(&hr);
                 bool compile_succeed = SUCCEEDED(hr);
@@ -133,131 +287,552 @@ namespace graphics_sandbox
                 // Release all the intermediate resources
                 result->Release();
                 source_blob->Release();
+                includeHandler->Release();
                 compiler->Release();
-        
-                // Grab the graphics device
-                DX12GraphicsDevice* deviceI = (DX12GraphicsDevice*)graphicsDevice;
+                return shader_blob;
+            }
+
+            IDxcBlob* load_kernel(DX12GraphicsDevice* deviceI, const ComputeShaderDescriptor& csd)
+            {
+                // Compilation arguments (ResourceDescriptorHeap requires shader model 6.6)
+                const char* profile = csd.bindless ? "cs_6_6" : "cs_6_4";
+                bento::Vector<std::string> arguments(*bento::common_allocator());
+                arguments.push_back("-O3");
+                arguments.push_back("-enable-16bit-types");
+                for (uint32_t includeDirIdx = 0; includeDirIdx < csd.includeDirectories.size(); ++includeDirIdx)
+                    arguments.push_back(std::string("-I ") + csd.includeDirectories[includeDirIdx].c_str());
+
+                // Canonical defines, equivalent lists share their shader cache entry
+                bento::Vector<bento::DynamicString> defines(*bento::common_allocator());
+                shader_permutation::canonicalize(csd.defines, defines);
+                for (uint32_t defineIdx = 0; defineIdx < defines.size(); ++defineIdx)
+                    arguments.push_back(std::string("-D") + defines[defineIdx].c_str());
+
+                // Without a cache, always compile
+                ShaderCache* cache = deviceI->shaderCache;
+                if (cache == nullptr)
+                    return compile_kernel(csd, profile, arguments);
+
+                bento::Vector<const char*> argumentsPtr(*bento::common_allocator());
+                for (uint32_t argIdx = 0; argIdx < arguments.size(); ++argIdx)
+                    argumentsPtr.push_back(arguments[argIdx].c_str());
+                Hash128 key;
+                bool validKey = shader_cache::compute_key(csd.filename.c_str(), csd.includeDirectories, csd.kernelname.c_str(), profile,
+                    argumentsPtr.begin(), argumentsPtr.size(), compiler_version(deviceI), key);
+
+                // Warm path, DXC is not involved at all
+                const void* cachedData;
+                uint64_t cachedSize;
+                if (validKey && shader_cache::lookup(cache, key, cachedData, cachedSize))
+                {
+                    IDxcLibrary* library;
+                    DxcCreateInstance(CLSID_DxcLibrary, IID_PPV_ARGS(&library));
+                    IDxcBlobEncoding* cachedBlob;
+                    assert_msg(library->CreateBlobWithEncodingOnHeapCopy(cachedData, (UINT32)cachedSize, 0, &cachedBlob) == S_OK, "Failed to create the cached shader blob.");
+                    library->Release();
+                    return cachedBlob;
+                }
+
+                // Cold path, compile and keep the result for the next run
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                IDxcBlob* shaderBlob = compile_kernel(csd, profile, arguments);
+                shader_cache::record_compilation(cache, (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+                if (validKey && shaderBlob != nullptr)
+                    shader_cache::store(cache, key, shaderBlob->GetBufferPointer(), shaderBlob->GetBufferSize());
+                return shaderBlob;
+            }
+
+            // Reloading a kernel that didn't change gives back the same pipeline state object
+            ID3D12PipelineState* acquire_pipeline_state(DX12GraphicsDevice* deviceI, IDxcBlob* shaderBlob, ID3D12RootSignature* rootSignature, const Hash128& rootSignatureKey, Hash128& pipelineKey)
+            {
+                object_cache::pipeline_key(shaderBlob->GetBufferPointer(), shaderBlob->GetBufferSize(), rootSignatureKey, pipelineKey);
+                uint64_t pso;
+                if (object_cache::acquire(deviceI->pipelineStates, pipelineKey, pso))
+                    return (ID3D12PipelineState*)pso;
+
+                // Create the pipeline state object for the shader
+                D3D12_COMPUTE_PIPELINE_STATE_DESC pso_desc = {};
+                pso_desc.pRootSignature = rootSignature;
+                pso_desc.CS.BytecodeLength = shaderBlob->GetBufferSize();
+                pso_desc.CS.pShaderBytecode = shaderBlob->GetBufferPointer();
+                ID3D12PipelineState* psoDX;
+                ID3D12PipelineLibrary* library = deviceI->pipelineLibrary;
+                wchar_t pipelineName[33];
+                swprintf(pipelineName, 33, L"%016llx%016llx", (unsigned long long)pipelineKey.high, (unsigned long long)pipelineKey.low);
+                if (library == nullptr || library->LoadComputePipeline(pipelineName, &pso_desc, IID_PPV_ARGS(&psoDX)) != S_OK)
+                {
+                    assert_msg(deviceI->device->CreateComputePipelineState(&pso_desc, IID_PPV_ARGS(&psoDX)) == S_OK, "Failed to create pipeline state object.");
+
+                    // The library is free threaded, a concurrent store of the same pipeline just fails
+                    if (library != nullptr && library->StorePipeline(pipelineName, psoDX) == S_OK)
+                        deviceI->pipelineLibraryDirty = true;
+                }
+                pso = object_cache::insert(deviceI->pipelineStates, pipelineKey, (uint64_t)psoDX);
+                if (pso != (uint64_t)psoDX)
+                    psoDX->Release();
+                return (ID3D12PipelineState*)pso;
+            }
+
+            // Creates the root signature and pipeline state of a compiled kernel, safe to call from any thread
+            void initialize_from_bytecode(DX12ComputeShader* cS, DX12GraphicsDevice* deviceI, const ComputeShaderDescriptor& csd, IDxcBlob* shader_blob)
+            {
                 ID3D12Device2* device = deviceI->device;
 
-                // Create the root signature for the shader
-                D3D12_ROOT_PARAMETER rootParameters[3];
-                D3D12_DESCRIPTOR_RANGE descRange[3];
+                // Complete the layout with what the kernel actually declares
+                bool reflected = reflect_kernel(shader_blob, cS->reflection);
+                assert_msg(reflected, "Failed to reflect the compute shader.");
+                ComputeShaderDescriptor layout(*bento::common_allocator());
+                compute_shader_descriptor::copy(csd, layout);
+                resolve_layout(cS->reflection, layout);
 
-                // Create our internal structure
-                DX12ComputeShader* cS = bento::make_new<DX12ComputeShader>(*bento::common_allocator(), *bento::common_allocator());
+                // Fill our internal structure
                 cS->srvIndex = UINT32_MAX;
                 cS->uavIndex = UINT32_MAX;
                 cS->cbvIndex = UINT32_MAX;
+                cS->bindless = layout.bindless;
+
+                D3D12_ROOT_PARAMETER1 rootParameters[DX12_MAX_ROOT_SIGNATURE_SIZE];
+                D3D12_DESCRIPTOR_RANGE1 descRange[3];
+                uint32_t numParameters = 0;
+                uint32_t numSlots = layout.srvCount + layout.uavCount + layout.cbvCount;
+                D3D12_VERSIONED_ROOT_SIGNATURE_DESC desc = {};
+                desc.Version = D3D_ROOT_SIGNATURE_VERSION_1_1;
+                if (layout.bindless)
+                {
+                    // The first parameter is the list of heap indices, the heap is accessed directly by the shader
+                    if (numSlots > 0)
+                    {
+                        D3D12_ROOT_PARAMETER1& indicesParameter = rootParameters[numParameters++];
+                        indicesParameter = {};
+                        indicesParameter.ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+                        indicesParameter.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+                        indicesParameter.Constants.ShaderRegister = 0; // b0
+                        indicesParameter.Constants.RegisterSpace = 0;
+                        indicesParameter.Constants.Num32BitValues = numSlots;
+                    }
+                    desc.Desc_1_1.Flags = D3D12_ROOT_SIGNATURE_FLAG_CBV_SRV_UAV_HEAP_DIRECTLY_INDEXED;
+                }
+                else
+                {
+                    // The tables are copied in the descriptor ring before being set and never modified afterwards, so the descriptors are
+                    // static. The buffers can be written by other dispatches of the command list, only UAVs can change during a dispatch.
+                    cS->srvIndex = append_table(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE, layout.srvCount, rootParameters, descRange, numParameters); // t0..tN
+                    cS->uavIndex = append_table(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE, layout.uavCount, rootParameters, descRange, numParameters); // u0..uN
+                    cS->cbvIndex = append_table(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE, layout.cbvCount, rootParameters, descRange, numParameters); // b0..bN
+                    desc.Desc_1_1.Flags = D3D12_ROOT_SIGNATURE_FLAG_NONE;
+                }
+                numParameters = append_root_parameters(cS, layout, rootParameters, numParameters);
+                desc.Desc_1_1.NumParameters = numParameters;
+                desc.Desc_1_1.pParameters = rootParameters;
+
+                // Kernels with the same layout share their root signature
+                object_cache::root_signature_key(layout, cS->rootSignatureKey);
+                uint64_t rootSignature;
+                if (!object_cache::acquire(deviceI->rootSignatures, cS->rootSignatureKey, rootSignature))
+                {
+                    // Create the signature blob
+                    ID3DBlob* signatureBlob;
+                    assert_msg(D3D12SerializeVersionedRootSignature(&desc, &signatureBlob, nullptr) == S_OK, "Failed to create root singnature blob.");
+
+                    // Create the root signature
+                    ID3D12RootSignature* rootSignatureDX;
+                    assert_msg(device->CreateRootSignature(0, signatureBlob->GetBufferPointer(), signatureBlob->GetBufferSize(), IID_PPV_ARGS(&rootSignatureDX)) == S_OK, "Failed to create root signature.");
 
-                // Tracking the current count/index
-                uint8_t cdIndex = 0;
+                    // Release the resources
+                    signatureBlob->Release();
+
+                    // Another thread may have created the same one in the meantime
+                    rootSignature = object_cache::insert(deviceI->rootSignatures, cS->rootSignatureKey, (uint64_t)rootSignatureDX);
+                    if (rootSignature != (uint64_t)rootSignatureDX)
+                        rootSignatureDX->Release();
+                }
 
-                // Process the SRVS
-                if (csd.srvCount > 0)
+                // Fill the compute shader structure
+                cS->device = deviceI;
+                cS->shaderBlob = shader_blob;
+                cS->rootSignature = (ID3D12RootSignature*)rootSignature;
+                cS->pipelineStateObject = acquire_pipeline_state(deviceI, shader_blob, cS->rootSignature, cS->rootSignatureKey, cS->pipelineKey);
+                cS->srvCount = layout.srvCount;
+                cS->uavCount = layout.uavCount;
+                cS->cbvCount = layout.cbvCount;
+
+                // No view is bound until the first set_compute_* call
+                if (layout.bindless)
                 {
-                    cS->srvIndex = cdIndex;
-                    descRange[cdIndex].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
-                    descRange[cdIndex].NumDescriptors = csd.srvCount;
-                    descRange[cdIndex].BaseShaderRegister = 0; // t0..tN
-                    descRange[cdIndex].RegisterSpace = 0;
-                    descRange[cdIndex].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
-                    rootParameters[cdIndex].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
-                    rootParameters[cdIndex].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
-                    rootParameters[cdIndex].DescriptorTable.NumDescriptorRanges = 1;
-                    rootParameters[cdIndex].DescriptorTable.pDescriptorRanges = &descRange[cdIndex];
-                    cdIndex++;
+                    cS->bindlessIndices.resize(numSlots);
+                    for (uint32_t slotIdx = 0; slotIdx < numSlots; ++slotIdx)
+                        cS->bindlessIndices[slotIdx] = UINT32_MAX;
                 }
+                else
+                {
+                    cS->boundDescriptors.resize(numSlots);
+                    for (uint32_t slotIdx = 0; slotIdx < numSlots; ++slotIdx)
+                        cS->boundDescriptors[slotIdx] = 0;
+                }
+                cS->boundRanges.resize(numSlots);
+                for (uint32_t slotIdx = 0; slotIdx < numSlots; ++slotIdx)
+                    cS->boundRanges[slotIdx].buffer = 0;
 
-                // Process the UAVs
-                if (csd.uavCount > 0)
+                // Remember what the kernel was built from, the reloader recompiles it when one of these files changes
+                if (deviceI->hotReloader != nullptr)
                 {
-                    cS->uavIndex = cdIndex;
-                    descRange[cdIndex].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_UAV;
-                    descRange[cdIndex].NumDescriptors = csd.uavCount;
-                    descRange[cdIndex].BaseShaderRegister = 0; // u0..uN
-                    descRange[cdIndex].RegisterSpace = 0;
-                    descRange[cdIndex].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
-                    rootParameters[cdIndex].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
-                    rootParameters[cdIndex].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
-                    rootParameters[cdIndex].DescriptorTable.NumDescriptorRanges = 1;
-                    rootParameters[cdIndex].DescriptorTable.pDescriptorRanges = &descRange[cdIndex];
-                    cdIndex++;
+                    cS->reloadDescriptor = bento::make_new<ComputeShaderDescriptor>(*bento::common_allocator(), *bento::common_allocator());
+                    compute_shader_descriptor::copy(csd, *cS->reloadDescriptor);
+                    bento::Vector<bento::DynamicString> dependencies(*bento::common_allocator());
+                    shader_cache::collect_dependencies(csd.filename.c_str(), csd.includeDirectories, dependencies);
+                    hot_reload::set_dependencies(deviceI->hotReloader, (uint64_t)cS, dependencies);
                 }
+            }
 
-                // Process the CBVs
-                if (csd.cbvCount > 0)
+            // Compiles the kernel with the parameters tuned for this adapter, safe to call from any thread
+            void initialize_compute_shader(DX12ComputeShader* cS, DX12GraphicsDevice* deviceI, const ComputeShaderDescriptor& csd)
+            {
+                // The tuned defines come first, the ones of the descriptor override them
+                ComputeShaderDescriptor tuned(*bento::common_allocator());
+                if (deviceI->autotuneCache != nullptr)
                 {
-                    cS->cbvIndex = cdIndex;
-                    descRange[cdIndex].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_CBV;
-                    descRange[cdIndex].NumDescriptors = csd.cbvCount;
-                    descRange[cdIndex].BaseShaderRegister = 0; // b0..bN
-                    descRange[cdIndex].RegisterSpace = 0;
-                    descRange[cdIndex].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
-                    rootParameters[cdIndex].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
-                    rootParameters[cdIndex].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
-                    rootParameters[cdIndex].DescriptorTable.NumDescriptorRanges = 1;
-                    rootParameters[cdIndex].DescriptorTable.pDescriptorRanges = &descRange[cdIndex];
-                    cdIndex++;
+                    Hash128 kernelKey;
+                    dispatch_autotuner::kernel_key(csd, kernelKey);
+                    dispatch_autotuner::lookup(deviceI->autotuneCache, deviceI->adapterId, kernelKey, nullptr, tuned.defines);
                 }
+                compute_shader_descriptor::copy(csd, tuned);
 
-                D3D12_ROOT_SIGNATURE_DESC desc = {};
-                desc.NumParameters = cdIndex;
-                desc.pParameters = rootParameters;
-                desc.NumStaticSamplers = 0;
-                desc.pStaticSamplers = nullptr;
+                // Fetch the bytecode
+                IDxcBlob* shader_blob = load_kernel(deviceI, tuned);
+                assert_msg(shader_blob != nullptr, "Failed to compile the compute shader.");
+                initialize_from_bytecode(cS, deviceI, tuned, shader_blob);
+            }
 
-                // Create the signature blob
-                ID3DBlob* signatureBlob;
-                assert_msg(D3D12SerializeRootSignature(&desc, D3D_ROOT_SIGNATURE_VERSION_1, &signatureBlob, nullptr) == S_OK, "Failed to create root singnature blob.");
+            ComputeShader create_compute_shader(GraphicsDevice graphicsDevice, const ComputeShaderDescriptor& csd)
+            {
+                // Create our internal structure
+                DX12ComputeShader* cS = bento::make_new<DX12ComputeShader>(*bento::common_allocator(), *bento::common_allocator());
+                initialize_compute_shader(cS, (DX12GraphicsDevice*)graphicsDevice, csd);
 
-                // Create the root signature
-                ID3D12RootSignature* rootSignature;
-                assert_msg(device->CreateRootSignature(0, signatureBlob->GetBufferPointer(), signatureBlob->GetBufferSize(), IID_PPV_ARGS(&rootSignature)) == S_OK, "Failed to create root signature.");
+                // Convert to the opaque structure
+                return (ComputeShader)cS;
+            }
 
-                // Release the resources
-                signatureBlob->Release();
-                    
-                // Create the pipeline state object for the shader
-                D3D12_COMPUTE_PIPELINE_STATE_DESC pso_desc = {};
-                pso_desc.pRootSignature = rootSignature;
-                pso_desc.CS.BytecodeLength = shader_blob->GetBufferSize();
-                pso_desc.CS.pShaderBytecode = shader_blob->GetBufferPointer();
-                ID3D12PipelineState* pso;
-                assert_msg(device->CreateComputePipelineState(&pso_desc, IID_PPV_ARGS(&pso)) == S_OK, "Failed to create pipeline state object.");
+            void compile_job(uint32_t jobIdx, void* userData)
+            {
+                DX12ShaderBatch* batch = (DX12ShaderBatch*)userData;
+                initialize_compute_shader(batch->shaders[jobIdx], batch->deviceI, *batch->descriptors[jobIdx]);
+            }
 
-                // Fill the compute shader structure
-                cS->device = deviceI;
-                cS->shaderBlob = shader_blob;
-                cS->rootSignature = rootSignature;
-                cS->pipelineStateObject = pso;
-                cS->srvCount = csd.srvCount;
-                cS->uavCount = csd.uavCount;
-                cS->cbvCount = csd.cbvCount;
+            void create_compute_shaders_async(GraphicsDevice graphicsDevice, const ComputeShaderDescriptor* descriptors, uint32_t count, ComputeShader* computeShaders)
+            {
+                bento::IAllocator* allocator = bento::common_allocator();
+                DX12GraphicsDevice* deviceI = (DX12GraphicsDevice*)graphicsDevice;
+                if (count == 0)
+                    return;
 
-                // Create the descriptor heap for this compute shader
-                cS->descriptorHeaps.push_back(create_desriptor_heap(graphicsDevice, csd.srvCount, csd.uavCount, csd.cbvCount));
-                cS->cmdBatchIndex = UINT32_MAX;
-                cS->nextUsableHeap = 0;
+                // The descriptors are copied, the caller's ones can go away before the compilation is over
+                DX12ShaderBatch* batch = bento::make_new<DX12ShaderBatch>(*allocator, *allocator);
+                batch->deviceI = deviceI;
+                batch->pendingShaders = count;
+                for (uint32_t shaderIdx = 0; shaderIdx < count; ++shaderIdx)
+                {
+                    ComputeShaderDescriptor* descriptor = bento::make_new<ComputeShaderDescriptor>(*allocator, *allocator);
+                    compute_shader_descriptor::copy(descriptors[shaderIdx], *descriptor);
+                    batch->descriptors.push_back(descriptor);
+
+                    DX12ComputeShader* cS = bento::make_new<DX12ComputeShader>(*allocator, *allocator);
+                    cS->batch = batch;
+                    cS->batchIndex = shaderIdx;
+                    batch->shaders.push_back(cS);
+                    computeShaders[shaderIdx] = (ComputeShader)cS;
+                }
 
-                // Convert to the opaque structure
-                return (ComputeShader)cS;
+                // Lazily initialized device state must not be raced by the workers
+                if (deviceI->shaderCache != nullptr)
+                    compiler_version(deviceI);
+                batch->jobs = job_batch::launch(*allocator, deviceI->workerPool, count, compile_job, batch);
             }
 
-            void destroy_compute_shader(ComputeShader computeShader)
+            bool is_ready(ComputeShader computeShader)
             {
-                // Grab the internal structure
-                DX12ComputeShader* dx12_computeShader = (DX12ComputeShader*)computeShader;
+                DX12ComputeShader* cS = (DX12ComputeShader*)computeShader;
+                return cS->batch == nullptr || job_batch::is_complete(cS->batch->jobs, cS->batchIndex);
+            }
+
+            void wait(ComputeShader computeShader)
+            {
+                DX12ComputeShader* cS = (DX12ComputeShader*)computeShader;
+                DX12ShaderBatch* batch = cS->batch;
+                if (batch == nullptr)
+                    return;
+                job_batch::wait(batch->jobs, cS->batchIndex);
+                cS->batch = nullptr;
+
+                // The last shader of the batch to be waited on releases it
+                if (--batch->pendingShaders == 0)
+                {
+                    job_batch::destroy(batch->jobs);
+                    bento::IAllocator* allocator = bento::common_allocator();
+                    for (uint32_t shaderIdx = 0; shaderIdx < batch->descriptors.size(); ++shaderIdx)
+                        bento::make_delete<ComputeShaderDescriptor>(*allocator, batch->descriptors[shaderIdx]);
+                    bento::make_delete<DX12ShaderBatch>(*allocator, batch);
+                }
+            }
 
-                // Destroy all the descriptor heaps
-                uint32_t numDescriptorHeaps = (uint32_t)dx12_computeShader->descriptorHeaps.size();
-                for (uint32_t heapIdx = 0; heapIdx < numDescriptorHeaps; ++heapIdx)
-                    destroy_descriptor_heap(dx12_computeShader->descriptorHeaps[heapIdx]);
+            struct DX12AutotuneContext
+            {
+                DX12GraphicsDevice* deviceI;
+                CommandQueue commandQueue;
+                CommandBuffer commandBuffer;
+                ProfilingScope profilingScope;
+                const ComputeShaderDescriptor* descriptor;
+                AutotuneRecordFunction recordFunction;
+                void* userData;
+            };
+
+            bool measure_candidate(const bento::Vector<bento::DynamicString>& defines, uint32_t numSamples, double* durations, void* userData)
+            {
+                DX12AutotuneContext* context = (DX12AutotuneContext*)userData;
+                ComputeShaderDescriptor candidate(*bento::common_allocator());
+                compute_shader_descriptor::copy(*context->descriptor, candidate);
+                for (uint32_t defineIdx = 0; defineIdx < defines.size(); ++defineIdx)
+                    candidate.defines.push_back(defines[defineIdx]);
+
+                // Values the compiler rejects (a thread group that is too large for instance) are skipped, the errors are logged
+                IDxcBlob* shaderBlob = load_kernel(context->deviceI, candidate);
+                if (shaderBlob == nullptr)
+                    return false;
+                DX12ComputeShader* cS = bento::make_new<DX12ComputeShader>(*bento::common_allocator(), *bento::common_allocator());
+                initialize_from_bytecode(cS, context->deviceI, candidate, shaderBlob);
+
+                // The first run pays for the cold caches and the clock ramp up, it is not measured
+                for (int32_t sampleIdx = -1; sampleIdx < (int32_t)numSamples; ++sampleIdx)
+                {
+                    command_buffer::reset(context->commandBuffer);
+                    command_buffer::enable_profiling_scope(context->commandBuffer, context->profilingScope);
+                    context->recordFunction(context->commandBuffer, (ComputeShader)cS, defines, context->userData);
+                    command_buffer::disable_profiling_scope(context->commandBuffer, context->profilingScope);
+                    command_buffer::close(context->commandBuffer);
+                    command_queue::execute_command_buffer(context->commandQueue, context->commandBuffer);
+                    command_queue::flush(context->commandQueue);
+                    if (sampleIdx >= 0)
+                        durations[sampleIdx] = (double)profiling_scope::get_duration_us(context->profilingScope);
+                }
+                destroy_compute_shader((ComputeShader)cS);
+                return true;
+            }
+
+            bool autotune(GraphicsDevice graphicsDevice, CommandQueue commandQueue, const ComputeShaderDescriptor& csd, const AutotuneSpace& space,
+                AutotuneRecordFunction recordFunction, void* userData, uint32_t numSamples, AutotuneResult& result)
+            {
+                DX12GraphicsDevice* deviceI = (DX12GraphicsDevice*)graphicsDevice;
+                Hash128 kernelKey, spaceKey;
+                dispatch_autotuner::kernel_key(csd, kernelKey);
+                dispatch_autotuner::space_key(space, spaceKey);
+
+                // Already tuned for this adapter and this space
+                result.defines.clear();
+                result.candidate = UINT32_MAX;
+                result.numMeasured = 0;
+                if (deviceI->autotuneCache != nullptr && dispatch_autotuner::lookup(deviceI->autotuneCache, deviceI->adapterId, kernelKey, &spaceKey, result.defines))
+                    return true;
+
+                DX12AutotuneContext context;
+                context.deviceI = deviceI;
+                context.commandQueue = commandQueue;
+                context.commandBuffer = command_buffer::create_command_buffer(graphicsDevice);
+                context.profilingScope = profiling_scope::create_profiling_scope(graphicsDevice, commandQueue);
+                context.descriptor = &csd;
+                context.recordFunction = recordFunction;
+                context.userData = userData;
+                bool found = dispatch_autotuner::search(space, measure_candidate, &context, numSamples, result);
+                profiling_scope::destroy_profiling_scope(context.profilingScope);
+                command_buffer::destroy_command_buffer(context.commandBuffer);
+
+                if (found && deviceI->autotuneCache != nullptr)
+                    dispatch_autotuner::store(deviceI->autotuneCache, deviceI->adapterId, kernelKey, spaceKey, result);
+                return found;
+            }
+
+            uint64_t create_variant(const ComputeShaderDescriptor& descriptor, void* userData)
+            {
+                return (uint64_t)create_compute_shader((GraphicsDevice)userData, descriptor);
+            }
+
+            void destroy_variant(uint64_t variant, void*)
+            {
+                destroy_compute_shader((ComputeShader)variant);
+            }
+
+            PermutationSet* create_permutation_set(GraphicsDevice graphicsDevice, const ComputeShaderDescriptor& baseDescriptor)
+            {
+                return shader_permutation::create_permutation_set(*bento::common_allocator(), baseDescriptor, create_variant, destroy_variant, (void*)graphicsDevice);
+            }
+
+            void destroy_permutation_set(PermutationSet* permutationSet)
+            {
+                shader_permutation::destroy_permutation_set(permutationSet);
+            }
+
+            ComputeShader get_permutation(PermutationSet* permutationSet, const bento::Vector<bento::DynamicString>& defines)
+            {
+                return (ComputeShader)shader_permutation::get_variant(permutationSet, defines);
+            }
+
+            const ShaderReflection& get_reflection(ComputeShader computeShader)
+            {
+                wait(computeShader);
+                return ((DX12ComputeShader*)computeShader)->reflection;
+            }
 
-                dx12_computeShader->rootSignature->Release();
+            uint64_t reload_shader(uint64_t shader, void*)
+            {
+                // Runs on the reloader's worker, a failed compilation has already been logged and keeps the current version
+                DX12ComputeShader* cS = (DX12ComputeShader*)shader;
+                DX12GraphicsDevice* deviceI = cS->device;
+                const ComputeShaderDescriptor& csd = *cS->reloadDescriptor;
+                IDxcBlob* shaderBlob = load_kernel(deviceI, csd);
+                if (shaderBlob == nullptr)
+                    return 0;
+
+                // The include set may have changed with the source
+                bento::Vector<bento::DynamicString> dependencies(*bento::common_allocator());
+                shader_cache::collect_dependencies(csd.filename.c_str(), csd.includeDirectories, dependencies);
+                hot_reload::set_dependencies(deviceI->hotReloader, shader, dependencies);
+
+                // The bound views and constants assume the current root signature, a kernel whose bindings changed needs a restart
+                DX12ShaderVersion* version = bento::make_new<DX12ShaderVersion>(*bento::common_allocator(), *bento::common_allocator());
+                ComputeShaderDescriptor layout(*bento::common_allocator());
+                compute_shader_descriptor::copy(csd, layout);
+                Hash128 rootSignatureKey;
+                bool sameLayout = reflect_kernel(shaderBlob, version->reflection);
+                if (sameLayout)
+                {
+                    resolve_layout(version->reflection, layout);
+                    object_cache::root_signature_key(layout, rootSignatureKey);
+                    sameLayout = hash::equal(rootSignatureKey, cS->rootSignatureKey);
+                }
+                if (!sameLayout)
+                {
+                    bento::default_logger()->log(bento::LogLevel::info, "Hot Reload", "The bindings of the kernel changed, it will not be reloaded.");
+                    shaderBlob->Release();
+                    bento::make_delete<DX12ShaderVersion>(*bento::common_allocator(), version);
+                    return 0;
+                }
+
+                version->shaderBlob = shaderBlob;
+                version->pipelineStateObject = acquire_pipeline_state(deviceI, shaderBlob, cS->rootSignature, cS->rootSignatureKey, version->pipelineKey);
+                return (uint64_t)version;
+            }
+
+            void destroy_shader_version(DX12GraphicsDevice* deviceI, DX12ShaderVersion* version)
+            {
+                uint64_t object;
+                if (object_cache::release(deviceI->pipelineStates, version->pipelineKey, object))
+                    ((ID3D12PipelineState*)object)->Release();
+                version->shaderBlob->Release();
+                bento::make_delete<DX12ShaderVersion>(*bento::common_allocator(), version);
+            }
+
+            void discard_shader_version(uint64_t version, void* userData)
+            {
+                destroy_shader_version((DX12GraphicsDevice*)userData, (DX12ShaderVersion*)version);
+            }
+
+            void release_retired_versions(DX12GraphicsDevice* deviceI, uint64_t fence, uint64_t completedValue)
+            {
+                bento::Vector<uint64_t> released(*bento::common_allocator());
+                hot_reload::reclaim(deviceI->hotReloader, fence, completedValue, released);
+                for (uint32_t versionIdx = 0; versionIdx < released.size(); ++versionIdx)
+                    destroy_shader_version(deviceI, (DX12ShaderVersion*)released[versionIdx]);
+            }
+
+            void swap_reloaded_versions(DX12GraphicsDevice* deviceI)
+            {
+                // The pipelines that were swapped out earlier may be done
+                std::lock_guard<std::mutex> lock(deviceI->queuesLock);
+                uint32_t numQueues = deviceI->queues.size();
+                for (uint32_t queueIdx = 0; queueIdx < numQueues; ++queueIdx)
+                {
+                    ID3D12Fence* fence = deviceI->queues[queueIdx]->fence;
+                    release_retired_versions(deviceI, (uint64_t)fence, fence->GetCompletedValue());
+                }
+
+                bento::Vector<HotReloadVersion> versions(*bento::common_allocator());
+                hot_reload::collect_ready(deviceI->hotReloader, versions);
+                if (versions.size() == 0)
+                    return;
+
+                // Anything submitted so far may still use the previous pipelines, the queues stay locked until they are retired
+                bento::Vector<uint64_t> fences(*bento::common_allocator());
+                bento::Vector<uint64_t> fenceValues(*bento::common_allocator());
+                for (uint32_t queueIdx = 0; queueIdx < numQueues; ++queueIdx)
+                {
+                    DX12CommandQueue* commandQueue = deviceI->queues[queueIdx];
+                    std::lock_guard<std::mutex> submitLock(commandQueue->submitLock);
+                    fences.push_back((uint64_t)commandQueue->fence);
+                    fenceValues.push_back(timeline::last_submitted(commandQueue->timeline));
+                }
+
+                for (uint32_t versionIdx = 0; versionIdx < versions.size(); ++versionIdx)
+                {
+                    // The version takes the previous objects and is retired in their place
+                    DX12ComputeShader* cS = (DX12ComputeShader*)versions[versionIdx].shader;
+                    DX12ShaderVersion* version = (DX12ShaderVersion*)versions[versionIdx].version;
+                    std::swap(cS->shaderBlob, version->shaderBlob);
+                    std::swap(cS->pipelineStateObject, version->pipelineStateObject);
+                    std::swap(cS->pipelineKey, version->pipelineKey);
+                    cS->reflection.groupSize[0] = version->reflection.groupSize[0];
+                    cS->reflection.groupSize[1] = version->reflection.groupSize[1];
+                    cS->reflection.groupSize[2] = version->reflection.groupSize[2];
+                    cS->reflection.bindings.clear();
+                    for (uint32_t bindingIdx = 0; bindingIdx < version->reflection.bindings.size(); ++bindingIdx)
+                        cS->reflection.bindings.push_back(version->reflection.bindings[bindingIdx]);
+                    hot_reload::retire(deviceI->hotReloader, (uint64_t)version, fences.begin(), fenceValues.begin(), numQueues);
+                }
+
+                // Without any queue nothing can be in flight
+                if (numQueues == 0)
+                    release_retired_versions(deviceI, 0, 0);
+            }
+
+            void release_compute_shader(uint64_t computeShader, void*)
+            {
+                // The API objects are only destroyed with their last user
+                DX12ComputeShader* dx12_computeShader = (DX12ComputeShader*)computeShader;
+                DX12GraphicsDevice* deviceI = dx12_computeShader->device;
+                uint64_t object;
+                if (object_cache::release(deviceI->pipelineStates, dx12_computeShader->pipelineKey, object))
+                    ((ID3D12PipelineState*)object)->Release();
+                if (object_cache::release(deviceI->rootSignatures, dx12_computeShader->rootSignatureKey, object))
+                    ((ID3D12RootSignature*)object)->Release();
                 dx12_computeShader->shaderBlob->Release();
                 
                 bento::make_delete<DX12ComputeShader>(*bento::common_allocator(), dx12_computeShader);
             }
+
+            void destroy_compute_shader(ComputeShader computeShader)
+            {
+                // Grab the internal structure
+                DX12ComputeShader* dx12_computeShader = (DX12ComputeShader*)computeShader;
+                wait(computeShader);
+
+                // The kernel stops being watched right away
+                DX12GraphicsDevice* deviceI = dx12_computeShader->device;
+                if (dx12_computeShader->reloadDescriptor != nullptr)
+                {
+                    hot_reload::remove_shader(deviceI->hotReloader, computeShader);
+                    bento::make_delete<ComputeShaderDescriptor>(*bento::common_allocator(), dx12_computeShader->reloadDescriptor);
+                    dx12_computeShader->reloadDescriptor = nullptr;
+                }
+
+                // The range views the slots point to can be recycled, the submitted tables don't depend on the pins
+                for (uint32_t slotIdx = 0; slotIdx < dx12_computeShader->boundRanges.size(); ++slotIdx)
+                {
+                    const DX12BoundRange& range = dx12_computeShader->boundRanges[slotIdx];
+                    if (range.buffer != 0)
+                        graphics_resources::unpin_range_view(range.buffer, range.key);
+                }
+
+                // Command buffers submitted before this call may still dispatch it
+                graphics_device::defer_release(deviceI, (uint64_t)dx12_computeShader, release_compute_shader);
+            }
         }
     }
 }
@@ -11,6 +11,23 @@ namespace graphics_sandbox
 {
     namespace d3d12
     {
+        namespace compute_shader
+        {
+            uint64_t compiler_version(DX12GraphicsDevice* deviceI);
+            uint64_t reload_shader(uint64_t shader, void* userData);
+            void discard_shader_version(uint64_t version, void* userData);
+            void swap_reloaded_versions(DX12GraphicsDevice* deviceI);
+        }
+
+        namespace graphics_resources
+        {
+            void destroy_heap_blocks(DX12GraphicsDevice* deviceI);
+        }
+
+        // Shared by every device, guarded by the lock while devices come and go
+        DX12HandleTables* handleTables = nullptr;
+        static std::mutex handleTablesLock;
+
         namespace graphics_device
         {
             // On DX12 to create a graphics device, we need to fetch the adapter of the right device.
@@ -77,11 +94,17 @@ namespace graphics_sandbox
                 ID3D12Device2* d3d12Device2;
                 assert_msg(D3D12CreateDevice(adapter, D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS(&d3d12Device2)) == S_OK, "D3D12 Device creation failed.");
 
+                // Serialized pipelines are only valid for this exact adapter and driver
+                DXGI_ADAPTER_DESC1 adapterDesc;
+                adapter->GetDesc1(&adapterDesc);
+                LARGE_INTEGER driverVersion = {};
+                adapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &driverVersion);
+
                 // Do not forget to release the adapter
                 adapter->Release();
 
                 // Create the graphics device internal structure
-                DX12GraphicsDevice* dx12_graphicsDevice = bento::make_new<DX12GraphicsDevice>(*allocator);
+                DX12GraphicsDevice* dx12_graphicsDevice = bento::make_new<DX12GraphicsDevice>(*allocator, *allocator);
                 dx12_graphicsDevice->device = d3d12Device2;
                 dx12_graphicsDevice->debugLayer = debugInterface;
                 for (int i = 0; i < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++i)
@@ -90,15 +113,321 @@ namespace graphics_sandbox
                 // Enable stable power state for profiling
                 dx12_graphicsDevice->device->SetStablePowerState(stable_power_state);
 
+                // The heap tier decides which resources can share a heap
+                D3D12_FEATURE_DATA_D3D12_OPTIONS options = {};
+                if (d3d12Device2->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &options, sizeof(options)) == S_OK)
+                    dx12_graphicsDevice->resourceHeapTier = options.ResourceHeapTier;
+
+                // Create the shader visible heap shared by all the dispatches of this device, the bindless views come first
+                dx12_graphicsDevice->resourceHeap = (ID3D12DescriptorHeap*)descriptor_heap::create_descriptor_heap((GraphicsDevice)dx12_graphicsDevice, DX12_BINDLESS_HEAP_SIZE + DX12_DESCRIPTOR_RING_SIZE, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+                uint64_t ringStart = (uint64_t)DX12_BINDLESS_HEAP_SIZE * dx12_graphicsDevice->descriptorSize[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV];
+                dx12_graphicsDevice->bindlessCPU = dx12_graphicsDevice->resourceHeap->GetCPUDescriptorHandleForHeapStart();
+                index_allocator::initialize(dx12_graphicsDevice->bindlessIndices, DX12_BINDLESS_HEAP_SIZE);
+
+                // The default views of the buffers are only copied from
+                D3D12_DESCRIPTOR_HEAP_DESC bufferViewHeapDesc = {};
+                bufferViewHeapDesc.NumDescriptors = DX12_MAX_GRAPHICS_BUFFERS * DX12_BUFFER_VIEW_COUNT;
+                bufferViewHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+                bufferViewHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+                assert_msg(dx12_graphicsDevice->device->CreateDescriptorHeap(&bufferViewHeapDesc, IID_PPV_ARGS(&dx12_graphicsDevice->bufferViewHeap)) == S_OK, "Failed to create the buffer view heap.");
+                dx12_graphicsDevice->bufferViewCPU = dx12_graphicsDevice->bufferViewHeap->GetCPUDescriptorHandleForHeapStart();
+                index_allocator::initialize(dx12_graphicsDevice->bufferViewBlocks, DX12_MAX_GRAPHICS_BUFFERS);
+
+                // The range views are only copied from too
+                D3D12_DESCRIPTOR_HEAP_DESC rangeViewHeapDesc = {};
+                rangeViewHeapDesc.NumDescriptors = DX12_RANGE_VIEW_HEAP_SIZE;
+                rangeViewHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+                rangeViewHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+                assert_msg(dx12_graphicsDevice->device->CreateDescriptorHeap(&rangeViewHeapDesc, IID_PPV_ARGS(&dx12_graphicsDevice->rangeViewHeap)) == S_OK, "Failed to create the range view heap.");
+                dx12_graphicsDevice->rangeViewCPU = dx12_graphicsDevice->rangeViewHeap->GetCPUDescriptorHandleForHeapStart();
+                index_allocator::initialize(dx12_graphicsDevice->rangeViewIndices, DX12_RANGE_VIEW_HEAP_SIZE);
+
+                dx12_graphicsDevice->descriptorRingCPU = dx12_graphicsDevice->bindlessCPU;
+                dx12_graphicsDevice->descriptorRingCPU.ptr += ringStart;
+                dx12_graphicsDevice->descriptorRingGPU = dx12_graphicsDevice->resourceHeap->GetGPUDescriptorHandleForHeapStart();
+                dx12_graphicsDevice->descriptorRingGPU.ptr += ringStart;
+                descriptor_ring::initialize(dx12_graphicsDevice->descriptorRing, DX12_DESCRIPTOR_RING_SIZE);
+                dx12_graphicsDevice->descriptorRingEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+                assert_msg(dx12_graphicsDevice->descriptorRingEvent != nullptr, "Failed to create descriptor ring event.");
+                dx12_graphicsDevice->commandAllocatorEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+                assert_msg(dx12_graphicsDevice->commandAllocatorEvent != nullptr, "Failed to create command allocator event.");
+                dx12_graphicsDevice->rootSignatures = object_cache::create_cache(*allocator);
+                dx12_graphicsDevice->pipelineStates = object_cache::create_cache(*allocator);
+                dx12_graphicsDevice->garbage = deferred_destruction::create_queue(*allocator);
+                dx12_graphicsDevice->workerPool = work_stealing_pool::create_pool(*allocator);
+
+                // The first device creates the storage of the buffers and render textures
+                {
+                    std::lock_guard<std::mutex> lock(handleTablesLock);
+                    if (handleTables == nullptr)
+                    {
+                        handleTables = bento::make_new<DX12HandleTables>(*allocator, *allocator);
+                        handle_table::initialize(handleTables->buffers, DX12_MAX_GRAPHICS_BUFFERS);
+                        handle_table::initialize(handleTables->renderTextures, DX12_MAX_RENDER_TEXTURES);
+                    }
+                    handleTables->numDevices++;
+                }
+                PipelineLibraryIdentity& identity = dx12_graphicsDevice->adapterIdentity;
+                identity.vendorId = adapterDesc.VendorId;
+                identity.deviceId = adapterDesc.DeviceId;
+                identity.subSysId = adapterDesc.SubSysId;
+                identity.revision = adapterDesc.Revision;
+                identity.driverVersion = (uint64_t)driverVersion.QuadPart;
+
+                // The autotuned parameters are specific to the adapter and its driver too
+                Hash128 adapterKey;
+                hash::begin(adapterKey);
+                hash::append(adapterKey, &identity, sizeof(PipelineLibraryIdentity));
+                dx12_graphicsDevice->adapterId = adapterKey.low;
+
                 return (GraphicsDevice)dx12_graphicsDevice;
             }
 
+            uint32_t allocate_descriptor_table(DX12GraphicsDevice* deviceI, uint64_t owner, uint32_t count)
+            {
+                // Waiting for the GPU with the lock held is fine, the submissions only need it after the work is queued
+                std::lock_guard<std::mutex> lock(deviceI->descriptorRingLock);
+                DescriptorRing& ring = deviceI->descriptorRing;
+                uint32_t offset = 0;
+                while (!descriptor_ring::allocate(ring, owner, count, offset))
+                {
+                    // The ring is full, wait for the oldest submitted work to be done with its tables
+                    uint64_t fence, fenceValue;
+                    assert_msg(descriptor_ring::oldest_fence(ring, fence, fenceValue), "Descriptor ring exhausted by unsubmitted command buffers.");
+                    ID3D12Fence* fenceDX = (ID3D12Fence*)fence;
+                    if (fenceDX->GetCompletedValue() < fenceValue)
+                    {
+                        assert_msg(fenceDX->SetEventOnCompletion(fenceValue, deviceI->descriptorRingEvent) == S_OK, "Failed to wait on fence.");
+                        WaitForSingleObject(deviceI->descriptorRingEvent, INFINITE);
+                    }
+                    descriptor_ring::reclaim(ring, fence, fenceDX->GetCompletedValue());
+                }
+                return offset;
+            }
+
+            ID3D12CommandAllocator* acquire_command_allocator(DX12GraphicsDevice* deviceI)
+            {
+                std::lock_guard<std::mutex> lock(deviceI->commandAllocatorLock);
+                CommandAllocatorPool& pool = deviceI->commandAllocators;
+                uint64_t allocator = 0;
+                while (!command_allocator_pool::acquire(pool, allocator))
+                {
+                    // Grow the pool until enough frames can be in flight
+                    if (pool.numAllocators < DX12_MAX_COMMAND_ALLOCATORS)
+                    {
+                        ID3D12CommandAllocator* cmdAlloc;
+                        assert_msg(deviceI->device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&cmdAlloc)) == S_OK, "Failed to create command allocator");
+                        command_allocator_pool::add(pool, (uint64_t)cmdAlloc);
+                        return cmdAlloc;
+                    }
+
+                    // Otherwise wait for the oldest submitted work to be done with its allocator
+                    uint64_t fence, fenceValue;
+                    assert_msg(command_allocator_pool::oldest_fence(pool, fence, fenceValue), "Command allocator pool exhausted by live command buffers.");
+                    ID3D12Fence* fenceDX = (ID3D12Fence*)fence;
+                    if (fenceDX->GetCompletedValue() < fenceValue)
+                    {
+                        assert_msg(fenceDX->SetEventOnCompletion(fenceValue, deviceI->commandAllocatorEvent) == S_OK, "Failed to wait on fence.");
+                        WaitForSingleObject(deviceI->commandAllocatorEvent, INFINITE);
+                    }
+                    command_allocator_pool::reclaim(pool, fence, fenceDX->GetCompletedValue());
+                }
+                return (ID3D12CommandAllocator*)allocator;
+            }
+
+            void defer_release(DX12GraphicsDevice* deviceI, uint64_t object, DeferredReleaseFunction releaseFunction)
+            {
+                // Anything submitted so far may still use the object, without any queue it goes with the next collection. A queue can't be
+                // destroyed before the entry is queued, and a submission in progress is either fully counted or not started.
+                std::lock_guard<std::mutex> lock(deviceI->queuesLock);
+                uint32_t numQueues = deviceI->queues.size();
+                assert_msg(numQueues <= DEFERRED_DESTRUCTION_MAX_FENCES, "Too many command queues for the deferred destructions.");
+                uint64_t fences[DEFERRED_DESTRUCTION_MAX_FENCES];
+                uint64_t fenceValues[DEFERRED_DESTRUCTION_MAX_FENCES];
+                for (uint32_t queueIdx = 0; queueIdx < numQueues; ++queueIdx)
+                {
+                    DX12CommandQueue* commandQueue = deviceI->queues[queueIdx];
+                    std::lock_guard<std::mutex> submitLock(commandQueue->submitLock);
+                    fences[queueIdx] = (uint64_t)commandQueue->fence;
+                    fenceValues[queueIdx] = timeline::last_submitted(commandQueue->timeline);
+                }
+                deferred_destruction::enqueue(deviceI->garbage, object, releaseFunction, deviceI, fences, fenceValues, numQueues);
+            }
+
+            uint32_t collect_garbage(GraphicsDevice graphicsDevice)
+            {
+                DX12GraphicsDevice* dx12_device = (DX12GraphicsDevice*)graphicsDevice;
+
+                // The release functions may destroy objects themselves, the queues are read first
+                uint64_t fences[DEFERRED_DESTRUCTION_MAX_FENCES];
+                uint64_t completedValues[DEFERRED_DESTRUCTION_MAX_FENCES];
+                uint32_t numQueues;
+                {
+                    std::lock_guard<std::mutex> lock(dx12_device->queuesLock);
+                    numQueues = dx12_device->queues.size();
+                    for (uint32_t queueIdx = 0; queueIdx < numQueues; ++queueIdx)
+                    {
+                        ID3D12Fence* fence = dx12_device->queues[queueIdx]->fence;
+                        fences[queueIdx] = (uint64_t)fence;
+                        completedValues[queueIdx] = fence->GetCompletedValue();
+                    }
+                }
+                return deferred_destruction::collect(dx12_device->garbage, fences, completedValues, numQueues);
+            }
+
+            void set_shader_cache(GraphicsDevice graphicsDevice, ShaderCache* shaderCache)
+            {
+                DX12GraphicsDevice* dx12_device = (DX12GraphicsDevice*)graphicsDevice;
+                dx12_device->shaderCache = shaderCache;
+            }
+
+            void set_autotune_cache(GraphicsDevice graphicsDevice, AutotuneCache* autotuneCache)
+            {
+                DX12GraphicsDevice* dx12_device = (DX12GraphicsDevice*)graphicsDevice;
+                dx12_device->autotuneCache = autotuneCache;
+            }
+
+            uint64_t get_adapter_id(GraphicsDevice graphicsDevice)
+            {
+                DX12GraphicsDevice* dx12_device = (DX12GraphicsDevice*)graphicsDevice;
+                return dx12_device->adapterId;
+            }
+
+            bool set_pipeline_library(GraphicsDevice graphicsDevice, const char* path)
+            {
+                DX12GraphicsDevice* dx12_device = (DX12GraphicsDevice*)graphicsDevice;
+                assert_msg(dx12_device->pipelineLibrary == nullptr, "A pipeline library is already attached.");
+                dx12_device->pipelineLibraryPath = path;
+
+                // The driver reads the pipelines from the mapping for as long as the library lives
+                MappedFile* file = mapped_file::open(dx12_device->_allocator, path);
+                bool reused = false;
+                if (file != nullptr)
+                {
+                    const char* payload;
+                    uint64_t payloadSize;
+                    PipelineLibraryStatus status = pipeline_library_file::validate(mapped_file::data(file), mapped_file::size(file), dx12_device->adapterIdentity, payload, payloadSize);
+                    if (status == PipelineLibraryStatus::Valid)
+                        reused = dx12_device->device->CreatePipelineLibrary(payload, payloadSize, IID_PPV_ARGS(&dx12_device->pipelineLibrary)) == S_OK;
+                    if (!reused)
+                    {
+                        bento::default_logger()->log(bento::LogLevel::info, "Pipeline Library", "Discarded the pipeline library file, it comes from another adapter or driver or is damaged.");
+                        mapped_file::close(file);
+                        file = nullptr;
+                    }
+                }
+
+                // Start empty, every pipeline will be stored and the file rewritten
+                if (!reused)
+                    assert_msg(dx12_device->device->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&dx12_device->pipelineLibrary)) == S_OK, "Failed to create the pipeline library.");
+                dx12_device->pipelineLibraryFile = file;
+                dx12_device->pipelineLibraryDirty = !reused;
+                return reused;
+            }
+
+            void enable_hot_reload(GraphicsDevice graphicsDevice)
+            {
+                DX12GraphicsDevice* dx12_device = (DX12GraphicsDevice*)graphicsDevice;
+                assert_msg(dx12_device->hotReloader == nullptr, "Hot reload is already enabled.");
+
+                // Lazily initialized device state must not be raced by the reloader's worker
+                compute_shader::compiler_version(dx12_device);
+                dx12_device->fileWatcher = file_watcher::create_file_watcher(dx12_device->_allocator);
+                dx12_device->hotReloader = hot_reload::create_hot_reloader(dx12_device->_allocator, compute_shader::reload_shader, compute_shader::discard_shader_version, dx12_device);
+            }
+
+            void apply_hot_reloads(GraphicsDevice graphicsDevice)
+            {
+                DX12GraphicsDevice* dx12_device = (DX12GraphicsDevice*)graphicsDevice;
+                if (dx12_device->hotReloader == nullptr)
+                    return;
+
+                // Watch the directories of the files included since the last call, then hand the changes to the worker
+                bento::Vector<bento::DynamicString> directories(*bento::common_allocator());
+                hot_reload::watched_directories(dx12_device->hotReloader, directories);
+                for (uint32_t dirIdx = 0; dirIdx < directories.size(); ++dirIdx)
+                    file_watcher::watch_directory(dx12_device->fileWatcher, directories[dirIdx].c_str());
+                bento::Vector<bento::DynamicString> changedFiles(*bento::common_allocator());
+                file_watcher::poll(dx12_device->fileWatcher, changedFiles);
+                if (changedFiles.size() > 0)
+                    hot_reload::notify_changes(dx12_device->hotReloader, changedFiles);
+
+                // The kernels compiled in the meantime replace the current ones
+                compute_shader::swap_reloaded_versions(dx12_device);
+            }
+
+            void save_pipeline_library(DX12GraphicsDevice* deviceI)
+            {
+                // Nothing was added since the file was loaded
+                ID3D12PipelineLibrary* library = deviceI->pipelineLibrary;
+                bento::Vector<char> serialized(deviceI->_allocator);
+                if (deviceI->pipelineLibraryDirty)
+                {
+                    serialized.resize((uint32_t)library->GetSerializedSize());
+                    if (library->Serialize(serialized.begin(), serialized.size()) != S_OK)
+                        serialized.clear();
+                }
+
+                // The file can only be replaced once the library no longer reads from its mapping
+                library->Release();
+                deviceI->pipelineLibrary = nullptr;
+                if (deviceI->pipelineLibraryFile != nullptr)
+                    mapped_file::close(deviceI->pipelineLibraryFile);
+                deviceI->pipelineLibraryFile = nullptr;
+                if (serialized.size() > 0 && !pipeline_library_file::write(deviceI->pipelineLibraryPath.c_str(), deviceI->adapterIdentity, serialized.begin(), serialized.size()))
+                    bento::default_logger()->log(bento::LogLevel::info, "Pipeline Library", "Failed to write the pipeline library.");
+            }
+
             void destroy_graphics_device(GraphicsDevice graphicsDevice)
             {
                 DX12GraphicsDevice* dx12_device = (DX12GraphicsDevice*)graphicsDevice;
+
+                // Every queue is gone, the objects destroyed since the last collection are released while the caches and heaps are alive
+                deferred_destruction::destroy_queue(dx12_device->garbage);
+                work_stealing_pool::destroy_pool(dx12_device->workerPool);
+
+                // Every command buffer and queue is gone, all the allocators are back in the pool
+                CommandAllocatorPool& pool = dx12_device->commandAllocators;
+                assert_msg(pool.inFlight.size() == 0 && pool.available.size() == pool.numAllocators, "Command allocators are still in use.");
+                for (uint32_t allocIdx = 0; allocIdx < pool.numAllocators; ++allocIdx)
+                    ((ID3D12CommandAllocator*)pool.available[allocIdx])->Release();
+                CloseHandle(dx12_device->commandAllocatorEvent);
+
+                // Every queue is gone, so the pipelines that were swapped out have been released
+                if (dx12_device->hotReloader != nullptr)
+                {
+                    hot_reload::destroy_hot_reloader(dx12_device->hotReloader);
+                    file_watcher::destroy_file_watcher(dx12_device->fileWatcher);
+                }
+
+                // Every compute shader is gone, so are the objects they shared
+                object_cache::destroy_cache(dx12_device->pipelineStates);
+                object_cache::destroy_cache(dx12_device->rootSignatures);
+                if (dx12_device->pipelineLibrary != nullptr)
+                    save_pipeline_library(dx12_device);
+
+                // Every resource is gone, so are their placements
+                graphics_resources::destroy_heap_blocks(dx12_device);
+
+                dx12_device->resourceHeap->Release();
+                dx12_device->rangeViewHeap->Release();
+                dx12_device->bufferViewHeap->Release();
+                CloseHandle(dx12_device->descriptorRingEvent);
                 dx12_device->device->Release();
                 if (dx12_device->debugLayer != nullptr)
                     dx12_device->debugLayer->Release();
+                bento::make_delete<DX12GraphicsDevice>(*bento::common_allocator(), dx12_device);
+
+                // The last device takes the storage of the buffers and render textures with it
+                std::lock_guard<std::mutex> lock(handleTablesLock);
+                if (--handleTables->numDevices == 0)
+                {
+                    assert_msg(handle_table::num_alive(handleTables->buffers) == 0 && handle_table::num_alive(handleTables->renderTextures) == 0, "Buffers or render textures are still alive.");
+                    handle_table::release(handleTables->buffers);
+                    handle_table::release(handleTables->renderTextures);
+                    bento::make_delete<DX12HandleTables>(*bento::common_allocator(), handleTables);
+                    handleTables = nullptr;
+                }
             }
         }
     }
@@ -12,6 +12,11 @@ namespace graphics_sandbox
 {
 	namespace d3d12
 	{
+		namespace compute_shader
+		{
+			void release_retired_versions(DX12GraphicsDevice* deviceI, uint64_t fence, uint64_t completedValue);
+		}
+
 		// Function to create the command queue
 		ID3D12CommandQueue* CreateCommandQueue(ID3D12Device2* device, D3D12_COMMAND_LIST_TYPE type)
 		{
@@ -96,46 +101,322 @@ namespace graphics_sandbox
 
 		namespace command_queue
 		{
+			uint64_t wait_for_queue_fence(void* userData, uint64_t value)
+			{
+				// Runs on the timeline's worker, the event is not shared with anyone else
+				DX12CommandQueue* dx12_commandQueue = (DX12CommandQueue*)userData;
+				if (dx12_commandQueue->fence->GetCompletedValue() < value)
+				{
+					assert_msg(dx12_commandQueue->fence->SetEventOnCompletion(value, dx12_commandQueue->fenceEvent) == S_OK, "Failed to wait on fence.");
+					WaitForSingleObject(dx12_commandQueue->fenceEvent, INFINITE);
+				}
+				return dx12_commandQueue->fence->GetCompletedValue();
+			}
+
+			void run_readback_callbacks(uint64_t point, void* userData)
+			{
+				// Runs on the timeline's worker once the point is reached, the lock isn't held by the callbacks so they can release their ticket
+				DX12CommandQueue* dx12_commandQueue = (DX12CommandQueue*)userData;
+				bento::Vector<uint64_t> tickets(*bento::common_allocator());
+				{
+					std::lock_guard<std::mutex> lock(dx12_commandQueue->readbackLock);
+					readback_ring::signal(dx12_commandQueue->readbackRing, point);
+					readback_ring::tickets_with_callback(dx12_commandQueue->readbackRing, point, tickets);
+				}
+				for (uint32_t ticketIdx = 0; ticketIdx < tickets.size(); ++ticketIdx)
+				{
+					ReadbackCallback callback = nullptr;
+					void* callbackData = nullptr;
+					{
+						std::lock_guard<std::mutex> lock(dx12_commandQueue->readbackLock);
+						ReadbackTicketState* state;
+						if (readback_ring::get(dx12_commandQueue->readbackRing, tickets[ticketIdx], state))
+						{
+							callback = state->callback;
+							callbackData = state->userData;
+						}
+					}
+
+					// The application may have released the ticket in the meantime
+					uint64_t size;
+					const char* data = callback != nullptr ? map_readback((CommandQueue)dx12_commandQueue, tickets[ticketIdx], size) : nullptr;
+					if (data != nullptr)
+						callback(tickets[ticketIdx], data, size, callbackData);
+				}
+			}
+
+			uint64_t signal_next_point(DX12CommandQueue* dx12_commandQueue, ID3D12CommandList* commandList)
+			{
+				std::lock_guard<std::mutex> lock(dx12_commandQueue->submitLock);
+				if (commandList != nullptr)
+					dx12_commandQueue->queue->ExecuteCommandLists(1, &commandList);
+				uint64_t point = timeline::submit(dx12_commandQueue->timeline);
+				dx12_commandQueue->queue->Signal(dx12_commandQueue->fence, point);
+				return point;
+			}
+
 			CommandQueue create_command_queue(GraphicsDevice graphicsDevice)
 			{
 				DX12GraphicsDevice* dx12_device = (DX12GraphicsDevice*)graphicsDevice;
 				ID3D12CommandQueue* commandQueue = CreateCommandQueue(dx12_device->device, D3D12_COMMAND_LIST_TYPE_DIRECT);
 				assert_msg(commandQueue != nullptr, "Failed to create command queue.");
 
-				DX12CommandQueue* dx12_commandQueue = bento::make_new<DX12CommandQueue>(*bento::common_allocator());
+				DX12CommandQueue* dx12_commandQueue = bento::make_new<DX12CommandQueue>(*bento::common_allocator(), *bento::common_allocator());
+				dx12_commandQueue->deviceI = dx12_device;
 				dx12_commandQueue->queue = commandQueue;
 				dx12_commandQueue->fence = (ID3D12Fence*)fence::create_fence(graphicsDevice);
 				dx12_commandQueue->fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
-
-				dx12_commandQueue->fenceValue = 0;
+				dx12_commandQueue->timeline = timeline::create_timeline(*bento::common_allocator(), wait_for_queue_fence, dx12_commandQueue);
+
+				// The upload ring is mapped once, the CPU only writes to it
+				D3D12_HEAP_PROPERTIES heap = {};
+				heap.Type = D3D12_HEAP_TYPE_UPLOAD;
+				D3D12_RESOURCE_DESC resourceDescriptor = { D3D12_RESOURCE_DIMENSION_BUFFER, 0, DX12_UPLOAD_RING_SIZE, 1, 1, 1, DXGI_FORMAT_UNKNOWN, 1, 0, D3D12_TEXTURE_LAYOUT_ROW_MAJOR, D3D12_RESOURCE_FLAG_NONE };
+				assert_msg(dx12_device->device->CreateCommittedResource(&heap, D3D12_HEAP_FLAG_NONE, &resourceDescriptor, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&dx12_commandQueue->uploadBuffer)) == S_OK, "Failed to create the upload ring.");
+				D3D12_RANGE readRange = { 0, 0 };
+				assert_msg(dx12_commandQueue->uploadBuffer->Map(0, &readRange, (void**)&dx12_commandQueue->uploadCPU) == S_OK, "Failed to map the upload ring.");
+				dx12_commandQueue->uploadGPU = dx12_commandQueue->uploadBuffer->GetGPUVirtualAddress();
+				upload_ring::initialize(dx12_commandQueue->uploadRing, DX12_UPLOAD_RING_SIZE);
+
+				// The readback memory is only mapped range by range, when the application reads a ticket
+				dx12_commandQueue->readbackBuffer = graphics_resources::create_graphics_buffer(graphicsDevice, DX12_READBACK_RING_SIZE, 1, GraphicsBufferType::Readback);
+				readback_ring::initialize(dx12_commandQueue->readbackRing, DX12_READBACK_RING_SIZE);
+				{
+					std::lock_guard<std::mutex> lock(dx12_device->queuesLock);
+					dx12_device->queues.push_back(dx12_commandQueue);
+				}
 				return (CommandQueue)dx12_commandQueue;
 			}
 
 			void destroy_command_queue(CommandQueue commandQueue)
 			{
 				DX12CommandQueue* dx12_commandQueue = (DX12CommandQueue*)commandQueue;
+
+				// Make sure nothing is in flight before the descriptor tables tracked by this fence are given back, nothing waits on it from now on
+				flush(commandQueue);
+				DX12GraphicsDevice* deviceI = dx12_commandQueue->deviceI;
+				{
+					std::lock_guard<std::mutex> lock(deviceI->queuesLock);
+					bento::Vector<DX12CommandQueue*>& queues = deviceI->queues;
+					for (uint32_t queueIdx = 0; queueIdx < queues.size(); ++queueIdx)
+					{
+						if (queues[queueIdx] == dx12_commandQueue)
+						{
+							queues[queueIdx] = queues[queues.size() - 1];
+							queues.resize(queues.size() - 1);
+							break;
+						}
+					}
+				}
+				{
+					std::lock_guard<std::mutex> lock(dx12_commandQueue->deviceI->descriptorRingLock);
+					descriptor_ring::forget_fence(dx12_commandQueue->deviceI->descriptorRing, (uint64_t)dx12_commandQueue->fence);
+				}
+				{
+					std::lock_guard<std::mutex> lock(dx12_commandQueue->deviceI->commandAllocatorLock);
+					command_allocator_pool::forget_fence(dx12_commandQueue->deviceI->commandAllocators, (uint64_t)dx12_commandQueue->fence);
+				}
+
+				// The pipelines swapped out and the objects destroyed while the queue was alive (its readback memory included) no longer wait for it
+				graphics_resources::destroy_graphics_buffer(dx12_commandQueue->readbackBuffer);
+				if (deviceI->hotReloader != nullptr)
+					compute_shader::release_retired_versions(deviceI, (uint64_t)dx12_commandQueue->fence, UINT64_MAX);
+				uint64_t fence = (uint64_t)dx12_commandQueue->fence;
+				uint64_t forgotten = UINT64_MAX;
+				deferred_destruction::collect(deviceI->garbage, &fence, &forgotten, 1);
+				timeline::destroy_timeline(dx12_commandQueue->timeline);
+				CloseHandle(dx12_commandQueue->fenceEvent);
+				dx12_commandQueue->uploadBuffer->Unmap(0, nullptr);
+				dx12_commandQueue->uploadBuffer->Release();
+
 				dx12_commandQueue->queue->Release();
 				fence::destroy_fence((Fence)dx12_commandQueue->fence);
 				bento::make_delete<DX12CommandQueue>(*bento::common_allocator(), dx12_commandQueue);
 			}
 
-			void execute_command_buffer(CommandQueue commandQueue, CommandBuffer commandBuffer)
+			uint64_t execute_command_buffer(CommandQueue commandQueue, CommandBuffer commandBuffer)
 			{
 				// Grab the internal structures
 				DX12CommandBuffer* dx12_commandBuffer = (DX12CommandBuffer*)commandBuffer;
 				DX12CommandQueue* dx12_commandQueue = (DX12CommandQueue*)commandQueue;
 
-				ID3D12CommandList* const commandLists[] = { dx12_commandBuffer->cmdList};
-				dx12_commandQueue->queue->ExecuteCommandLists(1, commandLists);
+				// Tag the descriptor tables and the allocator of this command buffer with the point that signals the end of its execution
+				uint64_t point = signal_next_point(dx12_commandQueue, dx12_commandBuffer->cmdList);
+				uint64_t fence = (uint64_t)dx12_commandQueue->fence;
+				uint64_t completedValue = dx12_commandQueue->fence->GetCompletedValue();
+				DX12GraphicsDevice* deviceI = dx12_commandQueue->deviceI;
+				{
+					std::lock_guard<std::mutex> lock(deviceI->descriptorRingLock);
+					descriptor_ring::submit(deviceI->descriptorRing, (uint64_t)dx12_commandBuffer, fence, point);
+					descriptor_ring::reclaim(deviceI->descriptorRing, fence, completedValue);
+				}
+				{
+					std::lock_guard<std::mutex> lock(deviceI->commandAllocatorLock);
+					command_allocator_pool::submit(deviceI->commandAllocators, (uint64_t)dx12_commandBuffer->cmdAlloc, fence, point);
+					command_allocator_pool::reclaim(deviceI->commandAllocators, fence, completedValue);
+				}
+
+				// Release the objects destroyed before the work this queue has completed, the other queues are collected with their own submissions
+				deferred_destruction::collect(dx12_commandQueue->deviceI->garbage, &fence, &completedValue, 1);
+
+				// The readbacks recorded by the command buffer are available once the point is reached
+				uint32_t numCallbacks;
+				{
+					std::lock_guard<std::mutex> lock(dx12_commandQueue->readbackLock);
+					numCallbacks = readback_ring::submit(dx12_commandQueue->readbackRing, (uint64_t)dx12_commandBuffer, point);
+					readback_ring::signal(dx12_commandQueue->readbackRing, completedValue);
+				}
+				if (numCallbacks > 0)
+					timeline::add_callback(dx12_commandQueue->timeline, point, run_readback_callbacks, dx12_commandQueue);
+				return point;
+			}
+
+			UploadAllocation allocate_upload(CommandQueue commandQueue, uint64_t size, uint64_t alignment)
+			{
+				DX12CommandQueue* dx12_commandQueue = (DX12CommandQueue*)commandQueue;
+				std::lock_guard<std::mutex> lock(dx12_commandQueue->uploadLock);
+				UploadRing& ring = dx12_commandQueue->uploadRing;
+				uint64_t offset = 0;
+				while (!upload_ring::allocate(ring, size, alignment, offset))
+				{
+					// The ring is full, wait for the GPU to be done with the oldest frame
+					uint64_t point;
+					assert_msg(upload_ring::oldest_fence_value(ring, point), "Upload ring exhausted by a single frame.");
+					timeline::wait(dx12_commandQueue->timeline, point);
+					upload_ring::reclaim(ring, dx12_commandQueue->fence->GetCompletedValue());
+				}
+
+				UploadAllocation allocation;
+				allocation.cpuAddress = dx12_commandQueue->uploadCPU + offset;
+				allocation.gpuAddress = dx12_commandQueue->uploadGPU + offset;
+				allocation.offset = offset;
+				allocation.size = size;
+				return allocation;
+			}
+
+			uint64_t end_upload_frame(CommandQueue commandQueue)
+			{
+				// The point is reached once everything executed so far is done, including every reader of the frame
+				DX12CommandQueue* dx12_commandQueue = (DX12CommandQueue*)commandQueue;
+				std::lock_guard<std::mutex> lock(dx12_commandQueue->uploadLock);
+				uint64_t point = signal_next_point(dx12_commandQueue, nullptr);
+				upload_ring::end_frame(dx12_commandQueue->uploadRing, point);
+				upload_ring::reclaim(dx12_commandQueue->uploadRing, dx12_commandQueue->fence->GetCompletedValue());
+				return point;
+			}
+
+			uint64_t request_readback(CommandQueue commandQueue, CommandBuffer commandBuffer, GraphicsBuffer graphicsBuffer, uint64_t offset, uint64_t size, ReadbackCallback callback, void* userData)
+			{
+				DX12CommandQueue* dx12_commandQueue = (DX12CommandQueue*)commandQueue;
+				uint64_t ticket;
+				uint64_t stagingOffset;
+				{
+					// Give the space of the completed tickets back first
+					std::lock_guard<std::mutex> lock(dx12_commandQueue->readbackLock);
+					readback_ring::signal(dx12_commandQueue->readbackRing, dx12_commandQueue->fence->GetCompletedValue());
+					ticket = readback_ring::allocate(dx12_commandQueue->readbackRing, size, READBACK_RING_ALIGNMENT, (uint64_t)commandBuffer, callback, userData, stagingOffset);
+				}
+				if (ticket != 0)
+					command_buffer::copy_buffer_region(commandBuffer, graphicsBuffer, offset, dx12_commandQueue->readbackBuffer, stagingOffset, size);
+				return ticket;
+			}
+
+			ReadbackStatus readback_status(CommandQueue commandQueue, uint64_t ticket)
+			{
+				DX12CommandQueue* dx12_commandQueue = (DX12CommandQueue*)commandQueue;
+				std::lock_guard<std::mutex> lock(dx12_commandQueue->readbackLock);
+				readback_ring::signal(dx12_commandQueue->readbackRing, dx12_commandQueue->fence->GetCompletedValue());
+				return readback_ring::status(dx12_commandQueue->readbackRing, ticket);
+			}
+
+			const char* map_readback(CommandQueue commandQueue, uint64_t ticket, uint64_t& size)
+			{
+				DX12CommandQueue* dx12_commandQueue = (DX12CommandQueue*)commandQueue;
+				std::lock_guard<std::mutex> lock(dx12_commandQueue->readbackLock);
+				ReadbackRing& ring = dx12_commandQueue->readbackRing;
+				readback_ring::signal(ring, dx12_commandQueue->fence->GetCompletedValue());
+				ReadbackTicketState* state;
+				if (readback_ring::status(ring, ticket) != ReadbackStatus::Ready || !readback_ring::get(ring, ticket, state))
+					return nullptr;
+
+				// Only the range of the ticket is made visible to the CPU, the mappings of the resource are counted
+				if (!state->mapped)
+				{
+					D3D12_RANGE range = { state->offset, state->offset + state->size };
+					ID3D12Resource* resource = handle_table::hot(handleTables->buffers, dx12_commandQueue->readbackBuffer)->resource;
+					assert_msg(resource->Map(0, &range, (void**)&dx12_commandQueue->readbackCPU) == S_OK, "Failed to map the readback range.");
+					state->mapped = true;
+				}
+				size = state->size;
+				return dx12_commandQueue->readbackCPU + state->offset;
+			}
+
+			void release_readback(CommandQueue commandQueue, uint64_t ticket)
+			{
+				DX12CommandQueue* dx12_commandQueue = (DX12CommandQueue*)commandQueue;
+				std::lock_guard<std::mutex> lock(dx12_commandQueue->readbackLock);
+				ReadbackTicketState* state;
+				assert_msg(readback_ring::get(dx12_commandQueue->readbackRing, ticket, state), "Invalid or released readback ticket.");
+				if (state->mapped)
+				{
+					// Nothing was written by the CPU
+					D3D12_RANGE writtenRange = { 0, 0 };
+					handle_table::hot(handleTables->buffers, dx12_commandQueue->readbackBuffer)->resource->Unmap(0, &writtenRange);
+				}
+				readback_ring::release(dx12_commandQueue->readbackRing, ticket);
 			}
-			
+
 			void flush(CommandQueue commandQueue)
 			{
 				DX12CommandQueue* dx12_commandQueue = (DX12CommandQueue*)commandQueue;
-				dx12_commandQueue->fenceValue++;
-				dx12_commandQueue->queue->Signal(dx12_commandQueue->fence, dx12_commandQueue->fenceValue);
-				dx12_commandQueue->fence->SetEventOnCompletion(dx12_commandQueue->fenceValue, dx12_commandQueue->fenceEvent);
-				WaitForSingleObject(dx12_commandQueue->fenceEvent, INFINITE);
+				timeline::wait(dx12_commandQueue->timeline, signal_next_point(dx12_commandQueue, nullptr));
+			}
+
+			bool is_complete(CommandQueue commandQueue, uint64_t point)
+			{
+				// Don't wait for the worker to notice, the fence is cheap to query
+				DX12CommandQueue* dx12_commandQueue = (DX12CommandQueue*)commandQueue;
+				timeline::signal(dx12_commandQueue->timeline, dx12_commandQueue->fence->GetCompletedValue());
+				return timeline::is_complete(dx12_commandQueue->timeline, point);
+			}
+
+			bool wait(CommandQueue commandQueue, uint64_t point, uint64_t timeoutMS)
+			{
+				DX12CommandQueue* dx12_commandQueue = (DX12CommandQueue*)commandQueue;
+				return timeline::wait(dx12_commandQueue->timeline, point, timeoutMS);
+			}
+
+			void gather_timelines(const CommandQueue* commandQueues, uint32_t count, bento::Vector<Timeline*>& timelines)
+			{
+				timelines.resize(count);
+				for (uint32_t queueIdx = 0; queueIdx < count; ++queueIdx)
+					timelines[queueIdx] = ((DX12CommandQueue*)commandQueues[queueIdx])->timeline;
+			}
+
+			uint32_t wait_any(const CommandQueue* commandQueues, const uint64_t* points, uint32_t count, uint64_t timeoutMS)
+			{
+				bento::Vector<Timeline*> timelines(*bento::common_allocator());
+				gather_timelines(commandQueues, count, timelines);
+				return timeline::wait_any(timelines.begin(), points, count, timeoutMS);
+			}
+
+			bool wait_all(const CommandQueue* commandQueues, const uint64_t* points, uint32_t count, uint64_t timeoutMS)
+			{
+				bento::Vector<Timeline*> timelines(*bento::common_allocator());
+				gather_timelines(commandQueues, count, timelines);
+				return timeline::wait_all(timelines.begin(), points, count, timeoutMS);
+			}
+
+			void add_completion_callback(CommandQueue commandQueue, uint64_t point, TimelineCallback callback, void* userData)
+			{
+				DX12CommandQueue* dx12_commandQueue = (DX12CommandQueue*)commandQueue;
+				timeline::add_callback(dx12_commandQueue->timeline, point, callback, userData);
+			}
+
+			Fence get_fence(CommandQueue commandQueue)
+			{
+				DX12CommandQueue* dx12_commandQueue = (DX12CommandQueue*)commandQueue;
+				return (Fence)dx12_commandQueue->fence;
 			}
 		}
 
@@ -173,16 +454,25 @@ namespace graphics_sandbox
 				for (uint32_t n = 0; n < DX12_NUM_BACK_BUFFERS; n++)
 				{
 					// Keep track of the descriptor heap where this is stored
-					DX12RenderTexture& currentRenderTexture = swapChainI->backBufferRenderTexture[n];
-					currentRenderTexture.state = D3D12_RESOURCE_STATE_PRESENT;
-					currentRenderTexture.descriptorHeap = swapChainI->descriptorHeap;
-					currentRenderTexture.heapOffset = deviceI->descriptorSize[D3D12_DESCRIPTOR_HEAP_TYPE_RTV] * n;
+					RenderTexture renderTexture = handle_table::allocate(handleTables->renderTextures);
+					assert_msg(renderTexture != 0, "Too many render textures.");
+					swapChainI->backBufferRenderTexture[n] = renderTexture;
+					DX12RenderTexture* currentRenderTexture = handle_table::hot(handleTables->renderTextures, renderTexture);
+					currentRenderTexture->state = D3D12_RESOURCE_STATE_PRESENT;
+					currentRenderTexture->rtvCPU = rtvHandle;
+					currentRenderTexture->needsDiscard = false;
+					DX12RenderTextureCold* renderTextureCold = handle_table::cold(handleTables->renderTextures, renderTexture);
+					renderTextureCold->deviceI = deviceI;
+					renderTextureCold->heapBlock = nullptr;
+					renderTextureCold->heapAllocation = TLSF_INVALID_BLOCK;
+					renderTextureCold->descriptorHeap = swapChainI->descriptorHeap;
+					renderTextureCold->rtOwned = false;
 
 					// Grab the buffer of the swap chain
-					assert_msg(swapChainI->swapChain->GetBuffer(n, IID_PPV_ARGS(&swapChainI->backBufferRenderTexture[n].resource)) == S_OK, "Failed to get the swap chain buffer.");
+					assert_msg(swapChainI->swapChain->GetBuffer(n, IID_PPV_ARGS(&currentRenderTexture->resource)) == S_OK, "Failed to get the swap chain buffer.");
 
 					// Create a render target view for it
-					device->CreateRenderTargetView(swapChainI->backBufferRenderTexture[n].resource, nullptr, rtvHandle);
+					device->CreateRenderTargetView(currentRenderTexture->resource, nullptr, rtvHandle);
 
 					// Move on to the next pointer
 					rtvHandle.ptr += (1 * deviceI->descriptorSize[D3D12_DESCRIPTOR_HEAP_TYPE_RTV]);
@@ -199,7 +489,11 @@ namespace graphics_sandbox
 
 				// Release the render target views
 				for (uint32_t n = 0; n < DX12_NUM_BACK_BUFFERS; n++)
-					dx12_swapChain->backBufferRenderTexture[n].resource->Release();
+				{
+					RenderTexture renderTexture = dx12_swapChain->backBufferRenderTexture[n];
+					handle_table::hot(handleTables->renderTextures, renderTexture)->resource->Release();
+					handle_table::free(handleTables->renderTextures, renderTexture);
+				}
 
 				// Release the DX12 structures
 				dx12_swapChain->descriptorHeap->Release();
@@ -212,10 +506,10 @@ namespace graphics_sandbox
 			RenderTexture get_current_render_texture(SwapChain swapChain)
 			{
 				DX12SwapChain* dx12_swapChain = (DX12SwapChain*)swapChain;
-				return (RenderTexture)(&dx12_swapChain->backBufferRenderTexture[dx12_swapChain->currentBackBuffer]);
+				return dx12_swapChain->backBufferRenderTexture[dx12_swapChain->currentBackBuffer];
 			}
 
-			void present(SwapChain swapChain, CommandQueue commandQueue)
+			uint64_t present(SwapChain swapChain, CommandQueue commandQueue)
 			{
 				// Convert to the internal structure
 				DX12SwapChain* dx12_swapChain = (DX12SwapChain*)swapChain;
@@ -223,12 +517,11 @@ namespace graphics_sandbox
 				// Present the frame buffer
 				assert_msg(dx12_swapChain->swapChain->Present(0, 0) == S_OK, "Swap Chain Present failed.");
 
-				// Wait on the fence
-				DX12CommandQueue* dx12_commandQueue = (DX12CommandQueue*)commandQueue;
-				command_queue::flush(commandQueue);
-
 				// Update the current back buffer
 				dx12_swapChain->currentBackBuffer = dx12_swapChain->swapChain->GetCurrentBackBufferIndex();
+
+				// The caller decides when it needs to wait for the frame
+				return command_queue::signal_next_point((DX12CommandQueue*)commandQueue, nullptr);
 			}
 		}
 
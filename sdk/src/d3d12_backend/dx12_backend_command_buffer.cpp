@@ -7,17 +7,22 @@
 #include "d3d12_backend/dx12_backend.h"
 #include "d3d12_backend/dx12_containers.h"
 
-// Value that allows us to identify the current batch for a command buffer
-#define INTIIAL_BATCH_IDENTIFIER 665;
-
 namespace graphics_sandbox
 {
     namespace d3d12
     {
         // Function that may be used and is declared in an other file
-        namespace compute_shader
+        namespace graphics_device
         {
-            void validate_compute_shader_heap(DX12ComputeShader* computeShader, uint32_t cmdBatchIndex);
+            uint32_t allocate_descriptor_table(DX12GraphicsDevice* deviceI, uint64_t owner, uint32_t count);
+            ID3D12CommandAllocator* acquire_command_allocator(DX12GraphicsDevice* deviceI);
+        }
+
+        namespace graphics_resources
+        {
+            uint32_t bindless_index(GraphicsBuffer graphicsBuffer, BufferViewType viewType);
+            void acquire_range_view(GraphicsBuffer graphicsBuffer, BufferViewType viewType, uint64_t first, uint64_t count, bool bindless, D3D12_CPU_DESCRIPTOR_HANDLE& view, uint32_t& bindlessIndex, uint64_t& key);
+            void unpin_range_view(GraphicsBuffer graphicsBuffer, uint64_t key);
         }
 
         // Command Buffer API
@@ -28,38 +33,71 @@ namespace graphics_sandbox
                 bool stateChange = targetState != resourceState;
                 if (stateChange)
                 {
-                    // Define a barrier for the resource
-                    D3D12_RESOURCE_BARRIER barrier = {};
-                    barrier.Type = (D3D12_RESOURCE_BARRIER_TYPE_TRANSITION);
-                    barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-                    barrier.Transition.pResource = resource;
-                    barrier.Transition.StateBefore = resourceState;
-                    barrier.Transition.StateAfter = targetState;
-                    barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-                    commandBuffer->cmdList->ResourceBarrier(1, &barrier);
+                    // The barrier is only emitted right before the next command that needs it
+                    resource_barrier_batch::request_transition(commandBuffer->barrierBatch, (uint64_t)resource, (uint32_t)resourceState, (uint32_t)targetState);
 
                     // Keep track of the new state
                     resourceState = targetState;
                 }
             }
 
+            void flush_resource_barriers(DX12CommandBuffer* commandBuffer)
+            {
+                // Drop the transitions that cancelled out
+                ResourceBarrierBatch& barrierBatch = commandBuffer->barrierBatch;
+                uint32_t numBarriers = resource_barrier_batch::compact(barrierBatch);
+                if (numBarriers == 0)
+                {
+                    resource_barrier_batch::reset(barrierBatch);
+                    return;
+                }
+
+                // Convert all the pending barriers
+                commandBuffer->barrierArray.resize(numBarriers);
+                bool transitions = false;
+                for (uint32_t barrierIdx = 0; barrierIdx < numBarriers; ++barrierIdx)
+                {
+                    const ResourceBarrier& pending = barrierBatch.barriers[barrierIdx];
+                    D3D12_RESOURCE_BARRIER& barrier = commandBuffer->barrierArray[barrierIdx];
+                    barrier = {};
+                    barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+                    if (pending.type == ResourceBarrierType::Transition)
+                    {
+                        barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+                        barrier.Transition.pResource = (ID3D12Resource*)pending.resource;
+                        barrier.Transition.StateBefore = (D3D12_RESOURCE_STATES)pending.stateBefore;
+                        barrier.Transition.StateAfter = (D3D12_RESOURCE_STATES)pending.stateAfter;
+                        barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+                        transitions = true;
+                    }
+                    else
+                    {
+                        barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+                        barrier.UAV.pResource = (ID3D12Resource*)pending.resource;
+                    }
+                }
+
+                // Emit them in a single call
+                commandBuffer->cmdList->ResourceBarrier(numBarriers, commandBuffer->barrierArray.begin());
+                resource_barrier_batch::reset(barrierBatch);
+
+                // The tables and root CBVs are declared static while set at execute, a resource that went through a copy or a write
+                // since they were set has to be set again before the next dispatch reads it
+                if (transitions)
+                    shadow_state_tracker::invalidate_root_arguments(commandBuffer->shadowState);
+            }
+
             void uav_barrier(CommandBuffer commandBuffer, GraphicsBuffer targetBuffer)
             {
                 // Get the internal command buffer structure
                 DX12CommandBuffer* dx12_commandBuffer = (DX12CommandBuffer*)commandBuffer;
 
                 // Prepare the input buffer if needed
-                DX12GraphicsBuffer* dx12_inputBuffer = (DX12GraphicsBuffer*)targetBuffer;
+                DX12GraphicsBuffer* dx12_inputBuffer = handle_table::hot(handleTables->buffers, targetBuffer);
 
                 // Define a barrier for the resource
                 if (dx12_inputBuffer->state == D3D12_RESOURCE_STATE_UNORDERED_ACCESS)
-                {
-                    D3D12_RESOURCE_BARRIER barrier = {};
-                    barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
-                    barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-                    barrier.UAV.pResource = dx12_inputBuffer->resource;
-                    dx12_commandBuffer->cmdList->ResourceBarrier(1, &barrier);
-                }
+                    resource_barrier_batch::request_uav_barrier(dx12_commandBuffer->barrierBatch, (uint64_t)dx12_inputBuffer->resource);
             }
 
             CommandBuffer create_command_buffer(GraphicsDevice graphicsDevice)
@@ -71,31 +109,55 @@ namespace graphics_sandbox
                 DX12GraphicsDevice* dx12_device = (DX12GraphicsDevice*)graphicsDevice;
 
                 // Create the command buffer
-                DX12CommandBuffer* dx12_commandBuffer = bento::make_new<DX12CommandBuffer>(*allocator);
+                DX12CommandBuffer* dx12_commandBuffer = bento::make_new<DX12CommandBuffer>(*allocator, *allocator);
 
-                // Create the command allocator i
-                assert_msg(dx12_device->device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE::D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&dx12_commandBuffer->cmdAlloc)) == S_OK, "Failed to create command allocator");
+                // Grab a command allocator from the device's pool
+                dx12_commandBuffer->cmdAlloc = graphics_device::acquire_command_allocator(dx12_device);
 
                 // Create the command list
                 assert_msg(dx12_device->device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE::D3D12_COMMAND_LIST_TYPE_DIRECT, dx12_commandBuffer->cmdAlloc, nullptr, IID_PPV_ARGS(&dx12_commandBuffer->cmdList)) == S_OK, "Failed to create command list.");
                 assert_msg(dx12_commandBuffer->cmdList->Close() == S_OK, "Failed to close command list.");
                 dx12_commandBuffer->deviceI = dx12_device;
-                dx12_commandBuffer->batchIdentifier = INTIIAL_BATCH_IDENTIFIER;
+                shadow_state_tracker::initialize(dx12_commandBuffer->shadowState);
 
                 // Convert to the opaque structure
                 return (CommandBuffer)dx12_commandBuffer;
             }
 
+            void cancel_readbacks(DX12CommandBuffer* commandBuffer)
+            {
+                // The copies recorded since the last execution will never run, their tickets must not be stamped by a later one
+                DX12GraphicsDevice* deviceI = commandBuffer->deviceI;
+                std::lock_guard<std::mutex> queuesLock(deviceI->queuesLock);
+                for (uint32_t queueIdx = 0; queueIdx < deviceI->queues.size(); ++queueIdx)
+                {
+                    DX12CommandQueue* commandQueue = deviceI->queues[queueIdx];
+                    std::lock_guard<std::mutex> lock(commandQueue->readbackLock);
+                    readback_ring::cancel(commandQueue->readbackRing, (uint64_t)commandBuffer);
+                }
+            }
+
             void destroy_command_buffer(CommandBuffer command_buffer)
             {
                 // Convert to the internal structure
                 DX12CommandBuffer* dx12_commandBuffer = (DX12CommandBuffer*)command_buffer;
 
+                // Give back the descriptor tables and the readback tickets that were never submitted
+                DX12GraphicsDevice* deviceI = dx12_commandBuffer->deviceI;
+                {
+                    std::lock_guard<std::mutex> lock(deviceI->descriptorRingLock);
+                    descriptor_ring::release(deviceI->descriptorRing, (uint64_t)dx12_commandBuffer);
+                }
+                cancel_readbacks(dx12_commandBuffer);
+
                 // Release the command list
                 dx12_commandBuffer->cmdList->Release();
 
-                // Release the command allocator
-                dx12_commandBuffer->cmdAlloc->Release();
+                // Give back the command allocator, it is recycled once the GPU is done with it
+                {
+                    std::lock_guard<std::mutex> lock(deviceI->commandAllocatorLock);
+                    command_allocator_pool::release(deviceI->commandAllocators, (uint64_t)dx12_commandBuffer->cmdAlloc);
+                }
 
                 // Destroy the render environment
                 bento::make_delete<DX12CommandBuffer>(*bento::common_allocator(), dx12_commandBuffer);
@@ -104,26 +166,59 @@ namespace graphics_sandbox
             void reset(CommandBuffer commandBuffer)
             {
                 DX12CommandBuffer* dx12_commandBuffer = (DX12CommandBuffer*)commandBuffer;
+
+                // The previous allocator may still be executing, record in one that the GPU is done with
+                DX12GraphicsDevice* deviceI = dx12_commandBuffer->deviceI;
+                {
+                    std::lock_guard<std::mutex> lock(deviceI->commandAllocatorLock);
+                    command_allocator_pool::release(deviceI->commandAllocators, (uint64_t)dx12_commandBuffer->cmdAlloc);
+                }
+                dx12_commandBuffer->cmdAlloc = graphics_device::acquire_command_allocator(dx12_commandBuffer->deviceI);
                 dx12_commandBuffer->cmdAlloc->Reset();
                 dx12_commandBuffer->cmdList->Reset(dx12_commandBuffer->cmdAlloc, nullptr);
-                dx12_commandBuffer->batchIdentifier++;
+                resource_barrier_batch::discard(dx12_commandBuffer->barrierBatch);
 
+                // The descriptor tables recorded since the last submission will never be used
+                {
+                    std::lock_guard<std::mutex> lock(deviceI->descriptorRingLock);
+                    descriptor_ring::release(deviceI->descriptorRing, (uint64_t)dx12_commandBuffer);
+                }
+                cancel_readbacks(dx12_commandBuffer);
+
+                // The new recording starts without any state or table bound
+                dx12_commandBuffer->recording = deviceI->nextRecording.fetch_add(1);
+                shadow_state_tracker::reset(dx12_commandBuffer->shadowState);
             }
 
             void close(CommandBuffer commandBuffer)
             {
                 DX12CommandBuffer* dx12_commandBuffer = (DX12CommandBuffer*)commandBuffer;
+                flush_resource_barriers(dx12_commandBuffer);
                 dx12_commandBuffer->cmdList->Close();
             }
 
+            void discard_render_texture(DX12CommandBuffer* commandBuffer, DX12RenderTexture* renderTexture)
+            {
+                // The metadata of a placed render or depth target is undefined until it is discarded, cleared or fully copied to
+                if (!renderTexture->needsDiscard)
+                    return;
+                renderTexture->needsDiscard = false;
+
+                // The discard needs the texture in its writable state
+                bool depth = (renderTexture->resource->GetDesc().Flags & D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL) != 0;
+                change_resource_state(commandBuffer, renderTexture->resource, renderTexture->state, depth ? D3D12_RESOURCE_STATE_DEPTH_WRITE : D3D12_RESOURCE_STATE_RENDER_TARGET);
+                flush_resource_barriers(commandBuffer);
+                commandBuffer->cmdList->DiscardResource(renderTexture->resource, nullptr);
+            }
+
             void set_render_texture(CommandBuffer commandBuffer, RenderTexture renderTexture)
             {
                 DX12CommandBuffer* dx12_commandBuffer = (DX12CommandBuffer*)commandBuffer;
-                DX12RenderTexture* dx12_renderTexture = (DX12RenderTexture*)renderTexture;
+                DX12RenderTexture* dx12_renderTexture = handle_table::hot(handleTables->renderTextures, renderTexture);
+                discard_render_texture(dx12_commandBuffer, dx12_renderTexture);
 
                 // Grab the render target view
-                D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle(dx12_renderTexture->descriptorHeap->GetCPUDescriptorHandleForHeapStart());
-                rtvHandle.ptr += dx12_renderTexture->heapOffset;
+                D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle = dx12_renderTexture->rtvCPU;
 
                 // Set the render target and the current one
                 dx12_commandBuffer->cmdList->OMSetRenderTargets(1, &rtvHandle, FALSE, nullptr);
@@ -133,23 +228,25 @@ namespace graphics_sandbox
             {
                 // Grab the actual structures
                 DX12CommandBuffer* dx12_commandBuffer = (DX12CommandBuffer*)commandBuffer;
-                DX12RenderTexture* dx12_renderTexture = (DX12RenderTexture*)renderTeture;
+                DX12RenderTexture* dx12_renderTexture = handle_table::hot(handleTables->renderTextures, renderTeture);
+                discard_render_texture(dx12_commandBuffer, dx12_renderTexture);
 
                 // Grab the render target view
-                D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle(dx12_renderTexture->descriptorHeap->GetCPUDescriptorHandleForHeapStart());
-                rtvHandle.ptr += dx12_renderTexture->heapOffset;
+                D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle = dx12_renderTexture->rtvCPU;
 
                 // Make sure the state is the right one
                 change_resource_state(dx12_commandBuffer, dx12_renderTexture->resource, dx12_renderTexture->state, D3D12_RESOURCE_STATE_RENDER_TARGET);
 
                 // Clear with the color
+                flush_resource_barriers(dx12_commandBuffer);
                 dx12_commandBuffer->cmdList->ClearRenderTargetView(rtvHandle, &color.x, 0, nullptr);
             }
 
             void render_texture_present(CommandBuffer commandBuffer, RenderTexture renderTeture)
             {
                 DX12CommandBuffer* dx12_commandBuffer = (DX12CommandBuffer*)commandBuffer;
-                DX12RenderTexture* dx12_renderTexture = (DX12RenderTexture*)renderTeture;
+                DX12RenderTexture* dx12_renderTexture = handle_table::hot(handleTables->renderTextures, renderTeture);
+                discard_render_texture(dx12_commandBuffer, dx12_renderTexture);
 
                 // Make sure the state is the right one
                 change_resource_state(dx12_commandBuffer, dx12_renderTexture->resource, dx12_renderTexture->state, D3D12_RESOURCE_STATE_PRESENT);
@@ -161,14 +258,15 @@ namespace graphics_sandbox
                 DX12CommandBuffer* dx12_commandBuffer = (DX12CommandBuffer*)commandBuffer;
 
                 // Prepare the input buffer if needed
-                DX12GraphicsBuffer* dx12_inputBuffer = (DX12GraphicsBuffer*)inputBuffer;
+                DX12GraphicsBuffer* dx12_inputBuffer = handle_table::hot(handleTables->buffers, inputBuffer);
                 change_resource_state(dx12_commandBuffer, dx12_inputBuffer->resource, dx12_inputBuffer->state, dx12_inputBuffer->type == GraphicsBufferType::Upload ? D3D12_RESOURCE_STATE_GENERIC_READ : D3D12_RESOURCE_STATE_COPY_SOURCE);
 
                 // Prepare the output buffer if needed
-                DX12GraphicsBuffer* dx12_outputBuffer = (DX12GraphicsBuffer*)outputBuffer;
+                DX12GraphicsBuffer* dx12_outputBuffer = handle_table::hot(handleTables->buffers, outputBuffer);
                 change_resource_state(dx12_commandBuffer, dx12_outputBuffer->resource, dx12_outputBuffer->state, D3D12_RESOURCE_STATE_COPY_DEST);
 
                 // Copy the resource
+                flush_resource_barriers(dx12_commandBuffer);
                 dx12_commandBuffer->cmdList->CopyResource(dx12_outputBuffer->resource, dx12_inputBuffer->resource);
             }
 
@@ -178,48 +276,110 @@ namespace graphics_sandbox
                 DX12CommandBuffer* dx12_commandBuffer = (DX12CommandBuffer*)commandBuffer;
 
                 // Prepare the input buffer if needed
-                DX12GraphicsBuffer* dx12_inputBuffer = (DX12GraphicsBuffer*)inputBuffer;
+                DX12GraphicsBuffer* dx12_inputBuffer = handle_table::hot(handleTables->buffers, inputBuffer);
                 change_resource_state(dx12_commandBuffer, dx12_inputBuffer->resource, dx12_inputBuffer->state, D3D12_RESOURCE_STATE_GENERIC_READ);
 
                 // Prepare the output buffer if needed
-                DX12GraphicsBuffer* dx12_outputBuffer = (DX12GraphicsBuffer*)outputBuffer;
+                DX12GraphicsBuffer* dx12_outputBuffer = handle_table::hot(handleTables->buffers, outputBuffer);
                 change_resource_state(dx12_commandBuffer, dx12_outputBuffer->resource, dx12_outputBuffer->state, D3D12_RESOURCE_STATE_COPY_DEST);
 
                 // Copy the resource
+                flush_resource_barriers(dx12_commandBuffer);
                 dx12_commandBuffer->cmdList->CopyResource(dx12_outputBuffer->resource, dx12_inputBuffer->resource);
             }
 
+            void prepare_buffer_copy(DX12CommandBuffer* commandBuffer, GraphicsBuffer inputBuffer, GraphicsBuffer outputBuffer, DX12GraphicsBuffer*& dx12_inputBuffer, DX12GraphicsBuffer*& dx12_outputBuffer)
+            {
+                // A resource can't be a copy source and destination at the same time
+                assert_msg(inputBuffer != outputBuffer, "Copies within a buffer are not supported.");
+
+                // Prepare the input buffer if needed
+                dx12_inputBuffer = handle_table::hot(handleTables->buffers, inputBuffer);
+                change_resource_state(commandBuffer, dx12_inputBuffer->resource, dx12_inputBuffer->state, dx12_inputBuffer->type == GraphicsBufferType::Upload ? D3D12_RESOURCE_STATE_GENERIC_READ : D3D12_RESOURCE_STATE_COPY_SOURCE);
+
+                // Prepare the output buffer if needed
+                dx12_outputBuffer = handle_table::hot(handleTables->buffers, outputBuffer);
+                change_resource_state(commandBuffer, dx12_outputBuffer->resource, dx12_outputBuffer->state, D3D12_RESOURCE_STATE_COPY_DEST);
+                flush_resource_barriers(commandBuffer);
+            }
+
+            void copy_buffer_region(CommandBuffer commandBuffer, GraphicsBuffer inputBuffer, uint64_t inputOffset, GraphicsBuffer outputBuffer, uint64_t outputOffset, uint64_t size)
+            {
+                DX12CommandBuffer* dx12_commandBuffer = (DX12CommandBuffer*)commandBuffer;
+                DX12GraphicsBuffer* dx12_inputBuffer;
+                DX12GraphicsBuffer* dx12_outputBuffer;
+                prepare_buffer_copy(dx12_commandBuffer, inputBuffer, outputBuffer, dx12_inputBuffer, dx12_outputBuffer);
+
+                // Only the requested bytes are copied
+                BufferCopyRegion region = { inputOffset, outputOffset, size };
+                assert_msg(buffer_copy_list::validate_region(dx12_inputBuffer->bufferSize, dx12_outputBuffer->bufferSize, region), "The copy region doesn't fit in the buffers.");
+                if (size != 0)
+                    dx12_commandBuffer->cmdList->CopyBufferRegion(dx12_outputBuffer->resource, outputOffset, dx12_inputBuffer->resource, inputOffset, size);
+            }
+
+            void copy_buffer_regions(CommandBuffer commandBuffer, GraphicsBuffer inputBuffer, GraphicsBuffer outputBuffer, const BufferCopyRegion* regions, uint32_t numRegions)
+            {
+                DX12CommandBuffer* dx12_commandBuffer = (DX12CommandBuffer*)commandBuffer;
+                DX12GraphicsBuffer* dx12_inputBuffer;
+                DX12GraphicsBuffer* dx12_outputBuffer;
+                prepare_buffer_copy(dx12_commandBuffer, inputBuffer, outputBuffer, dx12_inputBuffer, dx12_outputBuffer);
+
+                // Merge the contiguous regions, the barriers above are shared by all the copies
+                bento::Vector<BufferCopyRegion>& copyRegions = dx12_commandBuffer->copyRegions;
+                copyRegions.resize(numRegions);
+                for (uint32_t regionIdx = 0; regionIdx < numRegions; ++regionIdx)
+                {
+                    assert_msg(buffer_copy_list::validate_region(dx12_inputBuffer->bufferSize, dx12_outputBuffer->bufferSize, regions[regionIdx]), "The copy region doesn't fit in the buffers.");
+                    copyRegions[regionIdx] = regions[regionIdx];
+                }
+                assert_msg(buffer_copy_list::coalesce(copyRegions), "Copy regions write the same bytes from different sources.");
+                for (uint32_t regionIdx = 0; regionIdx < copyRegions.size(); ++regionIdx)
+                {
+                    const BufferCopyRegion& region = copyRegions[regionIdx];
+                    dx12_commandBuffer->cmdList->CopyBufferRegion(dx12_outputBuffer->resource, region.dstOffset, dx12_inputBuffer->resource, region.srcOffset, region.size);
+                }
+            }
+
+            void bind_view(DX12ComputeShader* computeShader, uint32_t slotIdx, D3D12_CPU_DESCRIPTOR_HANDLE view, uint32_t bindlessIndex, GraphicsBuffer rangeBuffer, uint64_t rangeKey)
+            {
+                // The slots only exist once the shader has been created
+                compute_shader::wait((ComputeShader)computeShader);
+
+                // The range view the slot pointed to can be evicted now, the new one was pinned when it was acquired
+                DX12BoundRange& boundRange = computeShader->boundRanges[slotIdx];
+                if (boundRange.buffer != 0)
+                    graphics_resources::unpin_range_view(boundRange.buffer, boundRange.key);
+                boundRange.buffer = rangeBuffer;
+                boundRange.key = rangeKey;
+
+                // Point the slot to the buffer's view, it is copied (or its index is pushed) at dispatch time
+                if (computeShader->bindless)
+                    computeShader->bindlessIndices[slotIdx] = bindlessIndex;
+                else if (computeShader->boundDescriptors[slotIdx] != view.ptr)
+                {
+                    // The last copied table doesn't match anymore
+                    computeShader->boundDescriptors[slotIdx] = view.ptr;
+                    computeShader->tableRecording = UINT64_MAX;
+                }
+            }
+
+            void bind_buffer_view(DX12ComputeShader* computeShader, uint32_t slotIdx, GraphicsBuffer graphicsBuffer, BufferViewType viewType, D3D12_CPU_DESCRIPTOR_HANDLE view)
+            {
+                // The default views only get a bindless index when a bindless shader binds them
+                compute_shader::wait((ComputeShader)computeShader);
+                uint32_t bindlessIndex = computeShader->bindless ? graphics_resources::bindless_index(graphicsBuffer, viewType) : UINT32_MAX;
+                bind_view(computeShader, slotIdx, view, bindlessIndex, 0, 0);
+            }
+
             void set_compute_graphics_buffer_uav(CommandBuffer commandBuffer, ComputeShader computeShader, uint32_t slot, GraphicsBuffer graphicsBuffer)
             {
                 // Grab all the internal structures
                 DX12CommandBuffer* dx12_commandBuffer = (DX12CommandBuffer*)commandBuffer;
-                DX12GraphicsDevice* deviceI = dx12_commandBuffer->deviceI;
                 DX12ComputeShader* dx12_cs = (DX12ComputeShader*)computeShader;
-                DX12GraphicsBuffer* buffer = (DX12GraphicsBuffer*)graphicsBuffer;
-
-                // First we need to validate that the right heap will be used
-                compute_shader::validate_compute_shader_heap(dx12_cs, dx12_commandBuffer->batchIdentifier);
-
-                // Create the view in the compute's heap
-                D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc;
-                ZeroMemory(&uavDesc, sizeof(D3D12_UNORDERED_ACCESS_VIEW_DESC));
-                uavDesc.Format = DXGI_FORMAT_UNKNOWN;
-                uavDesc.ViewDimension = D3D12_UAV_DIMENSION_BUFFER;
-                D3D12_BUFFER_UAV bufferUAV;
-                bufferUAV.FirstElement = 0;
-                bufferUAV.NumElements = (uint32_t)buffer->bufferSize / (uint32_t)buffer->elementSize;
-                bufferUAV.StructureByteStride = buffer->elementSize;
-                bufferUAV.Flags = D3D12_BUFFER_UAV_FLAG_NONE;
-                bufferUAV.CounterOffsetInBytes = 0;
-                uavDesc.Buffer = bufferUAV;
-
-                // Compute the slot on the heap
-                DX12DescriptorHeap& currentHeap = dx12_cs->descriptorHeaps[dx12_cs->nextUsableHeap];
-                D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle(currentHeap.uavCPU);
-                rtvHandle.ptr += (uint64_t)deviceI->descriptorSize[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV] * slot;
-
-                // Create the UAV
-                deviceI->device->CreateUnorderedAccessView(buffer->resource, nullptr, &uavDesc, rtvHandle);
+                DX12GraphicsBuffer* buffer = handle_table::hot(handleTables->buffers, graphicsBuffer);
+                assert_msg(buffer->uavCPU.ptr != 0, "This buffer type can't be bound as a UAV.");
+
+                bind_buffer_view(dx12_cs, dx12_cs->srvCount + slot, graphicsBuffer, BufferViewType::UAV, buffer->uavCPU);
 
                 // Change the resource's state
                 change_resource_state(dx12_commandBuffer, buffer->resource, buffer->state, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
@@ -229,32 +389,11 @@ namespace graphics_sandbox
             {
                 // Grab all the internal structures
                 DX12CommandBuffer* dx12_commandBuffer = (DX12CommandBuffer*)commandBuffer;
-                DX12GraphicsDevice* deviceI = dx12_commandBuffer->deviceI;
                 DX12ComputeShader* dx12_cs = (DX12ComputeShader*)computeShader;
-                DX12GraphicsBuffer* buffer = (DX12GraphicsBuffer*)graphicsBuffer;
-
-                // First we need to validate that the right heap will be used
-                compute_shader::validate_compute_shader_heap(dx12_cs, dx12_commandBuffer->batchIdentifier);
-
-                // Create the view in the compute's heap
-                D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc;
-                srvDesc.Format = DXGI_FORMAT_UNKNOWN;
-                srvDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
-                srvDesc.Shader4ComponentMapping = D3D12_ENCODE_SHADER_4_COMPONENT_MAPPING(D3D12_SHADER_COMPONENT_MAPPING_FROM_MEMORY_COMPONENT_0, D3D12_SHADER_COMPONENT_MAPPING_FROM_MEMORY_COMPONENT_1, D3D12_SHADER_COMPONENT_MAPPING_FROM_MEMORY_COMPONENT_2, D3D12_SHADER_COMPONENT_MAPPING_FROM_MEMORY_COMPONENT_3);
-                D3D12_BUFFER_SRV bufferSRV;
-                bufferSRV.FirstElement = 0;
-                bufferSRV.NumElements = (uint32_t)buffer->bufferSize / (uint32_t)buffer->elementSize;
-                bufferSRV.StructureByteStride = buffer->elementSize;
-                bufferSRV.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
-                srvDesc.Buffer = bufferSRV;
-
-                // Compute the slot on the heap
-                DX12DescriptorHeap& currentHeap = dx12_cs->descriptorHeaps[dx12_cs->nextUsableHeap];
-                D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle(currentHeap.srvCPU);
-                rtvHandle.ptr += (uint64_t)deviceI->descriptorSize[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV] * slot;
-
-                // Create the SRV
-                deviceI->device->CreateShaderResourceView(buffer->resource, &srvDesc, rtvHandle);
+                DX12GraphicsBuffer* buffer = handle_table::hot(handleTables->buffers, graphicsBuffer);
+                assert_msg(buffer->srvCPU.ptr != 0, "This buffer type can't be bound as a SRV.");
+
+                bind_buffer_view(dx12_cs, slot, graphicsBuffer, BufferViewType::SRV, buffer->srvCPU);
 
                 // Change the resource's state
                 change_resource_state(dx12_commandBuffer, buffer->resource, buffer->state, D3D12_RESOURCE_STATE_COMMON);
@@ -264,59 +403,251 @@ namespace graphics_sandbox
             {
                 // Grab all the internal structures
                 DX12CommandBuffer* dx12_commandBuffer = (DX12CommandBuffer*)commandBuffer;
-                DX12GraphicsDevice* deviceI = dx12_commandBuffer->deviceI;
                 DX12ComputeShader* dx12_cs = (DX12ComputeShader*)computeShader;
-                DX12GraphicsBuffer* buffer = (DX12GraphicsBuffer*)constantBuffer;
+                DX12GraphicsBuffer* buffer = handle_table::hot(handleTables->buffers, constantBuffer);
+                assert_msg(buffer->cbvCPU.ptr != 0, "Only constant buffers can be bound as a CBV.");
 
-                // First we need to validate that the right heap will be used
-                compute_shader::validate_compute_shader_heap(dx12_cs, dx12_commandBuffer->batchIdentifier);
+                bind_buffer_view(dx12_cs, dx12_cs->srvCount + dx12_cs->uavCount + slot, constantBuffer, BufferViewType::CBV, buffer->cbvCPU);
 
-                // Create the view in the compute's heap
-                D3D12_CONSTANT_BUFFER_VIEW_DESC cbvView;
-                cbvView.BufferLocation = buffer->resource->GetGPUVirtualAddress();
-                cbvView.SizeInBytes = (uint32_t)buffer->bufferSize;
+                // Change the resource's state (if this is a runtime constant buffer)
+                if (buffer->type != GraphicsBufferType::Upload)
+                    change_resource_state(dx12_commandBuffer, buffer->resource, buffer->state, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+            }
+
+            void set_compute_graphics_buffer_uav_range(CommandBuffer commandBuffer, ComputeShader computeShader, uint32_t slot, GraphicsBuffer graphicsBuffer, uint64_t firstElement, uint64_t numElements)
+            {
+                // Grab all the internal structures
+                DX12CommandBuffer* dx12_commandBuffer = (DX12CommandBuffer*)commandBuffer;
+                DX12ComputeShader* dx12_cs = (DX12ComputeShader*)computeShader;
+                DX12GraphicsBuffer* buffer = handle_table::hot(handleTables->buffers, graphicsBuffer);
+                assert_msg(buffer->uavCPU.ptr != 0, "This buffer type can't be bound as a UAV.");
+                uint32_t elementSize = handle_table::cold(handleTables->buffers, graphicsBuffer)->elementSize;
+                assert_msg(buffer_view_cache::validate_element_range(buffer->bufferSize, elementSize, firstElement, numElements), "Invalid UAV range.");
+
+                // The whole buffer already has a view
+                if (firstElement == 0 && numElements == buffer->bufferSize / elementSize)
+                    bind_buffer_view(dx12_cs, dx12_cs->srvCount + slot, graphicsBuffer, BufferViewType::UAV, buffer->uavCPU);
+                else
+                {
+                    // The shader has to exist to know if the range needs a bindless index
+                    compute_shader::wait(computeShader);
+                    D3D12_CPU_DESCRIPTOR_HANDLE view;
+                    uint32_t bindlessIndex;
+                    uint64_t key;
+                    graphics_resources::acquire_range_view(graphicsBuffer, BufferViewType::UAV, firstElement, numElements, dx12_cs->bindless, view, bindlessIndex, key);
+                    bind_view(dx12_cs, dx12_cs->srvCount + slot, view, bindlessIndex, graphicsBuffer, key);
+                }
+
+                // The state is tracked for the whole resource
+                change_resource_state(dx12_commandBuffer, buffer->resource, buffer->state, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+            }
+
+            void set_compute_graphics_buffer_srv_range(CommandBuffer commandBuffer, ComputeShader computeShader, uint32_t slot, GraphicsBuffer graphicsBuffer, uint64_t firstElement, uint64_t numElements)
+            {
+                // Grab all the internal structures
+                DX12CommandBuffer* dx12_commandBuffer = (DX12CommandBuffer*)commandBuffer;
+                DX12ComputeShader* dx12_cs = (DX12ComputeShader*)computeShader;
+                DX12GraphicsBuffer* buffer = handle_table::hot(handleTables->buffers, graphicsBuffer);
+                assert_msg(buffer->srvCPU.ptr != 0, "This buffer type can't be bound as a SRV.");
+                uint32_t elementSize = handle_table::cold(handleTables->buffers, graphicsBuffer)->elementSize;
+                assert_msg(buffer_view_cache::validate_element_range(buffer->bufferSize, elementSize, firstElement, numElements), "Invalid SRV range.");
+
+                // The whole buffer already has a view
+                if (firstElement == 0 && numElements == buffer->bufferSize / elementSize)
+                    bind_buffer_view(dx12_cs, slot, graphicsBuffer, BufferViewType::SRV, buffer->srvCPU);
+                else
+                {
+                    // The shader has to exist to know if the range needs a bindless index
+                    compute_shader::wait(computeShader);
+                    D3D12_CPU_DESCRIPTOR_HANDLE view;
+                    uint32_t bindlessIndex;
+                    uint64_t key;
+                    graphics_resources::acquire_range_view(graphicsBuffer, BufferViewType::SRV, firstElement, numElements, dx12_cs->bindless, view, bindlessIndex, key);
+                    bind_view(dx12_cs, slot, view, bindlessIndex, graphicsBuffer, key);
+                }
+
+                // The state is tracked for the whole resource
+                change_resource_state(dx12_commandBuffer, buffer->resource, buffer->state, D3D12_RESOURCE_STATE_COMMON);
+            }
+
+            void set_compute_graphics_buffer_cbv_range(CommandBuffer commandBuffer, ComputeShader computeShader, uint32_t slot, ConstantBuffer constantBuffer, uint64_t byteOffset, uint64_t size)
+            {
+                // Grab all the internal structures
+                DX12CommandBuffer* dx12_commandBuffer = (DX12CommandBuffer*)commandBuffer;
+                DX12ComputeShader* dx12_cs = (DX12ComputeShader*)computeShader;
+                DX12GraphicsBuffer* buffer = handle_table::hot(handleTables->buffers, constantBuffer);
+                assert_msg(buffer->cbvCPU.ptr != 0, "Only constant buffers can be bound as a CBV.");
+                assert_msg(buffer_view_cache::validate_cbv_range(buffer->bufferSize, byteOffset, size), "Invalid CBV range.");
+
+                // The whole buffer already has a view
+                uint32_t slotIdx = dx12_cs->srvCount + dx12_cs->uavCount + slot;
+                if (byteOffset == 0 && buffer_view_cache::aligned_cbv_size(size) == buffer->bufferSize)
+                    bind_buffer_view(dx12_cs, slotIdx, constantBuffer, BufferViewType::CBV, buffer->cbvCPU);
+                else
+                {
+                    // The shader has to exist to know if the range needs a bindless index
+                    compute_shader::wait(computeShader);
+                    D3D12_CPU_DESCRIPTOR_HANDLE view;
+                    uint32_t bindlessIndex;
+                    uint64_t key;
+                    graphics_resources::acquire_range_view(constantBuffer, BufferViewType::CBV, byteOffset, size, dx12_cs->bindless, view, bindlessIndex, key);
+                    bind_view(dx12_cs, slotIdx, view, bindlessIndex, constantBuffer, key);
+                }
+
+                // Change the resource's state (if this is a runtime constant buffer)
+                if (buffer->type != GraphicsBufferType::Upload)
+                    change_resource_state(dx12_commandBuffer, buffer->resource, buffer->state, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+            }
+
+            void set_compute_constants(CommandBuffer, ComputeShader computeShader, uint32_t slot, const void* data, uint32_t size)
+            {
+                // The values are pushed in the root signature at dispatch time, nothing goes through memory
+                DX12ComputeShader* dx12_cs = (DX12ComputeShader*)computeShader;
+                compute_shader::wait(computeShader);
+                assert_msg(slot < dx12_cs->rootConstantRanges.size(), "Invalid root constant slot.");
+                const DX12RootConstantRange& range = dx12_cs->rootConstantRanges[slot];
+                assert_msg(size % sizeof(uint32_t) == 0 && size <= range.count * sizeof(uint32_t), "Invalid root constant size.");
+                memcpy(dx12_cs->rootConstantData.begin() + range.offset, data, size);
+            }
 
-                // Compute the slot on the heap
-                DX12DescriptorHeap& currentHeap = dx12_cs->descriptorHeaps[dx12_cs->nextUsableHeap];
-                D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle(currentHeap.cbvCPU);
-                rtvHandle.ptr += (uint64_t)deviceI->descriptorSize[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV] * slot;
+            void set_compute_cbv_address(CommandBuffer commandBuffer, ComputeShader computeShader, uint32_t slot, ConstantBuffer constantBuffer, uint64_t offset)
+            {
+                // Grab all the internal structures
+                DX12CommandBuffer* dx12_commandBuffer = (DX12CommandBuffer*)commandBuffer;
+                DX12ComputeShader* dx12_cs = (DX12ComputeShader*)computeShader;
+                DX12GraphicsBuffer* buffer = handle_table::hot(handleTables->buffers, constantBuffer);
+                compute_shader::wait(computeShader);
+                assert_msg(slot < dx12_cs->rootCbvAddresses.size(), "Invalid root CBV slot.");
+                assert_msg(offset % DX12_CONSTANT_BUFFER_ALIGNEMENT_SIZE == 0 && offset < buffer->bufferSize, "Invalid root CBV offset.");
 
-                // Create the CBV
-                deviceI->device->CreateConstantBufferView(&cbvView, rtvHandle);
+                // The address is set as a root descriptor at dispatch time, no descriptor is written
+                dx12_cs->rootCbvAddresses[slot] = buffer->resource->GetGPUVirtualAddress() + offset;
 
                 // Change the resource's state (if this is a runtime constant buffer)
                 if (buffer->type != GraphicsBufferType::Upload)
                     change_resource_state(dx12_commandBuffer, buffer->resource, buffer->state, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+            }
 
+            void set_compute_cbv_upload(CommandBuffer commandBuffer, ComputeShader computeShader, uint32_t slot, const UploadAllocation& allocation)
+            {
+                DX12ComputeShader* dx12_cs = (DX12ComputeShader*)computeShader;
+                compute_shader::wait(computeShader);
+                assert_msg(slot < dx12_cs->rootCbvAddresses.size(), "Invalid root CBV slot.");
+                assert_msg(allocation.gpuAddress % DX12_CONSTANT_BUFFER_ALIGNEMENT_SIZE == 0, "Invalid root CBV address.");
+
+                // Upload heaps are always readable, no transition is needed
+                dx12_cs->rootCbvAddresses[slot] = allocation.gpuAddress;
+            }
+
+            void bind_root_parameters(DX12CommandBuffer* cmdI, DX12ComputeShader* dx12_cs)
+            {
+                uint32_t numRanges = dx12_cs->rootConstantRanges.size();
+                for (uint32_t rangeIdx = 0; rangeIdx < numRanges; ++rangeIdx)
+                {
+                    const DX12RootConstantRange& range = dx12_cs->rootConstantRanges[rangeIdx];
+                    const uint32_t* values = dx12_cs->rootConstantData.begin() + range.offset;
+                    if (shadow_state_tracker::set_root_constants(cmdI->shadowState, range.rootIndex, values, range.count))
+                        cmdI->cmdList->SetComputeRoot32BitConstants(range.rootIndex, range.count, values, 0);
+                }
+
+                uint32_t numRootCbvs = dx12_cs->rootCbvAddresses.size();
+                for (uint32_t cbvIdx = 0; cbvIdx < numRootCbvs; ++cbvIdx)
+                {
+                    assert_msg(dx12_cs->rootCbvAddresses[cbvIdx] != 0, "A root CBV was never set.");
+                    if (shadow_state_tracker::set_root_value(cmdI->shadowState, dx12_cs->rootCbvIndex + cbvIdx, dx12_cs->rootCbvAddresses[cbvIdx]))
+                        cmdI->cmdList->SetComputeRootConstantBufferView(dx12_cs->rootCbvIndex + cbvIdx, dx12_cs->rootCbvAddresses[cbvIdx]);
+                }
+            }
+
+            void bind_descriptor_tables(DX12CommandBuffer* cmdI, DX12ComputeShader* dx12_cs)
+            {
+                DX12GraphicsDevice* deviceI = cmdI->deviceI;
+
+                // Gather the bound views and copy them to a table of the shared shader visible ring
+                uint32_t tableSize = dx12_cs->srvCount + dx12_cs->uavCount + dx12_cs->cbvCount;
+                uint32_t descSize = deviceI->descriptorSize[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV];
+                D3D12_GPU_DESCRIPTOR_HANDLE tableGPU = deviceI->descriptorRingGPU;
+                if (tableSize > 0 && dx12_cs->tableRecording == cmdI->recording)
+                {
+                    // No view changed since the last dispatch of this recording, its table is still valid
+                    tableGPU.ptr = dx12_cs->tableGPU;
+                }
+                else if (tableSize > 0)
+                {
+                    uint32_t tableOffset = graphics_device::allocate_descriptor_table(deviceI, (uint64_t)cmdI, tableSize);
+                    D3D12_CPU_DESCRIPTOR_HANDLE tableCPU = deviceI->descriptorRingCPU;
+                    tableCPU.ptr += (uint64_t)tableOffset * descSize;
+                    tableGPU.ptr += (uint64_t)tableOffset * descSize;
+                    uint32_t numRanges = descriptor_copy_batch::build(cmdI->descriptorCopies, dx12_cs->boundDescriptors.begin(), tableSize, descSize);
+                    const D3D12_CPU_DESCRIPTOR_HANDLE* rangeStarts = (const D3D12_CPU_DESCRIPTOR_HANDLE*)cmdI->descriptorCopies.rangeStarts.begin();
+                    deviceI->device->CopyDescriptors(1, &tableCPU, &tableSize, numRanges, rangeStarts, cmdI->descriptorCopies.rangeSizes.begin(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+                    dx12_cs->tableRecording = cmdI->recording;
+                    dx12_cs->tableGPU = tableGPU.ptr;
+                }
+
+                // Bind the root descriptor tables
+                D3D12_GPU_DESCRIPTOR_HANDLE srvGPU = tableGPU;
+                D3D12_GPU_DESCRIPTOR_HANDLE uavGPU = srvGPU;
+                uavGPU.ptr += (uint64_t)dx12_cs->srvCount * descSize;
+                D3D12_GPU_DESCRIPTOR_HANDLE cbvGPU = uavGPU;
+                cbvGPU.ptr += (uint64_t)dx12_cs->uavCount * descSize;
+                ShadowStateTracker& shadowState = cmdI->shadowState;
+                if (dx12_cs->srvIndex != UINT32_MAX && shadow_state_tracker::set_root_value(shadowState, dx12_cs->srvIndex, srvGPU.ptr))
+                    cmdI->cmdList->SetComputeRootDescriptorTable(dx12_cs->srvIndex, srvGPU);
+                if (dx12_cs->uavIndex != UINT32_MAX && shadow_state_tracker::set_root_value(shadowState, dx12_cs->uavIndex, uavGPU.ptr))
+                    cmdI->cmdList->SetComputeRootDescriptorTable(dx12_cs->uavIndex, uavGPU);
+                if (dx12_cs->cbvIndex != UINT32_MAX && shadow_state_tracker::set_root_value(shadowState, dx12_cs->cbvIndex, cbvGPU.ptr))
+                    cmdI->cmdList->SetComputeRootDescriptorTable(dx12_cs->cbvIndex, cbvGPU);
+            }
+
+            void bind_bindless_indices(DX12CommandBuffer* cmdI, DX12ComputeShader* dx12_cs)
+            {
+                // No descriptor is written, the indices of the views are pushed in the root constants
+                uint32_t numSlots = dx12_cs->bindlessIndices.size();
+                for (uint32_t slotIdx = 0; slotIdx < numSlots; ++slotIdx)
+                    assert_msg(dx12_cs->bindlessIndices[slotIdx] != UINT32_MAX, "A descriptor slot was never bound.");
+                if (numSlots > 0 && shadow_state_tracker::set_root_constants(cmdI->shadowState, 0, dx12_cs->bindlessIndices.begin(), numSlots))
+                    cmdI->cmdList->SetComputeRoot32BitConstants(0, numSlots, dx12_cs->bindlessIndices.begin(), 0);
             }
 
             void dispatch(CommandBuffer commandBuffer, ComputeShader computeShader, uint32_t sizeX, uint32_t sizeY, uint32_t sizeZ)
             {
                 DX12CommandBuffer* cmdI = (DX12CommandBuffer*)commandBuffer;
                 DX12ComputeShader* dx12_cs = (DX12ComputeShader*)computeShader;
+                DX12GraphicsDevice* deviceI = cmdI->deviceI;
+                compute_shader::wait(computeShader);
 
-                // First we need to validate that the right heap will be used
-                compute_shader::validate_compute_shader_heap(dx12_cs, cmdI->batchIdentifier);
+                // The transitions go first, they decide which root arguments have to be set again
+                flush_resource_barriers(cmdI);
 
-                // Bind the root descriptor tables
-                DX12DescriptorHeap& currentHeap = dx12_cs->descriptorHeaps[dx12_cs->nextUsableHeap];
-                ID3D12DescriptorHeap* ppHeaps[] = { currentHeap.descriptorHeap };
-                cmdI->cmdList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
-                cmdI->cmdList->SetComputeRootSignature(dx12_cs->rootSignature);
-
-                if (dx12_cs->srvIndex != UINT32_MAX)
-                    cmdI->cmdList->SetComputeRootDescriptorTable(dx12_cs->srvIndex, currentHeap.srvGPU);
-                if (dx12_cs->uavIndex != UINT32_MAX)
-                    cmdI->cmdList->SetComputeRootDescriptorTable(dx12_cs->uavIndex, currentHeap.uavGPU);
-                if (dx12_cs->cbvIndex != UINT32_MAX)
-                    cmdI->cmdList->SetComputeRootDescriptorTable(dx12_cs->cbvIndex, currentHeap.cbvGPU);
+                // Only the state that differs from what is bound on the command list is set
+                ShadowStateTracker& shadowState = cmdI->shadowState;
+                if (shadow_state_tracker::set_descriptor_heap(shadowState, (uint64_t)deviceI->resourceHeap))
+                {
+                    ID3D12DescriptorHeap* ppHeaps[] = { deviceI->resourceHeap };
+                    cmdI->cmdList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
+                }
+                if (shadow_state_tracker::set_root_signature(shadowState, (uint64_t)dx12_cs->rootSignature))
+                    cmdI->cmdList->SetComputeRootSignature(dx12_cs->rootSignature);
+
+                // The range views are pinned while bound, they are only gone if their buffer was destroyed
+                for (uint32_t slotIdx = 0; slotIdx < dx12_cs->boundRanges.size(); ++slotIdx)
+                {
+                    GraphicsBuffer rangeBuffer = dx12_cs->boundRanges[slotIdx].buffer;
+                    assert_msg(rangeBuffer == 0 || handle_table::is_valid(handleTables->buffers, rangeBuffer), "A slot points to a range of a destroyed buffer.");
+                }
+
+                // Bind the resources
+                if (dx12_cs->bindless)
+                    bind_bindless_indices(cmdI, dx12_cs);
+                else
+                    bind_descriptor_tables(cmdI, dx12_cs);
+                bind_root_parameters(cmdI, dx12_cs);
 
                 // Bind the shader and dispatch it
-                cmdI->cmdList->SetPipelineState(dx12_cs->pipelineStateObject);
+                if (shadow_state_tracker::set_pipeline_state(shadowState, (uint64_t)dx12_cs->pipelineStateObject))
+                    cmdI->cmdList->SetPipelineState(dx12_cs->pipelineStateObject);
                 cmdI->cmdList->Dispatch(sizeX, sizeY, sizeZ);
-
-                // This heap has been used for the current command buffer batch, we need to move to the next one
-                dx12_cs->nextUsableHeap++;
             }
 
             void enable_profiling_scope(CommandBuffer commandBuffer, ProfilingScope profilingScope)
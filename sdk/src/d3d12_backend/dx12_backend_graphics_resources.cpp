@@ -6,13 +6,153 @@
 // Internal includes
 #include "d3d12_backend/dx12_backend.h"
 #include "d3d12_backend/dx12_containers.h"
+#include "tools/stream_copy.h"
 
 namespace graphics_sandbox
 {
 	namespace d3d12
 	{
+		namespace graphics_device
+		{
+			void defer_release(DX12GraphicsDevice* deviceI, uint64_t object, DeferredReleaseFunction releaseFunction);
+		}
+
 		namespace graphics_resources
 		{
+			D3D12_HEAP_FLAGS placed_heap_flags(DX12GraphicsDevice* deviceI, bool renderTexture)
+			{
+				// Tier 1 heaps only hold a single category of resources, tier 2 heaps can mix them
+				if (deviceI->resourceHeapTier >= D3D12_RESOURCE_HEAP_TIER_2)
+					return D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES;
+				return renderTexture ? D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES : D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+			}
+
+			DX12HeapBlock* create_heap_block(DX12GraphicsDevice* deviceI, D3D12_HEAP_TYPE heapType, D3D12_HEAP_FLAGS heapFlags)
+			{
+				// Heaps that can hold textures are aligned for multisampled ones
+				D3D12_HEAP_DESC heapDesc = {};
+				heapDesc.SizeInBytes = DX12_HEAP_BLOCK_SIZE;
+				heapDesc.Properties.Type = heapType;
+				heapDesc.Properties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+				heapDesc.Properties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+				heapDesc.Alignment = heapFlags == D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS ? D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT : D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT;
+				heapDesc.Flags = heapFlags;
+				ID3D12Heap* heap;
+				if (deviceI->device->CreateHeap(&heapDesc, IID_PPV_ARGS(&heap)) != S_OK)
+					return nullptr;
+
+				DX12HeapBlock* heapBlock = bento::make_new<DX12HeapBlock>(deviceI->_allocator, deviceI->_allocator);
+				heapBlock->deviceI = deviceI;
+				heapBlock->heap = heap;
+				heapBlock->heapType = heapType;
+				heapBlock->heapFlags = heapFlags;
+				tlsf_allocator::initialize(heapBlock->offsets, DX12_HEAP_BLOCK_SIZE, D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT);
+				deviceI->heapBlocks.push_back(heapBlock);
+				return heapBlock;
+			}
+
+			void destroy_heap_block(DX12GraphicsDevice* deviceI, DX12HeapBlock* heapBlock)
+			{
+				uint32_t numBlocks = deviceI->heapBlocks.size();
+				for (uint32_t blockIdx = 0; blockIdx < numBlocks; ++blockIdx)
+				{
+					if (deviceI->heapBlocks[blockIdx] == heapBlock)
+					{
+						deviceI->heapBlocks[blockIdx] = deviceI->heapBlocks[numBlocks - 1];
+						deviceI->heapBlocks.resize(numBlocks - 1);
+						break;
+					}
+				}
+				heapBlock->heap->Release();
+				bento::make_delete<DX12HeapBlock>(heapBlock->_allocator, heapBlock);
+			}
+
+			void destroy_heap_blocks(DX12GraphicsDevice* deviceI)
+			{
+				while (deviceI->heapBlocks.size() > 0)
+				{
+					DX12HeapBlock* heapBlock = deviceI->heapBlocks[deviceI->heapBlocks.size() - 1];
+					assert_msg(tlsf_allocator::is_empty(heapBlock->offsets), "Resources are still placed in the heap.");
+					destroy_heap_block(deviceI, heapBlock);
+				}
+			}
+
+			void free_placement(DX12HeapBlock* heapBlock, uint32_t heapAllocation)
+			{
+				DX12GraphicsDevice* deviceI = heapBlock->deviceI;
+				std::lock_guard<std::mutex> lock(deviceI->heapLock);
+				tlsf_allocator::free(heapBlock->offsets, heapAllocation);
+				if (!tlsf_allocator::is_empty(heapBlock->offsets))
+					return;
+
+				// Empty blocks are released as long as another block can serve their heap type
+				for (uint32_t blockIdx = 0; blockIdx < deviceI->heapBlocks.size(); ++blockIdx)
+				{
+					DX12HeapBlock* otherBlock = deviceI->heapBlocks[blockIdx];
+					if (otherBlock != heapBlock && otherBlock->heapType == heapBlock->heapType && otherBlock->heapFlags == heapBlock->heapFlags)
+					{
+						destroy_heap_block(deviceI, heapBlock);
+						return;
+					}
+				}
+			}
+
+			ID3D12Resource* create_resource(DX12GraphicsDevice* deviceI, const D3D12_HEAP_PROPERTIES& heapProperties, D3D12_HEAP_FLAGS committedFlags, bool renderTexture,
+				const D3D12_RESOURCE_DESC& resourceDescriptor, D3D12_RESOURCE_STATES state, const D3D12_CLEAR_VALUE* clearValue, DX12HeapBlock*& heapBlock, uint32_t& heapAllocation)
+			{
+				heapBlock = nullptr;
+				heapAllocation = TLSF_INVALID_BLOCK;
+				ID3D12Resource* resource = nullptr;
+
+				// Place the resource in one of the device's heaps if it is small enough
+				D3D12_RESOURCE_ALLOCATION_INFO info = deviceI->device->GetResourceAllocationInfo(0, 1, &resourceDescriptor);
+				if (info.SizeInBytes != UINT64_MAX && info.SizeInBytes <= DX12_PLACED_RESOURCE_MAX_SIZE && info.Alignment <= D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT)
+				{
+					D3D12_HEAP_FLAGS heapFlags = placed_heap_flags(deviceI, renderTexture);
+					std::lock_guard<std::mutex> lock(deviceI->heapLock);
+					TlsfAllocation allocation;
+					for (uint32_t blockIdx = 0; blockIdx < deviceI->heapBlocks.size() && heapBlock == nullptr; ++blockIdx)
+					{
+						DX12HeapBlock* candidate = deviceI->heapBlocks[blockIdx];
+						if (candidate->heapType == heapProperties.Type && candidate->heapFlags == heapFlags && tlsf_allocator::allocate(candidate->offsets, info.SizeInBytes, info.Alignment, allocation))
+							heapBlock = candidate;
+					}
+
+					// Every block of this kind is full, reserve a new one
+					if (heapBlock == nullptr)
+					{
+						heapBlock = create_heap_block(deviceI, heapProperties.Type, heapFlags);
+						if (heapBlock != nullptr && !tlsf_allocator::allocate(heapBlock->offsets, info.SizeInBytes, info.Alignment, allocation))
+							heapBlock = nullptr;
+					}
+
+					if (heapBlock != nullptr)
+					{
+						if (deviceI->device->CreatePlacedResource(heapBlock->heap, allocation.offset, &resourceDescriptor, state, clearValue, IID_PPV_ARGS(&resource)) == S_OK)
+							heapAllocation = allocation.block;
+						else
+						{
+							tlsf_allocator::free(heapBlock->offsets, allocation.block);
+							heapBlock = nullptr;
+							resource = nullptr;
+						}
+					}
+				}
+
+				// Huge resources, and the ones the heaps could not take, get their own allocation
+				if (resource == nullptr)
+					assert_msg(deviceI->device->CreateCommittedResource(&heapProperties, committedFlags, &resourceDescriptor, state, clearValue, IID_PPV_ARGS(&resource)) == S_OK, "Failed to create the resource.");
+				return resource;
+			}
+
+			void release_resource(ID3D12Resource* resource, DX12HeapBlock* heapBlock, uint32_t heapAllocation)
+			{
+				// The placement is reused right away, only called once the GPU is done with the resource
+				resource->Release();
+				if (heapBlock != nullptr)
+					free_placement(heapBlock, heapAllocation);
+			}
+
 			RenderTexture create_render_texture(GraphicsDevice graphicsDevice, RenderTextureDescriptor rtDesc)
 			{
 				DX12GraphicsDevice* deviceI = (DX12GraphicsDevice*)graphicsDevice;
@@ -57,8 +197,9 @@ namespace graphics_sandbox
 				state |= is_depth_format(rtDesc.format) ? D3D12_RESOURCE_STATE_DEPTH_WRITE | D3D12_RESOURCE_STATE_DEPTH_READ : D3D12_RESOURCE_STATE_RENDER_TARGET;
 
 				// Create the render target
-				ID3D12Resource* resource;
-				assert_msg(device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES, &resourceDescriptor, state, &clearValue, IID_PPV_ARGS(&resource)) == S_OK, "Failed to create render target.");
+				DX12HeapBlock* heapBlock;
+				uint32_t heapAllocation;
+				ID3D12Resource* resource = create_resource(deviceI, heapProperties, D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES, true, resourceDescriptor, state, &clearValue, heapBlock, heapAllocation);
 				
 				// Create the descriptor heap
 				ID3D12DescriptorHeap* descHeap = (ID3D12DescriptorHeap*)descriptor_heap::create_descriptor_heap(graphicsDevice, 1, is_depth_format(rtDesc.format) ? D3D12_DESCRIPTOR_HEAP_TYPE_DSV : D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
@@ -72,25 +213,229 @@ namespace graphics_sandbox
 				else
 					device->CreateRenderTargetView(resource, nullptr, rtvHandle);
 
-				bento::IAllocator* allocator = bento::common_allocator();
-				assert(allocator != nullptr);
-
 				// Create the render texture internal structure
-				DX12RenderTexture* dx12_renderTexture = bento::make_new<DX12RenderTexture>(*allocator);
+				RenderTexture renderTexture = handle_table::allocate(handleTables->renderTextures);
+				assert_msg(renderTexture != 0, "Too many render textures.");
+				DX12RenderTexture* dx12_renderTexture = handle_table::hot(handleTables->renderTextures, renderTexture);
 				dx12_renderTexture->resource = resource;
-				dx12_renderTexture->descriptorHeap = descHeap;
-				dx12_renderTexture->heapOffset = 0;
+				dx12_renderTexture->state = state;
+				dx12_renderTexture->rtvCPU = rtvHandle;
+				dx12_renderTexture->needsDiscard = heapBlock != nullptr;
+				DX12RenderTextureCold* renderTextureCold = handle_table::cold(handleTables->renderTextures, renderTexture);
+				renderTextureCold->deviceI = deviceI;
+				renderTextureCold->heapBlock = heapBlock;
+				renderTextureCold->heapAllocation = heapAllocation;
+				renderTextureCold->descriptorHeap = descHeap;
+				renderTextureCold->rtOwned = true;
 
 				// Return the render target
-				return (RenderTexture)dx12_renderTexture;
+				return renderTexture;
+			}
+
+			void release_render_texture(uint64_t releasedTexture, void*)
+			{
+				DX12ReleasedRenderTexture* released = (DX12ReleasedRenderTexture*)releasedTexture;
+				if (released->cold.rtOwned)
+					released->cold.descriptorHeap->Release();
+				release_resource(released->texture.resource, released->cold.heapBlock, released->cold.heapAllocation);
+				bento::make_delete<DX12ReleasedRenderTexture>(*bento::common_allocator(), released);
 			}
 
 			void destroy_render_texture(RenderTexture renderTexture)
 			{
-				DX12RenderTexture* dx12_renderTexture = (DX12RenderTexture*)renderTexture;
-				if (dx12_renderTexture->rtOwned)
-					dx12_renderTexture->descriptorHeap->Release();
-				dx12_renderTexture->resource->Release();
+				// The handle is freed right away (a second destroy or any later use fails the lookup), command buffers submitted
+				// before this call may still render to the resource so it moves to the deferred entry
+				DX12RenderTexture* dx12_renderTexture;
+				DX12RenderTextureCold* renderTextureCold;
+				assert_msg(handle_table::lookup(handleTables->renderTextures, renderTexture, dx12_renderTexture, renderTextureCold), "Invalid or stale render texture.");
+				DX12ReleasedRenderTexture* released = bento::make_new<DX12ReleasedRenderTexture>(*bento::common_allocator());
+				released->texture = *dx12_renderTexture;
+				released->cold = *renderTextureCold;
+				handle_table::free(handleTables->renderTextures, renderTexture);
+				graphics_device::defer_release(released->cold.deviceI, (uint64_t)released, release_render_texture);
+			}
+
+			uint32_t create_bindless_view(DX12GraphicsDevice* deviceI, D3D12_CPU_DESCRIPTOR_HANDLE view)
+			{
+				// Give the view a stable index in the bindless part of the resource heap
+				uint32_t index = index_allocator::allocate(deviceI->bindlessIndices);
+				assert_msg(index != UINT32_MAX, "The bindless heap is full.");
+				D3D12_CPU_DESCRIPTOR_HANDLE destination = deviceI->bindlessCPU;
+				destination.ptr += (uint64_t)index * deviceI->descriptorSize[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV];
+				deviceI->device->CopyDescriptorsSimple(1, destination, view, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+				return index;
+			}
+
+			void create_buffer_views(DX12GraphicsDevice* deviceI, DX12GraphicsBuffer* buffer, DX12GraphicsBufferCold* bufferCold)
+			{
+				buffer->bindlessSRV = UINT32_MAX;
+				buffer->bindlessUAV = UINT32_MAX;
+				buffer->bindlessCBV = UINT32_MAX;
+				bufferCold->viewBlock = UINT32_MAX;
+				buffer->srvCPU.ptr = 0;
+				buffer->uavCPU.ptr = 0;
+				buffer->cbvCPU.ptr = 0;
+
+				// Readback buffers are never accessed by shaders
+				if (buffer->type == GraphicsBufferType::Readback)
+					return;
+
+				// The views live in the device's staging heap, no descriptor heap is created per buffer
+				bufferCold->viewBlock = index_allocator::allocate(deviceI->bufferViewBlocks);
+				assert_msg(bufferCold->viewBlock != UINT32_MAX, "The buffer view heap is full.");
+
+				// The srv, uav and cbv are contiguous so that consecutive slots can be copied in a single range
+				uint32_t descSize = deviceI->descriptorSize[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV];
+				D3D12_CPU_DESCRIPTOR_HANDLE heapStart = deviceI->bufferViewCPU;
+				heapStart.ptr += (uint64_t)bufferCold->viewBlock * DX12_BUFFER_VIEW_COUNT * descSize;
+
+				// Create the SRV
+				D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc;
+				srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+				srvDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+				srvDesc.Shader4ComponentMapping = D3D12_ENCODE_SHADER_4_COMPONENT_MAPPING(D3D12_SHADER_COMPONENT_MAPPING_FROM_MEMORY_COMPONENT_0, D3D12_SHADER_COMPONENT_MAPPING_FROM_MEMORY_COMPONENT_1, D3D12_SHADER_COMPONENT_MAPPING_FROM_MEMORY_COMPONENT_2, D3D12_SHADER_COMPONENT_MAPPING_FROM_MEMORY_COMPONENT_3);
+				D3D12_BUFFER_SRV bufferSRV;
+				bufferSRV.FirstElement = 0;
+				bufferSRV.NumElements = (uint32_t)buffer->bufferSize / (uint32_t)bufferCold->elementSize;
+				bufferSRV.StructureByteStride = bufferCold->elementSize;
+				bufferSRV.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
+				srvDesc.Buffer = bufferSRV;
+				buffer->srvCPU = heapStart;
+				deviceI->device->CreateShaderResourceView(buffer->resource, &srvDesc, buffer->srvCPU);
+
+				// Only default buffers can be written by shaders
+				if (buffer->type == GraphicsBufferType::Default)
+				{
+					D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc;
+					ZeroMemory(&uavDesc, sizeof(D3D12_UNORDERED_ACCESS_VIEW_DESC));
+					uavDesc.Format = DXGI_FORMAT_UNKNOWN;
+					uavDesc.ViewDimension = D3D12_UAV_DIMENSION_BUFFER;
+					D3D12_BUFFER_UAV bufferUAV;
+					bufferUAV.FirstElement = 0;
+					bufferUAV.NumElements = (uint32_t)buffer->bufferSize / (uint32_t)bufferCold->elementSize;
+					bufferUAV.StructureByteStride = bufferCold->elementSize;
+					bufferUAV.Flags = D3D12_BUFFER_UAV_FLAG_NONE;
+					bufferUAV.CounterOffsetInBytes = 0;
+					uavDesc.Buffer = bufferUAV;
+					buffer->uavCPU = heapStart;
+					buffer->uavCPU.ptr += descSize;
+					deviceI->device->CreateUnorderedAccessView(buffer->resource, nullptr, &uavDesc, buffer->uavCPU);
+				}
+			}
+
+			uint32_t bindless_index(GraphicsBuffer graphicsBuffer, BufferViewType viewType)
+			{
+				// Most buffers are never bound to a bindless shader, their views don't take room in the bindless heap
+				DX12GraphicsBuffer* buffer;
+				DX12GraphicsBufferCold* bufferCold;
+				assert_msg(handle_table::lookup(handleTables->buffers, graphicsBuffer, buffer, bufferCold), "Invalid or stale graphics buffer.");
+				DX12GraphicsDevice* deviceI = bufferCold->deviceI;
+				uint32_t* bindlessIndex = viewType == BufferViewType::SRV ? &buffer->bindlessSRV : (viewType == BufferViewType::UAV ? &buffer->bindlessUAV : &buffer->bindlessCBV);
+				D3D12_CPU_DESCRIPTOR_HANDLE view = viewType == BufferViewType::SRV ? buffer->srvCPU : (viewType == BufferViewType::UAV ? buffer->uavCPU : buffer->cbvCPU);
+
+				std::lock_guard<std::mutex> lock(deviceI->bindlessLock);
+				if (*bindlessIndex == UINT32_MAX)
+					*bindlessIndex = create_bindless_view(deviceI, view);
+				return *bindlessIndex;
+			}
+
+			void release_range_view(uint64_t packedView, void* userData)
+			{
+				// The view was evicted from the cache of its buffer and the GPU is done with it
+				DX12GraphicsDevice* deviceI = (DX12GraphicsDevice*)userData;
+				uint32_t bindless = (uint32_t)(packedView >> 32);
+				if (bindless != UINT32_MAX)
+					index_allocator::free(deviceI->bindlessIndices, bindless);
+				index_allocator::free(deviceI->rangeViewIndices, (uint32_t)packedView);
+			}
+
+			void acquire_range_view(GraphicsBuffer graphicsBuffer, BufferViewType viewType, uint64_t first, uint64_t count, bool bindless, D3D12_CPU_DESCRIPTOR_HANDLE& view, uint32_t& bindlessIndex, uint64_t& key)
+			{
+				DX12GraphicsBuffer* buffer;
+				DX12GraphicsBufferCold* bufferCold;
+				assert_msg(handle_table::lookup(handleTables->buffers, graphicsBuffer, buffer, bufferCold), "Invalid or stale graphics buffer.");
+				DX12GraphicsDevice* deviceI = bufferCold->deviceI;
+				uint32_t descSize = deviceI->descriptorSize[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV];
+
+				// The cache only exists for the buffers that were bound by range at least once
+				std::lock_guard<std::mutex> lock(deviceI->rangeViewLock);
+				if (bufferCold->rangeViews == nullptr)
+					bufferCold->rangeViews = buffer_view_cache::create_cache(deviceI->_allocator, DX12_MAX_RANGE_VIEWS_PER_BUFFER);
+				BufferViewCache* cache = bufferCold->rangeViews;
+
+				// Every dispatch after the first one on this range reuses the view
+				key = buffer_view_cache::view_key(viewType, first, count);
+				uint64_t packedView;
+				if (!buffer_view_cache::lookup(cache, key, packedView))
+				{
+					uint32_t cpuIndex = index_allocator::allocate(deviceI->rangeViewIndices);
+					assert_msg(cpuIndex != UINT32_MAX, "The range view heap is full.");
+					D3D12_CPU_DESCRIPTOR_HANDLE cpuView = deviceI->rangeViewCPU;
+					cpuView.ptr += (uint64_t)cpuIndex * descSize;
+
+					if (viewType == BufferViewType::SRV)
+					{
+						D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+						srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+						srvDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+						srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+						srvDesc.Buffer.FirstElement = first;
+						srvDesc.Buffer.NumElements = (uint32_t)count;
+						srvDesc.Buffer.StructureByteStride = bufferCold->elementSize;
+						srvDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
+						deviceI->device->CreateShaderResourceView(buffer->resource, &srvDesc, cpuView);
+					}
+					else if (viewType == BufferViewType::UAV)
+					{
+						D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+						uavDesc.Format = DXGI_FORMAT_UNKNOWN;
+						uavDesc.ViewDimension = D3D12_UAV_DIMENSION_BUFFER;
+						uavDesc.Buffer.FirstElement = first;
+						uavDesc.Buffer.NumElements = (uint32_t)count;
+						uavDesc.Buffer.StructureByteStride = bufferCold->elementSize;
+						uavDesc.Buffer.CounterOffsetInBytes = 0;
+						uavDesc.Buffer.Flags = D3D12_BUFFER_UAV_FLAG_NONE;
+						deviceI->device->CreateUnorderedAccessView(buffer->resource, nullptr, &uavDesc, cpuView);
+					}
+					else
+					{
+						// CBV ranges are in bytes, the size is rounded up like the one of the whole buffer
+						D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc;
+						cbvDesc.BufferLocation = buffer->resource->GetGPUVirtualAddress() + first;
+						cbvDesc.SizeInBytes = (uint32_t)buffer_view_cache::aligned_cbv_size(count);
+						deviceI->device->CreateConstantBufferView(&cbvDesc, cpuView);
+					}
+
+					// A full cache gives up its least recently bound view that no slot points to, the submissions recorded so far may still use it
+					packedView = ((uint64_t)UINT32_MAX << 32) | cpuIndex;
+					uint64_t evictedView;
+					if (buffer_view_cache::insert(cache, key, packedView, evictedView))
+						graphics_device::defer_release(deviceI, evictedView, release_range_view);
+				}
+				view = deviceI->rangeViewCPU;
+				view.ptr += (uint64_t)(uint32_t)packedView * descSize;
+
+				// Only the ranges bound to bindless shaders take room in the bindless heap
+				if (bindless && (uint32_t)(packedView >> 32) == UINT32_MAX)
+				{
+					packedView = ((uint64_t)create_bindless_view(deviceI, view) << 32) | (uint32_t)packedView;
+					buffer_view_cache::update(cache, key, packedView);
+				}
+				bindlessIndex = (uint32_t)(packedView >> 32);
+
+				// The caller binds it to a slot, it can't be evicted until the slot is unpinned
+				buffer_view_cache::pin(cache, key);
+			}
+
+			void unpin_range_view(GraphicsBuffer graphicsBuffer, uint64_t key)
+			{
+				// The views of a destroyed buffer are already gone with it
+				DX12GraphicsBuffer* buffer;
+				DX12GraphicsBufferCold* bufferCold;
+				if (!handle_table::lookup(handleTables->buffers, graphicsBuffer, buffer, bufferCold))
+					return;
+				std::lock_guard<std::mutex> lock(bufferCold->deviceI->rangeViewLock);
+				buffer_view_cache::unpin(bufferCold->rangeViews, key);
 			}
 
 			GraphicsBuffer create_graphics_buffer(GraphicsDevice graphicsDevice, uint64_t bufferSize, uint32_t elementSize, GraphicsBufferType bufferType)
@@ -119,49 +464,104 @@ namespace graphics_sandbox
 					state = D3D12_RESOURCE_STATE_COMMON;
 
 				// Create the resource
-				ID3D12Resource* buffer;
-				assert_msg(deviceI->device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &resourceDescriptor, state, nullptr, IID_PPV_ARGS(&buffer)) == S_OK, "Failed to create the graphics buffer.");
+				DX12HeapBlock* heapBlock;
+				uint32_t heapAllocation;
+				ID3D12Resource* buffer = create_resource(deviceI, heapProperties, D3D12_HEAP_FLAG_NONE, false, resourceDescriptor, state, nullptr, heapBlock, heapAllocation);
 
 				// Create the buffer internal structure
-				DX12GraphicsBuffer* dx12_graphicsBuffer = bento::make_new<DX12GraphicsBuffer>(*bento::common_allocator());
+				GraphicsBuffer graphicsBuffer = handle_table::allocate(handleTables->buffers);
+				assert_msg(graphicsBuffer != 0, "Too many graphics buffers.");
+				DX12GraphicsBuffer* dx12_graphicsBuffer = handle_table::hot(handleTables->buffers, graphicsBuffer);
 				dx12_graphicsBuffer->resource = buffer;
 				dx12_graphicsBuffer->state = state;
 				dx12_graphicsBuffer->type = bufferType;
 				dx12_graphicsBuffer->bufferSize = bufferSize;
-				dx12_graphicsBuffer->elementSize = (uint32_t)elementSize;
-				
+				DX12GraphicsBufferCold* bufferCold = handle_table::cold(handleTables->buffers, graphicsBuffer);
+				bufferCold->deviceI = deviceI;
+				bufferCold->heapBlock = heapBlock;
+				bufferCold->heapAllocation = heapAllocation;
+				bufferCold->elementSize = (uint32_t)elementSize;
+
+				// Upload buffers are only written by the CPU, map them once
+				bufferCold->mappedData = nullptr;
+				if (bufferType == GraphicsBufferType::Upload)
+				{
+					D3D12_RANGE readRange = { 0, 0 };
+					assert_msg(buffer->Map(0, &readRange, (void**)&bufferCold->mappedData) == S_OK, "Failed to map the upload buffer.");
+				}
+
+				// Create the default views once, binding only copies them
+				create_buffer_views(deviceI, dx12_graphicsBuffer, bufferCold);
+
 				// Return the opaque structure
-				return (GraphicsBuffer)dx12_graphicsBuffer;
+				return graphicsBuffer;
+			}
+
+			void release_graphics_buffer(uint64_t releasedBuffer, void*)
+			{
+				DX12ReleasedBuffer* released = (DX12ReleasedBuffer*)releasedBuffer;
+				DX12GraphicsBuffer* dx12_buffer = &released->buffer;
+				DX12GraphicsBufferCold* bufferCold = &released->cold;
+				if (bufferCold->viewBlock != UINT32_MAX)
+					index_allocator::free(bufferCold->deviceI->bufferViewBlocks, bufferCold->viewBlock);
+
+				// The indices are reused right away, the bindless tables of the previous submissions no longer point to the buffer
+				IndexAllocator& bindlessIndices = bufferCold->deviceI->bindlessIndices;
+				if (dx12_buffer->bindlessSRV != UINT32_MAX)
+					index_allocator::free(bindlessIndices, dx12_buffer->bindlessSRV);
+				if (dx12_buffer->bindlessUAV != UINT32_MAX)
+					index_allocator::free(bindlessIndices, dx12_buffer->bindlessUAV);
+				if (dx12_buffer->bindlessCBV != UINT32_MAX)
+					index_allocator::free(bindlessIndices, dx12_buffer->bindlessCBV);
+
+				// Same for the views of the sub-ranges that were bound
+				if (bufferCold->rangeViews != nullptr)
+				{
+					bento::Vector<uint64_t> rangeViews(bufferCold->deviceI->_allocator);
+					buffer_view_cache::views(bufferCold->rangeViews, rangeViews);
+					for (uint32_t viewIdx = 0; viewIdx < rangeViews.size(); ++viewIdx)
+						release_range_view(rangeViews[viewIdx], bufferCold->deviceI);
+					buffer_view_cache::destroy_cache(bufferCold->rangeViews);
+				}
+				if (bufferCold->mappedData != nullptr)
+					dx12_buffer->resource->Unmap(0, nullptr);
+				release_resource(dx12_buffer->resource, bufferCold->heapBlock, bufferCold->heapAllocation);
+				bento::make_delete<DX12ReleasedBuffer>(*bento::common_allocator(), released);
 			}
 
 			void destroy_graphics_buffer(GraphicsBuffer graphicsBuffer)
 			{
-				DX12GraphicsBuffer* dx12_buffer = (DX12GraphicsBuffer*)graphicsBuffer;
-				dx12_buffer->resource->Release();
-				bento::make_delete<DX12GraphicsBuffer>(*bento::common_allocator(), dx12_buffer);
+				// The handle is freed right away (a second destroy or any later use fails the lookup), command buffers submitted
+				// before this call may still access the resource and its views so they move to the deferred entry
+				DX12GraphicsBuffer* dx12_buffer;
+				DX12GraphicsBufferCold* bufferCold;
+				assert_msg(handle_table::lookup(handleTables->buffers, graphicsBuffer, dx12_buffer, bufferCold), "Invalid or stale graphics buffer.");
+				DX12ReleasedBuffer* released = bento::make_new<DX12ReleasedBuffer>(*bento::common_allocator());
+				released->buffer = *dx12_buffer;
+				released->cold = *bufferCold;
+				handle_table::free(handleTables->buffers, graphicsBuffer);
+				graphics_device::defer_release(released->cold.deviceI, (uint64_t)released, release_graphics_buffer);
 			}
 
 			void set_data(GraphicsBuffer graphicsBuffer, char* buffer, uint64_t bufferSize)
 			{
 				// Convert to the internal structure 
-				DX12GraphicsBuffer* dx12_buffer = (DX12GraphicsBuffer*)graphicsBuffer;
+				DX12GraphicsBuffer* dx12_buffer = handle_table::hot(handleTables->buffers, graphicsBuffer);
 
 				// If this is not an upload buffer, we can't do anything here
 				if (dx12_buffer->type != GraphicsBufferType::Upload)
 					return;
 
-				// Copy to the CPU buffer
-				uint8_t* cpuBuffer = nullptr;
-				D3D12_RANGE readRange = { 0, 0 };
-				dx12_buffer->resource->Map(0, &readRange, reinterpret_cast<void **>(&cpuBuffer));
-				memcpy(cpuBuffer, buffer, bufferSize);
-				dx12_buffer->resource->Unmap(0, nullptr);
+				// The mapping is write-combined, stream the data to it (large inputs are split across threads)
+				assert_msg(bufferSize <= dx12_buffer->bufferSize, "The data doesn't fit in the buffer.");
+				DX12GraphicsBufferCold* bufferCold = handle_table::cold(handleTables->buffers, graphicsBuffer);
+				stream_copy::copy_parallel(bufferCold->deviceI->workerPool, bufferCold->mappedData, buffer, bufferSize);
 			}
 
 			char* allocate_cpu_buffer(GraphicsBuffer graphicsBuffer)
 			{
 				// Get the actual resource
-				DX12GraphicsBuffer* dx12_buffer = (DX12GraphicsBuffer*)graphicsBuffer;
+				DX12GraphicsBuffer* dx12_buffer = handle_table::hot(handleTables->buffers, graphicsBuffer);
 
 				// If this is not a readback buffer, just stop
 				if (dx12_buffer->type != GraphicsBufferType::Readback)
@@ -176,7 +576,7 @@ namespace graphics_sandbox
 
 			void release_cpu_buffer(GraphicsBuffer graphicsBuffer)
 			{
-				DX12GraphicsBuffer* dx12_buffer = (DX12GraphicsBuffer*)graphicsBuffer;
+				DX12GraphicsBuffer* dx12_buffer = handle_table::hot(handleTables->buffers, graphicsBuffer);
 				dx12_buffer->resource->Unmap(0, nullptr);
 			}
 
@@ -184,25 +584,32 @@ namespace graphics_sandbox
 			{
 				// The size needs to be aligned on 256
 				uint64_t alignedSize = (bufferSize + (DX12_CONSTANT_BUFFER_ALIGNEMENT_SIZE - 1)) / DX12_CONSTANT_BUFFER_ALIGNEMENT_SIZE;
-				DX12GraphicsBuffer* buffer = (DX12GraphicsBuffer*)create_graphics_buffer(graphicsDevice, alignedSize * DX12_CONSTANT_BUFFER_ALIGNEMENT_SIZE, elementSize, bufferType == ConstantBufferType::Static ? GraphicsBufferType::Upload : GraphicsBufferType::Default);
-				return (ConstantBuffer)buffer;
+				GraphicsBuffer graphicsBuffer = create_graphics_buffer(graphicsDevice, alignedSize * DX12_CONSTANT_BUFFER_ALIGNEMENT_SIZE, elementSize, bufferType == ConstantBufferType::Static ? GraphicsBufferType::Upload : GraphicsBufferType::Default);
+				DX12GraphicsBuffer* buffer = handle_table::hot(handleTables->buffers, graphicsBuffer);
+
+				// Create the CBV next to the other views
+				DX12GraphicsDevice* deviceI = (DX12GraphicsDevice*)graphicsDevice;
+				D3D12_CONSTANT_BUFFER_VIEW_DESC cbvView;
+				cbvView.BufferLocation = buffer->resource->GetGPUVirtualAddress();
+				cbvView.SizeInBytes = (uint32_t)buffer->bufferSize;
+				uint32_t descSize = deviceI->descriptorSize[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV];
+				buffer->cbvCPU = deviceI->bufferViewCPU;
+				buffer->cbvCPU.ptr += ((uint64_t)handle_table::cold(handleTables->buffers, graphicsBuffer)->viewBlock * DX12_BUFFER_VIEW_COUNT + 2) * descSize;
+				deviceI->device->CreateConstantBufferView(&cbvView, buffer->cbvCPU);
+				return (ConstantBuffer)graphicsBuffer;
 			}
 
 			void destroy_constant_buffer(ConstantBuffer constantBuffer)
 			{
-				DX12GraphicsBuffer* buffer = (DX12GraphicsBuffer*)constantBuffer;
-				destroy_graphics_buffer((GraphicsBuffer)buffer);
+				destroy_graphics_buffer((GraphicsBuffer)constantBuffer);
 			}
 
 			void upload_constant_buffer(ConstantBuffer constantBuffer, const char* bufferData, uint32_t bufferSize)
 			{
-				DX12GraphicsBuffer* buffer = (DX12GraphicsBuffer*)constantBuffer;
+				DX12GraphicsBuffer* buffer = handle_table::hot(handleTables->buffers, constantBuffer);
 				assert_msg(buffer->type == GraphicsBufferType::Upload, "An upload operation can only be done on an upload constant buffer.");
-				D3D12_RANGE readRange = { 0, bufferSize};
-				uint8_t* cbvDataBegin;
-				buffer->resource->Map(0, &readRange, reinterpret_cast<void**>(&cbvDataBegin));
-				memcpy(cbvDataBegin, bufferData, bufferSize);
-				buffer->resource->Unmap(0, nullptr);
+				assert_msg(bufferSize <= buffer->bufferSize, "The data doesn't fit in the constant buffer.");
+				stream_copy::copy(handle_table::cold(handleTables->buffers, constantBuffer)->mappedData, bufferData, bufferSize);
 			}
 		}
 	}
@@ -0,0 +1,72 @@
+// Bento includes
+#include <bento_base/security.h>
+
+// SDK includes
+#include "gpu_backend/buffer_copy_list.h"
+
+// System includes
+#include <algorithm>
+
+namespace graphics_sandbox
+{
+	namespace buffer_copy_list
+	{
+		bool validate_region(uint64_t srcSize, uint64_t dstSize, const BufferCopyRegion& region)
+		{
+			// Written to avoid overflowing on huge offsets
+			return region.srcOffset <= srcSize && region.size <= srcSize - region.srcOffset
+				&& region.dstOffset <= dstSize && region.size <= dstSize - region.dstOffset;
+		}
+
+		bool coalesce(bento::Vector<BufferCopyRegion>& regions)
+		{
+			// Drop the empty regions
+			uint32_t numRegions = 0;
+			for (uint32_t regionIdx = 0; regionIdx < regions.size(); ++regionIdx)
+			{
+				if (regions[regionIdx].size != 0)
+					regions[numRegions++] = regions[regionIdx];
+			}
+			regions.resize(numRegions);
+			if (numRegions == 0)
+				return true;
+
+			std::sort(regions.begin(), regions.end(), [](const BufferCopyRegion& a, const BufferCopyRegion& b)
+			{
+				return a.dstOffset != b.dstOffset ? a.dstOffset < b.dstOffset : a.srcOffset < b.srcOffset;
+			});
+
+			// The current region is the only one that can touch the next, the ones before it end at or before its start
+			uint32_t numMerged = 0;
+			BufferCopyRegion current = regions[0];
+			for (uint32_t regionIdx = 1; regionIdx < numRegions; ++regionIdx)
+			{
+				const BufferCopyRegion& next = regions[regionIdx];
+				uint64_t currentEnd = current.dstOffset + current.size;
+				if (next.dstOffset <= currentEnd && next.srcOffset - current.srcOffset == next.dstOffset - current.dstOffset && next.srcOffset >= current.srcOffset)
+				{
+					// Same shift between the buffers, the overlapping bytes are copied from the same place
+					current.size = std::max(currentEnd, next.dstOffset + next.size) - current.dstOffset;
+				}
+				else if (next.dstOffset < currentEnd)
+					return false;
+				else
+				{
+					regions[numMerged++] = current;
+					current = next;
+				}
+			}
+			regions[numMerged++] = current;
+			regions.resize(numMerged);
+			return true;
+		}
+
+		uint64_t num_bytes(const bento::Vector<BufferCopyRegion>& regions)
+		{
+			uint64_t numBytes = 0;
+			for (uint32_t regionIdx = 0; regionIdx < regions.size(); ++regionIdx)
+				numBytes += regions[regionIdx].size;
+			return numBytes;
+		}
+	}
+}
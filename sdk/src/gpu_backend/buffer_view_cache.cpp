@@ -0,0 +1,167 @@
+// Bento includes
+#include <bento_base/security.h>
+
+// SDK includes
+#include "gpu_backend/buffer_view_cache.h"
+
+namespace graphics_sandbox
+{
+	// Bits of each field of a key (the type takes the rest)
+	#define BUFFER_VIEW_KEY_BITS 31
+	#define BUFFER_VIEW_KEY_MASK ((1ull << BUFFER_VIEW_KEY_BITS) - 1)
+
+	struct BufferViewCacheEntry
+	{
+		uint64_t key;
+		uint64_t view;
+		// Value of the use counter the last time the range was bound
+		uint64_t lastUse;
+		// Slots the view is bound to
+		uint32_t pins;
+	};
+
+	// The capacity is small, the entries are searched linearly
+	struct BufferViewCache
+	{
+		ALLOCATOR_BASED;
+		BufferViewCache(bento::IAllocator& allocator)
+		: entries(allocator)
+		, capacity(0)
+		, useCounter(0)
+		, _allocator(allocator)
+		{
+		}
+
+		bento::Vector<BufferViewCacheEntry> entries;
+		uint32_t capacity;
+		uint64_t useCounter;
+		bento::IAllocator& _allocator;
+	};
+
+	namespace buffer_view_cache
+	{
+		BufferViewCache* create_cache(bento::IAllocator& allocator, uint32_t capacity)
+		{
+			assert_msg(capacity > 0, "A buffer view cache needs room for one view.");
+			BufferViewCache* cache = bento::make_new<BufferViewCache>(allocator, allocator);
+			cache->capacity = capacity;
+			return cache;
+		}
+
+		uint32_t find_entry(BufferViewCache* cache, uint64_t key)
+		{
+			uint32_t numEntries = cache->entries.size();
+			for (uint32_t entryIdx = 0; entryIdx < numEntries; ++entryIdx)
+			{
+				if (cache->entries[entryIdx].key == key)
+					return entryIdx;
+			}
+			return UINT32_MAX;
+		}
+
+		void destroy_cache(BufferViewCache* cache)
+		{
+			bento::make_delete<BufferViewCache>(cache->_allocator, cache);
+		}
+
+		bool validate_element_range(uint64_t bufferSize, uint32_t elementSize, uint64_t firstElement, uint64_t numElements)
+		{
+			// Written so that large values can't overflow
+			uint64_t bufferElements = elementSize != 0 ? bufferSize / elementSize : 0;
+			return numElements > 0 && firstElement < bufferElements && numElements <= bufferElements - firstElement;
+		}
+
+		uint64_t aligned_cbv_size(uint64_t size)
+		{
+			return (size + BUFFER_VIEW_CBV_ALIGNMENT - 1) / BUFFER_VIEW_CBV_ALIGNMENT * BUFFER_VIEW_CBV_ALIGNMENT;
+		}
+
+		bool validate_cbv_range(uint64_t bufferSize, uint64_t byteOffset, uint64_t size)
+		{
+			if (size == 0 || byteOffset % BUFFER_VIEW_CBV_ALIGNMENT != 0 || byteOffset >= bufferSize)
+				return false;
+			return size <= bufferSize - byteOffset && aligned_cbv_size(size) <= bufferSize - byteOffset;
+		}
+
+		uint64_t view_key(BufferViewType type, uint64_t first, uint64_t count)
+		{
+			// CBV ranges are aligned, their offset and size are stored in units of the alignment
+			if (type == BufferViewType::CBV)
+			{
+				first /= BUFFER_VIEW_CBV_ALIGNMENT;
+				count = aligned_cbv_size(count) / BUFFER_VIEW_CBV_ALIGNMENT;
+			}
+			assert_msg(first <= BUFFER_VIEW_KEY_MASK && count <= BUFFER_VIEW_KEY_MASK, "Buffer view range too large.");
+			return ((uint64_t)type << (2 * BUFFER_VIEW_KEY_BITS)) | (first << BUFFER_VIEW_KEY_BITS) | count;
+		}
+
+		bool lookup(BufferViewCache* cache, uint64_t key, uint64_t& view)
+		{
+			uint32_t entryIdx = find_entry(cache, key);
+			if (entryIdx == UINT32_MAX)
+				return false;
+			BufferViewCacheEntry& entry = cache->entries[entryIdx];
+			entry.lastUse = ++cache->useCounter;
+			view = entry.view;
+			return true;
+		}
+
+		bool insert(BufferViewCache* cache, uint64_t key, uint64_t view, uint64_t& evictedView)
+		{
+			assert_msg(find_entry(cache, key) == UINT32_MAX, "The range already has a view.");
+			BufferViewCacheEntry newEntry = { key, view, ++cache->useCounter, 0 };
+			uint32_t numEntries = cache->entries.size();
+
+			// Full, the least recently bound range that no slot uses makes room
+			uint32_t oldestIdx = UINT32_MAX;
+			for (uint32_t entryIdx = 0; entryIdx < numEntries && numEntries >= cache->capacity; ++entryIdx)
+			{
+				const BufferViewCacheEntry& entry = cache->entries[entryIdx];
+				if (entry.pins == 0 && (oldestIdx == UINT32_MAX || entry.lastUse < cache->entries[oldestIdx].lastUse))
+					oldestIdx = entryIdx;
+			}
+			if (oldestIdx == UINT32_MAX)
+			{
+				cache->entries.push_back(newEntry);
+				return false;
+			}
+			evictedView = cache->entries[oldestIdx].view;
+			cache->entries[oldestIdx] = newEntry;
+			return true;
+		}
+
+		void update(BufferViewCache* cache, uint64_t key, uint64_t view)
+		{
+			uint32_t entryIdx = find_entry(cache, key);
+			assert_msg(entryIdx != UINT32_MAX, "The range has no view.");
+			cache->entries[entryIdx].view = view;
+		}
+
+		void pin(BufferViewCache* cache, uint64_t key)
+		{
+			uint32_t entryIdx = find_entry(cache, key);
+			assert_msg(entryIdx != UINT32_MAX, "The range has no view.");
+			cache->entries[entryIdx].pins++;
+		}
+
+		void unpin(BufferViewCache* cache, uint64_t key)
+		{
+			uint32_t entryIdx = find_entry(cache, key);
+			assert_msg(entryIdx != UINT32_MAX && cache->entries[entryIdx].pins > 0, "The range view is not pinned.");
+			cache->entries[entryIdx].pins--;
+		}
+
+		void views(BufferViewCache* cache, bento::Vector<uint64_t>& views)
+		{
+			uint32_t numEntries = cache->entries.size();
+			views.resize(numEntries);
+			for (uint32_t entryIdx = 0; entryIdx < numEntries; ++entryIdx)
+				views[entryIdx] = cache->entries[entryIdx].view;
+		}
+
+		uint32_t size(BufferViewCache* cache)
+		{
+			return cache->entries.size();
+		}
+	}
+}
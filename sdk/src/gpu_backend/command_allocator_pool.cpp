@@ -0,0 +1,124 @@
+// Bento includes
+#include <bento_base/security.h>
+
+// SDK includes
+#include "gpu_backend/command_allocator_pool.h"
+
+namespace graphics_sandbox
+{
+	CommandAllocatorPool::CommandAllocatorPool(bento::IAllocator& allocator)
+	: _allocator(allocator)
+	, available(allocator)
+	, inFlight(allocator)
+	, numAllocators(0)
+	, recycled(0)
+	{
+	}
+
+	namespace command_allocator_pool
+	{
+		bool acquire(CommandAllocatorPool& pool, uint64_t& allocator)
+		{
+			uint32_t numAvailable = pool.available.size();
+			if (numAvailable == 0)
+				return false;
+			allocator = pool.available[numAvailable - 1];
+			pool.available.resize(numAvailable - 1);
+			pool.recycled++;
+			return true;
+		}
+
+		void add(CommandAllocatorPool& pool, uint64_t)
+		{
+			pool.numAllocators++;
+		}
+
+		void submit(CommandAllocatorPool& pool, uint64_t allocator, uint64_t fence, uint64_t fenceValue)
+		{
+			// A command buffer can be executed several times, only its last submission matters
+			uint32_t numInFlight = pool.inFlight.size();
+			for (uint32_t entryIdx = 0; entryIdx < numInFlight; ++entryIdx)
+			{
+				CommandAllocatorEntry& entry = pool.inFlight[entryIdx];
+				if (entry.allocator == allocator)
+				{
+					assert_msg(!entry.released, "Submitting a released command allocator.");
+					for (; entryIdx + 1 < numInFlight; ++entryIdx)
+						pool.inFlight[entryIdx] = pool.inFlight[entryIdx + 1];
+					pool.inFlight.resize(numInFlight - 1);
+					break;
+				}
+			}
+
+			CommandAllocatorEntry entry;
+			entry.allocator = allocator;
+			entry.fence = fence;
+			entry.fenceValue = fenceValue;
+			entry.released = false;
+			pool.inFlight.push_back(entry);
+		}
+
+		void release(CommandAllocatorPool& pool, uint64_t allocator)
+		{
+			uint32_t numInFlight = pool.inFlight.size();
+			for (uint32_t entryIdx = 0; entryIdx < numInFlight; ++entryIdx)
+			{
+				CommandAllocatorEntry& entry = pool.inFlight[entryIdx];
+				if (entry.allocator == allocator)
+				{
+					entry.released = true;
+					reclaim(pool, 0, 0);
+					return;
+				}
+			}
+
+			// Never submitted, nothing to wait for
+			pool.available.push_back(allocator);
+		}
+
+		void reclaim(CommandAllocatorPool& pool, uint64_t fence, uint64_t completedValue)
+		{
+			// Fences complete in order but the entries of several fences are interleaved, keep the order of the survivors
+			uint32_t numInFlight = pool.inFlight.size();
+			uint32_t numKept = 0;
+			for (uint32_t entryIdx = 0; entryIdx < numInFlight; ++entryIdx)
+			{
+				const CommandAllocatorEntry& entry = pool.inFlight[entryIdx];
+				bool completed = entry.fence == 0 || (entry.fence == fence && entry.fenceValue <= completedValue);
+				if (entry.released && completed)
+					pool.available.push_back(entry.allocator);
+				else
+					pool.inFlight[numKept++] = entry;
+			}
+			pool.inFlight.resize(numKept);
+		}
+
+		void forget_fence(CommandAllocatorPool& pool, uint64_t fence)
+		{
+			uint32_t numInFlight = pool.inFlight.size();
+			for (uint32_t entryIdx = 0; entryIdx < numInFlight; ++entryIdx)
+			{
+				CommandAllocatorEntry& entry = pool.inFlight[entryIdx];
+				if (entry.fence == fence)
+					entry.fence = 0;
+			}
+			reclaim(pool, 0, 0);
+		}
+
+		bool oldest_fence(const CommandAllocatorPool& pool, uint64_t& fence, uint64_t& fenceValue)
+		{
+			uint32_t numInFlight = pool.inFlight.size();
+			for (uint32_t entryIdx = 0; entryIdx < numInFlight; ++entryIdx)
+			{
+				const CommandAllocatorEntry& entry = pool.inFlight[entryIdx];
+				if (entry.released)
+				{
+					fence = entry.fence;
+					fenceValue = entry.fenceValue;
+					return true;
+				}
+			}
+			return false;
+		}
+	}
+}
@@ -7,7 +7,34 @@ namespace graphics_sandbox
 	: _allocator(allocator)
 	, filename(allocator)
 	, kernelname(allocator)
+	, uavCount(0)
+	, srvCount(0)
+	, cbvCount(0)
+	, bindless(false)
+	, rootConstantSizes(allocator)
+	, rootCbvCount(0)
 	, includeDirectories(allocator)
+	, defines(allocator)
 	{
 	}
+
+	namespace compute_shader_descriptor
+	{
+		void copy(const ComputeShaderDescriptor& source, ComputeShaderDescriptor& destination)
+		{
+			destination.filename = source.filename;
+			destination.kernelname = source.kernelname;
+			destination.uavCount = source.uavCount;
+			destination.srvCount = source.srvCount;
+			destination.cbvCount = source.cbvCount;
+			destination.bindless = source.bindless;
+			for (uint32_t rangeIdx = 0; rangeIdx < source.rootConstantSizes.size(); ++rangeIdx)
+				destination.rootConstantSizes.push_back(source.rootConstantSizes[rangeIdx]);
+			destination.rootCbvCount = source.rootCbvCount;
+			for (uint32_t includeDirIdx = 0; includeDirIdx < source.includeDirectories.size(); ++includeDirIdx)
+				destination.includeDirectories.push_back(source.includeDirectories[includeDirIdx]);
+			for (uint32_t defineIdx = 0; defineIdx < source.defines.size(); ++defineIdx)
+				destination.defines.push_back(source.defines[defineIdx]);
+		}
+	}
 }
\ No newline at end of file
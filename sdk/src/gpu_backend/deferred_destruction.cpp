@@ -0,0 +1,165 @@
+// Bento includes
+#include <bento_base/security.h>
+
+// SDK includes
+#include "gpu_backend/deferred_destruction.h"
+
+// System includes
+#include <atomic>
+#include <mutex>
+
+namespace graphics_sandbox
+{
+	struct DeferredObject
+	{
+		DeferredObject* next;
+		uint64_t object;
+		DeferredReleaseFunction releaseFunction;
+		void* userData;
+
+		// Fences still waited for, the reached ones are removed
+		uint32_t numFences;
+		uint64_t fences[DEFERRED_DESTRUCTION_MAX_FENCES];
+		uint64_t fenceValues[DEFERRED_DESTRUCTION_MAX_FENCES];
+	};
+
+	struct DeferredDestructionQueue
+	{
+		ALLOCATOR_BASED;
+		DeferredDestructionQueue(bento::IAllocator& allocator)
+		: _allocator(allocator)
+		, incoming(nullptr)
+		, numPending(0)
+		, pendingHead(nullptr)
+		, pendingTail(nullptr)
+		{
+		}
+
+		// Stack the producers push to (most recent first)
+		std::atomic<DeferredObject*> incoming;
+		std::atomic<uint32_t> numPending;
+
+		// Objects owned by the collector in enqueue order, guarded by the lock
+		DeferredObject* pendingHead;
+		DeferredObject* pendingTail;
+		std::mutex collectLock;
+		bento::IAllocator& _allocator;
+	};
+
+	namespace deferred_destruction
+	{
+		DeferredDestructionQueue* create_queue(bento::IAllocator& allocator)
+		{
+			return bento::make_new<DeferredDestructionQueue>(allocator, allocator);
+		}
+
+		void destroy_queue(DeferredDestructionQueue* queue)
+		{
+			// Gather what was pushed since the last collection, then release everything regardless of the fences
+			collect(queue, nullptr, nullptr, 0);
+			std::lock_guard<std::mutex> lock(queue->collectLock);
+			for (DeferredObject* object = queue->pendingHead; object != nullptr;)
+			{
+				DeferredObject* next = object->next;
+				object->releaseFunction(object->object, object->userData);
+				bento::make_delete<DeferredObject>(queue->_allocator, object);
+				object = next;
+			}
+			queue->pendingHead = nullptr;
+			queue->pendingTail = nullptr;
+			bento::make_delete<DeferredDestructionQueue>(queue->_allocator, queue);
+		}
+
+		void enqueue(DeferredDestructionQueue* queue, uint64_t object, DeferredReleaseFunction releaseFunction, void* userData, const uint64_t* fences, const uint64_t* fenceValues, uint32_t numFences)
+		{
+			assert_msg(numFences <= DEFERRED_DESTRUCTION_MAX_FENCES, "Too many fences for a deferred destruction.");
+			DeferredObject* deferred = bento::make_new<DeferredObject>(queue->_allocator);
+			deferred->object = object;
+			deferred->releaseFunction = releaseFunction;
+			deferred->userData = userData;
+			deferred->numFences = numFences;
+			for (uint32_t fenceIdx = 0; fenceIdx < numFences; ++fenceIdx)
+			{
+				deferred->fences[fenceIdx] = fences[fenceIdx];
+				deferred->fenceValues[fenceIdx] = fenceValues[fenceIdx];
+			}
+
+			// The collector takes the whole stack at once, so the head can't be recycled under a producer (no ABA)
+			queue->numPending.fetch_add(1, std::memory_order_relaxed);
+			deferred->next = queue->incoming.load(std::memory_order_relaxed);
+			while (!queue->incoming.compare_exchange_weak(deferred->next, deferred, std::memory_order_release, std::memory_order_relaxed))
+			{
+			}
+		}
+
+		uint32_t collect(DeferredDestructionQueue* queue, const uint64_t* fences, const uint64_t* completedValues, uint32_t numFences)
+		{
+			std::lock_guard<std::mutex> lock(queue->collectLock);
+
+			// Append what was pushed since the last collection, reversed to restore the enqueue order
+			DeferredObject* incoming = queue->incoming.exchange(nullptr, std::memory_order_acquire);
+			DeferredObject* ordered = nullptr;
+			DeferredObject* orderedTail = incoming;
+			while (incoming != nullptr)
+			{
+				DeferredObject* next = incoming->next;
+				incoming->next = ordered;
+				ordered = incoming;
+				incoming = next;
+			}
+			if (ordered != nullptr)
+			{
+				if (queue->pendingTail != nullptr)
+					queue->pendingTail->next = ordered;
+				else
+					queue->pendingHead = ordered;
+				queue->pendingTail = orderedTail;
+			}
+
+			// Drop the reached fences, release the objects that don't wait for anything anymore
+			uint32_t numReleased = 0;
+			DeferredObject* previous = nullptr;
+			for (DeferredObject* object = queue->pendingHead; object != nullptr;)
+			{
+				uint32_t numKept = 0;
+				for (uint32_t pendingIdx = 0; pendingIdx < object->numFences; ++pendingIdx)
+				{
+					bool reached = false;
+					for (uint32_t fenceIdx = 0; fenceIdx < numFences && !reached; ++fenceIdx)
+						reached = object->fences[pendingIdx] == fences[fenceIdx] && object->fenceValues[pendingIdx] <= completedValues[fenceIdx];
+					if (!reached)
+					{
+						object->fences[numKept] = object->fences[pendingIdx];
+						object->fenceValues[numKept] = object->fenceValues[pendingIdx];
+						numKept++;
+					}
+				}
+				object->numFences = numKept;
+
+				DeferredObject* next = object->next;
+				if (numKept == 0)
+				{
+					if (previous != nullptr)
+						previous->next = next;
+					else
+						queue->pendingHead = next;
+					if (queue->pendingTail == object)
+						queue->pendingTail = previous;
+					object->releaseFunction(object->object, object->userData);
+					bento::make_delete<DeferredObject>(queue->_allocator, object);
+					numReleased++;
+				}
+				else
+					previous = object;
+				object = next;
+			}
+			queue->numPending.fetch_sub(numReleased, std::memory_order_relaxed);
+			return numReleased;
+		}
+
+		uint32_t num_pending(DeferredDestructionQueue* queue)
+		{
+			return queue->numPending.load(std::memory_order_relaxed);
+		}
+	}
+}
@@ -0,0 +1,48 @@
+// Bento includes
+#include <bento_base/security.h>
+
+// SDK includes
+#include "gpu_backend/descriptor_copy_batch.h"
+
+namespace graphics_sandbox
+{
+	DescriptorCopyBatch::DescriptorCopyBatch(bento::IAllocator& allocator)
+	: _allocator(allocator)
+	, rangeStarts(allocator)
+	, rangeSizes(allocator)
+	, copiedDescriptors(0)
+	, copiedRanges(0)
+	{
+	}
+
+	namespace descriptor_copy_batch
+	{
+		uint32_t build(DescriptorCopyBatch& batch, const uint64_t* sources, uint32_t numSlots, uint32_t descriptorSize)
+		{
+			batch.rangeStarts.resize(numSlots);
+			batch.rangeSizes.resize(numSlots);
+
+			uint32_t numRanges = 0;
+			for (uint32_t slotIdx = 0; slotIdx < numSlots; ++slotIdx)
+			{
+				uint64_t source = sources[slotIdx];
+				assert_msg(source != 0, "A descriptor slot was never bound.");
+
+				// Extend the current range if the source directly follows it
+				if (numRanges > 0 && batch.rangeStarts[numRanges - 1] + (uint64_t)batch.rangeSizes[numRanges - 1] * descriptorSize == source)
+				{
+					batch.rangeSizes[numRanges - 1]++;
+					continue;
+				}
+
+				batch.rangeStarts[numRanges] = source;
+				batch.rangeSizes[numRanges] = 1;
+				numRanges++;
+			}
+
+			batch.copiedDescriptors += numSlots;
+			batch.copiedRanges += numRanges;
+			return numRanges;
+		}
+	}
+}
@@ -0,0 +1,198 @@
+// Bento includes
+#include <bento_base/security.h>
+
+// SDK includes
+#include "gpu_backend/descriptor_ring.h"
+
+namespace graphics_sandbox
+{
+	DescriptorRing::DescriptorRing(bento::IAllocator& allocator)
+	: _allocator(allocator)
+	, capacity(0)
+	, head(0)
+	, tail(0)
+	, used(0)
+	, spans(allocator)
+	, firstSpan(0)
+	, allocations(0)
+	, wraps(0)
+	, failedAllocations(0)
+	{
+	}
+
+	namespace descriptor_ring
+	{
+		void initialize(DescriptorRing& ring, uint32_t capacity)
+		{
+			ring.capacity = capacity;
+			ring.head = 0;
+			ring.tail = 0;
+			ring.used = 0;
+			ring.spans.clear();
+			ring.firstSpan = 0;
+		}
+
+		void push_span(DescriptorRing& ring, uint64_t owner, uint32_t offset, uint32_t count)
+		{
+			// Extend the last span if it is the continuation of the owner's current recording
+			if (ring.spans.size() > ring.firstSpan)
+			{
+				DescriptorRingSpan& last = ring.spans[ring.spans.size() - 1];
+				if (last.owner == owner && !last.submitted && last.offset + last.count == offset)
+				{
+					last.count += count;
+					return;
+				}
+			}
+
+			DescriptorRingSpan span;
+			span.offset = offset;
+			span.count = count;
+			span.owner = owner;
+			span.submitted = false;
+			span.fence = 0;
+			span.fenceValue = 0;
+			ring.spans.push_back(span);
+		}
+
+		bool allocate(DescriptorRing& ring, uint64_t owner, uint32_t count, uint32_t& offset)
+		{
+			assert_msg(count > 0 && count <= ring.capacity, "Invalid descriptor ring allocation size.");
+
+			// Restart from the beginning whenever possible, this avoids wasting the end of the ring
+			if (ring.used == 0)
+			{
+				ring.head = 0;
+				ring.tail = 0;
+			}
+
+			uint32_t padding = 0;
+			if (ring.used == ring.capacity)
+			{
+				ring.failedAllocations++;
+				return false;
+			}
+			else if (ring.head >= ring.tail)
+			{
+				// The free space is [head, capacity) and [0, tail), a table can't straddle the end of the ring
+				if (ring.capacity - ring.head < count)
+				{
+					if (ring.tail < count)
+					{
+						ring.failedAllocations++;
+						return false;
+					}
+					padding = ring.capacity - ring.head;
+				}
+			}
+			else if (ring.tail - ring.head < count)
+			{
+				// The free space is [head, tail)
+				ring.failedAllocations++;
+				return false;
+			}
+
+			// The skipped end of the ring is owned by the same owner so that it is released with it
+			if (padding > 0)
+			{
+				push_span(ring, owner, ring.head, padding);
+				ring.used += padding;
+				ring.head = 0;
+				ring.wraps++;
+			}
+
+			offset = ring.head;
+			push_span(ring, owner, offset, count);
+			ring.used += count;
+			ring.head = (ring.head + count) % ring.capacity;
+			ring.allocations++;
+			return true;
+		}
+
+		void submit(DescriptorRing& ring, uint64_t owner, uint64_t fence, uint64_t fenceValue)
+		{
+			// A command buffer can be executed several times, the tables it already submitted are used by the new execution as well
+			// and only its last submission matters. Released spans are left alone.
+			uint32_t numSpans = ring.spans.size();
+			for (uint32_t spanIdx = ring.firstSpan; spanIdx < numSpans; ++spanIdx)
+			{
+				DescriptorRingSpan& span = ring.spans[spanIdx];
+				if (span.owner == owner && (!span.submitted || span.fence != 0))
+				{
+					span.submitted = true;
+					span.fence = fence;
+					span.fenceValue = fenceValue;
+				}
+			}
+		}
+
+		void release(DescriptorRing& ring, uint64_t owner)
+		{
+			// Released spans are flagged with a null fence, they are freed as soon as they become the oldest. The submitted ones
+			// keep waiting on the GPU.
+			uint32_t numSpans = ring.spans.size();
+			for (uint32_t spanIdx = ring.firstSpan; spanIdx < numSpans; ++spanIdx)
+			{
+				DescriptorRingSpan& span = ring.spans[spanIdx];
+				if (span.owner == owner && !span.submitted)
+				{
+					span.submitted = true;
+					span.fence = 0;
+					span.fenceValue = 0;
+				}
+			}
+			reclaim(ring, 0, 0);
+		}
+
+		void reclaim(DescriptorRing& ring, uint64_t fence, uint64_t completedValue)
+		{
+			uint32_t numSpans = ring.spans.size();
+			while (ring.firstSpan < numSpans)
+			{
+				const DescriptorRingSpan& span = ring.spans[ring.firstSpan];
+				bool released = span.submitted && span.fence == 0;
+				bool completed = span.submitted && span.fence == fence && span.fenceValue <= completedValue;
+				if (!released && !completed)
+					break;
+
+				ring.tail = (span.offset + span.count) % ring.capacity;
+				ring.used -= span.count;
+				ring.firstSpan++;
+			}
+
+			// Compact the span list once the dead part dominates
+			if (ring.firstSpan > 0 && ring.firstSpan * 2 >= numSpans)
+			{
+				uint32_t numLive = numSpans - ring.firstSpan;
+				for (uint32_t spanIdx = 0; spanIdx < numLive; ++spanIdx)
+					ring.spans[spanIdx] = ring.spans[ring.firstSpan + spanIdx];
+				ring.spans.resize(numLive);
+				ring.firstSpan = 0;
+			}
+		}
+
+		void forget_fence(DescriptorRing& ring, uint64_t fence)
+		{
+			uint32_t numSpans = ring.spans.size();
+			for (uint32_t spanIdx = ring.firstSpan; spanIdx < numSpans; ++spanIdx)
+			{
+				DescriptorRingSpan& span = ring.spans[spanIdx];
+				if (span.submitted && span.fence == fence)
+					span.fence = 0;
+			}
+			reclaim(ring, 0, 0);
+		}
+
+		bool oldest_fence(const DescriptorRing& ring, uint64_t& fence, uint64_t& fenceValue)
+		{
+			if (ring.firstSpan >= ring.spans.size())
+				return false;
+			const DescriptorRingSpan& span = ring.spans[ring.firstSpan];
+			if (!span.submitted)
+				return false;
+			fence = span.fence;
+			fenceValue = span.fenceValue;
+			return true;
+		}
+	}
+}
@@ -0,0 +1,311 @@
+// Bento includes
+#include <bento_base/security.h>
+#include <bento_memory/common.h>
+
+// SDK includes
+#include "gpu_backend/dispatch_autotuner.h"
+#include "gpu_backend/shader_permutation.h"
+
+// System includes
+#include <algorithm>
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+namespace graphics_sandbox
+{
+	AutotuneSpace::AutotuneSpace(bento::IAllocator& allocator)
+	: _allocator(allocator)
+	, names(allocator)
+	, numValues(allocator)
+	, values(allocator)
+	{
+	}
+
+	AutotuneResult::AutotuneResult(bento::IAllocator& allocator)
+	: _allocator(allocator)
+	, candidate(UINT32_MAX)
+	, defines(allocator)
+	, duration(0.0)
+	, numMeasured(0)
+	{
+	}
+
+	struct AutotuneWinner
+	{
+		AutotuneCacheEntry entry;
+		std::vector<std::string> defines;
+	};
+
+	struct AutotuneCache
+	{
+		ALLOCATOR_BASED;
+		AutotuneCache(bento::IAllocator& allocator)
+		: _allocator(allocator)
+		, dirty(false)
+		{
+		}
+
+		std::string path;
+		std::vector<AutotuneWinner> winners;
+		bool dirty;
+		std::mutex lock;
+		bento::IAllocator& _allocator;
+	};
+
+	namespace dispatch_autotuner
+	{
+		void add_parameter(AutotuneSpace& space, const char* name, const uint32_t* values, uint32_t numValues)
+		{
+			assert_msg(numValues > 0, "A parameter needs at least one value.");
+			space.names.push_back(bento::DynamicString(*bento::common_allocator(), name));
+			space.numValues.push_back(numValues);
+			for (uint32_t valueIdx = 0; valueIdx < numValues; ++valueIdx)
+				space.values.push_back(values[valueIdx]);
+		}
+
+		uint32_t num_candidates(const AutotuneSpace& space)
+		{
+			uint32_t numCandidates = 1;
+			for (uint32_t paramIdx = 0; paramIdx < space.numValues.size(); ++paramIdx)
+				numCandidates *= space.numValues[paramIdx];
+			return numCandidates;
+		}
+
+		void candidate_defines(const AutotuneSpace& space, uint32_t candidate, bento::Vector<bento::DynamicString>& defines)
+		{
+			// The candidate index is a mixed radix number, the first parameter changes the fastest
+			uint32_t valueOffset = 0;
+			for (uint32_t paramIdx = 0; paramIdx < space.names.size(); ++paramIdx)
+			{
+				uint32_t numValues = space.numValues[paramIdx];
+				std::string define = std::string(space.names[paramIdx].c_str()) + "=" + std::to_string(space.values[valueOffset + candidate % numValues]);
+				defines.push_back(bento::DynamicString(*bento::common_allocator(), define.c_str()));
+				candidate /= numValues;
+				valueOffset += numValues;
+			}
+		}
+
+		void space_key(const AutotuneSpace& space, Hash128& key)
+		{
+			hash::begin(key);
+			hash::append_uint64(key, space.names.size());
+			uint32_t valueOffset = 0;
+			for (uint32_t paramIdx = 0; paramIdx < space.names.size(); ++paramIdx)
+			{
+				hash::append_string(key, space.names[paramIdx].c_str());
+				hash::append_uint64(key, space.numValues[paramIdx]);
+				for (uint32_t valueIdx = 0; valueIdx < space.numValues[paramIdx]; ++valueIdx)
+					hash::append_uint64(key, space.values[valueOffset + valueIdx]);
+				valueOffset += space.numValues[paramIdx];
+			}
+		}
+
+		void kernel_key(const ComputeShaderDescriptor& descriptor, Hash128& key)
+		{
+			bento::Vector<bento::DynamicString> defines(*bento::common_allocator());
+			shader_permutation::canonicalize(descriptor.defines, defines);
+			hash::begin(key);
+			hash::append_string(key, descriptor.filename.c_str());
+			hash::append_string(key, descriptor.kernelname.c_str());
+			hash::append_uint64(key, descriptor.bindless ? 1 : 0);
+			hash::append_uint64(key, defines.size());
+			for (uint32_t defineIdx = 0; defineIdx < defines.size(); ++defineIdx)
+				hash::append_string(key, defines[defineIdx].c_str());
+		}
+
+		bool search(const AutotuneSpace& space, AutotuneMeasureFunction measureFunction, void* userData, uint32_t numSamples, AutotuneResult& result)
+		{
+			assert_msg(numSamples > 0, "At least one sample per candidate is required.");
+			result.candidate = UINT32_MAX;
+			result.numMeasured = 0;
+			std::vector<double> durations(numSamples);
+			uint32_t numCandidates = num_candidates(space);
+			for (uint32_t candidate = 0; candidate < numCandidates; ++candidate)
+			{
+				bento::Vector<bento::DynamicString> defines(*bento::common_allocator());
+				candidate_defines(space, candidate, defines);
+				if (!measureFunction(defines, numSamples, &durations[0], userData))
+					continue;
+				result.numMeasured++;
+
+				// The median ignores the occasional preemption or clock change
+				std::sort(durations.begin(), durations.end());
+				double median = (numSamples % 2) ? durations[numSamples / 2] : (durations[numSamples / 2 - 1] + durations[numSamples / 2]) * 0.5;
+				if (result.candidate == UINT32_MAX || median < result.duration)
+				{
+					result.candidate = candidate;
+					result.duration = median;
+				}
+			}
+
+			if (result.candidate == UINT32_MAX)
+				return false;
+			result.defines.clear();
+			candidate_defines(space, result.candidate, result.defines);
+			return true;
+		}
+
+		// Cache
+
+		bool load_file(AutotuneCache* cache)
+		{
+			FILE* file = fopen(cache->path.c_str(), "rb");
+			if (file == nullptr)
+				return false;
+			fseek(file, 0, SEEK_END);
+			long size = ftell(file);
+			fseek(file, 0, SEEK_SET);
+			std::string content(size > 0 ? (size_t)size : 0, '\0');
+			bool success = size >= 0 && fread(&content[0], 1, content.size(), file) == content.size();
+			fclose(file);
+			if (!success || content.size() < sizeof(AutotuneCacheHeader))
+				return false;
+
+			AutotuneCacheHeader header;
+			memcpy(&header, content.c_str(), sizeof(header));
+			if (header.magic != AUTOTUNE_CACHE_MAGIC || header.version != AUTOTUNE_CACHE_VERSION)
+				return false;
+
+			// Every record is checked against the end of the file, a truncated file is dropped entirely
+			std::vector<AutotuneWinner> winners;
+			uint64_t cursor = sizeof(AutotuneCacheHeader);
+			for (uint32_t entryIdx = 0; entryIdx < header.numEntries; ++entryIdx)
+			{
+				AutotuneWinner winner;
+				if (content.size() - cursor < sizeof(AutotuneCacheEntry))
+					return false;
+				memcpy(&winner.entry, content.c_str() + cursor, sizeof(AutotuneCacheEntry));
+				cursor += sizeof(AutotuneCacheEntry);
+				for (uint32_t defineIdx = 0; defineIdx < winner.entry.numDefines; ++defineIdx)
+				{
+					uint32_t length;
+					if (content.size() - cursor < sizeof(uint32_t))
+						return false;
+					memcpy(&length, content.c_str() + cursor, sizeof(uint32_t));
+					cursor += sizeof(uint32_t);
+					if (content.size() - cursor < length)
+						return false;
+					winner.defines.push_back(content.substr((size_t)cursor, length));
+					cursor += length;
+				}
+				winners.push_back(winner);
+			}
+			if (cursor != content.size())
+				return false;
+			cache->winners = winners;
+			return true;
+		}
+
+		AutotuneCache* create_cache(bento::IAllocator& allocator, const char* path)
+		{
+			AutotuneCache* cache = bento::make_new<AutotuneCache>(allocator, allocator);
+			cache->path = path;
+			load_file(cache);
+			return cache;
+		}
+
+		void destroy_cache(AutotuneCache* cache)
+		{
+			save(cache);
+			bento::make_delete<AutotuneCache>(cache->_allocator, cache);
+		}
+
+		bool write_file(const char* path, const std::vector<AutotuneWinner>& winners)
+		{
+			FILE* file = fopen(path, "wb");
+			if (file == nullptr)
+				return false;
+			AutotuneCacheHeader header;
+			header.magic = AUTOTUNE_CACHE_MAGIC;
+			header.version = AUTOTUNE_CACHE_VERSION;
+			header.numEntries = (uint32_t)winners.size();
+			header.reserved = 0;
+			bool success = fwrite(&header, sizeof(header), 1, file) == 1;
+			for (uint32_t winnerIdx = 0; winnerIdx < (uint32_t)winners.size() && success; ++winnerIdx)
+			{
+				const AutotuneWinner& winner = winners[winnerIdx];
+				success &= fwrite(&winner.entry, sizeof(AutotuneCacheEntry), 1, file) == 1;
+				for (uint32_t defineIdx = 0; defineIdx < (uint32_t)winner.defines.size(); ++defineIdx)
+				{
+					uint32_t length = (uint32_t)winner.defines[defineIdx].size();
+					success &= fwrite(&length, sizeof(uint32_t), 1, file) == 1;
+					success &= fwrite(winner.defines[defineIdx].c_str(), 1, length, file) == length;
+				}
+			}
+			success &= fclose(file) == 0;
+			return success;
+		}
+
+		bool save(AutotuneCache* cache)
+		{
+			std::lock_guard<std::mutex> lock(cache->lock);
+			if (!cache->dirty)
+				return true;
+
+			// Write next to the file and swap, a crash never leaves a truncated file behind
+			std::string tempPath = cache->path + ".tmp";
+			if (!write_file(tempPath.c_str(), cache->winners))
+			{
+				remove(tempPath.c_str());
+				return false;
+			}
+			remove(cache->path.c_str());
+			if (rename(tempPath.c_str(), cache->path.c_str()) != 0)
+				return false;
+			cache->dirty = false;
+			return true;
+		}
+
+		AutotuneWinner* find_winner(AutotuneCache* cache, uint64_t adapterId, const Hash128& kernelKey)
+		{
+			for (uint32_t winnerIdx = 0; winnerIdx < (uint32_t)cache->winners.size(); ++winnerIdx)
+			{
+				AutotuneWinner& winner = cache->winners[winnerIdx];
+				if (winner.entry.adapterId == adapterId && hash::equal(winner.entry.kernelKey, kernelKey))
+					return &winner;
+			}
+			return nullptr;
+		}
+
+		bool lookup(AutotuneCache* cache, uint64_t adapterId, const Hash128& kernelKey, const Hash128* spaceKey, bento::Vector<bento::DynamicString>& defines)
+		{
+			std::lock_guard<std::mutex> lock(cache->lock);
+			const AutotuneWinner* winner = find_winner(cache, adapterId, kernelKey);
+			if (winner == nullptr || (spaceKey != nullptr && !hash::equal(winner->entry.spaceKey, *spaceKey)))
+				return false;
+			for (uint32_t defineIdx = 0; defineIdx < (uint32_t)winner->defines.size(); ++defineIdx)
+				defines.push_back(bento::DynamicString(*bento::common_allocator(), winner->defines[defineIdx].c_str()));
+			return true;
+		}
+
+		void store(AutotuneCache* cache, uint64_t adapterId, const Hash128& kernelKey, const Hash128& spaceKey, const AutotuneResult& result)
+		{
+			AutotuneWinner winner;
+			winner.entry.adapterId = adapterId;
+			winner.entry.kernelKey = kernelKey;
+			winner.entry.spaceKey = spaceKey;
+			winner.entry.duration = result.duration;
+			winner.entry.numDefines = result.defines.size();
+			winner.entry.reserved = 0;
+			for (uint32_t defineIdx = 0; defineIdx < result.defines.size(); ++defineIdx)
+				winner.defines.push_back(result.defines[defineIdx].c_str());
+
+			std::lock_guard<std::mutex> lock(cache->lock);
+			AutotuneWinner* previous = find_winner(cache, adapterId, kernelKey);
+			if (previous != nullptr)
+				*previous = winner;
+			else
+				cache->winners.push_back(winner);
+			cache->dirty = true;
+		}
+
+		uint32_t num_entries(AutotuneCache* cache)
+		{
+			std::lock_guard<std::mutex> lock(cache->lock);
+			return (uint32_t)cache->winners.size();
+		}
+	}
+}
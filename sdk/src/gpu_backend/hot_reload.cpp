@@ -0,0 +1,425 @@
+// Bento includes
+#include <bento_base/security.h>
+#include <bento_memory/common.h>
+
+// SDK includes
+#include "gpu_backend/hot_reload.h"
+
+// System includes
+#include <algorithm>
+#include <cctype>
+#include <condition_variable>
+#include <mutex>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+namespace graphics_sandbox
+{
+	struct ShaderDependency
+	{
+		uint64_t shader;
+		// Index in the file table
+		uint32_t file;
+	};
+
+	// Directory of a dependency, not null terminated
+	struct DirectoryName
+	{
+		const char* name;
+		uint32_t length;
+	};
+
+	struct RetiredFence
+	{
+		uint64_t object;
+		uint64_t fence;
+		uint64_t fenceValue;
+	};
+
+	struct HotReloader
+	{
+		ALLOCATOR_BASED;
+		HotReloader(bento::IAllocator& allocator)
+		: _allocator(allocator)
+		, compileFunction(nullptr)
+		, discardFunction(nullptr)
+		, userData(nullptr)
+		, files(allocator)
+		, dependencies(allocator)
+		, queue(allocator)
+		, compiling(0)
+		, ready(allocator)
+		, retired(allocator)
+		, pendingFences(allocator)
+		, stop(false)
+		{
+		}
+
+		HotReloadCompileFunction compileFunction;
+		HotReloadDiscardFunction discardFunction;
+		void* userData;
+
+		// Every normalized path a shader ever depended on, the dependencies refer to them by index sorted by shader then file
+		bento::Vector<bento::DynamicString> files;
+		bento::Vector<ShaderDependency> dependencies;
+
+		// Shaders waiting for the worker in order (each one at most once) and the one being compiled (0 if none)
+		bento::Vector<uint64_t> queue;
+		uint64_t compiling;
+
+		// Latest version compiled for every shader since the last collection
+		bento::Vector<HotReloadVersion> ready;
+
+		// Objects swapped out in order and the fences they are waiting for
+		bento::Vector<uint64_t> retired;
+		bento::Vector<RetiredFence> pendingFences;
+
+		std::thread worker;
+		bool stop;
+		std::mutex lock;
+		std::condition_variable workCondition;
+		std::condition_variable idleCondition;
+		bento::IAllocator& _allocator;
+	};
+
+	namespace hot_reload
+	{
+		std::string normalize_path(const char* path)
+		{
+			std::string input = path;
+			std::replace(input.begin(), input.end(), '\\', '/');
+#if defined(WINDOWSPC)
+			std::transform(input.begin(), input.end(), input.begin(), [](char c) { return (char)tolower((unsigned char)c); });
+#endif
+
+			// Keep the root ("/" or a drive letter) and resolve the components after it
+			bool absolute = input.size() > 0 && input[0] == '/';
+			std::vector<std::string> components;
+			size_t start = 0;
+			while (start <= input.size())
+			{
+				size_t end = input.find('/', start);
+				if (end == std::string::npos)
+					end = input.size();
+				std::string component = input.substr(start, end - start);
+				start = end + 1;
+				if (component.empty() || component == ".")
+					continue;
+				if (component == ".." && components.size() > 0 && components.back() != ".." && components.back().back() != ':')
+					components.pop_back();
+				else if (component != ".." || !absolute)
+					components.push_back(component);
+			}
+
+			std::string result = absolute ? "/" : "";
+			for (uint32_t componentIdx = 0; componentIdx < (uint32_t)components.size(); ++componentIdx)
+			{
+				if (componentIdx > 0)
+					result += "/";
+				result += components[componentIdx];
+			}
+			return result.empty() ? "." : result;
+		}
+
+		bool shader_less(const ShaderDependency& a, const ShaderDependency& b)
+		{
+			return a.shader != b.shader ? a.shader < b.shader : a.file < b.file;
+		}
+
+		uint32_t find_file(HotReloader* reloader, const char* path)
+		{
+			uint32_t numFiles = reloader->files.size();
+			for (uint32_t fileIdx = 0; fileIdx < numFiles; ++fileIdx)
+			{
+				if (strcmp(reloader->files[fileIdx].c_str(), path) == 0)
+					return fileIdx;
+			}
+			return numFiles;
+		}
+
+		HotReloadVersion* find_ready(HotReloader* reloader, uint64_t shader)
+		{
+			for (uint32_t versionIdx = 0; versionIdx < reloader->ready.size(); ++versionIdx)
+			{
+				if (reloader->ready[versionIdx].shader == shader)
+					return &reloader->ready[versionIdx];
+			}
+			return nullptr;
+		}
+
+		template<typename T>
+		void erase_at(bento::Vector<T>& vector, uint32_t index)
+		{
+			std::rotate(vector.begin() + index, vector.begin() + index + 1, vector.end());
+			vector.resize(vector.size() - 1);
+		}
+
+		void worker_loop(HotReloader* reloader)
+		{
+			std::unique_lock<std::mutex> lock(reloader->lock);
+			while (true)
+			{
+				reloader->workCondition.wait(lock, [&]() { return reloader->stop || reloader->queue.size() > 0; });
+				if (reloader->stop)
+					break;
+				uint64_t shader = reloader->queue[0];
+				erase_at(reloader->queue, 0);
+				reloader->compiling = shader;
+
+				// The shader can't be removed while it is being compiled, remove_shader waits for it
+				lock.unlock();
+				uint64_t version = reloader->compileFunction(shader, reloader->userData);
+				lock.lock();
+
+				// Only the latest version of a shader is worth swapping
+				uint64_t superseded = 0;
+				if (version != 0)
+				{
+					HotReloadVersion* ready = find_ready(reloader, shader);
+					if (ready != nullptr)
+					{
+						superseded = ready->version;
+						ready->version = version;
+					}
+					else
+					{
+						HotReloadVersion newVersion;
+						newVersion.shader = shader;
+						newVersion.version = version;
+						reloader->ready.push_back(newVersion);
+					}
+				}
+				reloader->compiling = 0;
+				reloader->idleCondition.notify_all();
+				if (superseded != 0)
+				{
+					lock.unlock();
+					reloader->discardFunction(superseded, reloader->userData);
+					lock.lock();
+				}
+			}
+		}
+
+		HotReloader* create_hot_reloader(bento::IAllocator& allocator, HotReloadCompileFunction compileFunction, HotReloadDiscardFunction discardFunction, void* userData)
+		{
+			HotReloader* reloader = bento::make_new<HotReloader>(allocator, allocator);
+			reloader->compileFunction = compileFunction;
+			reloader->discardFunction = discardFunction;
+			reloader->userData = userData;
+			reloader->worker = std::thread(worker_loop, reloader);
+			return reloader;
+		}
+
+		void destroy_hot_reloader(HotReloader* reloader)
+		{
+			{
+				std::lock_guard<std::mutex> lock(reloader->lock);
+				reloader->stop = true;
+			}
+			reloader->workCondition.notify_all();
+			reloader->worker.join();
+
+			assert_msg(reloader->retired.size() == 0, "Retired objects were not reclaimed.");
+			for (uint32_t versionIdx = 0; versionIdx < reloader->ready.size(); ++versionIdx)
+				reloader->discardFunction(reloader->ready[versionIdx].version, reloader->userData);
+			bento::make_delete<HotReloader>(reloader->_allocator, reloader);
+		}
+
+		void set_dependencies(HotReloader* reloader, uint64_t shader, const bento::Vector<bento::DynamicString>& files)
+		{
+			std::lock_guard<std::mutex> lock(reloader->lock);
+
+			// Drop the previous list, the files stay in the table for the next shaders that include them
+			bento::Vector<ShaderDependency>& dependencies = reloader->dependencies;
+			uint32_t numKept = 0;
+			for (uint32_t dependencyIdx = 0; dependencyIdx < dependencies.size(); ++dependencyIdx)
+			{
+				if (dependencies[dependencyIdx].shader != shader)
+					dependencies[numKept++] = dependencies[dependencyIdx];
+			}
+			dependencies.resize(numKept);
+
+			for (uint32_t fileIdx = 0; fileIdx < files.size(); ++fileIdx)
+			{
+				std::string normalized = normalize_path(files[fileIdx].c_str());
+				ShaderDependency dependency;
+				dependency.shader = shader;
+				dependency.file = find_file(reloader, normalized.c_str());
+				if (dependency.file == reloader->files.size())
+					reloader->files.push_back(bento::DynamicString(reloader->_allocator, normalized.c_str()));
+				dependencies.push_back(dependency);
+			}
+			std::sort(dependencies.begin(), dependencies.end(), shader_less);
+			ShaderDependency* end = std::unique(dependencies.begin(), dependencies.end(), [](const ShaderDependency& a, const ShaderDependency& b) { return a.shader == b.shader && a.file == b.file; });
+			dependencies.resize((uint32_t)(end - dependencies.begin()));
+		}
+
+		void remove_shader(HotReloader* reloader, uint64_t shader)
+		{
+			uint64_t pending = 0;
+			{
+				std::unique_lock<std::mutex> lock(reloader->lock);
+				reloader->idleCondition.wait(lock, [&]() { return reloader->compiling != shader; });
+				bento::Vector<ShaderDependency>& dependencies = reloader->dependencies;
+				uint32_t numKept = 0;
+				for (uint32_t dependencyIdx = 0; dependencyIdx < dependencies.size(); ++dependencyIdx)
+				{
+					if (dependencies[dependencyIdx].shader != shader)
+						dependencies[numKept++] = dependencies[dependencyIdx];
+				}
+				dependencies.resize(numKept);
+
+				uint64_t* queued = std::find(reloader->queue.begin(), reloader->queue.end(), shader);
+				if (queued != reloader->queue.end())
+					erase_at(reloader->queue, (uint32_t)(queued - reloader->queue.begin()));
+				HotReloadVersion* ready = find_ready(reloader, shader);
+				if (ready != nullptr)
+				{
+					pending = ready->version;
+					erase_at(reloader->ready, (uint32_t)(ready - reloader->ready.begin()));
+				}
+			}
+			if (pending != 0)
+				reloader->discardFunction(pending, reloader->userData);
+		}
+
+		void affected_shaders_internal(HotReloader* reloader, const bento::Vector<bento::DynamicString>& changedFiles, bento::Vector<uint64_t>& shaders)
+		{
+			uint32_t firstShader = shaders.size();
+			for (uint32_t fileIdx = 0; fileIdx < changedFiles.size(); ++fileIdx)
+			{
+				std::string normalized = normalize_path(changedFiles[fileIdx].c_str());
+				uint32_t file = find_file(reloader, normalized.c_str());
+				if (file == reloader->files.size())
+					continue;
+				for (uint32_t dependencyIdx = 0; dependencyIdx < reloader->dependencies.size(); ++dependencyIdx)
+				{
+					if (reloader->dependencies[dependencyIdx].file == file)
+						shaders.push_back(reloader->dependencies[dependencyIdx].shader);
+				}
+			}
+
+			// A shader is reported once even if several of its files changed
+			std::sort(shaders.begin() + firstShader, shaders.end());
+			uint64_t* end = std::unique(shaders.begin() + firstShader, shaders.end());
+			shaders.resize((uint32_t)(end - shaders.begin()));
+		}
+
+		void affected_shaders(HotReloader* reloader, const bento::Vector<bento::DynamicString>& changedFiles, bento::Vector<uint64_t>& shaders)
+		{
+			std::lock_guard<std::mutex> lock(reloader->lock);
+			affected_shaders_internal(reloader, changedFiles, shaders);
+		}
+
+		void watched_directories(HotReloader* reloader, bento::Vector<bento::DynamicString>& directories)
+		{
+			std::lock_guard<std::mutex> lock(reloader->lock);
+
+			// Only the files that are still a dependency are watched, the names point into the file table
+			bento::Vector<DirectoryName> names(reloader->_allocator);
+			for (uint32_t dependencyIdx = 0; dependencyIdx < reloader->dependencies.size(); ++dependencyIdx)
+			{
+				const char* file = reloader->files[reloader->dependencies[dependencyIdx].file].c_str();
+				const char* separator = strrchr(file, '/');
+				DirectoryName directory;
+				directory.name = separator == nullptr ? "." : file;
+				directory.length = separator == nullptr ? 1 : (separator == file ? 1 : (uint32_t)(separator - file));
+				names.push_back(directory);
+			}
+			auto name_less = [](const DirectoryName& a, const DirectoryName& b)
+			{
+				int order = memcmp(a.name, b.name, a.length < b.length ? a.length : b.length);
+				return order != 0 ? order < 0 : a.length < b.length;
+			};
+			std::sort(names.begin(), names.end(), name_less);
+			DirectoryName* end = std::unique(names.begin(), names.end(), [](const DirectoryName& a, const DirectoryName& b)
+				{ return a.length == b.length && memcmp(a.name, b.name, a.length) == 0; });
+
+			bento::Vector<char> name(reloader->_allocator);
+			for (DirectoryName* directory = names.begin(); directory != end; ++directory)
+			{
+				name.resize(directory->length + 1);
+				memcpy(&name[0], directory->name, directory->length);
+				name[directory->length] = '\0';
+				directories.push_back(bento::DynamicString(*bento::common_allocator(), &name[0]));
+			}
+		}
+
+		void notify_changes(HotReloader* reloader, const bento::Vector<bento::DynamicString>& changedFiles)
+		{
+			std::lock_guard<std::mutex> lock(reloader->lock);
+			bento::Vector<uint64_t> affected(reloader->_allocator);
+			affected_shaders_internal(reloader, changedFiles, affected);
+			for (uint32_t shaderIdx = 0; shaderIdx < affected.size(); ++shaderIdx)
+			{
+				// A shader that is already waiting will see the latest content anyway
+				if (std::find(reloader->queue.begin(), reloader->queue.end(), affected[shaderIdx]) == reloader->queue.end())
+					reloader->queue.push_back(affected[shaderIdx]);
+			}
+			if (affected.size() > 0)
+				reloader->workCondition.notify_one();
+		}
+
+		void wait_idle(HotReloader* reloader)
+		{
+			std::unique_lock<std::mutex> lock(reloader->lock);
+			reloader->idleCondition.wait(lock, [&]() { return reloader->queue.size() == 0 && reloader->compiling == 0; });
+		}
+
+		void collect_ready(HotReloader* reloader, bento::Vector<HotReloadVersion>& versions)
+		{
+			std::lock_guard<std::mutex> lock(reloader->lock);
+			std::sort(reloader->ready.begin(), reloader->ready.end(), [](const HotReloadVersion& a, const HotReloadVersion& b) { return a.shader < b.shader; });
+			for (uint32_t versionIdx = 0; versionIdx < reloader->ready.size(); ++versionIdx)
+				versions.push_back(reloader->ready[versionIdx]);
+			reloader->ready.clear();
+		}
+
+		void retire(HotReloader* reloader, uint64_t object, const uint64_t* fences, const uint64_t* fenceValues, uint32_t numFences)
+		{
+			std::lock_guard<std::mutex> lock(reloader->lock);
+			reloader->retired.push_back(object);
+			for (uint32_t fenceIdx = 0; fenceIdx < numFences; ++fenceIdx)
+			{
+				RetiredFence fence;
+				fence.object = object;
+				fence.fence = fences[fenceIdx];
+				fence.fenceValue = fenceValues[fenceIdx];
+				reloader->pendingFences.push_back(fence);
+			}
+		}
+
+		void reclaim(HotReloader* reloader, uint64_t fence, uint64_t completedValue, bento::Vector<uint64_t>& released)
+		{
+			std::lock_guard<std::mutex> lock(reloader->lock);
+			bento::Vector<RetiredFence>& pending = reloader->pendingFences;
+			uint32_t numPending = 0;
+			for (uint32_t fenceIdx = 0; fenceIdx < pending.size(); ++fenceIdx)
+			{
+				if (pending[fenceIdx].fence != fence || pending[fenceIdx].fenceValue > completedValue)
+					pending[numPending++] = pending[fenceIdx];
+			}
+			pending.resize(numPending);
+
+			// Objects retired without fences are released on the first reclaim
+			uint32_t numKept = 0;
+			for (uint32_t objectIdx = 0; objectIdx < reloader->retired.size(); ++objectIdx)
+			{
+				uint64_t object = reloader->retired[objectIdx];
+				bool waiting = std::find_if(pending.begin(), pending.end(), [&](const RetiredFence& retiredFence) { return retiredFence.object == object; }) != pending.end();
+				if (waiting)
+					reloader->retired[numKept++] = object;
+				else
+					released.push_back(object);
+			}
+			reloader->retired.resize(numKept);
+		}
+
+		uint32_t num_retired(HotReloader* reloader)
+		{
+			std::lock_guard<std::mutex> lock(reloader->lock);
+			return (uint32_t)reloader->retired.size();
+		}
+	}
+}
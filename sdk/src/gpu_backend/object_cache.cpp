@@ -0,0 +1,155 @@
+// Bento includes
+#include <bento_base/security.h>
+#include <bento_collection/vector.h>
+
+// SDK includes
+#include "gpu_backend/object_cache.h"
+
+// System includes
+#include <algorithm>
+#include <mutex>
+
+namespace graphics_sandbox
+{
+	struct ObjectCacheEntry
+	{
+		Hash128 key;
+		uint64_t object;
+		uint32_t refCount;
+	};
+
+	struct ObjectCache
+	{
+		ALLOCATOR_BASED;
+		ObjectCache(bento::IAllocator& allocator)
+		: _allocator(allocator)
+		, entries(allocator)
+		{
+			stats.hits = 0;
+			stats.misses = 0;
+		}
+
+		// Sorted by key, the caches hold a few hundred objects at most and are only touched when shaders are created or destroyed
+		bento::Vector<ObjectCacheEntry> entries;
+		ObjectCacheStats stats;
+		std::mutex lock;
+		bento::IAllocator& _allocator;
+	};
+
+	namespace object_cache
+	{
+		ObjectCache* create_cache(bento::IAllocator& allocator)
+		{
+			return bento::make_new<ObjectCache>(allocator, allocator);
+		}
+
+		void destroy_cache(ObjectCache* cache)
+		{
+			assert_msg(cache->entries.size() == 0, "Cached objects are still in use.");
+			bento::make_delete<ObjectCache>(cache->_allocator, cache);
+		}
+
+		ObjectCacheEntry* find_entry(ObjectCache* cache, const Hash128& key)
+		{
+			return std::lower_bound(cache->entries.begin(), cache->entries.end(), key, [](const ObjectCacheEntry& e, const Hash128& k) { return hash::less(e.key, k); });
+		}
+
+		bool acquire(ObjectCache* cache, const Hash128& key, uint64_t& object)
+		{
+			std::lock_guard<std::mutex> lock(cache->lock);
+			ObjectCacheEntry* entry = find_entry(cache, key);
+			if (entry == cache->entries.end() || !hash::equal(entry->key, key))
+			{
+				cache->stats.misses++;
+				return false;
+			}
+			cache->stats.hits++;
+			entry->refCount++;
+			object = entry->object;
+			return true;
+		}
+
+		uint64_t insert(ObjectCache* cache, const Hash128& key, uint64_t object)
+		{
+			std::lock_guard<std::mutex> lock(cache->lock);
+			uint32_t entryIdx = (uint32_t)(find_entry(cache, key) - cache->entries.begin());
+			if (entryIdx == cache->entries.size() || !hash::equal(cache->entries[entryIdx].key, key))
+			{
+				// Shift the following entries to keep the keys sorted
+				ObjectCacheEntry newEntry;
+				newEntry.key = key;
+				newEntry.object = object;
+				newEntry.refCount = 0;
+				cache->entries.push_back(newEntry);
+				std::rotate(cache->entries.begin() + entryIdx, cache->entries.end() - 1, cache->entries.end());
+			}
+			ObjectCacheEntry& entry = cache->entries[entryIdx];
+			entry.refCount++;
+			return entry.object;
+		}
+
+		bool release(ObjectCache* cache, const Hash128& key, uint64_t& object)
+		{
+			std::lock_guard<std::mutex> lock(cache->lock);
+			ObjectCacheEntry* entry = find_entry(cache, key);
+			assert_msg(entry != cache->entries.end() && hash::equal(entry->key, key), "Releasing an unknown object.");
+			object = entry->object;
+			if (--entry->refCount > 0)
+				return false;
+			std::rotate(entry, entry + 1, cache->entries.end());
+			cache->entries.resize(cache->entries.size() - 1);
+			return true;
+		}
+
+		uint32_t size(ObjectCache* cache)
+		{
+			std::lock_guard<std::mutex> lock(cache->lock);
+			return (uint32_t)cache->entries.size();
+		}
+
+		uint32_t ref_count(ObjectCache* cache, const Hash128& key)
+		{
+			std::lock_guard<std::mutex> lock(cache->lock);
+			ObjectCacheEntry* entry = find_entry(cache, key);
+			return entry != cache->entries.end() && hash::equal(entry->key, key) ? entry->refCount : 0;
+		}
+
+		ObjectCacheStats get_stats(ObjectCache* cache)
+		{
+			std::lock_guard<std::mutex> lock(cache->lock);
+			return cache->stats;
+		}
+
+		void root_signature_key(const ComputeShaderDescriptor& layout, Hash128& key)
+		{
+			hash::begin(key);
+			hash::append_uint64(key, layout.bindless);
+
+			// A bindless root signature only sees the total number of slots through the size of the index constants
+			if (layout.bindless)
+				hash::append_uint64(key, layout.srvCount + layout.uavCount + layout.cbvCount);
+			else
+			{
+				hash::append_uint64(key, layout.srvCount);
+				hash::append_uint64(key, layout.uavCount);
+				hash::append_uint64(key, layout.cbvCount);
+			}
+
+			// The range count is hashed so that the sizes can't be confused with the root CBV count
+			uint32_t numRanges = layout.rootConstantSizes.size();
+			hash::append_uint64(key, numRanges);
+			for (uint32_t rangeIdx = 0; rangeIdx < numRanges; ++rangeIdx)
+				hash::append_uint64(key, layout.rootConstantSizes[rangeIdx]);
+			hash::append_uint64(key, layout.rootCbvCount);
+		}
+
+		void pipeline_key(const void* bytecode, uint64_t bytecodeSize, const Hash128& rootSignatureKey, Hash128& key)
+		{
+			hash::begin(key);
+			hash::append_uint64(key, rootSignatureKey.low);
+			hash::append_uint64(key, rootSignatureKey.high);
+			hash::append_uint64(key, bytecodeSize);
+			hash::append(key, bytecode, bytecodeSize);
+		}
+	}
+}
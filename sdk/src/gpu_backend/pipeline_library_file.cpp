@@ -0,0 +1,87 @@
+// Bento includes
+#include <bento_base/security.h>
+
+// SDK includes
+#include "gpu_backend/pipeline_library_file.h"
+
+// System includes
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+namespace graphics_sandbox
+{
+	namespace pipeline_library_file
+	{
+		void hash_payload(const void* payload, uint64_t payloadSize, Hash128& payloadHash)
+		{
+			hash::begin(payloadHash);
+			hash::append(payloadHash, payload, payloadSize);
+		}
+
+		PipelineLibraryStatus validate(const char* data, uint64_t size, const PipelineLibraryIdentity& identity, const char*& payload, uint64_t& payloadSize)
+		{
+			if (size < sizeof(PipelineLibraryHeader))
+				return PipelineLibraryStatus::Corrupted;
+			PipelineLibraryHeader header;
+			memcpy(&header, data, sizeof(PipelineLibraryHeader));
+			if (header.magic != PIPELINE_LIBRARY_MAGIC)
+				return PipelineLibraryStatus::Corrupted;
+			if (header.version != PIPELINE_LIBRARY_VERSION)
+				return PipelineLibraryStatus::VersionMismatch;
+
+			// A different adapter or driver can't use the pipelines at all, the library has to be rebuilt
+			const PipelineLibraryIdentity& stored = header.identity;
+			if (stored.vendorId != identity.vendorId || stored.deviceId != identity.deviceId || stored.subSysId != identity.subSysId || stored.revision != identity.revision)
+				return PipelineLibraryStatus::AdapterMismatch;
+			if (stored.driverVersion != identity.driverVersion)
+				return PipelineLibraryStatus::DriverMismatch;
+
+			if (header.payloadOffset < sizeof(PipelineLibraryHeader) || header.payloadOffset > size || header.payloadSize != size - header.payloadOffset)
+				return PipelineLibraryStatus::Corrupted;
+
+			// The driver is not expected to cope with a damaged blob
+			Hash128 payloadHash;
+			hash_payload(data + header.payloadOffset, header.payloadSize, payloadHash);
+			if (!hash::equal(payloadHash, header.payloadHash))
+				return PipelineLibraryStatus::Corrupted;
+
+			payload = data + header.payloadOffset;
+			payloadSize = header.payloadSize;
+			return PipelineLibraryStatus::Valid;
+		}
+
+		bool write_file(const char* path, const PipelineLibraryHeader& header, const void* payload)
+		{
+			FILE* file = fopen(path, "wb");
+			if (file == nullptr)
+				return false;
+			static const char padding[PIPELINE_LIBRARY_PAYLOAD_ALIGNMENT] = {};
+			bool success = fwrite(&header, sizeof(PipelineLibraryHeader), 1, file) == 1;
+			success = success && fwrite(padding, 1, header.payloadOffset - sizeof(PipelineLibraryHeader), file) == header.payloadOffset - sizeof(PipelineLibraryHeader);
+			success = success && (header.payloadSize == 0 || fwrite(payload, header.payloadSize, 1, file) == 1);
+			return fclose(file) == 0 && success;
+		}
+
+		bool write(const char* path, const PipelineLibraryIdentity& identity, const void* payload, uint64_t payloadSize)
+		{
+			PipelineLibraryHeader header;
+			memset(&header, 0, sizeof(PipelineLibraryHeader));
+			header.magic = PIPELINE_LIBRARY_MAGIC;
+			header.version = PIPELINE_LIBRARY_VERSION;
+			header.identity = identity;
+			header.payloadOffset = (sizeof(PipelineLibraryHeader) + PIPELINE_LIBRARY_PAYLOAD_ALIGNMENT - 1) / PIPELINE_LIBRARY_PAYLOAD_ALIGNMENT * PIPELINE_LIBRARY_PAYLOAD_ALIGNMENT;
+			header.payloadSize = payloadSize;
+			hash_payload(payload, payloadSize, header.payloadHash);
+
+			std::string tempPath = std::string(path) + ".tmp";
+			if (!write_file(tempPath.c_str(), header, payload))
+			{
+				remove(tempPath.c_str());
+				return false;
+			}
+			remove(path);
+			return rename(tempPath.c_str(), path) == 0;
+		}
+	}
+}
@@ -0,0 +1,183 @@
+// Bento includes
+#include <bento_base/security.h>
+
+// SDK includes
+#include "gpu_backend/readback_ring.h"
+
+namespace graphics_sandbox
+{
+	ReadbackRing::ReadbackRing(bento::IAllocator& allocator)
+	: _allocator(allocator)
+	, space(allocator)
+	, tickets(allocator)
+	, firstTicket(1)
+	, firstLive(0)
+	, nextTicket(1)
+	, completedPoint(0)
+	, requests(0)
+	, failedRequests(0)
+	{
+	}
+
+	namespace readback_ring
+	{
+		void initialize(ReadbackRing& ring, uint64_t capacity)
+		{
+			upload_ring::initialize(ring.space, capacity);
+			ring.tickets.clear();
+			ring.firstTicket = 1;
+			ring.firstLive = 0;
+			ring.nextTicket = 1;
+			ring.completedPoint = 0;
+		}
+
+		bool find(const ReadbackRing& ring, uint64_t ticket, uint32_t& ticketIdx)
+		{
+			if (ticket < ring.firstTicket + ring.firstLive || ticket >= ring.nextTicket)
+				return false;
+			ticketIdx = (uint32_t)(ticket - ring.firstTicket);
+			return !ring.tickets[ticketIdx].released;
+		}
+
+		void reclaim(ReadbackRing& ring)
+		{
+			// The oldest tickets that are both released and complete give their space back
+			uint32_t numTickets = ring.tickets.size();
+			uint32_t firstLive = ring.firstLive;
+			while (firstLive < numTickets)
+			{
+				const ReadbackTicketState& state = ring.tickets[firstLive];
+				if (!state.released || state.point > ring.completedPoint)
+					break;
+				firstLive++;
+			}
+			if (firstLive == ring.firstLive)
+				return;
+			upload_ring::reclaim(ring.space, ring.firstTicket + firstLive - 1);
+			ring.firstLive = firstLive;
+
+			// Compact the ticket list once the dead part dominates
+			if (ring.firstLive * 2 >= numTickets)
+			{
+				uint32_t numLive = numTickets - ring.firstLive;
+				for (uint32_t ticketIdx = 0; ticketIdx < numLive; ++ticketIdx)
+					ring.tickets[ticketIdx] = ring.tickets[ring.firstLive + ticketIdx];
+				ring.tickets.resize(numLive);
+				ring.firstTicket += ring.firstLive;
+				ring.firstLive = 0;
+			}
+		}
+
+		uint64_t allocate(ReadbackRing& ring, uint64_t size, uint64_t alignment, uint64_t owner, ReadbackCallback callback, void* userData, uint64_t& offset)
+		{
+			ring.requests++;
+			if (!upload_ring::allocate(ring.space, size, alignment, offset))
+			{
+				ring.failedRequests++;
+				return 0;
+			}
+			uint64_t ticket = ring.nextTicket++;
+			upload_ring::end_frame(ring.space, ticket);
+
+			ReadbackTicketState state;
+			state.offset = offset;
+			state.size = size;
+			state.owner = owner;
+			state.point = UINT64_MAX;
+			state.callback = callback;
+			state.userData = userData;
+			state.mapped = false;
+			state.released = false;
+			ring.tickets.push_back(state);
+			return ticket;
+		}
+
+		uint32_t submit(ReadbackRing& ring, uint64_t owner, uint64_t point)
+		{
+			uint32_t numCallbacks = 0;
+			for (uint32_t ticketIdx = ring.firstLive; ticketIdx < ring.tickets.size(); ++ticketIdx)
+			{
+				ReadbackTicketState& state = ring.tickets[ticketIdx];
+				if (state.owner == owner && state.point == UINT64_MAX)
+				{
+					state.point = point;
+					if (state.callback != nullptr && !state.released)
+						numCallbacks++;
+				}
+			}
+			return numCallbacks;
+		}
+
+		void cancel(ReadbackRing& ring, uint64_t owner)
+		{
+			// The copies will never run, the tickets are released and complete right away so that the oldest ones don't block the ring
+			for (uint32_t ticketIdx = ring.firstLive; ticketIdx < ring.tickets.size(); ++ticketIdx)
+			{
+				ReadbackTicketState& state = ring.tickets[ticketIdx];
+				if (state.owner == owner && state.point == UINT64_MAX)
+				{
+					state.point = 0;
+					state.released = true;
+				}
+			}
+			reclaim(ring);
+		}
+
+		void signal(ReadbackRing& ring, uint64_t completedPoint)
+		{
+			if (completedPoint <= ring.completedPoint)
+				return;
+			ring.completedPoint = completedPoint;
+			reclaim(ring);
+		}
+
+		ReadbackStatus status(const ReadbackRing& ring, uint64_t ticket)
+		{
+			uint32_t ticketIdx;
+			if (!find(ring, ticket, ticketIdx))
+				return ReadbackStatus::Invalid;
+			uint64_t point = ring.tickets[ticketIdx].point;
+			if (point == UINT64_MAX)
+				return ReadbackStatus::Recorded;
+			return point <= ring.completedPoint ? ReadbackStatus::Ready : ReadbackStatus::InFlight;
+		}
+
+		bool get(ReadbackRing& ring, uint64_t ticket, ReadbackTicketState*& state)
+		{
+			uint32_t ticketIdx;
+			if (!find(ring, ticket, ticketIdx))
+				return false;
+			state = &ring.tickets[ticketIdx];
+			return true;
+		}
+
+		void tickets_with_callback(const ReadbackRing& ring, uint64_t point, bento::Vector<uint64_t>& tickets)
+		{
+			tickets.clear();
+			for (uint32_t ticketIdx = ring.firstLive; ticketIdx < ring.tickets.size(); ++ticketIdx)
+			{
+				const ReadbackTicketState& state = ring.tickets[ticketIdx];
+				if (state.point == point && state.callback != nullptr && !state.released)
+					tickets.push_back(ring.firstTicket + ticketIdx);
+			}
+		}
+
+		bool release(ReadbackRing& ring, uint64_t ticket)
+		{
+			uint32_t ticketIdx;
+			if (!find(ring, ticket, ticketIdx))
+				return false;
+			ring.tickets[ticketIdx].released = true;
+			reclaim(ring);
+			return true;
+		}
+
+		uint32_t num_live(const ReadbackRing& ring)
+		{
+			uint32_t numLive = 0;
+			for (uint32_t ticketIdx = ring.firstLive; ticketIdx < ring.tickets.size(); ++ticketIdx)
+				numLive += ring.tickets[ticketIdx].released ? 0 : 1;
+			return numLive;
+		}
+	}
+}
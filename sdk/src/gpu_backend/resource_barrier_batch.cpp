@@ -0,0 +1,96 @@
+// SDK includes
+#include "gpu_backend/resource_barrier_batch.h"
+
+namespace graphics_sandbox
+{
+	ResourceBarrierBatch::ResourceBarrierBatch(bento::IAllocator& allocator)
+	: _allocator(allocator)
+	, barriers(allocator)
+	, requestedBarriers(0)
+	, emittedBarriers(0)
+	, flushes(0)
+	{
+	}
+
+	namespace resource_barrier_batch
+	{
+		// The pending list rarely goes over a handful of entries, a linear search is the fastest option
+		ResourceBarrier* find_pending(ResourceBarrierBatch& batch, ResourceBarrierType type, uint64_t resource)
+		{
+			uint32_t numBarriers = batch.barriers.size();
+			for (uint32_t barrierIdx = 0; barrierIdx < numBarriers; ++barrierIdx)
+			{
+				ResourceBarrier& barrier = batch.barriers[barrierIdx];
+				if (barrier.type == type && barrier.resource == resource)
+					return &barrier;
+			}
+			return nullptr;
+		}
+
+		void request_transition(ResourceBarrierBatch& batch, uint64_t resource, uint32_t stateBefore, uint32_t stateAfter)
+		{
+			batch.requestedBarriers++;
+
+			// No GPU work can happen between two requests of the same batch, so the intermediate state can be skipped.
+			// If the transition cancels out, it stays in the list as a no-op so that a later request can reuse it.
+			ResourceBarrier* pending = find_pending(batch, ResourceBarrierType::Transition, resource);
+			if (pending != nullptr)
+			{
+				pending->stateAfter = stateAfter;
+				return;
+			}
+
+			ResourceBarrier barrier;
+			barrier.type = ResourceBarrierType::Transition;
+			barrier.resource = resource;
+			barrier.stateBefore = stateBefore;
+			barrier.stateAfter = stateAfter;
+			batch.barriers.push_back(barrier);
+		}
+
+		void request_uav_barrier(ResourceBarrierBatch& batch, uint64_t resource)
+		{
+			batch.requestedBarriers++;
+			if (find_pending(batch, ResourceBarrierType::UAV, resource) != nullptr)
+				return;
+
+			ResourceBarrier barrier;
+			barrier.type = ResourceBarrierType::UAV;
+			barrier.resource = resource;
+			barrier.stateBefore = 0;
+			barrier.stateAfter = 0;
+			batch.barriers.push_back(barrier);
+		}
+
+		uint32_t compact(ResourceBarrierBatch& batch)
+		{
+			// Remove the no-op transitions while preserving the order of the others
+			uint32_t numBarriers = batch.barriers.size();
+			uint32_t numKept = 0;
+			for (uint32_t barrierIdx = 0; barrierIdx < numBarriers; ++barrierIdx)
+			{
+				const ResourceBarrier& barrier = batch.barriers[barrierIdx];
+				if (barrier.type == ResourceBarrierType::Transition && barrier.stateBefore == barrier.stateAfter)
+					continue;
+				batch.barriers[numKept++] = barrier;
+			}
+			batch.barriers.resize(numKept);
+			return numKept;
+		}
+
+		void reset(ResourceBarrierBatch& batch)
+		{
+			if (batch.barriers.size() > 0)
+			{
+				batch.emittedBarriers += batch.barriers.size();
+				batch.flushes++;
+			}
+			batch.barriers.clear();
+		}
+
+		void discard(ResourceBarrierBatch& batch)
+		{
+			batch.barriers.clear();
+		}
+	}
+}
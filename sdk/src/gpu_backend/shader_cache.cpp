@@ -0,0 +1,444 @@
+// Bento includes
+#include <bento_base/security.h>
+#include <bento_memory/common.h>
+
+// SDK includes
+#include "gpu_backend/shader_cache.h"
+#include "tools/mapped_file.h"
+
+// System includes
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+namespace graphics_sandbox
+{
+	// Blob stored since the pack was loaded
+	struct ShaderCacheBlob
+	{
+		Hash128 key;
+		char* data;
+		uint64_t size;
+	};
+
+	struct ShaderCache
+	{
+		ALLOCATOR_BASED;
+		ShaderCache(bento::IAllocator& allocator)
+		: _allocator(allocator)
+		, path(allocator)
+		, pack(nullptr)
+		, entries(nullptr)
+		, numEntries(0)
+		, added(allocator)
+		, dirty(false)
+		{
+			memset(&stats, 0, sizeof(stats));
+		}
+
+		bento::DynamicString path;
+
+		// Mapping of the pack file, the entries and their blobs are read from it directly
+		MappedFile* pack;
+		const ShaderCacheEntry* entries;
+		uint32_t numEntries;
+
+		// Blobs that are not in the pack yet
+		bento::Vector<ShaderCacheBlob> added;
+		bool dirty;
+
+		ShaderCacheStats stats;
+		std::mutex lock;
+		bento::IAllocator& _allocator;
+	};
+
+	namespace shader_cache
+	{
+		typedef std::chrono::steady_clock Clock;
+
+		uint64_t elapsed_ns(Clock::time_point start)
+		{
+			return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+		}
+
+		bool read_file(const char* path, std::string& content)
+		{
+			FILE* file = fopen(path, "rb");
+			if (file == nullptr)
+				return false;
+			fseek(file, 0, SEEK_END);
+			long size = ftell(file);
+			fseek(file, 0, SEEK_SET);
+			content.resize(size > 0 ? (size_t)size : 0);
+			bool success = size >= 0 && fread(&content[0], 1, content.size(), file) == content.size();
+			fclose(file);
+			return success;
+		}
+
+		bool validate_pack(const char* pack, uint64_t packSize)
+		{
+			if (packSize < sizeof(ShaderCacheHeader))
+				return false;
+			const ShaderCacheHeader* header = (const ShaderCacheHeader*)pack;
+			if (header->magic != SHADER_CACHE_MAGIC || header->version != SHADER_CACHE_VERSION || header->fileSize != packSize)
+				return false;
+
+			// Every blob must be inside the file and the keys must be sorted for the binary search
+			uint64_t blobsStart = sizeof(ShaderCacheHeader) + (uint64_t)header->numEntries * sizeof(ShaderCacheEntry);
+			if (blobsStart > packSize)
+				return false;
+			const ShaderCacheEntry* entries = (const ShaderCacheEntry*)(pack + sizeof(ShaderCacheHeader));
+			for (uint32_t entryIdx = 0; entryIdx < header->numEntries; ++entryIdx)
+			{
+				const ShaderCacheEntry& entry = entries[entryIdx];
+				if (entry.offset < blobsStart || entry.offset > packSize || entry.size > packSize - entry.offset)
+					return false;
+				if (entryIdx > 0 && !hash::less(entries[entryIdx - 1].key, entry.key))
+					return false;
+			}
+			return true;
+		}
+
+		bool load_pack(ShaderCache* cache)
+		{
+			// The mapping is page aligned, so are the blobs
+			MappedFile* pack = mapped_file::open(cache->_allocator, cache->path.c_str());
+			if (pack == nullptr)
+				return false;
+			const char* packData = mapped_file::data(pack);
+			if (!validate_pack(packData, mapped_file::size(pack)))
+			{
+				mapped_file::close(pack);
+				return false;
+			}
+			cache->pack = pack;
+			cache->entries = (const ShaderCacheEntry*)(packData + sizeof(ShaderCacheHeader));
+			cache->numEntries = ((const ShaderCacheHeader*)packData)->numEntries;
+			return true;
+		}
+
+		void release_pack(ShaderCache* cache)
+		{
+			if (cache->pack == nullptr)
+				return;
+			mapped_file::close(cache->pack);
+			cache->pack = nullptr;
+			cache->entries = nullptr;
+			cache->numEntries = 0;
+		}
+
+		void release_added(ShaderCache* cache)
+		{
+			for (uint32_t blobIdx = 0; blobIdx < (uint32_t)cache->added.size(); ++blobIdx)
+				cache->_allocator.deallocate(cache->added[blobIdx].data);
+			cache->added.clear();
+		}
+
+		ShaderCache* create_cache(bento::IAllocator& allocator, const char* path)
+		{
+			ShaderCache* cache = bento::make_new<ShaderCache>(allocator, allocator);
+			cache->path = path;
+			load_pack(cache);
+			return cache;
+		}
+
+		void destroy_cache(ShaderCache* cache)
+		{
+			save(cache);
+			release_added(cache);
+			release_pack(cache);
+			bento::make_delete<ShaderCache>(cache->_allocator, cache);
+		}
+
+		bool write_pack(const char* path, bento::Vector<ShaderCacheEntry>& entries, bento::Vector<const char*>& blobs)
+		{
+			FILE* file = fopen(path, "wb");
+			if (file == nullptr)
+				return false;
+
+			// Place the blobs after the entry table
+			uint64_t offset = sizeof(ShaderCacheHeader) + (uint64_t)entries.size() * sizeof(ShaderCacheEntry);
+			for (uint32_t entryIdx = 0; entryIdx < (uint32_t)entries.size(); ++entryIdx)
+			{
+				offset = (offset + SHADER_CACHE_BLOB_ALIGNMENT - 1) / SHADER_CACHE_BLOB_ALIGNMENT * SHADER_CACHE_BLOB_ALIGNMENT;
+				entries[entryIdx].offset = offset;
+				offset += entries[entryIdx].size;
+			}
+
+			ShaderCacheHeader header;
+			header.magic = SHADER_CACHE_MAGIC;
+			header.version = SHADER_CACHE_VERSION;
+			header.numEntries = (uint32_t)entries.size();
+			header.reserved = 0;
+			header.fileSize = offset;
+			bool success = fwrite(&header, sizeof(header), 1, file) == 1;
+			if (entries.size() > 0)
+				success &= fwrite(&entries[0], sizeof(ShaderCacheEntry), entries.size(), file) == entries.size();
+
+			const char padding[SHADER_CACHE_BLOB_ALIGNMENT] = {};
+			uint64_t position = sizeof(ShaderCacheHeader) + (uint64_t)entries.size() * sizeof(ShaderCacheEntry);
+			for (uint32_t entryIdx = 0; entryIdx < (uint32_t)entries.size() && success; ++entryIdx)
+			{
+				const ShaderCacheEntry& entry = entries[entryIdx];
+				success &= fwrite(padding, 1, (size_t)(entry.offset - position), file) == entry.offset - position;
+				success &= fwrite(blobs[entryIdx], 1, (size_t)entry.size, file) == entry.size;
+				position = entry.offset + entry.size;
+			}
+			success &= fclose(file) == 0;
+			return success;
+		}
+
+		bool save(ShaderCache* cache)
+		{
+			std::lock_guard<std::mutex> lock(cache->lock);
+			if (!cache->dirty)
+				return true;
+
+			// Merge the pack and the new blobs, sorted by key
+			bento::IAllocator& allocator = cache->_allocator;
+			uint32_t numBlobs = cache->numEntries + (uint32_t)cache->added.size();
+			bento::Vector<uint32_t> order(allocator);
+			order.resize(numBlobs);
+			for (uint32_t blobIdx = 0; blobIdx < numBlobs; ++blobIdx)
+				order[blobIdx] = blobIdx;
+			auto key_of = [&](uint32_t blobIdx) -> const Hash128& { return blobIdx < cache->numEntries ? cache->entries[blobIdx].key : cache->added[blobIdx - cache->numEntries].key; };
+			std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return hash::less(key_of(a), key_of(b)); });
+
+			const char* packData = cache->pack != nullptr ? mapped_file::data(cache->pack) : nullptr;
+			bento::Vector<ShaderCacheEntry> entries(allocator);
+			bento::Vector<const char*> blobs(allocator);
+			entries.resize(numBlobs);
+			blobs.resize(numBlobs);
+			for (uint32_t entryIdx = 0; entryIdx < numBlobs; ++entryIdx)
+			{
+				uint32_t blobIdx = order[entryIdx];
+				entries[entryIdx].key = key_of(blobIdx);
+				if (blobIdx < cache->numEntries)
+				{
+					entries[entryIdx].size = cache->entries[blobIdx].size;
+					blobs[entryIdx] = packData + cache->entries[blobIdx].offset;
+				}
+				else
+				{
+					entries[entryIdx].size = cache->added[blobIdx - cache->numEntries].size;
+					blobs[entryIdx] = cache->added[blobIdx - cache->numEntries].data;
+				}
+			}
+
+			// Write next to the pack and swap, a crash never leaves a truncated pack behind
+			uint32_t pathLength = (uint32_t)strlen(cache->path.c_str());
+			bento::Vector<char> tempPath(allocator);
+			tempPath.resize(pathLength + 5);
+			memcpy(&tempPath[0], cache->path.c_str(), pathLength);
+			memcpy(&tempPath[pathLength], ".tmp", 5);
+			if (!write_pack(&tempPath[0], entries, blobs))
+			{
+				remove(&tempPath[0]);
+				return false;
+			}
+
+			// The mapped pack can't be replaced while it is open, the new one holds every blob and is mapped instead
+			release_pack(cache);
+			remove(cache->path.c_str());
+			bool replaced = rename(&tempPath[0], cache->path.c_str()) == 0;
+			if (!load_pack(cache) || !replaced)
+				return false;
+			release_added(cache);
+			cache->dirty = false;
+			return true;
+		}
+
+		// Dependencies
+
+		std::string directory_of(const std::string& path)
+		{
+			size_t separator = path.find_last_of("/\\");
+			return separator == std::string::npos ? std::string() : path.substr(0, separator + 1);
+		}
+
+		std::string join_path(const std::string& directory, const std::string& file)
+		{
+			if (directory.empty() || directory.back() == '/' || directory.back() == '\\')
+				return directory + file;
+			return directory + "/" + file;
+		}
+
+		bool file_exists(const std::string& path)
+		{
+			FILE* file = fopen(path.c_str(), "rb");
+			if (file != nullptr)
+				fclose(file);
+			return file != nullptr;
+		}
+
+		// Extracts the targets of the #include directives, quoted is true for "file" and false for <file>
+		void parse_includes(const std::string& source, std::vector<std::pair<std::string, bool>>& includes)
+		{
+			size_t lineStart = 0;
+			while (lineStart < source.size())
+			{
+				size_t lineEnd = source.find('\n', lineStart);
+				if (lineEnd == std::string::npos)
+					lineEnd = source.size();
+
+				size_t cursor = source.find_first_not_of(" \t", lineStart);
+				if (cursor < lineEnd && source[cursor] == '#')
+				{
+					cursor = source.find_first_not_of(" \t", cursor + 1);
+					if (cursor < lineEnd && source.compare(cursor, 7, "include") == 0)
+					{
+						cursor = source.find_first_not_of(" \t", cursor + 7);
+						if (cursor < lineEnd && (source[cursor] == '"' || source[cursor] == '<'))
+						{
+							char closing = source[cursor] == '"' ? '"' : '>';
+							size_t nameEnd = source.find(closing, cursor + 1);
+							if (nameEnd < lineEnd)
+								includes.push_back(std::make_pair(source.substr(cursor + 1, nameEnd - cursor - 1), closing == '"'));
+						}
+					}
+				}
+				lineStart = lineEnd + 1;
+			}
+		}
+
+		void visit(const std::string& path, const bento::Vector<bento::DynamicString>& includeDirectories, std::vector<std::string>& files)
+		{
+			if (std::find(files.begin(), files.end(), path) != files.end())
+				return;
+			std::string source;
+			if (!read_file(path.c_str(), source))
+				return;
+			files.push_back(path);
+
+			std::vector<std::pair<std::string, bool>> includes;
+			parse_includes(source, includes);
+			for (uint32_t includeIdx = 0; includeIdx < (uint32_t)includes.size(); ++includeIdx)
+			{
+				const std::string& name = includes[includeIdx].first;
+				std::string resolved;
+				if (includes[includeIdx].second && file_exists(join_path(directory_of(path), name)))
+					resolved = join_path(directory_of(path), name);
+				for (uint32_t dirIdx = 0; dirIdx < includeDirectories.size() && resolved.empty(); ++dirIdx)
+				{
+					std::string candidate = join_path(includeDirectories[dirIdx].c_str(), name);
+					if (file_exists(candidate))
+						resolved = candidate;
+				}
+
+				// Unresolved includes make the compilation fail, nothing would be stored
+				if (!resolved.empty())
+					visit(resolved, includeDirectories, files);
+			}
+		}
+
+		void collect_dependencies(const char* filename, const bento::Vector<bento::DynamicString>& includeDirectories, bento::Vector<bento::DynamicString>& dependencies)
+		{
+			std::vector<std::string> files;
+			visit(filename, includeDirectories, files);
+			for (uint32_t fileIdx = 0; fileIdx < (uint32_t)files.size(); ++fileIdx)
+				dependencies.push_back(bento::DynamicString(*bento::common_allocator(), files[fileIdx].c_str()));
+		}
+
+		bool compute_key(const char* filename, const bento::Vector<bento::DynamicString>& includeDirectories, const char* kernelName, const char* profile,
+			const char* const* arguments, uint32_t numArguments, uint64_t compilerVersion, Hash128& key)
+		{
+			std::vector<std::string> files;
+			visit(filename, includeDirectories, files);
+			if (files.size() == 0)
+				return false;
+
+			// Only the content matters, moving the sources around doesn't invalidate anything
+			hash::begin(key);
+			hash::append_uint64(key, SHADER_CACHE_VERSION);
+			hash::append_uint64(key, files.size());
+			for (uint32_t fileIdx = 0; fileIdx < (uint32_t)files.size(); ++fileIdx)
+			{
+				std::string content;
+				if (!read_file(files[fileIdx].c_str(), content))
+					return false;
+				hash::append_uint64(key, content.size());
+				hash::append(key, content.c_str(), content.size());
+			}
+			hash::append_string(key, kernelName);
+			hash::append_string(key, profile);
+			hash::append_uint64(key, numArguments);
+			for (uint32_t argIdx = 0; argIdx < numArguments; ++argIdx)
+				hash::append_string(key, arguments[argIdx]);
+			hash::append_uint64(key, compilerVersion);
+			return true;
+		}
+
+		// Lookup
+
+		bool find_locked(ShaderCache* cache, const Hash128& key, const void*& data, uint64_t& size)
+		{
+			const ShaderCacheEntry* end = cache->entries + cache->numEntries;
+			const ShaderCacheEntry* entry = std::lower_bound(cache->entries, end, key, [](const ShaderCacheEntry& e, const Hash128& k) { return hash::less(e.key, k); });
+			if (entry != end && hash::equal(entry->key, key))
+			{
+				data = mapped_file::data(cache->pack) + entry->offset;
+				size = entry->size;
+				return true;
+			}
+			for (uint32_t blobIdx = 0; blobIdx < (uint32_t)cache->added.size(); ++blobIdx)
+			{
+				if (hash::equal(cache->added[blobIdx].key, key))
+				{
+					data = cache->added[blobIdx].data;
+					size = cache->added[blobIdx].size;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		bool lookup(ShaderCache* cache, const Hash128& key, const void*& data, uint64_t& size)
+		{
+			Clock::time_point start = Clock::now();
+			std::lock_guard<std::mutex> lock(cache->lock);
+			bool hit = find_locked(cache, key, data, size);
+			if (hit)
+				cache->stats.hits++;
+			else
+				cache->stats.misses++;
+			cache->stats.lookupTime += elapsed_ns(start);
+			return hit;
+		}
+
+		void store(ShaderCache* cache, const Hash128& key, const void* data, uint64_t size)
+		{
+			std::lock_guard<std::mutex> lock(cache->lock);
+
+			// Two compilations of the same shader may race, the first one wins
+			const void* existingData;
+			uint64_t existingSize;
+			if (find_locked(cache, key, existingData, existingSize))
+				return;
+
+			ShaderCacheBlob blob;
+			blob.key = key;
+			blob.size = size;
+			blob.data = (char*)cache->_allocator.allocate(size > 0 ? size : 1, SHADER_CACHE_BLOB_ALIGNMENT);
+			memcpy(blob.data, data, size);
+			cache->added.push_back(blob);
+			cache->dirty = true;
+			cache->stats.stores++;
+		}
+
+		void record_compilation(ShaderCache* cache, uint64_t duration)
+		{
+			std::lock_guard<std::mutex> lock(cache->lock);
+			cache->stats.compilationTime += duration;
+		}
+
+		ShaderCacheStats get_stats(ShaderCache* cache)
+		{
+			std::lock_guard<std::mutex> lock(cache->lock);
+			return cache->stats;
+		}
+	}
+}
@@ -0,0 +1,155 @@
+// Bento includes
+#include <bento_base/security.h>
+#include <bento_memory/common.h>
+
+// SDK includes
+#include "gpu_backend/shader_permutation.h"
+
+// System includes
+#include <algorithm>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace graphics_sandbox
+{
+	struct PermutationVariant
+	{
+		uint64_t variant;
+		bool ready;
+	};
+
+	struct PermutationKeyLess
+	{
+		bool operator()(const Hash128& a, const Hash128& b) const
+		{
+			return hash::less(a, b);
+		}
+	};
+
+	struct PermutationSet
+	{
+		ALLOCATOR_BASED;
+		PermutationSet(bento::IAllocator& allocator)
+		: _allocator(allocator)
+		, base(allocator)
+		, createFunction(nullptr)
+		, destroyFunction(nullptr)
+		, userData(nullptr)
+		{
+		}
+
+		ComputeShaderDescriptor base;
+		PermutationCreateFunction createFunction;
+		PermutationDestroyFunction destroyFunction;
+		void* userData;
+
+		// Variants by canonical define set, the ones being created are not ready yet
+		std::map<Hash128, PermutationVariant, PermutationKeyLess> variants;
+		std::mutex lock;
+		std::condition_variable readyCondition;
+		bento::IAllocator& _allocator;
+	};
+
+	namespace shader_permutation
+	{
+		void canonicalize(const bento::Vector<bento::DynamicString>& defines, bento::Vector<bento::DynamicString>& canonical)
+		{
+			// Split the names and the values, the last definition of a name wins
+			std::vector<std::pair<std::string, std::string>> definitions;
+			for (uint32_t defineIdx = 0; defineIdx < defines.size(); ++defineIdx)
+			{
+				std::string define = defines[defineIdx].c_str();
+				size_t separator = define.find('=');
+				std::string name = define.substr(0, separator);
+				std::string value = separator == std::string::npos ? "1" : define.substr(separator + 1);
+				assert_msg(name.size() > 0, "Invalid define.");
+				auto previous = std::find_if(definitions.begin(), definitions.end(), [&](const std::pair<std::string, std::string>& definition) { return definition.first == name; });
+				if (previous != definitions.end())
+					previous->second = value;
+				else
+					definitions.push_back(std::make_pair(name, value));
+			}
+			std::sort(definitions.begin(), definitions.end());
+
+			canonical.clear();
+			for (uint32_t definitionIdx = 0; definitionIdx < (uint32_t)definitions.size(); ++definitionIdx)
+			{
+				std::string define = definitions[definitionIdx].first + "=" + definitions[definitionIdx].second;
+				canonical.push_back(bento::DynamicString(*bento::common_allocator(), define.c_str()));
+			}
+		}
+
+		void compute_key(const bento::Vector<bento::DynamicString>& defines, Hash128& key)
+		{
+			bento::Vector<bento::DynamicString> canonical(*bento::common_allocator());
+			canonicalize(defines, canonical);
+			hash::begin(key);
+			hash::append_uint64(key, canonical.size());
+			for (uint32_t defineIdx = 0; defineIdx < canonical.size(); ++defineIdx)
+				hash::append_string(key, canonical[defineIdx].c_str());
+		}
+
+		PermutationSet* create_permutation_set(bento::IAllocator& allocator, const ComputeShaderDescriptor& base, PermutationCreateFunction createFunction,
+			PermutationDestroyFunction destroyFunction, void* userData)
+		{
+			PermutationSet* set = bento::make_new<PermutationSet>(allocator, allocator);
+			compute_shader_descriptor::copy(base, set->base);
+			set->createFunction = createFunction;
+			set->destroyFunction = destroyFunction;
+			set->userData = userData;
+			return set;
+		}
+
+		void destroy_permutation_set(PermutationSet* set)
+		{
+			for (auto it = set->variants.begin(); it != set->variants.end(); ++it)
+			{
+				assert_msg(it->second.ready, "A variant is still being created.");
+				set->destroyFunction(it->second.variant, set->userData);
+			}
+			bento::make_delete<PermutationSet>(set->_allocator, set);
+		}
+
+		uint64_t get_variant(PermutationSet* set, const bento::Vector<bento::DynamicString>& defines)
+		{
+			Hash128 key;
+			compute_key(defines, key);
+
+			std::unique_lock<std::mutex> lock(set->lock);
+			auto it = set->variants.find(key);
+			if (it != set->variants.end())
+			{
+				// Wait if another thread is still creating it
+				set->readyCondition.wait(lock, [&]() { return it->second.ready; });
+				return it->second.variant;
+			}
+
+			// Reserve the entry and create the variant without holding the lock, other variants can be created in parallel
+			PermutationVariant& entry = set->variants[key];
+			entry.variant = 0;
+			entry.ready = false;
+			lock.unlock();
+
+			ComputeShaderDescriptor descriptor(set->_allocator);
+			compute_shader_descriptor::copy(set->base, descriptor);
+			for (uint32_t defineIdx = 0; defineIdx < defines.size(); ++defineIdx)
+				descriptor.defines.push_back(defines[defineIdx]);
+			uint64_t variant = set->createFunction(descriptor, set->userData);
+
+			lock.lock();
+			entry.variant = variant;
+			entry.ready = true;
+			set->readyCondition.notify_all();
+			return variant;
+		}
+
+		uint32_t num_variants(PermutationSet* set)
+		{
+			std::lock_guard<std::mutex> lock(set->lock);
+			return (uint32_t)set->variants.size();
+		}
+	}
+}
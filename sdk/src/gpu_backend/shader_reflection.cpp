@@ -0,0 +1,132 @@
+// Bento includes
+#include <bento_base/security.h>
+
+// SDK includes
+#include "gpu_backend/shader_reflection.h"
+
+// System includes
+#include <string.h>
+
+namespace graphics_sandbox
+{
+	ShaderReflection::ShaderReflection(bento::IAllocator& allocator)
+	: _allocator(allocator)
+	, bindings(allocator)
+	{
+		groupSize[0] = groupSize[1] = groupSize[2] = 0;
+	}
+
+	namespace shader_reflection
+	{
+		void reset(ShaderReflection& reflection)
+		{
+			reflection.groupSize[0] = reflection.groupSize[1] = reflection.groupSize[2] = 0;
+			reflection.bindings.clear();
+		}
+
+		void add_binding(ShaderReflection& reflection, ShaderBindingType type, uint32_t registerIndex, uint32_t space, uint32_t count, uint32_t size)
+		{
+			ShaderBinding binding;
+			binding.type = type;
+			binding.registerIndex = registerIndex;
+			binding.space = space;
+			binding.count = count;
+			binding.size = size;
+			reflection.bindings.push_back(binding);
+		}
+
+		uint32_t register_range(const ShaderReflection& reflection, ShaderBindingType type, uint32_t space)
+		{
+			uint32_t range = 0;
+			for (uint32_t bindingIdx = 0; bindingIdx < reflection.bindings.size(); ++bindingIdx)
+			{
+				const ShaderBinding& binding = reflection.bindings[bindingIdx];
+				if (binding.type == type && binding.space == space && binding.registerIndex + binding.count > range)
+					range = binding.registerIndex + binding.count;
+			}
+			return range;
+		}
+
+		const ShaderBinding* find_binding(const ShaderReflection& reflection, ShaderBindingType type, uint32_t registerIndex, uint32_t space)
+		{
+			for (uint32_t bindingIdx = 0; bindingIdx < reflection.bindings.size(); ++bindingIdx)
+			{
+				const ShaderBinding& binding = reflection.bindings[bindingIdx];
+				if (binding.type == type && binding.space == space && registerIndex >= binding.registerIndex && registerIndex - binding.registerIndex < binding.count)
+					return &binding;
+			}
+			return nullptr;
+		}
+
+		bool validate(const ShaderReflection& reflection)
+		{
+			const uint32_t* groupSize = reflection.groupSize;
+			if (groupSize[0] == 0 || groupSize[1] == 0 || groupSize[2] == 0)
+				return false;
+			if (groupSize[0] > SHADER_REFLECTION_MAX_GROUP_SIZE_XY || groupSize[1] > SHADER_REFLECTION_MAX_GROUP_SIZE_XY || groupSize[2] > SHADER_REFLECTION_MAX_GROUP_SIZE_Z)
+				return false;
+			if (groupSize[0] * groupSize[1] * groupSize[2] > SHADER_REFLECTION_MAX_GROUP_THREADS)
+				return false;
+
+			uint32_t numBindings = reflection.bindings.size();
+			for (uint32_t bindingIdx = 0; bindingIdx < numBindings; ++bindingIdx)
+			{
+				const ShaderBinding& binding = reflection.bindings[bindingIdx];
+				if (binding.type >= ShaderBindingType::Count || binding.count == 0 || binding.registerIndex + binding.count < binding.registerIndex)
+					return false;
+
+				// The ranges [register, register + count) of a type and space must be disjoint
+				for (uint32_t otherIdx = bindingIdx + 1; otherIdx < numBindings; ++otherIdx)
+				{
+					const ShaderBinding& other = reflection.bindings[otherIdx];
+					if (other.type == binding.type && other.space == binding.space
+						&& other.registerIndex < binding.registerIndex + binding.count && binding.registerIndex < other.registerIndex + other.count)
+						return false;
+				}
+			}
+			return true;
+		}
+
+		void serialize(const ShaderReflection& reflection, bento::Vector<char>& output)
+		{
+			ShaderReflectionHeader header;
+			header.magic = SHADER_REFLECTION_MAGIC;
+			header.version = SHADER_REFLECTION_VERSION;
+			memcpy(header.groupSize, reflection.groupSize, sizeof(header.groupSize));
+			header.numBindings = reflection.bindings.size();
+
+			uint64_t bindingsSize = header.numBindings * sizeof(ShaderBinding);
+			output.resize((uint32_t)(sizeof(ShaderReflectionHeader) + bindingsSize));
+			memcpy(output.begin(), &header, sizeof(ShaderReflectionHeader));
+			if (bindingsSize > 0)
+				memcpy(output.begin() + sizeof(ShaderReflectionHeader), reflection.bindings.begin(), bindingsSize);
+		}
+
+		bool deserialize(const char* data, uint64_t size, ShaderReflection& reflection)
+		{
+			reset(reflection);
+			if (size < sizeof(ShaderReflectionHeader))
+				return false;
+
+			ShaderReflectionHeader header;
+			memcpy(&header, data, sizeof(ShaderReflectionHeader));
+			if (header.magic != SHADER_REFLECTION_MAGIC || header.version != SHADER_REFLECTION_VERSION)
+				return false;
+			if ((size - sizeof(ShaderReflectionHeader)) / sizeof(ShaderBinding) != header.numBindings || (size - sizeof(ShaderReflectionHeader)) % sizeof(ShaderBinding) != 0)
+				return false;
+
+			memcpy(reflection.groupSize, header.groupSize, sizeof(reflection.groupSize));
+			reflection.bindings.resize(header.numBindings);
+			if (header.numBindings > 0)
+				memcpy(reflection.bindings.begin(), data + sizeof(ShaderReflectionHeader), header.numBindings * sizeof(ShaderBinding));
+
+			// Never hand out metadata that would produce a broken root signature
+			if (!validate(reflection))
+			{
+				reset(reflection);
+				return false;
+			}
+			return true;
+		}
+	}
+}
@@ -0,0 +1,112 @@
+// Bento includes
+#include <bento_base/security.h>
+
+// SDK includes
+#include "gpu_backend/shadow_state_tracker.h"
+
+// System includes
+#include <string.h>
+
+namespace graphics_sandbox
+{
+	namespace shadow_state_tracker
+	{
+		void initialize(ShadowStateTracker& tracker)
+		{
+			memset(tracker.requestedCalls, 0, sizeof(tracker.requestedCalls));
+			memset(tracker.elidedCalls, 0, sizeof(tracker.elidedCalls));
+			reset(tracker);
+		}
+
+		void invalidate_root_arguments(ShadowStateTracker& tracker)
+		{
+			memset(tracker.rootValid, 0, sizeof(tracker.rootValid));
+			tracker.nextConstant = 0;
+		}
+
+		void reset(ShadowStateTracker& tracker)
+		{
+			tracker.descriptorHeap = 0;
+			tracker.rootSignature = 0;
+			tracker.pipelineState = 0;
+			invalidate_root_arguments(tracker);
+		}
+
+		bool record_call(ShadowStateTracker& tracker, ShadowStateCall call, bool required)
+		{
+			tracker.requestedCalls[(uint32_t)call]++;
+			if (!required)
+				tracker.elidedCalls[(uint32_t)call]++;
+			return required;
+		}
+
+		bool set_descriptor_heap(ShadowStateTracker& tracker, uint64_t descriptorHeap)
+		{
+			if (!record_call(tracker, ShadowStateCall::DescriptorHeap, tracker.descriptorHeap != descriptorHeap))
+				return false;
+
+			// The tables that were set point to the previous heap
+			tracker.descriptorHeap = descriptorHeap;
+			invalidate_root_arguments(tracker);
+			return true;
+		}
+
+		bool set_root_signature(ShadowStateTracker& tracker, uint64_t rootSignature)
+		{
+			if (!record_call(tracker, ShadowStateCall::RootSignature, tracker.rootSignature != rootSignature))
+				return false;
+			tracker.rootSignature = rootSignature;
+			invalidate_root_arguments(tracker);
+			return true;
+		}
+
+		bool set_pipeline_state(ShadowStateTracker& tracker, uint64_t pipelineState)
+		{
+			if (!record_call(tracker, ShadowStateCall::PipelineState, tracker.pipelineState != pipelineState))
+				return false;
+			tracker.pipelineState = pipelineState;
+			return true;
+		}
+
+		bool set_root_value(ShadowStateTracker& tracker, uint32_t rootIndex, uint64_t value)
+		{
+			assert_msg(rootIndex < SHADOW_STATE_MAX_ROOT_SIZE, "Invalid root parameter index.");
+			bool bound = tracker.rootValid[rootIndex] && tracker.rootValue[rootIndex] == value;
+			if (!record_call(tracker, ShadowStateCall::RootParameter, !bound))
+				return false;
+			tracker.rootValid[rootIndex] = true;
+			tracker.rootValue[rootIndex] = value;
+			return true;
+		}
+
+		bool set_root_constants(ShadowStateTracker& tracker, uint32_t rootIndex, const uint32_t* values, uint32_t count)
+		{
+			assert_msg(rootIndex < SHADOW_STATE_MAX_ROOT_SIZE, "Invalid root parameter index.");
+			bool bound = tracker.rootValid[rootIndex] && tracker.constantCount[rootIndex] == count
+				&& memcmp(tracker.constants + tracker.constantOffset[rootIndex], values, count * sizeof(uint32_t)) == 0;
+			if (!record_call(tracker, ShadowStateCall::RootParameter, !bound))
+				return false;
+
+			// A parameter always has the same size for a given root signature, its storage is only allocated the first time it is set
+			if (!tracker.rootValid[rootIndex] || tracker.constantCount[rootIndex] != count)
+			{
+				if (tracker.nextConstant + count > SHADOW_STATE_MAX_ROOT_SIZE)
+					invalidate_root_arguments(tracker);
+				tracker.constantOffset[rootIndex] = tracker.nextConstant;
+				tracker.constantCount[rootIndex] = count;
+				tracker.nextConstant += count;
+			}
+			memcpy(tracker.constants + tracker.constantOffset[rootIndex], values, count * sizeof(uint32_t));
+			tracker.rootValid[rootIndex] = true;
+			return true;
+		}
+
+		uint64_t total_elided_calls(const ShadowStateTracker& tracker)
+		{
+			uint64_t total = 0;
+			for (uint32_t callIdx = 0; callIdx < (uint32_t)ShadowStateCall::Count; ++callIdx)
+				total += tracker.elidedCalls[callIdx];
+			return total;
+		}
+	}
+}
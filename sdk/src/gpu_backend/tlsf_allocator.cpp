@@ -0,0 +1,358 @@
+// Bento includes
+#include <bento_base/security.h>
+
+// SDK includes
+#include "gpu_backend/tlsf_allocator.h"
+
+// System includes
+#include <vector>
+#if defined(WINDOWSPC)
+#include <intrin.h>
+#endif
+
+namespace graphics_sandbox
+{
+	TlsfAllocator::TlsfAllocator(bento::IAllocator& allocator)
+	: _allocator(allocator)
+	, capacity(0)
+	, granularity(1)
+	, flBitmap(0)
+	, blocks(allocator)
+	, unusedBlocks(TLSF_INVALID_BLOCK)
+	, used(0)
+	, numAllocations(0)
+	{
+	}
+
+	namespace tlsf_allocator
+	{
+		uint32_t most_significant_bit(uint64_t value)
+		{
+		#if defined(WINDOWSPC)
+			unsigned long index;
+			_BitScanReverse64(&index, value);
+			return (uint32_t)index;
+		#else
+			return 63 - (uint32_t)__builtin_clzll(value);
+		#endif
+		}
+
+		uint32_t least_significant_bit(uint64_t value)
+		{
+		#if defined(WINDOWSPC)
+			unsigned long index;
+			_BitScanForward64(&index, value);
+			return (uint32_t)index;
+		#else
+			return (uint32_t)__builtin_ctzll(value);
+		#endif
+		}
+
+		// Size class of a block of this many granules
+		void mapping(uint64_t units, uint32_t& fl, uint32_t& sl)
+		{
+			if (units < TLSF_SL_COUNT)
+			{
+				fl = 0;
+				sl = (uint32_t)units;
+				return;
+			}
+			uint32_t msb = most_significant_bit(units);
+			fl = msb - TLSF_SL_BITS + 1;
+			sl = (uint32_t)(units >> (msb - TLSF_SL_BITS)) - TLSF_SL_COUNT;
+		}
+
+		uint32_t acquire_block_record(TlsfAllocator& allocator)
+		{
+			if (allocator.unusedBlocks != TLSF_INVALID_BLOCK)
+			{
+				uint32_t blockIdx = allocator.unusedBlocks;
+				allocator.unusedBlocks = allocator.blocks[blockIdx].nextFree;
+				return blockIdx;
+			}
+			TlsfBlock block = {};
+			allocator.blocks.push_back(block);
+			return allocator.blocks.size() - 1;
+		}
+
+		void release_block_record(TlsfAllocator& allocator, uint32_t blockIdx)
+		{
+			allocator.blocks[blockIdx].nextFree = allocator.unusedBlocks;
+			allocator.unusedBlocks = blockIdx;
+		}
+
+		void insert_free_block(TlsfAllocator& allocator, uint32_t blockIdx)
+		{
+			TlsfBlock& block = allocator.blocks[blockIdx];
+			uint32_t fl, sl;
+			mapping(block.size / allocator.granularity, fl, sl);
+			block.free = true;
+			block.prevFree = TLSF_INVALID_BLOCK;
+			block.nextFree = allocator.freeHeads[fl][sl];
+			if (block.nextFree != TLSF_INVALID_BLOCK)
+				allocator.blocks[block.nextFree].prevFree = blockIdx;
+			allocator.freeHeads[fl][sl] = blockIdx;
+			allocator.slBitmap[fl] |= 1u << sl;
+			allocator.flBitmap |= 1ull << fl;
+		}
+
+		void remove_free_block(TlsfAllocator& allocator, uint32_t blockIdx)
+		{
+			TlsfBlock& block = allocator.blocks[blockIdx];
+			uint32_t fl, sl;
+			mapping(block.size / allocator.granularity, fl, sl);
+			if (block.prevFree != TLSF_INVALID_BLOCK)
+				allocator.blocks[block.prevFree].nextFree = block.nextFree;
+			else
+				allocator.freeHeads[fl][sl] = block.nextFree;
+			if (block.nextFree != TLSF_INVALID_BLOCK)
+				allocator.blocks[block.nextFree].prevFree = block.prevFree;
+			block.free = false;
+
+			// Lower the bits of the emptied lists
+			if (allocator.freeHeads[fl][sl] == TLSF_INVALID_BLOCK)
+			{
+				allocator.slBitmap[fl] &= ~(1u << sl);
+				if (allocator.slBitmap[fl] == 0)
+					allocator.flBitmap &= ~(1ull << fl);
+			}
+		}
+
+		void initialize(TlsfAllocator& allocator, uint64_t capacity, uint64_t granularity)
+		{
+			assert_msg(granularity > 0 && (granularity & (granularity - 1)) == 0, "The granularity must be a power of two.");
+			assert_msg(capacity > 0 && capacity % granularity == 0, "The capacity must be a multiple of the granularity.");
+			allocator.capacity = capacity;
+			allocator.granularity = granularity;
+			allocator.flBitmap = 0;
+			for (uint32_t fl = 0; fl < TLSF_FL_COUNT; ++fl)
+			{
+				allocator.slBitmap[fl] = 0;
+				for (uint32_t sl = 0; sl < TLSF_SL_COUNT; ++sl)
+					allocator.freeHeads[fl][sl] = TLSF_INVALID_BLOCK;
+			}
+			allocator.blocks.clear();
+			allocator.unusedBlocks = TLSF_INVALID_BLOCK;
+			allocator.used = 0;
+			allocator.numAllocations = 0;
+
+			// The whole range starts as a single free block
+			TlsfBlock block;
+			block.offset = 0;
+			block.size = capacity;
+			block.prevPhysical = TLSF_INVALID_BLOCK;
+			block.nextPhysical = TLSF_INVALID_BLOCK;
+			block.prevFree = TLSF_INVALID_BLOCK;
+			block.nextFree = TLSF_INVALID_BLOCK;
+			block.free = false;
+			allocator.blocks.push_back(block);
+			insert_free_block(allocator, 0);
+		}
+
+		// Size class where every block can hold this many granules, returns false if all of them are empty
+		bool find_size_class(const TlsfAllocator& allocator, uint64_t units, uint32_t& fl, uint32_t& sl)
+		{
+			// Round up to the next class so that the head of the list is always large enough
+			if (units >= TLSF_SL_COUNT)
+				units += (1ull << (most_significant_bit(units) - TLSF_SL_BITS)) - 1;
+			mapping(units, fl, sl);
+			if (fl >= TLSF_FL_COUNT)
+				return false;
+
+			uint32_t slMap = allocator.slBitmap[fl] & (~0u << sl);
+			if (slMap == 0)
+			{
+				uint64_t flMap = fl + 1 < 64 ? allocator.flBitmap & (~0ull << (fl + 1)) : 0;
+				if (flMap == 0)
+					return false;
+				fl = least_significant_bit(flMap);
+				slMap = allocator.slBitmap[fl];
+			}
+			sl = least_significant_bit(slMap);
+			return true;
+		}
+
+		// Creates a block for the end of this one, starting at the given size, and returns it
+		uint32_t split_block(TlsfAllocator& allocator, uint32_t blockIdx, uint64_t size)
+		{
+			uint32_t remainderIdx = acquire_block_record(allocator);
+			TlsfBlock& block = allocator.blocks[blockIdx];
+			TlsfBlock& remainder = allocator.blocks[remainderIdx];
+			remainder.offset = block.offset + size;
+			remainder.size = block.size - size;
+			remainder.prevPhysical = blockIdx;
+			remainder.nextPhysical = block.nextPhysical;
+			remainder.free = false;
+			if (block.nextPhysical != TLSF_INVALID_BLOCK)
+				allocator.blocks[block.nextPhysical].prevPhysical = remainderIdx;
+			block.nextPhysical = remainderIdx;
+			block.size = size;
+			return remainderIdx;
+		}
+
+		// Absorbs the block that follows this one and releases its record
+		void merge_next(TlsfAllocator& allocator, uint32_t blockIdx)
+		{
+			TlsfBlock& block = allocator.blocks[blockIdx];
+			uint32_t nextIdx = block.nextPhysical;
+			TlsfBlock& next = allocator.blocks[nextIdx];
+			block.size += next.size;
+			block.nextPhysical = next.nextPhysical;
+			if (next.nextPhysical != TLSF_INVALID_BLOCK)
+				allocator.blocks[next.nextPhysical].prevPhysical = blockIdx;
+			release_block_record(allocator, nextIdx);
+		}
+
+		bool allocate(TlsfAllocator& allocator, uint64_t size, uint64_t alignment, TlsfAllocation& allocation)
+		{
+			assert_msg(size > 0, "Empty allocations are not supported.");
+			assert_msg(alignment > 0 && (alignment & (alignment - 1)) == 0, "The alignment must be a power of two.");
+			uint64_t granularity = allocator.granularity;
+			uint64_t alignedSize = (size + granularity - 1) & ~(granularity - 1);
+
+			// Alignments above the granularity are guaranteed by searching for the worst case padding as well
+			uint64_t padding = alignment > granularity ? alignment - granularity : 0;
+			if (alignedSize > allocator.capacity || padding > allocator.capacity - alignedSize)
+				return false;
+			uint32_t fl, sl;
+			if (!find_size_class(allocator, (alignedSize + padding) / granularity, fl, sl))
+				return false;
+			uint32_t blockIdx = allocator.freeHeads[fl][sl];
+			remove_free_block(allocator, blockIdx);
+
+			// Give the front padding back as a free block, the previous block is always allocated
+			uint64_t blockOffset = allocator.blocks[blockIdx].offset;
+			uint64_t offset = (blockOffset + alignment - 1) & ~(alignment - 1);
+			if (offset > blockOffset)
+			{
+				uint32_t alignedIdx = split_block(allocator, blockIdx, offset - blockOffset);
+				insert_free_block(allocator, blockIdx);
+				blockIdx = alignedIdx;
+			}
+
+			// Same for the end of the block, the next block is allocated as well
+			if (allocator.blocks[blockIdx].size > alignedSize)
+			{
+				uint32_t remainderIdx = split_block(allocator, blockIdx, alignedSize);
+				insert_free_block(allocator, remainderIdx);
+			}
+
+			allocator.used += alignedSize;
+			allocator.numAllocations++;
+			allocation.offset = offset;
+			allocation.size = alignedSize;
+			allocation.block = blockIdx;
+			return true;
+		}
+
+		void free(TlsfAllocator& allocator, uint32_t block)
+		{
+			assert_msg(block < allocator.blocks.size() && !allocator.blocks[block].free, "Freeing a block that is not allocated.");
+			allocator.used -= allocator.blocks[block].size;
+			allocator.numAllocations--;
+
+			// Merge with the free neighbours, two free blocks are never adjacent
+			uint32_t nextIdx = allocator.blocks[block].nextPhysical;
+			if (nextIdx != TLSF_INVALID_BLOCK && allocator.blocks[nextIdx].free)
+			{
+				remove_free_block(allocator, nextIdx);
+				merge_next(allocator, block);
+			}
+			uint32_t prevIdx = allocator.blocks[block].prevPhysical;
+			if (prevIdx != TLSF_INVALID_BLOCK && allocator.blocks[prevIdx].free)
+			{
+				remove_free_block(allocator, prevIdx);
+				merge_next(allocator, prevIdx);
+				block = prevIdx;
+			}
+			insert_free_block(allocator, block);
+		}
+
+		uint64_t largest_free_block(const TlsfAllocator& allocator)
+		{
+			if (allocator.flBitmap == 0)
+				return 0;
+
+			// Only the largest non empty class needs to be walked
+			uint32_t fl = most_significant_bit(allocator.flBitmap);
+			uint32_t sl = most_significant_bit(allocator.slBitmap[fl]);
+			uint64_t largest = 0;
+			for (uint32_t blockIdx = allocator.freeHeads[fl][sl]; blockIdx != TLSF_INVALID_BLOCK; blockIdx = allocator.blocks[blockIdx].nextFree)
+				largest = allocator.blocks[blockIdx].size > largest ? allocator.blocks[blockIdx].size : largest;
+			return largest;
+		}
+
+		bool is_empty(const TlsfAllocator& allocator)
+		{
+			return allocator.numAllocations == 0;
+		}
+
+		bool validate(const TlsfAllocator& allocator)
+		{
+			uint32_t numBlocks = allocator.blocks.size();
+			std::vector<bool> unused(numBlocks, false);
+			for (uint32_t blockIdx = allocator.unusedBlocks; blockIdx != TLSF_INVALID_BLOCK; blockIdx = allocator.blocks[blockIdx].nextFree)
+			{
+				if (blockIdx >= numBlocks || unused[blockIdx])
+					return false;
+				unused[blockIdx] = true;
+			}
+
+			// The physical chain starts at offset 0, covers the range without gaps and never has two free blocks in a row
+			uint32_t first = TLSF_INVALID_BLOCK;
+			for (uint32_t blockIdx = 0; blockIdx < numBlocks && first == TLSF_INVALID_BLOCK; ++blockIdx)
+				if (!unused[blockIdx] && allocator.blocks[blockIdx].prevPhysical == TLSF_INVALID_BLOCK)
+					first = blockIdx;
+			uint64_t offset = 0, used = 0;
+			uint32_t numAllocations = 0, numFree = 0, numLive = 0;
+			bool previousFree = false;
+			for (uint32_t blockIdx = first; blockIdx != TLSF_INVALID_BLOCK; blockIdx = allocator.blocks[blockIdx].nextPhysical)
+			{
+				const TlsfBlock& block = allocator.blocks[blockIdx];
+				if (unused[blockIdx] || block.offset != offset || block.size == 0 || block.size % allocator.granularity != 0 || (block.free && previousFree))
+					return false;
+				if (block.nextPhysical != TLSF_INVALID_BLOCK && allocator.blocks[block.nextPhysical].prevPhysical != blockIdx)
+					return false;
+				offset += block.size;
+				numLive++;
+				if (block.free)
+					numFree++;
+				else
+				{
+					used += block.size;
+					numAllocations++;
+				}
+				previousFree = block.free;
+				if (numLive > numBlocks)
+					return false;
+			}
+			if (offset != allocator.capacity || used != allocator.used || numAllocations != allocator.numAllocations)
+				return false;
+
+			// Every free block is in the list of its class and the bitmaps mirror the non empty lists
+			uint32_t numListed = 0;
+			for (uint32_t fl = 0; fl < TLSF_FL_COUNT; ++fl)
+			{
+				if (((allocator.flBitmap >> fl) & 1) != (allocator.slBitmap[fl] != 0 ? 1u : 0u))
+					return false;
+				for (uint32_t sl = 0; sl < TLSF_SL_COUNT; ++sl)
+				{
+					uint32_t head = allocator.freeHeads[fl][sl];
+					if (((allocator.slBitmap[fl] >> sl) & 1) != (head != TLSF_INVALID_BLOCK ? 1u : 0u))
+						return false;
+					uint32_t prevIdx = TLSF_INVALID_BLOCK;
+					for (uint32_t blockIdx = head; blockIdx != TLSF_INVALID_BLOCK; blockIdx = allocator.blocks[blockIdx].nextFree)
+					{
+						const TlsfBlock& block = allocator.blocks[blockIdx];
+						uint32_t blockFl, blockSl;
+						mapping(block.size / allocator.granularity, blockFl, blockSl);
+						if (unused[blockIdx] || !block.free || block.prevFree != prevIdx || blockFl != fl || blockSl != sl || ++numListed > numFree)
+							return false;
+						prevIdx = blockIdx;
+					}
+				}
+			}
+			return numListed == numFree;
+		}
+	}
+}
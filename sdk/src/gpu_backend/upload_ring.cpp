@@ -0,0 +1,138 @@
+// Bento includes
+#include <bento_base/security.h>
+
+// SDK includes
+#include "gpu_backend/upload_ring.h"
+
+namespace graphics_sandbox
+{
+	UploadRing::UploadRing(bento::IAllocator& allocator)
+	: _allocator(allocator)
+	, capacity(0)
+	, head(0)
+	, tail(0)
+	, used(0)
+	, frameSize(0)
+	, frames(allocator)
+	, firstFrame(0)
+	, allocations(0)
+	, wraps(0)
+	, failedAllocations(0)
+	{
+	}
+
+	namespace upload_ring
+	{
+		void initialize(UploadRing& ring, uint64_t capacity)
+		{
+			ring.capacity = capacity;
+			ring.head = 0;
+			ring.tail = 0;
+			ring.used = 0;
+			ring.frameSize = 0;
+			ring.frames.clear();
+			ring.firstFrame = 0;
+		}
+
+		bool allocate(UploadRing& ring, uint64_t size, uint64_t alignment, uint64_t& offset)
+		{
+			assert_msg(size > 0 && size <= ring.capacity, "Invalid upload ring allocation size.");
+			assert_msg(alignment > 0 && (alignment & (alignment - 1)) == 0, "The alignment must be a power of two.");
+
+			// Restart from the beginning whenever possible, this avoids wasting the end of the ring
+			if (ring.used == 0)
+			{
+				ring.head = 0;
+				ring.tail = 0;
+			}
+
+			uint64_t alignedHead = (ring.head + alignment - 1) & ~(alignment - 1);
+			uint64_t padding;
+			if (ring.used == ring.capacity)
+			{
+				ring.failedAllocations++;
+				return false;
+			}
+			else if (ring.head >= ring.tail)
+			{
+				// The free space is [head, capacity) and [0, tail), the start of the ring is aligned for any allocation
+				if (alignedHead <= ring.capacity && ring.capacity - alignedHead >= size)
+					padding = alignedHead - ring.head;
+				else if (ring.tail >= size)
+				{
+					padding = ring.capacity - ring.head;
+					alignedHead = 0;
+					ring.wraps++;
+				}
+				else
+				{
+					ring.failedAllocations++;
+					return false;
+				}
+			}
+			else if (alignedHead <= ring.tail && ring.tail - alignedHead >= size)
+			{
+				// The free space is [head, tail)
+				padding = alignedHead - ring.head;
+			}
+			else
+			{
+				ring.failedAllocations++;
+				return false;
+			}
+
+			// The padding is freed with the allocation's frame
+			offset = alignedHead;
+			ring.used += padding + size;
+			ring.frameSize += padding + size;
+			ring.head = (alignedHead + size) % ring.capacity;
+			ring.allocations++;
+			return true;
+		}
+
+		void end_frame(UploadRing& ring, uint64_t fenceValue)
+		{
+			if (ring.frameSize == 0)
+				return;
+			assert_msg(ring.frames.size() == ring.firstFrame || ring.frames[ring.frames.size() - 1].fenceValue <= fenceValue, "The fence values must increase.");
+			UploadRingFrame frame;
+			frame.end = ring.head;
+			frame.size = ring.frameSize;
+			frame.fenceValue = fenceValue;
+			ring.frames.push_back(frame);
+			ring.frameSize = 0;
+		}
+
+		void reclaim(UploadRing& ring, uint64_t completedValue)
+		{
+			uint32_t numFrames = ring.frames.size();
+			while (ring.firstFrame < numFrames)
+			{
+				const UploadRingFrame& frame = ring.frames[ring.firstFrame];
+				if (frame.fenceValue > completedValue)
+					break;
+				ring.tail = frame.end;
+				ring.used -= frame.size;
+				ring.firstFrame++;
+			}
+
+			// Compact the frame list once the dead part dominates
+			if (ring.firstFrame > 0 && ring.firstFrame * 2 >= numFrames)
+			{
+				uint32_t numLive = numFrames - ring.firstFrame;
+				for (uint32_t frameIdx = 0; frameIdx < numLive; ++frameIdx)
+					ring.frames[frameIdx] = ring.frames[ring.firstFrame + frameIdx];
+				ring.frames.resize(numLive);
+				ring.firstFrame = 0;
+			}
+		}
+
+		bool oldest_fence_value(const UploadRing& ring, uint64_t& fenceValue)
+		{
+			if (ring.firstFrame >= ring.frames.size())
+				return false;
+			fenceValue = ring.frames[ring.firstFrame].fenceValue;
+			return true;
+		}
+	}
+}
@@ -0,0 +1,224 @@
+// Bento includes
+#include <bento_base/security.h>
+#include <bento_memory/common.h>
+
+// Internal includes
+#include "tools/file_watcher.h"
+
+// System includes
+#include <string.h>
+#include <string>
+#include <vector>
+#if defined(WINDOWSPC)
+#include <Windows.h>
+#else
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace graphics_sandbox
+{
+#if defined(WINDOWSPC)
+	// Size of the buffer that receives the notifications of a directory between two polls
+	#define FILE_WATCHER_BUFFER_SIZE 16384
+
+	struct WatchedDirectory
+	{
+		std::string path;
+		HANDLE handle;
+		OVERLAPPED overlapped;
+		DWORD* buffer;
+	};
+#else
+	struct WatchedDirectory
+	{
+		std::string path;
+		int descriptor;
+	};
+#endif
+
+	struct FileWatcher
+	{
+		ALLOCATOR_BASED;
+		FileWatcher(bento::IAllocator& allocator)
+		: _allocator(allocator)
+		{
+		}
+
+		// The pending reads point into the directories, they never move
+		std::vector<WatchedDirectory*> directories;
+#if !defined(WINDOWSPC)
+		int inotify;
+#endif
+		bento::IAllocator& _allocator;
+	};
+
+	namespace file_watcher
+	{
+		std::string strip_separator(const char* directory)
+		{
+			std::string path = directory;
+			while (path.size() > 1 && (path.back() == '/' || path.back() == '\\'))
+				path.pop_back();
+			return path;
+		}
+
+		bool is_watched(FileWatcher* watcher, const std::string& path)
+		{
+			for (uint32_t dirIdx = 0; dirIdx < (uint32_t)watcher->directories.size(); ++dirIdx)
+				if (watcher->directories[dirIdx]->path == path)
+					return true;
+			return false;
+		}
+
+#if defined(WINDOWSPC)
+		bool issue_read(WatchedDirectory& directory)
+		{
+			return ReadDirectoryChangesW(directory.handle, directory.buffer, FILE_WATCHER_BUFFER_SIZE, FALSE,
+				FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE, nullptr, &directory.overlapped, nullptr) != 0;
+		}
+
+		FileWatcher* create_file_watcher(bento::IAllocator& allocator)
+		{
+			return bento::make_new<FileWatcher>(allocator, allocator);
+		}
+
+		void destroy_file_watcher(FileWatcher* watcher)
+		{
+			for (uint32_t dirIdx = 0; dirIdx < (uint32_t)watcher->directories.size(); ++dirIdx)
+			{
+				WatchedDirectory* directory = watcher->directories[dirIdx];
+				CancelIoEx(directory->handle, &directory->overlapped);
+				DWORD transferred;
+				GetOverlappedResult(directory->handle, &directory->overlapped, &transferred, TRUE);
+				CloseHandle(directory->overlapped.hEvent);
+				CloseHandle(directory->handle);
+				watcher->_allocator.deallocate(directory->buffer);
+				bento::make_delete<WatchedDirectory>(watcher->_allocator, directory);
+			}
+			bento::make_delete<FileWatcher>(watcher->_allocator, watcher);
+		}
+
+		bool watch_directory(FileWatcher* watcher, const char* directoryPath)
+		{
+			std::string path = strip_separator(directoryPath);
+			if (is_watched(watcher, path))
+				return true;
+
+			HANDLE handle = CreateFileA(path.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+				OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+			if (handle == INVALID_HANDLE_VALUE)
+				return false;
+			WatchedDirectory* directory = bento::make_new<WatchedDirectory>(watcher->_allocator);
+			directory->path = path;
+			directory->handle = handle;
+			memset(&directory->overlapped, 0, sizeof(OVERLAPPED));
+			directory->overlapped.hEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+
+			// The notifications are DWORD aligned
+			directory->buffer = (DWORD*)watcher->_allocator.allocate(FILE_WATCHER_BUFFER_SIZE, sizeof(DWORD));
+			if (!issue_read(*directory))
+			{
+				CloseHandle(directory->overlapped.hEvent);
+				CloseHandle(directory->handle);
+				watcher->_allocator.deallocate(directory->buffer);
+				bento::make_delete<WatchedDirectory>(watcher->_allocator, directory);
+				return false;
+			}
+			watcher->directories.push_back(directory);
+			return true;
+		}
+
+		void poll(FileWatcher* watcher, bento::Vector<bento::DynamicString>& changedFiles)
+		{
+			for (uint32_t dirIdx = 0; dirIdx < (uint32_t)watcher->directories.size(); ++dirIdx)
+			{
+				WatchedDirectory& directory = *watcher->directories[dirIdx];
+				DWORD transferred = 0;
+				if (!GetOverlappedResult(directory.handle, &directory.overlapped, &transferred, FALSE))
+					continue;
+
+				// An empty result means that the buffer overflowed, the changes are lost
+				const char* notification = (const char*)directory.buffer;
+				while (transferred > 0)
+				{
+					const FILE_NOTIFY_INFORMATION* info = (const FILE_NOTIFY_INFORMATION*)notification;
+					if (info->Action != FILE_ACTION_REMOVED && info->Action != FILE_ACTION_RENAMED_OLD_NAME)
+					{
+						int nameLength = (int)(info->FileNameLength / sizeof(WCHAR));
+						int size = WideCharToMultiByte(CP_UTF8, 0, info->FileName, nameLength, nullptr, 0, nullptr, nullptr);
+						std::string name(size, '\0');
+						WideCharToMultiByte(CP_UTF8, 0, info->FileName, nameLength, &name[0], size, nullptr, nullptr);
+						std::string file = directory.path + "/" + name;
+						changedFiles.push_back(bento::DynamicString(*bento::common_allocator(), file.c_str()));
+					}
+					if (info->NextEntryOffset == 0)
+						break;
+					notification += info->NextEntryOffset;
+				}
+				ResetEvent(directory.overlapped.hEvent);
+				issue_read(directory);
+			}
+		}
+#else
+		FileWatcher* create_file_watcher(bento::IAllocator& allocator)
+		{
+			FileWatcher* watcher = bento::make_new<FileWatcher>(allocator, allocator);
+			watcher->inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+			assert_msg(watcher->inotify >= 0, "Failed to initialize inotify.");
+			return watcher;
+		}
+
+		void destroy_file_watcher(FileWatcher* watcher)
+		{
+			for (uint32_t dirIdx = 0; dirIdx < (uint32_t)watcher->directories.size(); ++dirIdx)
+				bento::make_delete<WatchedDirectory>(watcher->_allocator, watcher->directories[dirIdx]);
+			close(watcher->inotify);
+			bento::make_delete<FileWatcher>(watcher->_allocator, watcher);
+		}
+
+		bool watch_directory(FileWatcher* watcher, const char* directoryPath)
+		{
+			std::string path = strip_separator(directoryPath);
+			if (is_watched(watcher, path))
+				return true;
+
+			// Editors either rewrite the file in place or write a temporary one and move it over the original
+			int descriptor = inotify_add_watch(watcher->inotify, path.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+			if (descriptor < 0)
+				return false;
+			WatchedDirectory* directory = bento::make_new<WatchedDirectory>(watcher->_allocator);
+			directory->path = path;
+			directory->descriptor = descriptor;
+			watcher->directories.push_back(directory);
+			return true;
+		}
+
+		void poll(FileWatcher* watcher, bento::Vector<bento::DynamicString>& changedFiles)
+		{
+			alignas(struct inotify_event) char buffer[4096];
+			while (true)
+			{
+				ssize_t length = read(watcher->inotify, buffer, sizeof(buffer));
+				if (length <= 0)
+					break;
+				for (const char* cursor = buffer; cursor < buffer + length; )
+				{
+					const struct inotify_event* event = (const struct inotify_event*)cursor;
+					cursor += sizeof(struct inotify_event) + event->len;
+					if (event->len == 0 || (event->mask & IN_ISDIR) != 0)
+						continue;
+					for (uint32_t dirIdx = 0; dirIdx < (uint32_t)watcher->directories.size(); ++dirIdx)
+					{
+						if (watcher->directories[dirIdx]->descriptor != event->wd)
+							continue;
+						std::string file = watcher->directories[dirIdx]->path + "/" + event->name;
+						changedFiles.push_back(bento::DynamicString(*bento::common_allocator(), file.c_str()));
+						break;
+					}
+				}
+			}
+		}
+#endif
+	}
+}
@@ -0,0 +1,60 @@
+// Internal includes
+#include "tools/hash.h"
+
+// System includes
+#include <string.h>
+
+namespace graphics_sandbox
+{
+	namespace hash
+	{
+		// FNV-1a for the low part and a multiply/xorshift mix for the high part
+		const uint64_t FNVOffsetBasis = 0xcbf29ce484222325ull;
+		const uint64_t FNVPrime = 0x100000001b3ull;
+		const uint64_t MixSeed = 0x243f6a8885a308d3ull;
+		const uint64_t MixMultiplier = 0x9e3779b97f4a7c15ull;
+
+		void begin(Hash128& state)
+		{
+			state.low = FNVOffsetBasis;
+			state.high = MixSeed;
+		}
+
+		void append(Hash128& state, const void* data, uint64_t size)
+		{
+			const uint8_t* bytes = (const uint8_t*)data;
+			uint64_t low = state.low;
+			uint64_t high = state.high;
+			for (uint64_t byteIdx = 0; byteIdx < size; ++byteIdx)
+			{
+				low = (low ^ bytes[byteIdx]) * FNVPrime;
+				high = (high ^ bytes[byteIdx]) * MixMultiplier;
+				high ^= high >> 29;
+			}
+			state.low = low;
+			state.high = high;
+		}
+
+		void append_string(Hash128& state, const char* str)
+		{
+			uint64_t length = strlen(str);
+			append_uint64(state, length);
+			append(state, str, length);
+		}
+
+		void append_uint64(Hash128& state, uint64_t value)
+		{
+			append(state, &value, sizeof(uint64_t));
+		}
+
+		bool equal(const Hash128& a, const Hash128& b)
+		{
+			return a.low == b.low && a.high == b.high;
+		}
+
+		bool less(const Hash128& a, const Hash128& b)
+		{
+			return a.high != b.high ? a.high < b.high : a.low < b.low;
+		}
+	}
+}
@@ -0,0 +1,61 @@
+// Bento includes
+#include <bento_base/security.h>
+
+// SDK includes
+#include "tools/index_allocator.h"
+
+namespace graphics_sandbox
+{
+	IndexAllocator::IndexAllocator(bento::IAllocator& allocator)
+	: _allocator(allocator)
+	, capacity(0)
+	, nextIndex(0)
+	, numAllocated(0)
+	, freeIndices(allocator)
+	{
+	}
+
+	namespace index_allocator
+	{
+		void initialize(IndexAllocator& allocator, uint32_t capacity)
+		{
+			allocator.capacity = capacity;
+			allocator.nextIndex = 0;
+			allocator.numAllocated = 0;
+			allocator.freeIndices.clear();
+		}
+
+		uint32_t allocate(IndexAllocator& allocator)
+		{
+			std::lock_guard<std::mutex> guard(allocator.lock);
+			uint32_t index;
+			uint32_t numFree = allocator.freeIndices.size();
+			if (numFree > 0)
+			{
+				index = allocator.freeIndices[numFree - 1];
+				allocator.freeIndices.resize(numFree - 1);
+			}
+			else if (allocator.nextIndex < allocator.capacity)
+				index = allocator.nextIndex++;
+			else
+				return UINT32_MAX;
+
+			allocator.numAllocated++;
+			return index;
+		}
+
+		void free(IndexAllocator& allocator, uint32_t index)
+		{
+			std::lock_guard<std::mutex> guard(allocator.lock);
+			assert_msg(index < allocator.nextIndex && allocator.numAllocated > 0, "Freeing an index that was never allocated.");
+			allocator.freeIndices.push_back(index);
+			allocator.numAllocated--;
+		}
+
+		uint32_t num_allocated(IndexAllocator& allocator)
+		{
+			std::lock_guard<std::mutex> guard(allocator.lock);
+			return allocator.numAllocated;
+		}
+	}
+}
@@ -0,0 +1,134 @@
+// Bento includes
+#include <bento_base/security.h>
+
+// Internal includes
+#include "tools/job_batch.h"
+
+// System includes
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+namespace graphics_sandbox
+{
+	struct JobBatch
+	{
+		ALLOCATOR_BASED;
+		JobBatch(bento::IAllocator& allocator, uint32_t jobCount)
+		: _allocator(allocator)
+		, function(nullptr)
+		, userData(nullptr)
+		, count(jobCount)
+		, nextJob(0)
+		, completed(jobCount, false)
+		, numCompleted(0)
+		, numWorkers(0)
+		, runningWorkers(0)
+		{
+		}
+
+		// Jobs
+		JobFunction function;
+		void* userData;
+		uint32_t count;
+
+		// Index of the next job to process, the workers grab them in order
+		std::atomic<uint32_t> nextJob;
+
+		// Completion state, guarded by the lock
+		std::vector<bool> completed;
+		uint32_t numCompleted;
+		std::mutex lock;
+		std::condition_variable completedCondition;
+
+		// Tasks of the pool working on the batch, guarded by the lock. The batch can't be destroyed before they have all returned.
+		uint32_t numWorkers;
+		uint32_t runningWorkers;
+		bento::IAllocator& _allocator;
+	};
+
+	namespace job_batch
+	{
+		// Processes the jobs nobody has started yet, up to lastJob included
+		void process_jobs(JobBatch* batch, uint32_t lastJob)
+		{
+			while (batch->nextJob.load() <= lastJob)
+			{
+				uint32_t jobIdx = batch->nextJob.fetch_add(1);
+				if (jobIdx >= batch->count)
+					break;
+				batch->function(jobIdx, batch->userData);
+
+				std::lock_guard<std::mutex> lock(batch->lock);
+				batch->completed[jobIdx] = true;
+				batch->numCompleted++;
+				batch->completedCondition.notify_all();
+			}
+		}
+
+		void worker_task(void* userData)
+		{
+			JobBatch* batch = (JobBatch*)userData;
+			process_jobs(batch, batch->count - 1);
+
+			std::lock_guard<std::mutex> lock(batch->lock);
+			batch->runningWorkers--;
+			batch->completedCondition.notify_all();
+		}
+
+		JobBatch* launch(bento::IAllocator& allocator, WorkStealingPool* pool, uint32_t count, JobFunction function, void* userData)
+		{
+			JobBatch* batch = bento::make_new<JobBatch>(allocator, allocator, count);
+			batch->function = function;
+			batch->userData = userData;
+
+			// The calling thread isn't a worker, it only helps when it waits
+			uint32_t numWorkers = std::min(work_stealing_pool::num_threads(pool) - 1, count);
+			batch->numWorkers = numWorkers;
+			batch->runningWorkers = numWorkers;
+			for (uint32_t workerIdx = 0; workerIdx < numWorkers; ++workerIdx)
+				work_stealing_pool::submit(pool, worker_task, batch);
+			return batch;
+		}
+
+		void destroy(JobBatch* batch)
+		{
+			process_jobs(batch, batch->count - 1);
+			{
+				std::unique_lock<std::mutex> lock(batch->lock);
+				batch->completedCondition.wait(lock, [&]() { return batch->numCompleted == batch->count && batch->runningWorkers == 0; });
+			}
+			bento::make_delete<JobBatch>(batch->_allocator, batch);
+		}
+
+		bool is_complete(JobBatch* batch, uint32_t jobIdx)
+		{
+			assert_msg(jobIdx < batch->count, "Invalid job index.");
+			std::lock_guard<std::mutex> lock(batch->lock);
+			return batch->completed[jobIdx];
+		}
+
+		void wait(JobBatch* batch, uint32_t jobIdx)
+		{
+			// The workers may be busy with other tasks, the jobs up to this one are not left waiting for them
+			assert_msg(jobIdx < batch->count, "Invalid job index.");
+			process_jobs(batch, jobIdx);
+			std::unique_lock<std::mutex> lock(batch->lock);
+			batch->completedCondition.wait(lock, [&]() { return (bool)batch->completed[jobIdx]; });
+		}
+
+		void wait_all(JobBatch* batch)
+		{
+			process_jobs(batch, batch->count - 1);
+			std::unique_lock<std::mutex> lock(batch->lock);
+			batch->completedCondition.wait(lock, [&]() { return batch->numCompleted == batch->count; });
+		}
+
+		uint32_t num_workers(const JobBatch* batch)
+		{
+			return batch->numWorkers;
+		}
+	}
+}
@@ -0,0 +1,115 @@
+// Bento includes
+#include <bento_base/security.h>
+
+// Internal includes
+#include "tools/mapped_file.h"
+
+// System includes
+#if defined(WINDOWSPC)
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace graphics_sandbox
+{
+	struct MappedFile
+	{
+		ALLOCATOR_BASED;
+		MappedFile(bento::IAllocator& allocator)
+		: _allocator(allocator)
+		, data(nullptr)
+		, size(0)
+		{
+		}
+
+		const char* data;
+		uint64_t size;
+#if defined(WINDOWSPC)
+		HANDLE file;
+		HANDLE mapping;
+#endif
+		bento::IAllocator& _allocator;
+	};
+
+	namespace mapped_file
+	{
+#if defined(WINDOWSPC)
+		MappedFile* open(bento::IAllocator& allocator, const char* path)
+		{
+			HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (file == INVALID_HANDLE_VALUE)
+				return nullptr;
+			LARGE_INTEGER fileSize;
+			HANDLE mapping = nullptr;
+			const void* view = nullptr;
+			if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+				mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (mapping != nullptr)
+				view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			if (view == nullptr)
+			{
+				if (mapping != nullptr)
+					CloseHandle(mapping);
+				CloseHandle(file);
+				return nullptr;
+			}
+
+			MappedFile* mappedFile = bento::make_new<MappedFile>(allocator, allocator);
+			mappedFile->data = (const char*)view;
+			mappedFile->size = (uint64_t)fileSize.QuadPart;
+			mappedFile->file = file;
+			mappedFile->mapping = mapping;
+			return mappedFile;
+		}
+
+		void close(MappedFile* file)
+		{
+			UnmapViewOfFile(file->data);
+			CloseHandle(file->mapping);
+			CloseHandle(file->file);
+			bento::make_delete<MappedFile>(file->_allocator, file);
+		}
+#else
+		MappedFile* open(bento::IAllocator& allocator, const char* path)
+		{
+			int descriptor = ::open(path, O_RDONLY);
+			if (descriptor < 0)
+				return nullptr;
+			struct stat status;
+			void* view = MAP_FAILED;
+			if (fstat(descriptor, &status) == 0 && status.st_size > 0)
+				view = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+
+			// The mapping keeps the file alive
+			::close(descriptor);
+			if (view == MAP_FAILED)
+				return nullptr;
+
+			MappedFile* mappedFile = bento::make_new<MappedFile>(allocator, allocator);
+			mappedFile->data = (const char*)view;
+			mappedFile->size = (uint64_t)status.st_size;
+			return mappedFile;
+		}
+
+		void close(MappedFile* file)
+		{
+			munmap((void*)file->data, (size_t)file->size);
+			bento::make_delete<MappedFile>(file->_allocator, file);
+		}
+#endif
+
+		const char* data(const MappedFile* file)
+		{
+			return file->data;
+		}
+
+		uint64_t size(const MappedFile* file)
+		{
+			return file->size;
+		}
+	}
+}
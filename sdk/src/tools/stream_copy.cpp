@@ -0,0 +1,203 @@
+// Bento includes
+#include <bento_base/security.h>
+#include <bento_memory/common.h>
+
+// Internal includes
+#include "tools/stream_copy.h"
+
+// System includes
+#include <string.h>
+#if defined(_M_X64) || defined(__x86_64__)
+#define STREAM_COPY_X86
+#include <immintrin.h>
+#if defined(WINDOWSPC)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// The AVX2 path is compiled for its own function only, the rest of the binary doesn't require it
+#if defined(STREAM_COPY_X86) && !defined(WINDOWSPC)
+#define STREAM_COPY_AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define STREAM_COPY_AVX2_TARGET
+#endif
+
+// Size of the pieces a parallel copy is split in
+#define STREAM_COPY_CHUNK_SIZE (4ull << 20)
+
+namespace graphics_sandbox
+{
+	namespace stream_copy
+	{
+	#if defined(STREAM_COPY_X86)
+		bool cpu_supports_avx2()
+		{
+			// The CPU must have the instructions and the OS must save the ymm registers
+		#if defined(WINDOWSPC)
+			int info[4];
+			__cpuid(info, 0);
+			if (info[0] < 7)
+				return false;
+			__cpuid(info, 1);
+			if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6)
+				return false;
+			__cpuidex(info, 7, 0);
+			return (info[1] & (1 << 5)) != 0;
+		#else
+			unsigned int eax, ebx, ecx, edx;
+			if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || (ecx & (1 << 27)) == 0 || (ecx & (1 << 28)) == 0)
+				return false;
+			unsigned int xcr0Low, xcr0High;
+			__asm__ volatile("xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+			if ((xcr0Low & 6) != 6)
+				return false;
+			if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+				return false;
+			return (ebx & (1 << 5)) != 0;
+		#endif
+		}
+
+		// Number of bytes to write with regular stores before the destination is aligned on a cache line
+		uint64_t head_size(const char* destination, uint64_t size)
+		{
+			uint64_t head = (64 - ((uintptr_t)destination & 63)) & 63;
+			return head < size ? head : size;
+		}
+
+		void copy_sse2(char* destination, const char* source, uint64_t size)
+		{
+			uint64_t head = head_size(destination, size);
+			memcpy(destination, source, (size_t)head);
+			destination += head;
+			source += head;
+			size -= head;
+
+			// A full line per iteration, the write combining buffers are flushed whole
+			for (; size >= 64; size -= 64, destination += 64, source += 64)
+			{
+				__m128i line0 = _mm_loadu_si128((const __m128i*)source);
+				__m128i line1 = _mm_loadu_si128((const __m128i*)(source + 16));
+				__m128i line2 = _mm_loadu_si128((const __m128i*)(source + 32));
+				__m128i line3 = _mm_loadu_si128((const __m128i*)(source + 48));
+				_mm_stream_si128((__m128i*)destination, line0);
+				_mm_stream_si128((__m128i*)(destination + 16), line1);
+				_mm_stream_si128((__m128i*)(destination + 32), line2);
+				_mm_stream_si128((__m128i*)(destination + 48), line3);
+			}
+			memcpy(destination, source, (size_t)size);
+			_mm_sfence();
+		}
+
+		STREAM_COPY_AVX2_TARGET void copy_avx2(char* destination, const char* source, uint64_t size)
+		{
+			uint64_t head = head_size(destination, size);
+			memcpy(destination, source, (size_t)head);
+			destination += head;
+			source += head;
+			size -= head;
+
+			// Two lines per iteration
+			for (; size >= 128; size -= 128, destination += 128, source += 128)
+			{
+				__m256i line0 = _mm256_loadu_si256((const __m256i*)source);
+				__m256i line1 = _mm256_loadu_si256((const __m256i*)(source + 32));
+				__m256i line2 = _mm256_loadu_si256((const __m256i*)(source + 64));
+				__m256i line3 = _mm256_loadu_si256((const __m256i*)(source + 96));
+				_mm256_stream_si256((__m256i*)destination, line0);
+				_mm256_stream_si256((__m256i*)(destination + 32), line1);
+				_mm256_stream_si256((__m256i*)(destination + 64), line2);
+				_mm256_stream_si256((__m256i*)(destination + 96), line3);
+			}
+			if (size >= 64)
+			{
+				__m256i line0 = _mm256_loadu_si256((const __m256i*)source);
+				__m256i line1 = _mm256_loadu_si256((const __m256i*)(source + 32));
+				_mm256_stream_si256((__m256i*)destination, line0);
+				_mm256_stream_si256((__m256i*)(destination + 32), line1);
+				size -= 64;
+				destination += 64;
+				source += 64;
+			}
+			memcpy(destination, source, (size_t)size);
+			_mm_sfence();
+			_mm256_zeroupper();
+		}
+	#endif
+
+		StreamCopyPath detect_path()
+		{
+		#if defined(STREAM_COPY_X86)
+			return cpu_supports_avx2() ? StreamCopyPath::AVX2 : StreamCopyPath::SSE2;
+		#else
+			return StreamCopyPath::Scalar;
+		#endif
+		}
+
+		StreamCopyPath best_path()
+		{
+			static const StreamCopyPath path = detect_path();
+			return path;
+		}
+
+		const char* path_name(StreamCopyPath path)
+		{
+			switch (path)
+			{
+				case StreamCopyPath::SSE2:
+					return "SSE2";
+				case StreamCopyPath::AVX2:
+					return "AVX2";
+				default:
+					return "Scalar";
+			}
+		}
+
+		void copy(void* destination, const void* source, uint64_t size)
+		{
+			copy(destination, source, size, best_path());
+		}
+
+		void copy(void* destination, const void* source, uint64_t size, StreamCopyPath path)
+		{
+			assert_msg((uint32_t)path <= (uint32_t)best_path(), "Copy path not supported by the CPU.");
+		#if defined(STREAM_COPY_X86)
+			if (path == StreamCopyPath::AVX2)
+			{
+				copy_avx2((char*)destination, (const char*)source, size);
+				return;
+			}
+			if (path == StreamCopyPath::SSE2)
+			{
+				copy_sse2((char*)destination, (const char*)source, size);
+				return;
+			}
+		#endif
+			memcpy(destination, source, (size_t)size);
+		}
+
+		void copy_parallel(WorkStealingPool* pool, void* destination, const void* source, uint64_t size)
+		{
+			// Waking the workers up costs more than small copies
+			uint64_t numChunks = (size + STREAM_COPY_CHUNK_SIZE - 1) / STREAM_COPY_CHUNK_SIZE;
+			if (numChunks < 4 || work_stealing_pool::num_threads(pool) == 1)
+			{
+				copy(destination, source, size);
+				return;
+			}
+
+			// Every thread fences its own stores, the end of the loop makes them visible to the caller
+			StreamCopyPath path = best_path();
+			work_stealing_pool::parallel_for(pool, (uint32_t)numChunks, 1, [&](uint32_t chunkBegin, uint32_t chunkEnd)
+			{
+				for (uint32_t chunkIdx = chunkBegin; chunkIdx < chunkEnd; ++chunkIdx)
+				{
+					uint64_t offset = (uint64_t)chunkIdx * STREAM_COPY_CHUNK_SIZE;
+					uint64_t chunkSize = size - offset < STREAM_COPY_CHUNK_SIZE ? size - offset : STREAM_COPY_CHUNK_SIZE;
+					copy((char*)destination + offset, (const char*)source + offset, chunkSize, path);
+				}
+			});
+		}
+	}
+}
@@ -0,0 +1,269 @@
+// Bento includes
+#include <bento_base/security.h>
+
+// Internal includes
+#include "tools/timeline.h"
+
+// System includes
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace graphics_sandbox
+{
+	struct TimelineCallbackEntry
+	{
+		uint64_t point;
+		TimelineCallback callback;
+		void* userData;
+	};
+
+	// Registered by wait_any on every timeline it waits on, whichever progresses first wakes it up
+	struct TimelineWaiter
+	{
+		std::mutex lock;
+		std::condition_variable condition;
+		bool signaled;
+	};
+
+	struct Timeline
+	{
+		ALLOCATOR_BASED;
+		Timeline(bento::IAllocator& allocator)
+		: _allocator(allocator)
+		, submittedValue(0)
+		, completedValue(0)
+		, waitFunction(nullptr)
+		, userData(nullptr)
+		, shutdown(false)
+		{
+		}
+
+		std::mutex lock;
+		uint64_t submittedValue;
+		uint64_t completedValue;
+		std::condition_variable completedCondition;
+		std::vector<TimelineWaiter*> waiters;
+
+		// Backend wait, only called from the worker
+		TimelineWaitFunction waitFunction;
+		void* userData;
+
+		// Worker that reports the completions and runs the callbacks
+		std::thread worker;
+		std::condition_variable workerCondition;
+		std::vector<TimelineCallbackEntry> callbacks;
+		bool shutdown;
+		bento::IAllocator& _allocator;
+	};
+
+	namespace timeline
+	{
+		typedef std::chrono::steady_clock Clock;
+
+		Clock::time_point deadline(uint64_t timeoutMS)
+		{
+			// Clamped so that the addition can't overflow
+			return Clock::now() + std::chrono::milliseconds(std::min(timeoutMS, (uint64_t)(24ull * 3600 * 1000 * 365)));
+		}
+
+		// Must be called with the timeline's lock held
+		void set_completed(Timeline* timeline, uint64_t completedValue)
+		{
+			if (completedValue <= timeline->completedValue)
+				return;
+			timeline->completedValue = completedValue;
+			timeline->completedCondition.notify_all();
+			timeline->workerCondition.notify_one();
+			for (uint32_t waiterIdx = 0; waiterIdx < (uint32_t)timeline->waiters.size(); ++waiterIdx)
+			{
+				TimelineWaiter* waiter = timeline->waiters[waiterIdx];
+				std::lock_guard<std::mutex> waiterLock(waiter->lock);
+				waiter->signaled = true;
+				waiter->condition.notify_one();
+			}
+		}
+
+		bool pop_ready_callback(Timeline* timeline, TimelineCallbackEntry& entry)
+		{
+			uint32_t numCallbacks = (uint32_t)timeline->callbacks.size();
+			for (uint32_t callbackIdx = 0; callbackIdx < numCallbacks; ++callbackIdx)
+			{
+				if (timeline->callbacks[callbackIdx].point <= timeline->completedValue)
+				{
+					entry = timeline->callbacks[callbackIdx];
+					timeline->callbacks.erase(timeline->callbacks.begin() + callbackIdx);
+					return true;
+				}
+			}
+			return false;
+		}
+
+		void worker_loop(Timeline* timeline)
+		{
+			std::unique_lock<std::mutex> lock(timeline->lock);
+			while (true)
+			{
+				// Callbacks run without the lock so that they can use the timeline
+				TimelineCallbackEntry entry;
+				if (pop_ready_callback(timeline, entry))
+				{
+					lock.unlock();
+					entry.callback(entry.point, entry.userData);
+					lock.lock();
+					continue;
+				}
+
+				// Wait on the device for everything that was submitted so far
+				if (timeline->waitFunction != nullptr && timeline->completedValue < timeline->submittedValue)
+				{
+					uint64_t target = timeline->submittedValue;
+					lock.unlock();
+					uint64_t reached = timeline->waitFunction(timeline->userData, target);
+					lock.lock();
+					set_completed(timeline, reached);
+					continue;
+				}
+
+				if (timeline->shutdown)
+					break;
+				timeline->workerCondition.wait(lock);
+			}
+		}
+
+		Timeline* create_timeline(bento::IAllocator& allocator, TimelineWaitFunction waitFunction, void* userData)
+		{
+			Timeline* timeline = bento::make_new<Timeline>(allocator, allocator);
+			timeline->waitFunction = waitFunction;
+			timeline->userData = userData;
+			timeline->worker = std::thread(worker_loop, timeline);
+			return timeline;
+		}
+
+		void destroy_timeline(Timeline* timeline)
+		{
+			{
+				std::lock_guard<std::mutex> lock(timeline->lock);
+				timeline->shutdown = true;
+			}
+			timeline->workerCondition.notify_one();
+			timeline->worker.join();
+			assert_msg(timeline->callbacks.size() == 0, "Destroying a timeline with callbacks on points that were never reached.");
+			bento::make_delete<Timeline>(timeline->_allocator, timeline);
+		}
+
+		uint64_t submit(Timeline* timeline)
+		{
+			std::lock_guard<std::mutex> lock(timeline->lock);
+			uint64_t point = ++timeline->submittedValue;
+			if (timeline->waitFunction != nullptr)
+				timeline->workerCondition.notify_one();
+			return point;
+		}
+
+		void signal(Timeline* timeline, uint64_t completedValue)
+		{
+			std::lock_guard<std::mutex> lock(timeline->lock);
+			set_completed(timeline, completedValue);
+		}
+
+		uint64_t last_submitted(Timeline* timeline)
+		{
+			std::lock_guard<std::mutex> lock(timeline->lock);
+			return timeline->submittedValue;
+		}
+
+		uint64_t completed_value(Timeline* timeline)
+		{
+			std::lock_guard<std::mutex> lock(timeline->lock);
+			return timeline->completedValue;
+		}
+
+		bool is_complete(Timeline* timeline, uint64_t point)
+		{
+			std::lock_guard<std::mutex> lock(timeline->lock);
+			return timeline->completedValue >= point;
+		}
+
+		bool wait_until(Timeline* timeline, uint64_t point, Clock::time_point deadline)
+		{
+			std::unique_lock<std::mutex> lock(timeline->lock);
+			assert_msg(point <= timeline->submittedValue, "Waiting on a point that was never submitted.");
+			return timeline->completedCondition.wait_until(lock, deadline, [&]() { return timeline->completedValue >= point; });
+		}
+
+		bool wait(Timeline* timeline, uint64_t point, uint64_t timeoutMS)
+		{
+			return wait_until(timeline, point, deadline(timeoutMS));
+		}
+
+		bool wait_all(Timeline* const* timelines, const uint64_t* points, uint32_t count, uint64_t timeoutMS)
+		{
+			// The deadline is shared by all the waits
+			Clock::time_point end = deadline(timeoutMS);
+			for (uint32_t timelineIdx = 0; timelineIdx < count; ++timelineIdx)
+			{
+				if (!wait_until(timelines[timelineIdx], points[timelineIdx], end))
+					return false;
+			}
+			return true;
+		}
+
+		uint32_t first_complete(Timeline* const* timelines, const uint64_t* points, uint32_t count)
+		{
+			for (uint32_t timelineIdx = 0; timelineIdx < count; ++timelineIdx)
+			{
+				if (is_complete(timelines[timelineIdx], points[timelineIdx]))
+					return timelineIdx;
+			}
+			return UINT32_MAX;
+		}
+
+		uint32_t wait_any(Timeline* const* timelines, const uint64_t* points, uint32_t count, uint64_t timeoutMS)
+		{
+			Clock::time_point end = deadline(timeoutMS);
+			TimelineWaiter waiter;
+			waiter.signaled = false;
+			for (uint32_t timelineIdx = 0; timelineIdx < count; ++timelineIdx)
+			{
+				std::lock_guard<std::mutex> lock(timelines[timelineIdx]->lock);
+				timelines[timelineIdx]->waiters.push_back(&waiter);
+			}
+
+			// Any progress after the registration flags the waiter, so no completion can be missed between the check and the wait
+			uint32_t reached = first_complete(timelines, points, count);
+			while (reached == UINT32_MAX)
+			{
+				{
+					std::unique_lock<std::mutex> waiterLock(waiter.lock);
+					if (!waiter.condition.wait_until(waiterLock, end, [&]() { return waiter.signaled; }))
+						break;
+					waiter.signaled = false;
+				}
+				reached = first_complete(timelines, points, count);
+			}
+
+			for (uint32_t timelineIdx = 0; timelineIdx < count; ++timelineIdx)
+			{
+				std::lock_guard<std::mutex> lock(timelines[timelineIdx]->lock);
+				std::vector<TimelineWaiter*>& waiters = timelines[timelineIdx]->waiters;
+				waiters.erase(std::find(waiters.begin(), waiters.end(), &waiter));
+			}
+			return reached;
+		}
+
+		void add_callback(Timeline* timeline, uint64_t point, TimelineCallback callback, void* userData)
+		{
+			std::lock_guard<std::mutex> lock(timeline->lock);
+			TimelineCallbackEntry entry;
+			entry.point = point;
+			entry.callback = callback;
+			entry.userData = userData;
+			timeline->callbacks.push_back(entry);
+			timeline->workerCondition.notify_one();
+		}
+	}
+}
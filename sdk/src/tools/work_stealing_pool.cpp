@@ -0,0 +1,265 @@
+// Bento includes
+#include <bento_base/security.h>
+
+// Internal includes
+#include "tools/work_stealing_pool.h"
+
+// System includes
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace graphics_sandbox
+{
+	// Each thread owns a contiguous range of batches [first, last) packed in a single atomic so that both the owner (front)
+	// and the thieves (back) can claim a batch with a single compare and swap.
+	struct ThreadQueue
+	{
+		std::atomic<uint64_t> range;
+		char padding[64 - sizeof(std::atomic<uint64_t>)];
+	};
+
+	struct PoolTask
+	{
+		TaskFunction function;
+		void* userData;
+	};
+
+	struct WorkStealingPool
+	{
+		ALLOCATOR_BASED;
+		WorkStealingPool(bento::IAllocator& allocator, uint32_t workerCount)
+		: _allocator(allocator)
+		, queues(workerCount + 1)
+		, function(nullptr)
+		, count(0)
+		, batchSize(1)
+		, pendingBatches(0)
+		, generation(0)
+		, shutdown(false)
+		, tasks(allocator)
+		, nextTask(0)
+		{
+		}
+
+		// Worker threads, the calling thread always uses the queue 0
+		std::vector<std::thread> workers;
+		std::vector<ThreadQueue> queues;
+
+		// Loop that is currently being processed
+		const RangeFunction* function;
+		uint32_t count;
+		uint32_t batchSize;
+		std::atomic<uint32_t> pendingBatches;
+
+		// Wake up mechanism for the workers
+		std::mutex lock;
+		std::condition_variable wakeCondition;
+		uint64_t generation;
+		bool shutdown;
+
+		// Background tasks, guarded by the lock. The ones before nextTask have been taken by a worker.
+		bento::Vector<PoolTask> tasks;
+		uint32_t nextTask;
+
+		// Only one loop can be in flight at a given time
+		std::mutex submitLock;
+		bento::IAllocator& _allocator;
+	};
+
+	namespace work_stealing_pool
+	{
+		uint64_t pack_range(uint32_t first, uint32_t last)
+		{
+			return (uint64_t)first | ((uint64_t)last << 32);
+		}
+
+		bool pop_front(ThreadQueue& queue, uint32_t& batchIdx)
+		{
+			uint64_t range = queue.range.load(std::memory_order_acquire);
+			while (true)
+			{
+				uint32_t first = (uint32_t)range;
+				uint32_t last = (uint32_t)(range >> 32);
+				if (first >= last)
+					return false;
+				if (queue.range.compare_exchange_weak(range, pack_range(first + 1, last), std::memory_order_acq_rel, std::memory_order_acquire))
+				{
+					batchIdx = first;
+					return true;
+				}
+			}
+		}
+
+		bool steal_back(ThreadQueue& queue, uint32_t& batchIdx)
+		{
+			uint64_t range = queue.range.load(std::memory_order_acquire);
+			while (true)
+			{
+				uint32_t first = (uint32_t)range;
+				uint32_t last = (uint32_t)(range >> 32);
+				if (first >= last)
+					return false;
+				if (queue.range.compare_exchange_weak(range, pack_range(first, last - 1), std::memory_order_acq_rel, std::memory_order_acquire))
+				{
+					batchIdx = last - 1;
+					return true;
+				}
+			}
+		}
+
+		bool acquire_batch(WorkStealingPool* pool, uint32_t threadIdx, uint32_t& batchIdx)
+		{
+			// Our own queue first, this keeps every thread walking through contiguous memory
+			if (pop_front(pool->queues[threadIdx], batchIdx))
+				return true;
+
+			// Then try to steal from the others
+			uint32_t numQueues = (uint32_t)pool->queues.size();
+			for (uint32_t offset = 1; offset < numQueues; ++offset)
+			{
+				if (steal_back(pool->queues[(threadIdx + offset) % numQueues], batchIdx))
+					return true;
+			}
+			return false;
+		}
+
+		void process_batches(WorkStealingPool* pool, uint32_t threadIdx)
+		{
+			uint32_t batchIdx;
+			while (acquire_batch(pool, threadIdx, batchIdx))
+			{
+				uint32_t begin = batchIdx * pool->batchSize;
+				uint32_t end = std::min(begin + pool->batchSize, pool->count);
+				(*pool->function)(begin, end);
+				pool->pendingBatches.fetch_sub(1, std::memory_order_acq_rel);
+			}
+		}
+
+		void worker_loop(WorkStealingPool* pool, uint32_t threadIdx)
+		{
+			uint64_t seenGeneration = 0;
+			while (true)
+			{
+				PoolTask task = { nullptr, nullptr };
+				{
+					std::unique_lock<std::mutex> lock(pool->lock);
+					pool->wakeCondition.wait(lock, [&] { return pool->shutdown || pool->generation != seenGeneration || pool->nextTask < pool->tasks.size(); });
+					if (pool->shutdown)
+						return;
+					seenGeneration = pool->generation;
+
+					// Take the oldest task, the queue is emptied once they have all been taken
+					if (pool->nextTask < pool->tasks.size())
+					{
+						task = pool->tasks[pool->nextTask++];
+						if (pool->nextTask == pool->tasks.size())
+						{
+							pool->tasks.clear();
+							pool->nextTask = 0;
+						}
+					}
+				}
+
+				// The loops come first, their caller is blocked
+				process_batches(pool, threadIdx);
+				if (task.function != nullptr)
+					task.function(task.userData);
+			}
+		}
+
+		WorkStealingPool* create_pool(bento::IAllocator& allocator, uint32_t numWorkers)
+		{
+			if (numWorkers == 0)
+			{
+				uint32_t hardwareThreads = std::thread::hardware_concurrency();
+				numWorkers = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+			}
+
+			WorkStealingPool* pool = bento::make_new<WorkStealingPool>(allocator, allocator, numWorkers);
+			for (uint32_t queueIdx = 0; queueIdx < (uint32_t)pool->queues.size(); ++queueIdx)
+				pool->queues[queueIdx].range.store(0, std::memory_order_relaxed);
+
+			// Spawn the workers, they will sleep until a loop is submitted
+			for (uint32_t workerIdx = 0; workerIdx < numWorkers; ++workerIdx)
+				pool->workers.push_back(std::thread(worker_loop, pool, workerIdx + 1));
+			return pool;
+		}
+
+		void destroy_pool(WorkStealingPool* pool)
+		{
+			{
+				std::lock_guard<std::mutex> lock(pool->lock);
+				pool->shutdown = true;
+			}
+			pool->wakeCondition.notify_all();
+			for (uint32_t workerIdx = 0; workerIdx < (uint32_t)pool->workers.size(); ++workerIdx)
+				pool->workers[workerIdx].join();
+			assert_msg(pool->nextTask == pool->tasks.size(), "Tasks were never run.");
+			bento::make_delete<WorkStealingPool>(pool->_allocator, pool);
+		}
+
+		uint32_t num_threads(const WorkStealingPool* pool)
+		{
+			return (uint32_t)pool->queues.size();
+		}
+
+		void parallel_for(WorkStealingPool* pool, uint32_t count, uint32_t batchSize, const RangeFunction& function)
+		{
+			if (count == 0)
+				return;
+			batchSize = std::max(batchSize, 1u);
+
+			// Not worth waking anyone up
+			uint32_t numBatches = (count + batchSize - 1) / batchSize;
+			if (numBatches == 1 || pool->workers.size() == 0)
+			{
+				function(0, count);
+				return;
+			}
+
+			std::lock_guard<std::mutex> submitLock(pool->submitLock);
+
+			// The pending count and the loop parameters must be visible before the batches are published
+			pool->pendingBatches.store(numBatches, std::memory_order_relaxed);
+			pool->function = &function;
+			pool->count = count;
+			pool->batchSize = batchSize;
+
+			// Every queue receives a contiguous chunk of batches
+			uint32_t numQueues = (uint32_t)pool->queues.size();
+			for (uint32_t queueIdx = 0; queueIdx < numQueues; ++queueIdx)
+			{
+				uint32_t first = (uint32_t)((uint64_t)numBatches * queueIdx / numQueues);
+				uint32_t last = (uint32_t)((uint64_t)numBatches * (queueIdx + 1) / numQueues);
+				pool->queues[queueIdx].range.store(pack_range(first, last), std::memory_order_release);
+			}
+
+			// Wake up the workers
+			{
+				std::lock_guard<std::mutex> lock(pool->lock);
+				pool->generation++;
+			}
+			pool->wakeCondition.notify_all();
+
+			// The calling thread participates and then waits for the batches stolen by the others
+			process_batches(pool, 0);
+			while (pool->pendingBatches.load(std::memory_order_acquire) != 0)
+				std::this_thread::yield();
+		}
+
+		void submit(WorkStealingPool* pool, TaskFunction function, void* userData)
+		{
+			assert_msg(pool->workers.size() > 0, "The pool has no worker to run the task.");
+			{
+				std::lock_guard<std::mutex> lock(pool->lock);
+				PoolTask task = { function, userData };
+				pool->tasks.push_back(task);
+			}
+			pool->wakeCondition.notify_one();
+		}
+	}
+}
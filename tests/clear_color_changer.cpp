@@ -13,7 +13,7 @@
 using namespace graphics_sandbox;
 using namespace graphics_sandbox::d3d12;
 
-void Render(CommandQueue commandQueue, CommandBuffer commandBuffer, SwapChain swapChain)
+uint64_t Render(CommandQueue commandQueue, CommandBuffer commandBuffer, SwapChain swapChain)
 {
 	// Reset the command buffer
 	command_buffer::reset(commandBuffer);
@@ -43,7 +43,7 @@ void Render(CommandQueue commandQueue, CommandBuffer commandBuffer, SwapChain sw
 	command_queue::execute_command_buffer(commandQueue, commandBuffer);
 
 	// Present
-	swap_chain::present(swapChain, commandQueue);
+	return swap_chain::present(swapChain, commandQueue);
 }
 
 int CALLBACK main(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR lpCmdLine, int nCmdShow)
@@ -73,6 +73,7 @@ int CALLBACK main(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR lpCmdLine,
 
     // Render loop
 	bool activeLoop = true;
+	uint64_t previousFrame = 0;
     while (activeLoop)
     {
 		FrameEvent frameEvent;
@@ -82,7 +83,9 @@ int CALLBACK main(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR lpCmdLine,
 			{
 				case FrameEvent::Paint:
 				{
-					Render(commandQueue, commandBuffer, swapChain);
+					// Keep at most one frame in flight while recording the next one
+					command_queue::wait(commandQueue, previousFrame);
+					previousFrame = Render(commandQueue, commandBuffer, swapChain);
 				}
 				break;
 				case FrameEvent::Close:
@@ -108,6 +111,7 @@ int CALLBACK main(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR lpCmdLine,
     }
 
     // Destroy the command buffer
+    command_queue::flush(commandQueue);
     command_buffer::destroy_command_buffer(commandBuffer);
 
 	// Destroy the swap chain
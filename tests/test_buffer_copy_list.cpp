@@ -0,0 +1,198 @@
+// System includes
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Bento includes
+#include <bento_base/security.h>
+#include <bento_memory/common.h>
+
+// SDK includes
+#include "gpu_backend/buffer_copy_list.h"
+#include "cpu_backend/cpu_backend.h"
+
+using namespace graphics_sandbox;
+
+const uint32_t bufferSize = 4096;
+
+// Reference: every region copied in order, byte by byte
+void apply_regions(const std::vector<uint8_t>& source, std::vector<uint8_t>& destination, const BufferCopyRegion* regions, uint32_t numRegions)
+{
+    for (uint32_t regionIdx = 0; regionIdx < numRegions; ++regionIdx)
+        for (uint64_t byteIdx = 0; byteIdx < regions[regionIdx].size; ++byteIdx)
+            destination[regions[regionIdx].dstOffset + byteIdx] = source[regions[regionIdx].srcOffset + byteIdx];
+}
+
+void test_validation()
+{
+    BufferCopyRegion fits = { 0, 96, 32 };
+    BufferCopyRegion empty = { 128, 128, 0 };
+    BufferCopyRegion tooLarge = { 100, 0, 29 };
+    BufferCopyRegion overflow = { 8, 8, UINT64_MAX - 4 };
+    assert_msg(buffer_copy_list::validate_region(128, 128, fits) && buffer_copy_list::validate_region(128, 128, empty), "Valid region rejected");
+    assert_msg(!buffer_copy_list::validate_region(128, 128, tooLarge) && !buffer_copy_list::validate_region(128, 128, overflow), "Invalid region accepted");
+}
+
+void test_merges()
+{
+    // Adjacent in both buffers, out of order, plus an empty one
+    bento::Vector<BufferCopyRegion> regions(*bento::common_allocator());
+    BufferCopyRegion adjacent[4] = { { 64, 1064, 64 }, { 0, 1000, 64 }, { 500, 500, 0 }, { 128, 1128, 8 } };
+    for (const BufferCopyRegion& region : adjacent)
+        regions.push_back(region);
+    assert_msg(buffer_copy_list::coalesce(regions) && regions.size() == 1, "Adjacent regions not merged");
+    assert_msg(regions[0].srcOffset == 0 && regions[0].dstOffset == 1000 && regions[0].size == 136, "Wrong merged region");
+
+    // Contiguous in the destination only, they stay separate
+    regions.clear();
+    BufferCopyRegion gathered[2] = { { 0, 0, 16 }, { 32, 16, 16 } };
+    regions.push_back(gathered[0]);
+    regions.push_back(gathered[1]);
+    assert_msg(buffer_copy_list::coalesce(regions) && regions.size() == 2, "Gathered regions merged");
+
+    // Duplicated and overlapping updates of the same bytes copy the same data
+    regions.clear();
+    BufferCopyRegion duplicated[3] = { { 10, 10, 20 }, { 10, 10, 20 }, { 20, 20, 40 } };
+    for (const BufferCopyRegion& region : duplicated)
+        regions.push_back(region);
+    assert_msg(buffer_copy_list::coalesce(regions) && regions.size() == 1 && regions[0].size == 50, "Overlapping regions not merged");
+
+    // The same bytes written from two places
+    regions.clear();
+    BufferCopyRegion conflicting[2] = { { 0, 0, 16 }, { 100, 8, 16 } };
+    regions.push_back(conflicting[0]);
+    regions.push_back(conflicting[1]);
+    assert_msg(!buffer_copy_list::coalesce(regions), "Conflicting regions accepted");
+}
+
+void test_properties()
+{
+    std::mt19937 generator(7);
+    std::vector<uint8_t> source(bufferSize);
+    for (uint32_t byteIdx = 0; byteIdx < bufferSize; ++byteIdx)
+        source[byteIdx] = (uint8_t)generator();
+
+    uint32_t numValid = 0, numConflicts = 0;
+    for (uint32_t caseIdx = 0; caseIdx < 20000; ++caseIdx)
+    {
+        // Incremental updates: mostly runs of neighbouring blocks, some of them repeated or overlapping, sometimes a scattered one
+        uint32_t numRegions = 1 + generator() % 24;
+        bool gathered = generator() % 4 == 0;
+        std::vector<BufferCopyRegion> input;
+        uint64_t cursor = generator() % (bufferSize / 2);
+        for (uint32_t regionIdx = 0; regionIdx < numRegions; ++regionIdx)
+        {
+            BufferCopyRegion region;
+            region.size = generator() % 64;
+            uint32_t kind = generator() % 8;
+            if (kind == 0)
+                cursor = generator() % bufferSize;
+            else if (kind == 1 && cursor >= 16)
+                cursor -= 16;
+            region.dstOffset = std::min<uint64_t>(cursor, bufferSize - region.size);
+            region.srcOffset = gathered ? (generator() % (bufferSize - region.size)) : region.dstOffset;
+            cursor = region.dstOffset + region.size;
+            assert_msg(buffer_copy_list::validate_region(bufferSize, bufferSize, region), "Generated an invalid region");
+            input.push_back(region);
+        }
+
+        bento::Vector<BufferCopyRegion> regions(*bento::common_allocator());
+        for (const BufferCopyRegion& region : input)
+            regions.push_back(region);
+        std::vector<uint8_t> expected(bufferSize, 0);
+        apply_regions(source, expected, input.data(), numRegions);
+
+        if (!buffer_copy_list::coalesce(regions))
+        {
+            // Rejected only if some byte is written with two different source bytes
+            numConflicts++;
+            std::vector<int32_t> writer(bufferSize, -1);
+            bool conflict = false;
+            for (const BufferCopyRegion& region : input)
+                for (uint64_t byteIdx = 0; byteIdx < region.size; ++byteIdx)
+                {
+                    int32_t& origin = writer[region.dstOffset + byteIdx];
+                    conflict |= origin != -1 && origin != (int32_t)(region.srcOffset + byteIdx);
+                    origin = (int32_t)(region.srcOffset + byteIdx);
+                }
+            assert_msg(conflict, "Regions rejected without a conflict");
+            continue;
+        }
+        numValid++;
+
+        // Same bytes as the copies in order
+        std::vector<uint8_t> result(bufferSize, 0);
+        apply_regions(source, result, regions.begin(), regions.size());
+        assert_msg(result == expected, "Coalesced copies give a different result");
+
+        // Sorted, disjoint, non empty, nothing left to merge and never more copies or bytes than the input
+        uint64_t inputBytes = 0;
+        for (const BufferCopyRegion& region : input)
+            inputBytes += region.size;
+        assert_msg(regions.size() <= numRegions && buffer_copy_list::num_bytes(regions) <= inputBytes, "Coalescing added work");
+        for (uint32_t regionIdx = 0; regionIdx < regions.size(); ++regionIdx)
+        {
+            assert_msg(regions[regionIdx].size != 0, "Empty region kept");
+            if (regionIdx == 0)
+                continue;
+            const BufferCopyRegion& previous = regions[regionIdx - 1];
+            const BufferCopyRegion& current = regions[regionIdx];
+            assert_msg(previous.dstOffset + previous.size <= current.dstOffset, "Regions overlap or are unsorted");
+            assert_msg(previous.dstOffset + previous.size != current.dstOffset || previous.srcOffset + previous.size != current.srcOffset, "Mergeable regions left");
+        }
+    }
+    assert_msg(numValid > 0 && numConflicts > 0, "The generator doesn't cover both outcomes");
+    std::cout << "Coalesced " << numValid << " copy lists, rejected " << numConflicts << " conflicting ones" << std::endl;
+}
+
+void test_cpu_backend()
+{
+    using namespace graphics_sandbox::cpu;
+    GraphicsDevice graphicsDevice = graphics_device::create_graphics_device();
+    CommandQueue commandQueue = command_queue::create_command_queue(graphicsDevice);
+    CommandBuffer commandBuffer = command_buffer::create_command_buffer(graphicsDevice);
+
+    // Initial content, then a few updated blocks
+    GraphicsBuffer uploadBuffer = graphics_resources::create_graphics_buffer(graphicsDevice, bufferSize, 1, GraphicsBufferType::Upload);
+    GraphicsBuffer buffer = graphics_resources::create_graphics_buffer(graphicsDevice, bufferSize, 1, GraphicsBufferType::Default);
+    GraphicsBuffer readbackBuffer = graphics_resources::create_graphics_buffer(graphicsDevice, bufferSize, 1, GraphicsBufferType::Readback);
+    std::vector<uint8_t> data(bufferSize);
+    for (uint32_t byteIdx = 0; byteIdx < bufferSize; ++byteIdx)
+        data[byteIdx] = (uint8_t)byteIdx;
+    graphics_resources::set_data(uploadBuffer, (char*)data.data(), bufferSize);
+
+    BufferCopyRegion updates[3] = { { 256, 256, 128 }, { 0, 0, 64 }, { 384, 384, 128 } };
+    std::vector<uint8_t> expected(bufferSize, 0);
+    apply_regions(data, expected, updates, 3);
+    expected[4000] = data[100];
+
+    command_buffer::reset(commandBuffer);
+    command_buffer::copy_buffer_regions(commandBuffer, uploadBuffer, buffer, updates, 3);
+    command_buffer::copy_buffer_region(commandBuffer, uploadBuffer, 100, buffer, 4000, 1);
+    command_buffer::copy_graphics_buffer(commandBuffer, buffer, readbackBuffer);
+    command_buffer::close(commandBuffer);
+    command_queue::execute_command_buffer(commandQueue, commandBuffer);
+    command_queue::flush(commandQueue);
+
+    uint8_t* outputData = (uint8_t*)graphics_resources::allocate_cpu_buffer(readbackBuffer);
+    for (uint32_t byteIdx = 0; byteIdx < bufferSize; ++byteIdx)
+        assert_msg(outputData[byteIdx] == expected[byteIdx], "Wrong byte after the region copies");
+    graphics_resources::release_cpu_buffer(readbackBuffer);
+
+    graphics_resources::destroy_graphics_buffer(readbackBuffer);
+    graphics_resources::destroy_graphics_buffer(buffer);
+    graphics_resources::destroy_graphics_buffer(uploadBuffer);
+    command_buffer::destroy_command_buffer(commandBuffer);
+    command_queue::destroy_command_queue(commandQueue);
+    graphics_device::destroy_graphics_device(graphicsDevice);
+}
+
+int main()
+{
+    test_validation();
+    test_merges();
+    test_properties();
+    test_cpu_backend();
+    std::cout << "Buffer copy list tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,163 @@
+// System includes
+#include <iostream>
+#include <set>
+
+// Bento includes
+#include <bento_base/security.h>
+#include <bento_memory/common.h>
+
+// SDK includes
+#include "gpu_backend/buffer_view_cache.h"
+
+using namespace graphics_sandbox;
+
+void test_ranges()
+{
+    // 1000 elements of 16 bytes
+    assert_msg(buffer_view_cache::validate_element_range(16000, 16, 0, 1000), "Whole buffer rejected");
+    assert_msg(buffer_view_cache::validate_element_range(16000, 16, 999, 1), "Last element rejected");
+    assert_msg(!buffer_view_cache::validate_element_range(16000, 16, 999, 2), "Range past the end accepted");
+    assert_msg(!buffer_view_cache::validate_element_range(16000, 16, 1000, 1), "Range after the end accepted");
+    assert_msg(!buffer_view_cache::validate_element_range(16000, 16, 10, 0), "Empty range accepted");
+    assert_msg(!buffer_view_cache::validate_element_range(16000, 16, 1, UINT64_MAX), "Overflowing range accepted");
+    assert_msg(!buffer_view_cache::validate_element_range(16000, 0, 0, 1), "Range without elements accepted");
+
+    // CBVs need aligned offsets, their size is rounded up
+    assert_msg(buffer_view_cache::aligned_cbv_size(1) == 256 && buffer_view_cache::aligned_cbv_size(256) == 256 && buffer_view_cache::aligned_cbv_size(257) == 512, "Wrong CBV size");
+    assert_msg(buffer_view_cache::validate_cbv_range(1024, 512, 512), "Aligned CBV rejected");
+    assert_msg(buffer_view_cache::validate_cbv_range(1024, 768, 100), "Small CBV rejected");
+    assert_msg(!buffer_view_cache::validate_cbv_range(1024, 100, 100), "Misaligned CBV accepted");
+    assert_msg(!buffer_view_cache::validate_cbv_range(1000, 768, 200), "CBV whose aligned size doesn't fit accepted");
+    assert_msg(!buffer_view_cache::validate_cbv_range(1024, 1024, 1), "CBV after the end accepted");
+    assert_msg(!buffer_view_cache::validate_cbv_range(1024, 0, 0), "Empty CBV accepted");
+}
+
+void test_keys()
+{
+    // Every type, offset and count gives a distinct key
+    std::set<uint64_t> keys;
+    for (uint32_t typeIdx = 0; typeIdx < (uint32_t)BufferViewType::Count; ++typeIdx)
+        for (uint64_t first = 0; first < 8; ++first)
+            for (uint64_t count = 1; count < 8; ++count)
+                keys.insert(buffer_view_cache::view_key((BufferViewType)typeIdx, first * 256, count * 256));
+    assert_msg(keys.size() == 3 * 8 * 7, "Key collision");
+
+    // CBVs whose sizes round up to the same view share it
+    assert_msg(buffer_view_cache::view_key(BufferViewType::CBV, 512, 100) == buffer_view_cache::view_key(BufferViewType::CBV, 512, 256), "Equivalent CBVs have different keys");
+    assert_msg(buffer_view_cache::view_key(BufferViewType::SRV, 512, 100) != buffer_view_cache::view_key(BufferViewType::SRV, 512, 256), "Element ranges merged");
+}
+
+void test_cache()
+{
+    BufferViewCache* cache = buffer_view_cache::create_cache(*bento::common_allocator(), 4);
+    uint64_t view = 0;
+    uint64_t evicted = 0;
+    uint64_t key = buffer_view_cache::view_key(BufferViewType::SRV, 0, 10);
+    assert_msg(!buffer_view_cache::lookup(cache, key, view), "Empty cache hit");
+    assert_msg(!buffer_view_cache::insert(cache, key, 42, evicted) && buffer_view_cache::lookup(cache, key, view) && view == 42, "Inserted view not found");
+    buffer_view_cache::update(cache, key, 43);
+    assert_msg(buffer_view_cache::lookup(cache, key, view) && view == 43 && buffer_view_cache::size(cache) == 1, "View not updated");
+    buffer_view_cache::destroy_cache(cache);
+}
+
+void test_eviction()
+{
+    // A window sliding over a big buffer never holds more than the capacity
+    const uint32_t capacity = 8;
+    const uint32_t numSlices = 512;
+    BufferViewCache* cache = buffer_view_cache::create_cache(*bento::common_allocator(), capacity);
+    std::set<uint64_t> alive;
+    for (uint32_t sliceIdx = 0; sliceIdx < numSlices; ++sliceIdx)
+    {
+        uint64_t sliceKey = buffer_view_cache::view_key(BufferViewType::UAV, sliceIdx * 1024, 1024);
+        uint64_t sliceView;
+        assert_msg(!buffer_view_cache::lookup(cache, sliceKey, sliceView), "New slice hit");
+        uint64_t evicted;
+        bool full = buffer_view_cache::insert(cache, sliceKey, sliceIdx, evicted);
+        assert_msg(full == (sliceIdx >= capacity), "Wrong eviction");
+        if (full)
+        {
+            // The window slides, the oldest slice leaves first
+            assert_msg(evicted == sliceIdx - capacity, "Evicted the wrong slice");
+            alive.erase(evicted);
+        }
+        alive.insert(sliceIdx);
+        assert_msg(buffer_view_cache::size(cache) == alive.size(), "Wrong number of views");
+    }
+
+    // A range that keeps being bound survives the others
+    uint64_t hotKey = buffer_view_cache::view_key(BufferViewType::SRV, 0, 16);
+    uint64_t evicted;
+    buffer_view_cache::insert(cache, hotKey, 5000, evicted);
+    alive.erase(evicted);
+    for (uint32_t sliceIdx = numSlices; sliceIdx < 2 * numSlices; ++sliceIdx)
+    {
+        uint64_t hotView;
+        assert_msg(buffer_view_cache::lookup(cache, hotKey, hotView) && hotView == 5000, "Recently used range evicted");
+        assert_msg(buffer_view_cache::insert(cache, buffer_view_cache::view_key(BufferViewType::UAV, sliceIdx * 1024, 1024), sliceIdx, evicted) && evicted != 5000, "Recently used view evicted");
+        alive.erase(evicted);
+        alive.insert(sliceIdx);
+    }
+
+    // The views left are exactly the ones that were never evicted
+    bento::Vector<uint64_t> views(*bento::common_allocator());
+    buffer_view_cache::views(cache, views);
+    assert_msg(views.size() == capacity, "Views missing");
+    alive.insert(5000);
+    for (uint32_t viewIdx = 0; viewIdx < views.size(); ++viewIdx)
+        assert_msg(alive.count(views[viewIdx]) == 1, "Evicted view still in the cache");
+    assert_msg(alive.size() == capacity, "Evicted views were lost");
+    buffer_view_cache::destroy_cache(cache);
+}
+
+void test_pinning()
+{
+    // Two ranges stay bound to slots while others stream through the cache
+    const uint32_t capacity = 4;
+    BufferViewCache* cache = buffer_view_cache::create_cache(*bento::common_allocator(), capacity);
+    uint64_t evicted;
+    uint64_t boundA = buffer_view_cache::view_key(BufferViewType::SRV, 0, 16);
+    uint64_t boundB = buffer_view_cache::view_key(BufferViewType::UAV, 0, 16);
+    buffer_view_cache::insert(cache, boundA, 100, evicted);
+    buffer_view_cache::pin(cache, boundA);
+    buffer_view_cache::insert(cache, boundB, 200, evicted);
+    buffer_view_cache::pin(cache, boundB);
+    buffer_view_cache::pin(cache, boundB);
+    for (uint32_t sliceIdx = 0; sliceIdx < 64; ++sliceIdx)
+    {
+        bool full = buffer_view_cache::insert(cache, buffer_view_cache::view_key(BufferViewType::UAV, 16 + sliceIdx, 1), sliceIdx, evicted);
+        assert_msg(!full || (evicted != 100 && evicted != 200), "Pinned view evicted");
+    }
+    assert_msg(buffer_view_cache::size(cache) == capacity, "Unpinned views not evicted");
+
+    // Everything pinned, the cache grows instead of recycling a bound view
+    uint64_t extraKey = buffer_view_cache::view_key(BufferViewType::CBV, 256, 256);
+    buffer_view_cache::insert(cache, extraKey, 300, evicted);
+    buffer_view_cache::pin(cache, extraKey);
+    for (uint32_t sliceIdx = 64; sliceIdx < 66; ++sliceIdx)
+    {
+        uint64_t sliceKey = buffer_view_cache::view_key(BufferViewType::UAV, 16 + sliceIdx, 1);
+        buffer_view_cache::insert(cache, sliceKey, sliceIdx, evicted);
+        buffer_view_cache::pin(cache, sliceKey);
+    }
+    uint64_t lastKey = buffer_view_cache::view_key(BufferViewType::UAV, 1000, 1);
+    assert_msg(!buffer_view_cache::insert(cache, lastKey, 400, evicted) && buffer_view_cache::size(cache) == capacity + 2, "Pinned view evicted from a full cache");
+
+    // Once a slot binds something else, its view can go
+    buffer_view_cache::unpin(cache, boundA);
+    assert_msg(buffer_view_cache::insert(cache, buffer_view_cache::view_key(BufferViewType::UAV, 2000, 1), 500, evicted) && evicted == 100, "Unpinned view kept");
+    buffer_view_cache::unpin(cache, boundB);
+    assert_msg(buffer_view_cache::insert(cache, buffer_view_cache::view_key(BufferViewType::UAV, 3000, 1), 600, evicted) && evicted != 200, "View evicted while still pinned once");
+    buffer_view_cache::destroy_cache(cache);
+}
+
+int main()
+{
+    test_ranges();
+    test_keys();
+    test_cache();
+    test_eviction();
+    test_pinning();
+    std::cout << "Buffer view cache tests passed" << std::endl;
+    return 0;
+}
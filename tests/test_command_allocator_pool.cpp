@@ -0,0 +1,155 @@
+// System includes
+#include <iostream>
+
+// Bento includes
+#include <bento_base/security.h>
+#include <bento_memory/common.h>
+
+// SDK includes
+#include "gpu_backend/command_allocator_pool.h"
+
+using namespace graphics_sandbox;
+
+// Fence of a simulated queue, the GPU completes the submissions when asked to
+struct SimulatedQueue
+{
+    uint64_t fence;
+    uint64_t submittedValue;
+    uint64_t completedValue;
+};
+
+// Per allocator bookkeeping of the simulation, indexed by the allocator identifier
+const uint32_t MaxAllocators = 8;
+struct SimulatedAllocators
+{
+    uint64_t lastSubmission[MaxAllocators];
+    bool owned[MaxAllocators];
+    uint32_t numCreated;
+};
+
+uint64_t acquire(CommandAllocatorPool& pool, SimulatedAllocators& allocators)
+{
+    uint64_t allocator;
+    if (!command_allocator_pool::acquire(pool, allocator))
+    {
+        assert_msg(allocators.numCreated < MaxAllocators, "Too many allocators created");
+        allocator = allocators.numCreated++;
+        command_allocator_pool::add(pool, allocator);
+    }
+    assert_msg(!allocators.owned[allocator], "Allocator acquired twice");
+    allocators.owned[allocator] = true;
+    return allocator;
+}
+
+void submit(CommandAllocatorPool& pool, SimulatedQueue& queue, SimulatedAllocators& allocators, uint64_t allocator)
+{
+    queue.submittedValue++;
+    allocators.lastSubmission[allocator] = queue.submittedValue;
+    command_allocator_pool::submit(pool, allocator, queue.fence, queue.submittedValue);
+    command_allocator_pool::reclaim(pool, queue.fence, queue.completedValue);
+}
+
+void test_frames_in_flight()
+{
+    CommandAllocatorPool pool(*bento::common_allocator());
+    SimulatedQueue queue = { 0x100, 0, 0 };
+    SimulatedAllocators allocators = {};
+
+    // Two command buffers alternate, the GPU lags two frames behind the CPU
+    const uint32_t framesInFlight = 2;
+    uint64_t commandBuffers[2] = { acquire(pool, allocators), acquire(pool, allocators) };
+    for (uint32_t frameIdx = 0; frameIdx < 100; ++frameIdx)
+    {
+        uint64_t& allocator = commandBuffers[frameIdx % 2];
+
+        // Reset: the previous allocator goes back to the pool and the new one must be complete
+        allocators.owned[allocator] = false;
+        command_allocator_pool::release(pool, allocator);
+        allocator = acquire(pool, allocators);
+        assert_msg(allocators.lastSubmission[allocator] <= queue.completedValue, "Allocator recycled while in flight");
+
+        submit(pool, queue, allocators, allocator);
+        if (queue.submittedValue > framesInFlight)
+            queue.completedValue = queue.submittedValue - framesInFlight;
+    }
+
+    // Recording never waited for the GPU, the pool only grew to cover the frames in flight
+    assert_msg(allocators.numCreated == 2 + framesInFlight, "Wrong number of allocators");
+    assert_msg(pool.numAllocators == allocators.numCreated, "Pool lost track of the allocators");
+}
+
+void test_wait_for_oldest()
+{
+    CommandAllocatorPool pool(*bento::common_allocator());
+    SimulatedQueue queue = { 0x100, 0, 0 };
+    SimulatedAllocators allocators = {};
+
+    // Nothing completed, the released allocators can't be recycled
+    uint64_t first = acquire(pool, allocators);
+    submit(pool, queue, allocators, first);
+    command_allocator_pool::release(pool, first);
+    uint64_t second = acquire(pool, allocators);
+    submit(pool, queue, allocators, second);
+    command_allocator_pool::release(pool, second);
+    uint64_t allocator;
+    assert_msg(!command_allocator_pool::acquire(pool, allocator), "Acquired an allocator in flight");
+
+    // This is what the backend waits on when the pool is full
+    uint64_t fence, fenceValue;
+    assert_msg(command_allocator_pool::oldest_fence(pool, fence, fenceValue) && fence == queue.fence && fenceValue == 1, "Wrong oldest fence");
+    command_allocator_pool::reclaim(pool, queue.fence, 1);
+    assert_msg(command_allocator_pool::acquire(pool, allocator) && allocator == first, "Oldest allocator was not recycled");
+}
+
+void test_unreleased_and_resubmitted()
+{
+    CommandAllocatorPool pool(*bento::common_allocator());
+    SimulatedQueue queue = { 0x100, 0, 0 };
+    SimulatedAllocators allocators = {};
+
+    // A complete allocator still owned by its command buffer is not recycled
+    uint64_t allocator = acquire(pool, allocators);
+    submit(pool, queue, allocators, allocator);
+    command_allocator_pool::reclaim(pool, queue.fence, 1);
+    uint64_t other;
+    assert_msg(!command_allocator_pool::acquire(pool, other), "Recycled an owned allocator");
+
+    // Executing the command buffer again moves the allocator to its last submission
+    submit(pool, queue, allocators, allocator);
+    command_allocator_pool::release(pool, allocator);
+    command_allocator_pool::reclaim(pool, queue.fence, 1);
+    assert_msg(!command_allocator_pool::acquire(pool, other), "Recycled before the last submission");
+    command_allocator_pool::reclaim(pool, queue.fence, 2);
+    assert_msg(command_allocator_pool::acquire(pool, other) && other == allocator && pool.inFlight.size() == 0, "Resubmitted allocator was not recycled");
+}
+
+void test_forget_fence()
+{
+    CommandAllocatorPool pool(*bento::common_allocator());
+    SimulatedQueue queueA = { 0x100, 0, 0 };
+    SimulatedQueue queueB = { 0x200, 0, 0 };
+    SimulatedAllocators allocators = {};
+
+    uint64_t allocatorA = acquire(pool, allocators);
+    uint64_t allocatorB = acquire(pool, allocators);
+    submit(pool, queueA, allocators, allocatorA);
+    submit(pool, queueB, allocators, allocatorB);
+    command_allocator_pool::release(pool, allocatorA);
+    command_allocator_pool::release(pool, allocatorB);
+
+    // Destroying queue A (after a flush) only frees its own allocators
+    command_allocator_pool::forget_fence(pool, queueA.fence);
+    assert_msg(pool.available.size() == 1 && pool.available[0] == allocatorA, "Wrong allocator freed");
+    uint64_t fence, fenceValue;
+    assert_msg(command_allocator_pool::oldest_fence(pool, fence, fenceValue) && fence == queueB.fence, "Wrong oldest fence");
+}
+
+int main()
+{
+    test_frames_in_flight();
+    test_wait_for_oldest();
+    test_unreleased_and_resubmitted();
+    test_forget_fence();
+    std::cout << "All command allocator pool tests passed" << std::endl;
+    return 0;
+}
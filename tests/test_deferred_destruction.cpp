@@ -0,0 +1,189 @@
+// System includes
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// Bento includes
+#include <bento_base/security.h>
+#include <bento_memory/common.h>
+
+// SDK includes
+#include "gpu_backend/deferred_destruction.h"
+
+using namespace graphics_sandbox;
+
+// Fake fence identifiers, the queue never interprets them
+const uint64_t FenceA = 0x100;
+const uint64_t FenceB = 0x200;
+
+// Simulated GPU objects, they record whether their fences were reached when they were released
+struct FakeObject
+{
+    uint64_t valueA;
+    uint64_t valueB;
+    uint32_t releaseOrder;
+    std::atomic<uint32_t> numReleases;
+};
+
+struct SimulatedDevice
+{
+    std::atomic<uint64_t> completedA;
+    std::atomic<uint64_t> completedB;
+    std::atomic<uint32_t> numReleased;
+    std::atomic<uint32_t> numEarly;
+};
+
+void release_object(uint64_t object, void* userData)
+{
+    FakeObject* fakeObject = (FakeObject*)object;
+    SimulatedDevice* device = (SimulatedDevice*)userData;
+    if (fakeObject->valueA > device->completedA.load() || fakeObject->valueB > device->completedB.load())
+        device->numEarly++;
+    fakeObject->releaseOrder = device->numReleased++;
+    fakeObject->numReleases++;
+}
+
+void test_fences()
+{
+    SimulatedDevice device;
+    device.completedA = 0;
+    device.completedB = 0;
+    device.numReleased = 0;
+    device.numEarly = 0;
+    DeferredDestructionQueue* queue = deferred_destruction::create_queue(*bento::common_allocator());
+
+    // Used by both queues, by one queue and by none
+    FakeObject both, onlyA, unused;
+    both.valueA = 2; both.valueB = 1; both.numReleases = 0;
+    onlyA.valueA = 1; onlyA.valueB = 0; onlyA.numReleases = 0;
+    unused.valueA = 0; unused.valueB = 0; unused.numReleases = 0;
+    uint64_t fences[2] = { FenceA, FenceB };
+    uint64_t values[2] = { both.valueA, both.valueB };
+    deferred_destruction::enqueue(queue, (uint64_t)&both, release_object, &device, fences, values, 2);
+    deferred_destruction::enqueue(queue, (uint64_t)&onlyA, release_object, &device, fences, &onlyA.valueA, 1);
+    deferred_destruction::enqueue(queue, (uint64_t)&unused, release_object, &device, nullptr, nullptr, 0);
+    assert_msg(deferred_destruction::num_pending(queue) == 3, "Wrong pending count");
+
+    // Only the object without fences can go
+    uint64_t completed[2] = { 0, 0 };
+    assert_msg(deferred_destruction::collect(queue, fences, completed, 2) == 1 && unused.numReleases == 1, "Unused object not released");
+
+    // Reaching a fence value releases the objects that only waited for it
+    device.completedA = 2;
+    completed[0] = 2;
+    assert_msg(deferred_destruction::collect(queue, fences, completed, 1) == 1 && onlyA.numReleases == 1 && both.numReleases == 0, "Wrong release on fence A");
+
+    // The second fence is reached in a later collection, the first one is remembered
+    device.completedB = 1;
+    completed[1] = 1;
+    assert_msg(deferred_destruction::collect(queue, fences + 1, completed + 1, 1) == 1 && both.numReleases == 1, "Object waiting on both fences not released");
+    assert_msg(deferred_destruction::num_pending(queue) == 0 && device.numEarly == 0, "Wrong final state");
+
+    // Forgetting a fence (its queue is destroyed) and destroying the queue release the leftovers in order
+    FakeObject first, second;
+    first.valueA = 10; first.valueB = 0; first.numReleases = 0;
+    second.valueA = 10; second.valueB = 10; second.numReleases = 0;
+    deferred_destruction::enqueue(queue, (uint64_t)&first, release_object, &device, fences, &first.valueA, 1);
+    deferred_destruction::enqueue(queue, (uint64_t)&second, release_object, &device, fences, values, 2);
+    uint64_t forgotten = UINT64_MAX;
+    device.completedA = UINT64_MAX;
+    assert_msg(deferred_destruction::collect(queue, fences, &forgotten, 1) == 1 && first.numReleases == 1, "Forgotten fence still waited for");
+    device.completedB = UINT64_MAX;
+    deferred_destruction::destroy_queue(queue);
+    assert_msg(second.numReleases == 1 && second.releaseOrder > first.releaseOrder, "Leftovers not released");
+}
+
+void test_enqueue_order()
+{
+    SimulatedDevice device;
+    device.completedA = 5;
+    device.completedB = 0;
+    device.numReleased = 0;
+    device.numEarly = 0;
+    DeferredDestructionQueue* queue = deferred_destruction::create_queue(*bento::common_allocator());
+
+    // Objects released by the same collection go in enqueue order, across collections too
+    const uint32_t numObjects = 16;
+    std::vector<FakeObject> objects(numObjects);
+    for (uint32_t objectIdx = 0; objectIdx < numObjects; ++objectIdx)
+    {
+        objects[objectIdx].valueA = 1 + objectIdx % 3;
+        objects[objectIdx].valueB = 0;
+        objects[objectIdx].numReleases = 0;
+        deferred_destruction::enqueue(queue, (uint64_t)&objects[objectIdx], release_object, &device, &FenceA, &objects[objectIdx].valueA, 1);
+        if (objectIdx == numObjects / 2)
+            deferred_destruction::collect(queue, nullptr, nullptr, 0);
+    }
+    uint64_t completed = device.completedA.load();
+    deferred_destruction::collect(queue, &FenceA, &completed, 1);
+    for (uint32_t objectIdx = 0; objectIdx < numObjects; ++objectIdx)
+        assert_msg(objects[objectIdx].numReleases == 1 && objects[objectIdx].releaseOrder == objectIdx, "Objects released out of order");
+    deferred_destruction::destroy_queue(queue);
+}
+
+void test_concurrent_producers()
+{
+    SimulatedDevice device;
+    device.completedA = 0;
+    device.completedB = 0;
+    device.numReleased = 0;
+    device.numEarly = 0;
+    DeferredDestructionQueue* queue = deferred_destruction::create_queue(*bento::common_allocator());
+
+    // Producers destroy objects tagged with the values last submitted on both queues while the GPU advances and a collector runs
+    const uint32_t numProducers = 4;
+    const uint32_t numObjectsPerProducer = 20000;
+    std::vector<FakeObject> objects(numProducers * numObjectsPerProducer);
+    std::atomic<uint64_t> submittedA(0), submittedB(0);
+    std::atomic<bool> producing(true);
+    std::vector<std::thread> producers;
+    for (uint32_t producerIdx = 0; producerIdx < numProducers; ++producerIdx)
+    {
+        producers.push_back(std::thread([&, producerIdx]()
+        {
+            uint64_t fences[2] = { FenceA, FenceB };
+            for (uint32_t objectIdx = 0; objectIdx < numObjectsPerProducer; ++objectIdx)
+            {
+                FakeObject& object = objects[producerIdx * numObjectsPerProducer + objectIdx];
+                object.valueA = submittedA.fetch_add(1) + 1;
+                object.valueB = submittedB.load();
+                object.numReleases = 0;
+                uint64_t values[2] = { object.valueA, object.valueB };
+                deferred_destruction::enqueue(queue, (uint64_t)&object, release_object, &device, fences, values, 2);
+            }
+        }));
+    }
+
+    std::thread collector([&]()
+    {
+        while (producing.load() || deferred_destruction::num_pending(queue) > 0)
+        {
+            // The simulated GPU never gets ahead of the submissions
+            device.completedA = submittedA.load();
+            device.completedB = submittedB.fetch_add(1);
+            uint64_t fences[2] = { FenceA, FenceB };
+            uint64_t completed[2] = { device.completedA.load(), device.completedB.load() };
+            deferred_destruction::collect(queue, fences, completed, 2);
+        }
+    });
+
+    for (uint32_t producerIdx = 0; producerIdx < numProducers; ++producerIdx)
+        producers[producerIdx].join();
+    producing = false;
+    collector.join();
+
+    for (uint32_t objectIdx = 0; objectIdx < objects.size(); ++objectIdx)
+        assert_msg(objects[objectIdx].numReleases == 1, "Object lost or released twice");
+    assert_msg(device.numEarly == 0 && device.numReleased == objects.size(), "Object released before its fences");
+    deferred_destruction::destroy_queue(queue);
+}
+
+int main()
+{
+    test_fences();
+    test_enqueue_order();
+    test_concurrent_producers();
+    std::cout << "Deferred destruction tests passed" << std::endl;
+    return 0;
+}
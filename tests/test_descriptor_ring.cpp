@@ -0,0 +1,139 @@
+// System includes
+#include <iostream>
+
+// Bento includes
+#include <bento_base/security.h>
+#include <bento_memory/common.h>
+
+// SDK includes
+#include "gpu_backend/descriptor_ring.h"
+
+using namespace graphics_sandbox;
+
+// Fake fence identifiers, the ring never interprets them
+const uint64_t FenceA = 0x100;
+const uint64_t FenceB = 0x200;
+
+void test_allocate_and_reclaim()
+{
+    DescriptorRing ring(*bento::common_allocator());
+    descriptor_ring::initialize(ring, 16);
+
+    // Consecutive tables of the same command buffer end up in one span
+    uint32_t offset;
+    assert_msg(descriptor_ring::allocate(ring, 1, 4, offset) && offset == 0, "Wrong first offset");
+    assert_msg(descriptor_ring::allocate(ring, 1, 4, offset) && offset == 4, "Wrong second offset");
+    assert_msg(ring.spans.size() == 1 && ring.used == 8, "Tables were not merged");
+
+    // Nothing is freed before the fence value is reached
+    descriptor_ring::submit(ring, 1, FenceA, 1);
+    descriptor_ring::reclaim(ring, FenceA, 0);
+    assert_msg(ring.used == 8, "Span freed too early");
+    descriptor_ring::reclaim(ring, FenceA, 1);
+    assert_msg(ring.used == 0, "Span was not freed");
+}
+
+void test_wraparound()
+{
+    DescriptorRing ring(*bento::common_allocator());
+    descriptor_ring::initialize(ring, 16);
+
+    uint32_t offset;
+    descriptor_ring::allocate(ring, 1, 6, offset);
+    descriptor_ring::submit(ring, 1, FenceA, 1);
+    descriptor_ring::allocate(ring, 2, 6, offset);
+    descriptor_ring::submit(ring, 2, FenceA, 2);
+    descriptor_ring::reclaim(ring, FenceA, 1);
+
+    // 4 descriptors are left at the end, the table restarts at 0 and the end is padded
+    assert_msg(descriptor_ring::allocate(ring, 3, 5, offset) && offset == 0, "Table straddles the end of the ring");
+    assert_msg(ring.wraps == 1 && ring.used == 15, "Wrong padding");
+
+    // The padding is freed with its owner
+    descriptor_ring::submit(ring, 3, FenceA, 3);
+    descriptor_ring::reclaim(ring, FenceA, 3);
+    assert_msg(ring.used == 0, "Padding was not freed");
+}
+
+void test_interleaved_owners()
+{
+    DescriptorRing ring(*bento::common_allocator());
+    descriptor_ring::initialize(ring, 32);
+
+    // Two command buffers record at the same time on two queues
+    uint32_t offset;
+    descriptor_ring::allocate(ring, 1, 4, offset);
+    descriptor_ring::allocate(ring, 2, 4, offset);
+    descriptor_ring::allocate(ring, 1, 4, offset);
+    descriptor_ring::submit(ring, 1, FenceA, 1);
+    descriptor_ring::reclaim(ring, FenceA, 1);
+
+    // The tables of the first buffer can't be freed while the second is still recording in between
+    assert_msg(ring.used == 8, "Freed past a recording command buffer");
+
+    descriptor_ring::submit(ring, 2, FenceB, 1);
+    descriptor_ring::reclaim(ring, FenceA, 1);
+    assert_msg(ring.used == 8, "Freed a span of another fence");
+    descriptor_ring::reclaim(ring, FenceB, 1);
+    descriptor_ring::reclaim(ring, FenceA, 1);
+    assert_msg(ring.used == 0, "Spans were not freed");
+}
+
+void test_full_and_release()
+{
+    DescriptorRing ring(*bento::common_allocator());
+    descriptor_ring::initialize(ring, 8);
+
+    uint32_t offset;
+    assert_msg(descriptor_ring::allocate(ring, 1, 8, offset), "Failed to fill the ring");
+    assert_msg(!descriptor_ring::allocate(ring, 2, 1, offset) && ring.failedAllocations == 1, "Allocated in a full ring");
+
+    // The oldest span is not submitted, there is nothing to wait on
+    uint64_t fence, fenceValue;
+    assert_msg(!descriptor_ring::oldest_fence(ring, fence, fenceValue), "Unsubmitted span has a fence");
+
+    // A reset command buffer gives its tables back
+    descriptor_ring::release(ring, 1);
+    assert_msg(descriptor_ring::allocate(ring, 2, 8, offset) && offset == 0, "Released span was not reused");
+
+    // Destroying a queue retires everything submitted on its fence
+    descriptor_ring::submit(ring, 2, FenceB, 7);
+    assert_msg(descriptor_ring::oldest_fence(ring, fence, fenceValue) && fence == FenceB && fenceValue == 7, "Wrong oldest fence");
+    descriptor_ring::forget_fence(ring, FenceB);
+    assert_msg(ring.used == 0, "Forgotten fence was not retired");
+}
+
+void test_resubmission()
+{
+    DescriptorRing ring(*bento::common_allocator());
+    descriptor_ring::initialize(ring, 16);
+
+    // A closed command buffer is executed twice without a reset, on two queues
+    uint32_t offset;
+    descriptor_ring::allocate(ring, 1, 4, offset);
+    descriptor_ring::submit(ring, 1, FenceA, 1);
+    descriptor_ring::submit(ring, 1, FenceB, 5);
+
+    // The first execution being done doesn't free the tables the second one reads
+    descriptor_ring::reclaim(ring, FenceA, 1);
+    assert_msg(ring.used == 4, "Tables of a resubmitted command buffer freed with its first execution");
+    uint64_t fence, fenceValue;
+    assert_msg(descriptor_ring::oldest_fence(ring, fence, fenceValue) && fence == FenceB && fenceValue == 5, "Tables not moved to the last submission");
+
+    // Resetting it afterwards doesn't free what is still in flight
+    descriptor_ring::release(ring, 1);
+    assert_msg(ring.used == 4, "Release freed submitted tables");
+    descriptor_ring::reclaim(ring, FenceB, 5);
+    assert_msg(ring.used == 0, "Spans were not freed");
+}
+
+int main(int, char**)
+{
+    test_allocate_and_reclaim();
+    test_wraparound();
+    test_interleaved_owners();
+    test_full_and_release();
+    test_resubmission();
+    std::cout << "Descriptor ring tests succeeded" << std::endl;
+    return 0;
+}
@@ -0,0 +1,230 @@
+// System includes
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+// Bento includes
+#include <bento_base/security.h>
+#include <bento_memory/common.h>
+
+// SDK includes
+#include "gpu_backend/dispatch_autotuner.h"
+
+using namespace graphics_sandbox;
+
+const char* CachePath = "test_dispatch_autotuner.cache";
+const uint32_t GroupSizes[] = { 32, 64, 128, 256, 512, 1024 };
+const uint32_t ElementsPerThread[] = { 1, 2, 4, 8 };
+
+// Simulated adapter, the cost of a candidate is a bowl around the adapter's sweet spot. Every few samples one is
+// delayed (preemption, clock change) and thread groups above the adapter's limit can't run.
+struct SimulatedAdapter
+{
+    uint32_t bestGroupSize;
+    uint32_t bestElementsPerThread;
+    uint32_t maxGroupSize;
+    uint32_t numSamples;
+    uint32_t numMeasured;
+};
+
+uint32_t define_value(const bento::Vector<bento::DynamicString>& defines, const char* name)
+{
+    size_t nameLength = strlen(name);
+    for (uint32_t defineIdx = 0; defineIdx < defines.size(); ++defineIdx)
+    {
+        const char* define = defines[defineIdx].c_str();
+        if (strncmp(define, name, nameLength) == 0 && define[nameLength] == '=')
+            return (uint32_t)atoi(define + nameLength + 1);
+    }
+    assert_msg(false, "Missing define");
+    return 0;
+}
+
+double distance(uint32_t value, uint32_t best)
+{
+    double ratio = value > best ? (double)value / best : (double)best / value;
+    return ratio - 1.0;
+}
+
+bool simulated_measure(const bento::Vector<bento::DynamicString>& defines, uint32_t numSamples, double* durations, void* userData)
+{
+    SimulatedAdapter* adapter = (SimulatedAdapter*)userData;
+    uint32_t groupSize = define_value(defines, "GROUP_SIZE");
+    uint32_t elementsPerThread = define_value(defines, "ELEMENTS_PER_THREAD");
+    if (groupSize > adapter->maxGroupSize)
+        return false;
+    adapter->numMeasured++;
+
+    double cost = 100.0 + 40.0 * distance(groupSize, adapter->bestGroupSize) + 25.0 * distance(elementsPerThread, adapter->bestElementsPerThread);
+    for (uint32_t sampleIdx = 0; sampleIdx < numSamples; ++sampleIdx)
+    {
+        adapter->numSamples++;
+        durations[sampleIdx] = cost + (sampleIdx % 3 == 1 ? 500.0 : 0.1 * sampleIdx);
+    }
+    return true;
+}
+
+void fill_space(AutotuneSpace& space)
+{
+    dispatch_autotuner::add_parameter(space, "GROUP_SIZE", GroupSizes, 6);
+    dispatch_autotuner::add_parameter(space, "ELEMENTS_PER_THREAD", ElementsPerThread, 4);
+}
+
+void test_search_space()
+{
+    AutotuneSpace space(*bento::common_allocator());
+    fill_space(space);
+    assert_msg(dispatch_autotuner::num_candidates(space) == 24, "Wrong number of candidates");
+
+    // Every candidate is a distinct combination
+    for (uint32_t candidate = 0; candidate < 24; ++candidate)
+    {
+        bento::Vector<bento::DynamicString> defines(*bento::common_allocator());
+        dispatch_autotuner::candidate_defines(space, candidate, defines);
+        assert_msg(defines.size() == 2, "Wrong number of defines");
+        assert_msg(define_value(defines, "GROUP_SIZE") == GroupSizes[candidate % 6], "Wrong group size");
+        assert_msg(define_value(defines, "ELEMENTS_PER_THREAD") == ElementsPerThread[candidate / 6], "Wrong elements per thread");
+    }
+
+    // Any change to the space changes its key
+    Hash128 key, otherKey;
+    dispatch_autotuner::space_key(space, key);
+    AutotuneSpace smaller(*bento::common_allocator());
+    dispatch_autotuner::add_parameter(smaller, "GROUP_SIZE", GroupSizes, 5);
+    dispatch_autotuner::add_parameter(smaller, "ELEMENTS_PER_THREAD", ElementsPerThread, 4);
+    dispatch_autotuner::space_key(smaller, otherKey);
+    assert_msg(!hash::equal(key, otherKey), "Space change ignored");
+    AutotuneSpace same(*bento::common_allocator());
+    fill_space(same);
+    dispatch_autotuner::space_key(same, otherKey);
+    assert_msg(hash::equal(key, otherKey), "Space key is not deterministic");
+
+    // The kernel key ignores the order of the defines but not the source, the entry point or the values
+    ComputeShaderDescriptor descriptor(*bento::common_allocator());
+    descriptor.filename = "IncrementBuffer.compute";
+    descriptor.kernelname = "IncrementBuffer";
+    descriptor.defines.push_back(bento::DynamicString(*bento::common_allocator(), "A=1"));
+    descriptor.defines.push_back(bento::DynamicString(*bento::common_allocator(), "B"));
+    dispatch_autotuner::kernel_key(descriptor, key);
+    ComputeShaderDescriptor reordered(*bento::common_allocator());
+    reordered.filename = "IncrementBuffer.compute";
+    reordered.kernelname = "IncrementBuffer";
+    reordered.defines.push_back(bento::DynamicString(*bento::common_allocator(), "B=1"));
+    reordered.defines.push_back(bento::DynamicString(*bento::common_allocator(), "A=1"));
+    dispatch_autotuner::kernel_key(reordered, otherKey);
+    assert_msg(hash::equal(key, otherKey), "Define order changes the kernel key");
+    reordered.kernelname = "OtherKernel";
+    dispatch_autotuner::kernel_key(reordered, otherKey);
+    assert_msg(!hash::equal(key, otherKey), "Entry point ignored");
+}
+
+void test_search()
+{
+    AutotuneSpace space(*bento::common_allocator());
+    fill_space(space);
+
+    // Two adapters with different sweet spots, the second one can't run groups of 1024 threads
+    SimulatedAdapter adapters[2] = { { 256, 4, 1024, 0, 0 }, { 64, 1, 512, 0, 0 } };
+    for (uint32_t adapterIdx = 0; adapterIdx < 2; ++adapterIdx)
+    {
+        SimulatedAdapter& adapter = adapters[adapterIdx];
+        AutotuneResult result(*bento::common_allocator());
+        assert_msg(dispatch_autotuner::search(space, simulated_measure, &adapter, 5, result), "Search failed");
+        assert_msg(define_value(result.defines, "GROUP_SIZE") == adapter.bestGroupSize, "Wrong group size picked");
+        assert_msg(define_value(result.defines, "ELEMENTS_PER_THREAD") == adapter.bestElementsPerThread, "Wrong elements per thread picked");
+
+        // The outliers don't reach the median
+        assert_msg(result.duration > 99.0 && result.duration < 101.0, "Outliers reached the median");
+        uint32_t numRunnable = adapter.maxGroupSize == 1024 ? 24 : 20;
+        assert_msg(result.numMeasured == numRunnable && adapter.numSamples == numRunnable * 5, "Wrong number of measurements");
+    }
+
+    // Nothing can run
+    SimulatedAdapter tiny = { 32, 1, 16, 0, 0 };
+    AutotuneResult result(*bento::common_allocator());
+    assert_msg(!dispatch_autotuner::search(space, simulated_measure, &tiny, 3, result), "Search succeeded without candidates");
+}
+
+void test_cache()
+{
+    remove(CachePath);
+    AutotuneSpace space(*bento::common_allocator());
+    fill_space(space);
+    Hash128 spaceKey, kernelKey, otherKernelKey;
+    dispatch_autotuner::space_key(space, spaceKey);
+    ComputeShaderDescriptor descriptor(*bento::common_allocator());
+    descriptor.filename = "IncrementBuffer.compute";
+    descriptor.kernelname = "IncrementBuffer";
+    dispatch_autotuner::kernel_key(descriptor, kernelKey);
+    descriptor.kernelname = "OtherKernel";
+    dispatch_autotuner::kernel_key(descriptor, otherKernelKey);
+
+    // Tune the kernel on two adapters
+    const uint64_t adapterIds[2] = { 0x10de2684ull, 0x100274bfull };
+    SimulatedAdapter adapters[2] = { { 256, 4, 1024, 0, 0 }, { 64, 1, 512, 0, 0 } };
+    AutotuneCache* cache = dispatch_autotuner::create_cache(*bento::common_allocator(), CachePath);
+    assert_msg(dispatch_autotuner::num_entries(cache) == 0, "Cache not empty");
+    for (uint32_t adapterIdx = 0; adapterIdx < 2; ++adapterIdx)
+    {
+        AutotuneResult result(*bento::common_allocator());
+        assert_msg(dispatch_autotuner::search(space, simulated_measure, &adapters[adapterIdx], 3, result), "Search failed");
+        dispatch_autotuner::store(cache, adapterIds[adapterIdx], kernelKey, spaceKey, result);
+    }
+
+    // Storing again replaces the winner
+    AutotuneResult result(*bento::common_allocator());
+    dispatch_autotuner::search(space, simulated_measure, &adapters[1], 3, result);
+    dispatch_autotuner::store(cache, adapterIds[1], kernelKey, spaceKey, result);
+    assert_msg(dispatch_autotuner::num_entries(cache) == 2, "Winner duplicated");
+    dispatch_autotuner::destroy_cache(cache);
+
+    // The next run finds every adapter's winner without measuring anything
+    cache = dispatch_autotuner::create_cache(*bento::common_allocator(), CachePath);
+    assert_msg(dispatch_autotuner::num_entries(cache) == 2, "Cache not reloaded");
+    for (uint32_t adapterIdx = 0; adapterIdx < 2; ++adapterIdx)
+    {
+        bento::Vector<bento::DynamicString> defines(*bento::common_allocator());
+        assert_msg(dispatch_autotuner::lookup(cache, adapterIds[adapterIdx], kernelKey, &spaceKey, defines), "Winner not found");
+        assert_msg(define_value(defines, "GROUP_SIZE") == adapters[adapterIdx].bestGroupSize, "Wrong cached group size");
+        assert_msg(define_value(defines, "ELEMENTS_PER_THREAD") == adapters[adapterIdx].bestElementsPerThread, "Wrong cached elements per thread");
+    }
+
+    // Other adapters, other kernels and other spaces miss
+    bento::Vector<bento::DynamicString> defines(*bento::common_allocator());
+    assert_msg(!dispatch_autotuner::lookup(cache, 0x80865690ull, kernelKey, nullptr, defines), "Unknown adapter hit");
+    assert_msg(!dispatch_autotuner::lookup(cache, adapterIds[0], otherKernelKey, nullptr, defines), "Unknown kernel hit");
+    Hash128 otherSpaceKey;
+    AutotuneSpace smaller(*bento::common_allocator());
+    dispatch_autotuner::add_parameter(smaller, "GROUP_SIZE", GroupSizes, 2);
+    dispatch_autotuner::space_key(smaller, otherSpaceKey);
+    assert_msg(!dispatch_autotuner::lookup(cache, adapterIds[0], kernelKey, &otherSpaceKey, defines), "Stale space hit");
+    assert_msg(dispatch_autotuner::lookup(cache, adapterIds[0], kernelKey, nullptr, defines), "Lookup without space missed");
+    dispatch_autotuner::destroy_cache(cache);
+
+    // A truncated file is ignored
+    FILE* file = fopen(CachePath, "rb");
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    std::string content((size_t)size, '\0');
+    fread(&content[0], 1, content.size(), file);
+    fclose(file);
+    file = fopen(CachePath, "wb");
+    fwrite(content.c_str(), 1, content.size() - 3, file);
+    fclose(file);
+    cache = dispatch_autotuner::create_cache(*bento::common_allocator(), CachePath);
+    assert_msg(dispatch_autotuner::num_entries(cache) == 0, "Truncated cache loaded");
+    dispatch_autotuner::destroy_cache(cache);
+    remove(CachePath);
+}
+
+int main()
+{
+    test_search_space();
+    test_search();
+    test_cache();
+    std::cout << "Dispatch autotuner tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,218 @@
+// System includes
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Bento includes
+#include <bento_base/security.h>
+#include <bento_memory/common.h>
+
+// SDK includes
+#include "gpu_backend/handle_table.h"
+
+using namespace graphics_sandbox;
+
+// Shaped like a buffer: what binding it reads and what only creation and destruction touch
+struct HotObject
+{
+    uint64_t resource;
+    uint64_t viewCPU;
+    uint32_t state;
+    uint32_t bindlessIndex;
+};
+
+struct ColdObject
+{
+    uint64_t heapBlock;
+    uint64_t heapAllocation;
+    uint64_t mappedData;
+    uint64_t viewHeap;
+    char debugName[64];
+};
+
+// Same object allocated on its own, the way the backend used to
+struct PointerObject
+{
+    HotObject hot;
+    ColdObject cold;
+};
+
+typedef HandleTable<HotObject, ColdObject> ObjectTable;
+
+void test_handles()
+{
+    ObjectTable table(*bento::common_allocator());
+    handle_table::initialize(table, 600);
+    assert_msg(!handle_table::is_valid(table, 0), "The null handle is valid");
+
+    // Fill the table past a few chunks, every slot is distinct and starts zeroed
+    std::vector<uint64_t> handles;
+    for (uint32_t objectIdx = 0; objectIdx < 600; ++objectIdx)
+    {
+        uint64_t handle = handle_table::allocate(table);
+        assert_msg(handle != 0 && handle_table::is_valid(table, handle), "Allocation failed");
+        HotObject* hot = handle_table::hot(table, handle);
+        assert_msg(hot->resource == 0 && handle_table::cold(table, handle)->heapBlock == 0, "Slot not initialized");
+        hot->resource = objectIdx;
+        handles.push_back(handle);
+    }
+    assert_msg(handle_table::allocate(table) == 0 && handle_table::num_alive(table) == 600, "Full table handed out a slot");
+    for (uint32_t objectIdx = 0; objectIdx < 600; ++objectIdx)
+        assert_msg(handle_table::hot(table, handles[objectIdx])->resource == objectIdx, "Wrong slot");
+
+    // A freed handle stays stale once its slot is recycled
+    uint64_t freed = handles[17];
+    assert_msg(handle_table::free(table, freed) && !handle_table::free(table, freed), "Double free not detected");
+    uint64_t recycled = handle_table::allocate(table);
+    assert_msg((uint32_t)recycled == (uint32_t)freed && recycled != freed, "Slot not recycled with a new generation");
+    HotObject* hot;
+    ColdObject* cold;
+    assert_msg(!handle_table::is_valid(table, freed) && !handle_table::lookup(table, freed, hot, cold), "Stale handle not detected");
+    assert_msg(handle_table::lookup(table, recycled, hot, cold) && hot->resource == 0, "Recycled slot not reset");
+
+    // Handles of slots that were never handed out or out of range
+    assert_msg(!handle_table::is_valid(table, (1ull << 32) | 700) && !handle_table::is_valid(table, (5ull << 32) | 3), "Forged handle accepted");
+    handle_table::release(table);
+}
+
+void test_concurrent()
+{
+    ObjectTable table(*bento::common_allocator());
+    const uint32_t numThreads = 4;
+    const uint32_t numObjectsPerThread = 2048;
+    handle_table::initialize(table, numThreads * numObjectsPerThread);
+
+    // Every thread keeps a set of live objects and churns through them while the others do the same
+    std::vector<std::thread> threads;
+    std::atomic<uint32_t> numErrors(0);
+    for (uint32_t threadIdx = 0; threadIdx < numThreads; ++threadIdx)
+    {
+        threads.push_back(std::thread([&, threadIdx]()
+        {
+            std::mt19937 generator(threadIdx);
+            std::vector<uint64_t> live;
+            for (uint32_t step = 0; step < 50000; ++step)
+            {
+                if (live.size() < numObjectsPerThread && (live.empty() || generator() % 2 == 0))
+                {
+                    uint64_t handle = handle_table::allocate(table);
+                    handle_table::hot(table, handle)->resource = handle;
+                    live.push_back(handle);
+                }
+                else
+                {
+                    uint32_t liveIdx = generator() % live.size();
+                    uint64_t handle = live[liveIdx];
+                    if (handle_table::hot(table, handle)->resource != handle || !handle_table::free(table, handle) || handle_table::is_valid(table, handle))
+                        numErrors++;
+                    live[liveIdx] = live.back();
+                    live.pop_back();
+                }
+            }
+            for (uint64_t handle : live)
+                handle_table::free(table, handle);
+        }));
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+    assert_msg(numErrors == 0 && handle_table::num_alive(table) == 0, "Concurrent allocations corrupted the table");
+    handle_table::release(table);
+}
+
+// Binds a random sequence of objects the way a recording does, reading the hot fields only
+template<typename LookupFunction>
+double measure_binds(const std::vector<uint64_t>& sequence, LookupFunction lookup, uint64_t& checksum)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    for (uint64_t handle : sequence)
+    {
+        const HotObject* hot = lookup(handle);
+        checksum += hot->resource + hot->viewCPU + hot->state + hot->bindlessIndex;
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / sequence.size();
+}
+
+void benchmark()
+{
+    const uint32_t numObjects = 100000;
+    const uint32_t numBinds = 4000000;
+    bento::IAllocator& allocator = *bento::common_allocator();
+
+    // Interleave the individual allocations with others of various sizes, like a long running application would
+    std::mt19937 generator(42);
+    std::vector<PointerObject*> pointers;
+    std::vector<void*> noise;
+    for (uint32_t objectIdx = 0; objectIdx < numObjects; ++objectIdx)
+    {
+        PointerObject* object = bento::make_new<PointerObject>(allocator);
+        object->hot.resource = objectIdx;
+        pointers.push_back(object);
+        noise.push_back(allocator.allocate(64 + generator() % 512, 16));
+    }
+
+    ObjectTable table(allocator);
+    handle_table::initialize(table, numObjects);
+    std::vector<uint64_t> handles;
+    for (uint32_t objectIdx = 0; objectIdx < numObjects; ++objectIdx)
+    {
+        handles.push_back(handle_table::allocate(table));
+        handle_table::hot(table, handles.back())->resource = objectIdx;
+    }
+
+    std::vector<uint32_t> order(numBinds);
+    for (uint32_t bindIdx = 0; bindIdx < numBinds; ++bindIdx)
+        order[bindIdx] = generator() % numObjects;
+    std::vector<uint64_t> pointerSequence(numBinds), handleSequence(numBinds);
+    for (uint32_t bindIdx = 0; bindIdx < numBinds; ++bindIdx)
+    {
+        pointerSequence[bindIdx] = (uint64_t)pointers[order[bindIdx]];
+        handleSequence[bindIdx] = handles[order[bindIdx]];
+    }
+
+    uint64_t pointerChecksum = 0, handleChecksum = 0;
+    double pointerTime = measure_binds(pointerSequence, [](uint64_t handle) { return &((const PointerObject*)handle)->hot; }, pointerChecksum);
+    double handleTime = measure_binds(handleSequence, [&table](uint64_t handle) { return handle_table::hot(table, handle); }, handleChecksum);
+    assert_msg(pointerChecksum == handleChecksum, "Lookups disagree");
+    std::cout << "Random binds of " << numObjects << " objects: pointers " << pointerTime << " ns, handle table " << handleTime << " ns" << std::endl;
+
+    // Recycling: free and allocate in a loop, nothing goes to the allocator
+    const uint32_t numRecycles = 1000000;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (uint32_t recycleIdx = 0; recycleIdx < numRecycles; ++recycleIdx)
+    {
+        uint32_t objectIdx = recycleIdx % numObjects;
+        handle_table::free(table, handles[objectIdx]);
+        handles[objectIdx] = handle_table::allocate(table);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    double tableRecycle = std::chrono::duration<double, std::nano>(end - start).count() / numRecycles;
+    start = std::chrono::high_resolution_clock::now();
+    for (uint32_t recycleIdx = 0; recycleIdx < numRecycles; ++recycleIdx)
+    {
+        uint32_t objectIdx = recycleIdx % numObjects;
+        bento::make_delete<PointerObject>(allocator, pointers[objectIdx]);
+        pointers[objectIdx] = bento::make_new<PointerObject>(allocator);
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double pointerRecycle = std::chrono::duration<double, std::nano>(end - start).count() / numRecycles;
+    std::cout << "Recycling: allocator " << pointerRecycle << " ns, handle table " << tableRecycle << " ns" << std::endl;
+
+    for (PointerObject* object : pointers)
+        bento::make_delete<PointerObject>(allocator, object);
+    for (void* block : noise)
+        allocator.deallocate(block);
+    handle_table::release(table);
+}
+
+int main()
+{
+    test_handles();
+    test_concurrent();
+    benchmark();
+    std::cout << "Handle table tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,282 @@
+// System includes
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+
+// Bento includes
+#include <bento_base/security.h>
+#include <bento_memory/common.h>
+
+// SDK includes
+#include "gpu_backend/hot_reload.h"
+#include "gpu_backend/shader_cache.h"
+#include "tools/file_watcher.h"
+
+using namespace graphics_sandbox;
+
+bento::Vector<bento::DynamicString> make_files(std::initializer_list<const char*> files)
+{
+    bento::Vector<bento::DynamicString> result(*bento::common_allocator());
+    for (const char* file : files)
+        result.push_back(bento::DynamicString(*bento::common_allocator(), file));
+    return result;
+}
+
+bool contains(const bento::Vector<uint64_t>& values, uint64_t value)
+{
+    for (uint32_t valueIdx = 0; valueIdx < values.size(); ++valueIdx)
+        if (values[valueIdx] == value)
+            return true;
+    return false;
+}
+
+// Stub compiler, a version is the shader followed by a compilation counter
+struct StubCompiler
+{
+    std::atomic<uint32_t> numCompilations;
+    std::atomic<uint32_t> numDiscards;
+    std::atomic<bool> fail;
+    uint32_t delayMS;
+};
+
+uint64_t stub_compile(uint64_t shader, void* userData)
+{
+    StubCompiler* compiler = (StubCompiler*)userData;
+    uint32_t compilation = ++compiler->numCompilations;
+    std::this_thread::sleep_for(std::chrono::milliseconds(compiler->delayMS));
+    return compiler->fail ? 0 : (shader << 32) | compilation;
+}
+
+void stub_discard(uint64_t, void* userData)
+{
+    ((StubCompiler*)userData)->numDiscards++;
+}
+
+void reset_compiler(StubCompiler& compiler, uint32_t delayMS)
+{
+    compiler.numCompilations = 0;
+    compiler.numDiscards = 0;
+    compiler.fail = false;
+    compiler.delayMS = delayMS;
+}
+
+void test_normalization()
+{
+    assert_msg(hot_reload::normalize_path("shaders/./common/../math.hlsli") == "shaders/math.hlsli", "Dot components not resolved");
+    assert_msg(hot_reload::normalize_path("shaders\\math.hlsli") == "shaders/math.hlsli", "Backslashes not converted");
+    assert_msg(hot_reload::normalize_path("/usr//include/") == "/usr/include", "Empty components kept");
+    assert_msg(hot_reload::normalize_path("../shaders/../math.hlsli") == "../math.hlsli", "Leading parent component dropped");
+    assert_msg(hot_reload::normalize_path("/../math.hlsli") == "/math.hlsli", "Parent of the root kept");
+    assert_msg(hot_reload::normalize_path("./") == ".", "Current directory lost");
+}
+
+void test_dependency_graph()
+{
+    StubCompiler compiler;
+    reset_compiler(compiler, 0);
+    HotReloader* reloader = hot_reload::create_hot_reloader(*bento::common_allocator(), stub_compile, stub_discard, &compiler);
+
+    // Two kernels share an include, the third one is standalone
+    hot_reload::set_dependencies(reloader, 1, make_files({ "shaders/reduce.compute", "shaders/common.hlsli" }));
+    hot_reload::set_dependencies(reloader, 2, make_files({ "shaders/scan.compute", "shaders/./common.hlsli", "shaders/scan.hlsli" }));
+    hot_reload::set_dependencies(reloader, 3, make_files({ "other/copy.compute" }));
+
+    bento::Vector<uint64_t> affected(*bento::common_allocator());
+    hot_reload::affected_shaders(reloader, make_files({ "shaders/common.hlsli" }), affected);
+    assert_msg(affected.size() == 2 && contains(affected, 1) && contains(affected, 2), "Shared include not tracked");
+
+    affected.clear();
+    hot_reload::affected_shaders(reloader, make_files({ "shaders\\scan.hlsli", "shaders/scan.compute" }), affected);
+    assert_msg(affected.size() == 1 && affected[0] == 2, "Shader reported for every changed file");
+
+    affected.clear();
+    hot_reload::affected_shaders(reloader, make_files({ "shaders/unrelated.hlsli", "copy.compute" }), affected);
+    assert_msg(affected.size() == 0, "Unrelated file affects a shader");
+
+    // A recompilation can change the include set
+    hot_reload::set_dependencies(reloader, 1, make_files({ "shaders/reduce.compute" }));
+    affected.clear();
+    hot_reload::affected_shaders(reloader, make_files({ "shaders/common.hlsli" }), affected);
+    assert_msg(affected.size() == 1 && affected[0] == 2, "Stale dependency kept");
+
+    bento::Vector<bento::DynamicString> directories(*bento::common_allocator());
+    hot_reload::watched_directories(reloader, directories);
+    assert_msg(directories.size() == 2 && strcmp(directories[0].c_str(), "other") == 0 && strcmp(directories[1].c_str(), "shaders") == 0, "Wrong watched directories");
+
+    hot_reload::remove_shader(reloader, 2);
+    affected.clear();
+    hot_reload::affected_shaders(reloader, make_files({ "shaders/common.hlsli" }), affected);
+    assert_msg(affected.size() == 0, "Removed shader still tracked");
+    hot_reload::destroy_hot_reloader(reloader);
+}
+
+void test_background_recompilation()
+{
+    StubCompiler compiler;
+    reset_compiler(compiler, 20);
+    HotReloader* reloader = hot_reload::create_hot_reloader(*bento::common_allocator(), stub_compile, stub_discard, &compiler);
+    hot_reload::set_dependencies(reloader, 1, make_files({ "a.compute", "common.hlsli" }));
+    hot_reload::set_dependencies(reloader, 2, make_files({ "b.compute", "common.hlsli" }));
+    hot_reload::set_dependencies(reloader, 3, make_files({ "c.compute" }));
+
+    // Notifying doesn't wait for the compilation
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    hot_reload::notify_changes(reloader, make_files({ "common.hlsli" }));
+    assert_msg(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(20), "Notification blocked on the compilation");
+
+    // Saves in a burst only queue a shader once, only the affected shaders are compiled
+    hot_reload::notify_changes(reloader, make_files({ "common.hlsli", "a.compute" }));
+    hot_reload::notify_changes(reloader, make_files({ "b.compute" }));
+    hot_reload::wait_idle(reloader);
+    uint32_t numCompilations = compiler.numCompilations;
+    assert_msg(numCompilations >= 2 && numCompilations <= 4, "Shader compiled for every notification");
+
+    // Only the latest version of every shader is handed out, the others were discarded
+    bento::Vector<HotReloadVersion> versions(*bento::common_allocator());
+    hot_reload::collect_ready(reloader, versions);
+    assert_msg(versions.size() == 2, "Unaffected shader recompiled");
+    for (uint32_t versionIdx = 0; versionIdx < versions.size(); ++versionIdx)
+        assert_msg(versions[versionIdx].version >> 32 == versions[versionIdx].shader, "Version given to the wrong shader");
+    assert_msg(compiler.numDiscards == numCompilations - 2, "Superseded version not discarded");
+
+    // Nothing new until the next change
+    versions.clear();
+    hot_reload::collect_ready(reloader, versions);
+    assert_msg(versions.size() == 0, "Version handed out twice");
+
+    // A failed compilation keeps the current version
+    compiler.fail = true;
+    hot_reload::notify_changes(reloader, make_files({ "c.compute" }));
+    hot_reload::wait_idle(reloader);
+    hot_reload::collect_ready(reloader, versions);
+    assert_msg(versions.size() == 0, "Failed compilation handed out");
+
+    // Versions of a removed shader or still pending at destruction are discarded
+    compiler.fail = false;
+    uint32_t numDiscards = compiler.numDiscards;
+    hot_reload::notify_changes(reloader, make_files({ "common.hlsli" }));
+    hot_reload::wait_idle(reloader);
+    hot_reload::remove_shader(reloader, 1);
+    assert_msg(compiler.numDiscards == numDiscards + 1, "Removed shader's version leaked");
+    hot_reload::destroy_hot_reloader(reloader);
+    assert_msg(compiler.numDiscards == numDiscards + 2, "Pending version leaked");
+}
+
+void test_retirement()
+{
+    StubCompiler compiler;
+    reset_compiler(compiler, 0);
+    HotReloader* reloader = hot_reload::create_hot_reloader(*bento::common_allocator(), stub_compile, stub_discard, &compiler);
+    const uint64_t graphicsFence = 100;
+    const uint64_t computeFence = 200;
+    bento::Vector<uint64_t> released(*bento::common_allocator());
+
+    // The first pipeline may still be used by both queues, the second one by the graphics queue only
+    uint64_t fences[2] = { graphicsFence, computeFence };
+    uint64_t values[2] = { 10, 4 };
+    hot_reload::retire(reloader, 1, fences, values, 2);
+    uint64_t laterValue = 12;
+    hot_reload::retire(reloader, 2, fences, &laterValue, 1);
+    assert_msg(hot_reload::num_retired(reloader) == 2, "Object not retired");
+
+    hot_reload::reclaim(reloader, graphicsFence, 9, released);
+    hot_reload::reclaim(reloader, computeFence, 4, released);
+    assert_msg(released.size() == 0, "Object released before every fence completed");
+
+    hot_reload::reclaim(reloader, graphicsFence, 10, released);
+    assert_msg(released.size() == 1 && released[0] == 1, "Object not released once its fences completed");
+
+    // Another fence reaching the value doesn't help
+    hot_reload::reclaim(reloader, computeFence, 20, released);
+    assert_msg(released.size() == 1, "Object released by an unrelated fence");
+    hot_reload::reclaim(reloader, graphicsFence, 15, released);
+    assert_msg(released.size() == 2 && released[1] == 2 && hot_reload::num_retired(reloader) == 0, "Object not released");
+
+    // Nothing in flight, released on the next reclaim
+    hot_reload::retire(reloader, 3, nullptr, nullptr, 0);
+    hot_reload::reclaim(reloader, graphicsFence, 15, released);
+    assert_msg(released.size() == 3 && released[2] == 3, "Idle object not released");
+    hot_reload::destroy_hot_reloader(reloader);
+}
+
+void write_file(const char* path, const char* content)
+{
+    FILE* file = fopen(path, "wb");
+    assert_msg(file != nullptr, "Failed to write a test file");
+    fwrite(content, 1, strlen(content), file);
+    fclose(file);
+}
+
+void test_file_watcher()
+{
+    write_file("test_hot_reload_main.compute", "#include \"test_hot_reload_common.hlsli\"\n[numthreads(64, 1, 1)]\nvoid Kernel(uint id : SV_DispatchThreadID) {}\n");
+    write_file("test_hot_reload_common.hlsli", "#define VALUE 1\n");
+    write_file("test_hot_reload_other.hlsli", "#define OTHER 1\n");
+
+    // The dependencies are the ones the shader cache hashes
+    bento::Vector<bento::DynamicString> includeDirectories(*bento::common_allocator());
+    includeDirectories.push_back(bento::DynamicString(*bento::common_allocator(), "."));
+    bento::Vector<bento::DynamicString> dependencies(*bento::common_allocator());
+    shader_cache::collect_dependencies("test_hot_reload_main.compute", includeDirectories, dependencies);
+    assert_msg(dependencies.size() == 2, "Include not collected");
+
+    StubCompiler compiler;
+    reset_compiler(compiler, 0);
+    HotReloader* reloader = hot_reload::create_hot_reloader(*bento::common_allocator(), stub_compile, stub_discard, &compiler);
+    hot_reload::set_dependencies(reloader, 7, dependencies);
+    FileWatcher* watcher = file_watcher::create_file_watcher(*bento::common_allocator());
+    bento::Vector<bento::DynamicString> directories(*bento::common_allocator());
+    hot_reload::watched_directories(reloader, directories);
+    for (uint32_t dirIdx = 0; dirIdx < directories.size(); ++dirIdx)
+        assert_msg(file_watcher::watch_directory(watcher, directories[dirIdx].c_str()), "Failed to watch the directory");
+    assert_msg(!file_watcher::watch_directory(watcher, "test_hot_reload_missing"), "Missing directory watched");
+
+    // Touching a file the shader doesn't include is reported but doesn't trigger anything
+    bento::Vector<bento::DynamicString> changedFiles(*bento::common_allocator());
+    write_file("test_hot_reload_other.hlsli", "#define OTHER 2\n");
+    for (uint32_t attempt = 0; attempt < 100 && changedFiles.size() == 0; ++attempt)
+    {
+        file_watcher::poll(watcher, changedFiles);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    assert_msg(changedFiles.size() > 0, "Change not reported");
+    hot_reload::notify_changes(reloader, changedFiles);
+    hot_reload::wait_idle(reloader);
+    assert_msg(compiler.numCompilations == 0, "Unrelated change recompiled the shader");
+
+    // Editing the include recompiles the shader
+    changedFiles.clear();
+    write_file("test_hot_reload_common.hlsli", "#define VALUE 2\n");
+    for (uint32_t attempt = 0; attempt < 100 && compiler.numCompilations == 0; ++attempt)
+    {
+        file_watcher::poll(watcher, changedFiles);
+        hot_reload::notify_changes(reloader, changedFiles);
+        changedFiles.clear();
+        hot_reload::wait_idle(reloader);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    bento::Vector<HotReloadVersion> versions(*bento::common_allocator());
+    hot_reload::collect_ready(reloader, versions);
+    assert_msg(versions.size() == 1 && versions[0].shader == 7, "Include change not detected");
+
+    file_watcher::destroy_file_watcher(watcher);
+    hot_reload::destroy_hot_reloader(reloader);
+    remove("test_hot_reload_main.compute");
+    remove("test_hot_reload_common.hlsli");
+    remove("test_hot_reload_other.hlsli");
+}
+
+int main()
+{
+    test_normalization();
+    test_dependency_graph();
+    test_background_recompilation();
+    test_retirement();
+    test_file_watcher();
+    std::cout << "Hot reload tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,87 @@
+// System includes
+#include <iostream>
+#include <thread>
+#include <atomic>
+
+// Bento includes
+#include <bento_base/security.h>
+#include <bento_memory/common.h>
+
+// SDK includes
+#include "tools/index_allocator.h"
+
+using namespace graphics_sandbox;
+
+#define NUM_THREADS 4
+#define NUM_ITERATIONS 20000
+#define CAPACITY 64
+
+void test_sequential()
+{
+    IndexAllocator allocator(*bento::common_allocator());
+    index_allocator::initialize(allocator, 4);
+
+    // Fresh indices are handed out in order
+    for (uint32_t index = 0; index < 4; ++index)
+        assert_msg(index_allocator::allocate(allocator) == index, "Wrong fresh index");
+    assert_msg(index_allocator::allocate(allocator) == UINT32_MAX, "Allocated past the capacity");
+
+    // Freed indices are reused, most recent first
+    index_allocator::free(allocator, 1);
+    index_allocator::free(allocator, 3);
+    assert_msg(index_allocator::num_allocated(allocator) == 2, "Wrong allocation count");
+    assert_msg(index_allocator::allocate(allocator) == 3, "Freed index was not reused");
+    assert_msg(index_allocator::allocate(allocator) == 1, "Freed index was not reused");
+    assert_msg(index_allocator::allocate(allocator) == UINT32_MAX, "Allocated past the capacity");
+}
+
+void test_concurrent()
+{
+    IndexAllocator allocator(*bento::common_allocator());
+    index_allocator::initialize(allocator, CAPACITY);
+
+    // Every thread keeps a few indices alive and checks that nobody else owns them at the same time
+    std::atomic<uint32_t> owners[CAPACITY];
+    for (uint32_t index = 0; index < CAPACITY; ++index)
+        owners[index] = 0;
+    std::atomic<uint32_t> conflicts(0);
+
+    std::thread threads[NUM_THREADS];
+    for (uint32_t threadIdx = 0; threadIdx < NUM_THREADS; ++threadIdx)
+    {
+        threads[threadIdx] = std::thread([&, threadIdx]()
+        {
+            uint32_t held[CAPACITY / NUM_THREADS];
+            for (uint32_t iteration = 0; iteration < NUM_ITERATIONS; ++iteration)
+            {
+                for (uint32_t heldIdx = 0; heldIdx < CAPACITY / NUM_THREADS; ++heldIdx)
+                {
+                    held[heldIdx] = index_allocator::allocate(allocator);
+                    uint32_t expected = 0;
+                    if (held[heldIdx] == UINT32_MAX || !owners[held[heldIdx]].compare_exchange_strong(expected, threadIdx + 1))
+                        conflicts++;
+                }
+                for (uint32_t heldIdx = 0; heldIdx < CAPACITY / NUM_THREADS; ++heldIdx)
+                {
+                    if (held[heldIdx] == UINT32_MAX)
+                        continue;
+                    owners[held[heldIdx]] = 0;
+                    index_allocator::free(allocator, held[heldIdx]);
+                }
+            }
+        });
+    }
+    for (uint32_t threadIdx = 0; threadIdx < NUM_THREADS; ++threadIdx)
+        threads[threadIdx].join();
+
+    assert_msg(conflicts == 0, "An index was handed out twice");
+    assert_msg(index_allocator::num_allocated(allocator) == 0, "Indices leaked");
+}
+
+int main(int, char**)
+{
+    test_sequential();
+    test_concurrent();
+    std::cout << "Index allocator tests succeeded" << std::endl;
+    return 0;
+}
@@ -0,0 +1,136 @@
+// System includes
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+// Bento includes
+#include <bento_base/security.h>
+#include <bento_memory/common.h>
+
+// SDK includes
+#include "tools/job_batch.h"
+#include "tools/work_stealing_pool.h"
+
+using namespace graphics_sandbox;
+
+#define NUM_SHADERS 16
+#define COMPILATION_TIME_MS 20
+
+// Stands for the shader compiler, every "compilation" takes a fixed amount of time
+struct StubCompilation
+{
+    uint32_t sources[NUM_SHADERS];
+    uint64_t binaries[NUM_SHADERS];
+};
+
+void stub_compile(uint32_t jobIdx, void* userData)
+{
+    StubCompilation* compilation = (StubCompilation*)userData;
+    std::this_thread::sleep_for(std::chrono::milliseconds(COMPILATION_TIME_MS));
+    compilation->binaries[jobIdx] = (uint64_t)compilation->sources[jobIdx] * 2654435761ull + 1;
+}
+
+void prepare_sources(StubCompilation& compilation)
+{
+    for (uint32_t shaderIdx = 0; shaderIdx < NUM_SHADERS; ++shaderIdx)
+    {
+        compilation.sources[shaderIdx] = shaderIdx * 7 + 3;
+        compilation.binaries[shaderIdx] = 0;
+    }
+}
+
+// Reference without any pool, the waiting thread of a batch also runs jobs so a single worker isn't serial
+double compile_serial(StubCompilation& compilation)
+{
+    prepare_sources(compilation);
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t shaderIdx = 0; shaderIdx < NUM_SHADERS; ++shaderIdx)
+        stub_compile(shaderIdx, &compilation);
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+double compile_all(StubCompilation& compilation, uint32_t numWorkers)
+{
+    prepare_sources(compilation);
+
+    WorkStealingPool* pool = work_stealing_pool::create_pool(*bento::common_allocator(), numWorkers);
+    auto start = std::chrono::steady_clock::now();
+    JobBatch* batch = job_batch::launch(*bento::common_allocator(), pool, NUM_SHADERS, stub_compile, &compilation);
+    assert_msg(job_batch::num_workers(batch) == numWorkers, "Unexpected worker count");
+
+    // Consume the results in order, like a renderer that needs the shaders one after the other
+    for (uint32_t shaderIdx = 0; shaderIdx < NUM_SHADERS; ++shaderIdx)
+    {
+        job_batch::wait(batch, shaderIdx);
+        assert_msg(job_batch::is_complete(batch, shaderIdx), "Waited job is not complete");
+        assert_msg(compilation.binaries[shaderIdx] == (uint64_t)compilation.sources[shaderIdx] * 2654435761ull + 1, "Wrong compilation result");
+    }
+    job_batch::wait_all(batch);
+    job_batch::destroy(batch);
+    double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    work_stealing_pool::destroy_pool(pool);
+    return elapsed;
+}
+
+void test_launch_returns_immediately()
+{
+    StubCompilation compilation;
+    for (uint32_t shaderIdx = 0; shaderIdx < NUM_SHADERS; ++shaderIdx)
+        compilation.sources[shaderIdx] = shaderIdx;
+
+    WorkStealingPool* pool = work_stealing_pool::create_pool(*bento::common_allocator(), 2);
+    auto start = std::chrono::steady_clock::now();
+    JobBatch* batch = job_batch::launch(*bento::common_allocator(), pool, NUM_SHADERS, stub_compile, &compilation);
+    double launchTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    assert_msg(launchTime < COMPILATION_TIME_MS, "Launch blocked on the compilations");
+    assert_msg(!job_batch::is_complete(batch, NUM_SHADERS - 1), "Last job complete right after the launch");
+
+    // Destroying the batch waits for the remaining jobs
+    job_batch::destroy(batch);
+    work_stealing_pool::destroy_pool(pool);
+}
+
+void test_shared_pool()
+{
+    // Batches share the workers, and a parallel loop submitted meanwhile still completes
+    WorkStealingPool* pool = work_stealing_pool::create_pool(*bento::common_allocator(), 3);
+    StubCompilation compilations[2];
+    JobBatch* batches[2];
+    for (uint32_t batchIdx = 0; batchIdx < 2; ++batchIdx)
+    {
+        for (uint32_t shaderIdx = 0; shaderIdx < NUM_SHADERS; ++shaderIdx)
+            compilations[batchIdx].sources[shaderIdx] = shaderIdx + batchIdx * NUM_SHADERS;
+        batches[batchIdx] = job_batch::launch(*bento::common_allocator(), pool, NUM_SHADERS, stub_compile, &compilations[batchIdx]);
+    }
+    std::atomic<uint32_t> sum(0);
+    work_stealing_pool::parallel_for(pool, 1000, 10, [&](uint32_t begin, uint32_t end) { sum += end - begin; });
+    assert_msg(sum == 1000, "Loop items missing");
+
+    for (uint32_t batchIdx = 0; batchIdx < 2; ++batchIdx)
+    {
+        job_batch::wait_all(batches[batchIdx]);
+        for (uint32_t shaderIdx = 0; shaderIdx < NUM_SHADERS; ++shaderIdx)
+            assert_msg(compilations[batchIdx].binaries[shaderIdx] == (uint64_t)compilations[batchIdx].sources[shaderIdx] * 2654435761ull + 1, "Wrong compilation result");
+        job_batch::destroy(batches[batchIdx]);
+    }
+    work_stealing_pool::destroy_pool(pool);
+}
+
+void test_parallel_speedup()
+{
+    StubCompilation compilation;
+    double serialTime = compile_serial(compilation);
+    double parallelTime = compile_all(compilation, 8);
+    std::cout << "serial: " << serialTime << " ms, 8 workers: " << parallelTime << " ms" << std::endl;
+    assert_msg(parallelTime < serialTime * 0.5, "No parallel speedup");
+}
+
+int main()
+{
+    test_launch_returns_immediately();
+    test_parallel_speedup();
+    test_shared_pool();
+    std::cout << "Job batch tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,158 @@
+// System includes
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// Bento includes
+#include <bento_base/security.h>
+#include <bento_memory/common.h>
+
+// SDK includes
+#include "gpu_backend/object_cache.h"
+
+using namespace graphics_sandbox;
+
+void fill_layout(ComputeShaderDescriptor& layout, uint32_t srvCount, uint32_t uavCount, uint32_t cbvCount)
+{
+    layout.srvCount = srvCount;
+    layout.uavCount = uavCount;
+    layout.cbvCount = cbvCount;
+}
+
+Hash128 layout_key(const ComputeShaderDescriptor& layout)
+{
+    Hash128 key;
+    object_cache::root_signature_key(layout, key);
+    return key;
+}
+
+void test_root_signature_keys()
+{
+    bento::IAllocator& allocator = *bento::common_allocator();
+
+    // Only the layout matters
+    ComputeShaderDescriptor first(allocator), second(allocator);
+    first.filename = "blur.hlsl";
+    first.kernelname = "Horizontal";
+    fill_layout(first, 2, 1, 1);
+    second.filename = "sort.hlsl";
+    second.kernelname = "Scatter";
+    second.includeDirectories.push_back(bento::DynamicString(allocator, "shaders/"));
+    fill_layout(second, 2, 1, 1);
+    assert_msg(hash::equal(layout_key(first), layout_key(second)), "Same layout, different keys");
+
+    // Every field changes the key
+    fill_layout(second, 1, 2, 1);
+    assert_msg(!hash::equal(layout_key(first), layout_key(second)), "Swapped counts share a key");
+    fill_layout(second, 2, 1, 1);
+    second.rootCbvCount = 1;
+    assert_msg(!hash::equal(layout_key(first), layout_key(second)), "Root CBV count ignored");
+    second.rootCbvCount = 0;
+    second.bindless = true;
+    assert_msg(!hash::equal(layout_key(first), layout_key(second)), "Bindless flag ignored");
+
+    // Root constant ranges can't be confused with each other or with the root CBVs
+    ComputeShaderDescriptor split(allocator), merged(allocator), cbv(allocator);
+    split.rootConstantSizes.push_back(1);
+    split.rootConstantSizes.push_back(2);
+    merged.rootConstantSizes.push_back(3);
+    cbv.rootConstantSizes.push_back(1);
+    cbv.rootCbvCount = 2;
+    assert_msg(!hash::equal(layout_key(split), layout_key(merged)), "Split and merged ranges share a key");
+    assert_msg(!hash::equal(layout_key(split), layout_key(cbv)), "Range sizes confused with root CBVs");
+
+    // A bindless root signature only depends on the total number of slots
+    ComputeShaderDescriptor bindlessA(allocator), bindlessB(allocator);
+    bindlessA.bindless = bindlessB.bindless = true;
+    fill_layout(bindlessA, 3, 1, 0);
+    fill_layout(bindlessB, 1, 2, 1);
+    assert_msg(hash::equal(layout_key(bindlessA), layout_key(bindlessB)), "Equivalent bindless layouts have different keys");
+
+    // Pipelines differ with the bytecode and the root signature
+    const char bytecodeA[] = "DXBC-kernel-a";
+    const char bytecodeB[] = "DXBC-kernel-b";
+    Hash128 pipelineA, pipelineA2, pipelineB, pipelineC;
+    object_cache::pipeline_key(bytecodeA, sizeof(bytecodeA), layout_key(first), pipelineA);
+    object_cache::pipeline_key(bytecodeA, sizeof(bytecodeA), layout_key(first), pipelineA2);
+    object_cache::pipeline_key(bytecodeB, sizeof(bytecodeB), layout_key(first), pipelineB);
+    object_cache::pipeline_key(bytecodeA, sizeof(bytecodeA), layout_key(second), pipelineC);
+    assert_msg(hash::equal(pipelineA, pipelineA2), "Pipeline key is not deterministic");
+    assert_msg(!hash::equal(pipelineA, pipelineB) && !hash::equal(pipelineA, pipelineC), "Different pipelines share a key");
+}
+
+void test_ref_counting()
+{
+    ObjectCache* cache = object_cache::create_cache(*bento::common_allocator());
+    Hash128 key;
+    hash::begin(key);
+    hash::append_string(key, "layout");
+
+    uint64_t object = 0;
+    assert_msg(!object_cache::acquire(cache, key, object), "Empty cache hit");
+    assert_msg(object_cache::insert(cache, key, 0x1000) == 0x1000, "Inserted object not returned");
+    assert_msg(object_cache::acquire(cache, key, object) && object == 0x1000, "Cached object not found");
+
+    // A concurrent creation of the same key gets the existing object back
+    assert_msg(object_cache::insert(cache, key, 0x2000) == 0x1000, "Duplicate insertion replaced the object");
+    assert_msg(object_cache::ref_count(cache, key) == 3 && object_cache::size(cache) == 1, "Wrong reference count");
+
+    assert_msg(!object_cache::release(cache, key, object), "Object released too early");
+    assert_msg(!object_cache::release(cache, key, object), "Object released too early");
+    assert_msg(object_cache::release(cache, key, object) && object == 0x1000, "Last release did not hand the object back");
+    assert_msg(object_cache::size(cache) == 0, "Released object still cached");
+
+    ObjectCacheStats stats = object_cache::get_stats(cache);
+    assert_msg(stats.hits == 1 && stats.misses == 1, "Wrong statistics");
+    object_cache::destroy_cache(cache);
+}
+
+void test_concurrent_creation()
+{
+    // Every thread creates the same handful of objects, exactly one survives per key and every reference is accounted for
+    const uint32_t numThreads = 8;
+    const uint32_t numKeys = 4;
+    const uint32_t numIterations = 1000;
+    ObjectCache* cache = object_cache::create_cache(*bento::common_allocator());
+    std::atomic<uint32_t> destroyed(0);
+    std::atomic<uint32_t> nextObject(1);
+
+    std::vector<std::thread> threads;
+    for (uint32_t threadIdx = 0; threadIdx < numThreads; ++threadIdx)
+    {
+        threads.push_back(std::thread([&, threadIdx]()
+        {
+            for (uint32_t iteration = 0; iteration < numIterations; ++iteration)
+            {
+                Hash128 key;
+                hash::begin(key);
+                hash::append_uint64(key, (iteration + threadIdx) % numKeys);
+                uint64_t object;
+                if (!object_cache::acquire(cache, key, object))
+                {
+                    uint64_t created = nextObject++;
+                    object = object_cache::insert(cache, key, created);
+                    if (object != created)
+                        destroyed++;
+                }
+                if (object_cache::release(cache, key, object))
+                    destroyed++;
+            }
+        }));
+    }
+    for (uint32_t threadIdx = 0; threadIdx < numThreads; ++threadIdx)
+        threads[threadIdx].join();
+
+    assert_msg(object_cache::size(cache) == 0, "References leaked");
+    assert_msg(destroyed == nextObject - 1, "Objects leaked or destroyed twice");
+    object_cache::destroy_cache(cache);
+}
+
+int main()
+{
+    test_root_signature_keys();
+    test_ref_counting();
+    test_concurrent_creation();
+    std::cout << "Object cache tests passed" << std::endl;
+    return 0;
+}
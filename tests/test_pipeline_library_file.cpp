@@ -0,0 +1,149 @@
+// System includes
+#include <iostream>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+// Bento includes
+#include <bento_base/security.h>
+#include <bento_memory/common.h>
+
+// SDK includes
+#include "gpu_backend/pipeline_library_file.h"
+#include "tools/mapped_file.h"
+
+using namespace graphics_sandbox;
+
+const char* library_path = "test_pipeline_library.bin";
+
+PipelineLibraryIdentity reference_identity()
+{
+    PipelineLibraryIdentity identity;
+    identity.vendorId = 0x10de;
+    identity.deviceId = 0x2684;
+    identity.subSysId = 0x16f3;
+    identity.revision = 0xa1;
+    identity.driverVersion = 0x001f000f000f1234ull;
+    return identity;
+}
+
+// Rewrites the file with an edited copy of its content
+void patch_file(const std::string& content)
+{
+    FILE* file = fopen(library_path, "wb");
+    fwrite(content.c_str(), 1, content.size(), file);
+    fclose(file);
+}
+
+std::string read_file()
+{
+    MappedFile* file = mapped_file::open(*bento::common_allocator(), library_path);
+    assert_msg(file != nullptr, "Failed to map the library");
+    std::string content(mapped_file::data(file), mapped_file::size(file));
+    mapped_file::close(file);
+    return content;
+}
+
+PipelineLibraryStatus validate_file(const PipelineLibraryIdentity& identity, std::string& payload)
+{
+    MappedFile* file = mapped_file::open(*bento::common_allocator(), library_path);
+    assert_msg(file != nullptr, "Failed to map the library");
+    const char* payloadData = nullptr;
+    uint64_t payloadSize = 0;
+    PipelineLibraryStatus status = pipeline_library_file::validate(mapped_file::data(file), mapped_file::size(file), identity, payloadData, payloadSize);
+    if (status == PipelineLibraryStatus::Valid)
+    {
+        assert_msg((uint64_t)(payloadData - mapped_file::data(file)) % PIPELINE_LIBRARY_PAYLOAD_ALIGNMENT == 0, "Payload is not aligned");
+        payload.assign(payloadData, payloadSize);
+    }
+    mapped_file::close(file);
+    return status;
+}
+
+void test_round_trip()
+{
+    std::string payload(1000, '\0');
+    for (uint32_t byteIdx = 0; byteIdx < payload.size(); ++byteIdx)
+        payload[byteIdx] = (char)(byteIdx * 31);
+    assert_msg(pipeline_library_file::write(library_path, reference_identity(), payload.c_str(), payload.size()), "Failed to write the library");
+
+    std::string loaded;
+    assert_msg(validate_file(reference_identity(), loaded) == PipelineLibraryStatus::Valid, "Valid library rejected");
+    assert_msg(loaded == payload, "Payload changed");
+
+    // Overwriting keeps a single up to date file
+    payload.resize(10);
+    assert_msg(pipeline_library_file::write(library_path, reference_identity(), payload.c_str(), payload.size()), "Failed to rewrite the library");
+    assert_msg(validate_file(reference_identity(), loaded) == PipelineLibraryStatus::Valid && loaded == payload, "Rewritten library is wrong");
+}
+
+void test_invalidation()
+{
+    const char payload[] = "driver blob";
+    assert_msg(pipeline_library_file::write(library_path, reference_identity(), payload, sizeof(payload)), "Failed to write the library");
+    std::string loaded;
+
+    // Any change of adapter invalidates the file
+    PipelineLibraryIdentity identity = reference_identity();
+    identity.deviceId++;
+    assert_msg(validate_file(identity, loaded) == PipelineLibraryStatus::AdapterMismatch, "Other device accepted");
+    identity = reference_identity();
+    identity.vendorId = 0x1002;
+    assert_msg(validate_file(identity, loaded) == PipelineLibraryStatus::AdapterMismatch, "Other vendor accepted");
+    identity = reference_identity();
+    identity.revision++;
+    assert_msg(validate_file(identity, loaded) == PipelineLibraryStatus::AdapterMismatch, "Other revision accepted");
+
+    // So does a driver update
+    identity = reference_identity();
+    identity.driverVersion++;
+    assert_msg(validate_file(identity, loaded) == PipelineLibraryStatus::DriverMismatch, "Other driver accepted");
+}
+
+void test_corruption()
+{
+    const char payload[] = "driver blob";
+    assert_msg(pipeline_library_file::write(library_path, reference_identity(), payload, sizeof(payload)), "Failed to write the library");
+    const std::string original = read_file();
+    std::string loaded;
+
+    // Format version bump
+    std::string content = original;
+    PipelineLibraryHeader header;
+    memcpy(&header, content.c_str(), sizeof(header));
+    header.version = PIPELINE_LIBRARY_VERSION + 1;
+    memcpy(&content[0], &header, sizeof(header));
+    patch_file(content);
+    assert_msg(validate_file(reference_identity(), loaded) == PipelineLibraryStatus::VersionMismatch, "Other version accepted");
+
+    // Not a library
+    content = original;
+    content[0] = 'X';
+    patch_file(content);
+    assert_msg(validate_file(reference_identity(), loaded) == PipelineLibraryStatus::Corrupted, "Wrong magic accepted");
+
+    // Truncated payload, then truncated header
+    patch_file(original.substr(0, original.size() - 1));
+    assert_msg(validate_file(reference_identity(), loaded) == PipelineLibraryStatus::Corrupted, "Truncated payload accepted");
+    patch_file(original.substr(0, sizeof(PipelineLibraryHeader) - 1));
+    assert_msg(validate_file(reference_identity(), loaded) == PipelineLibraryStatus::Corrupted, "Truncated header accepted");
+
+    // Damaged payload
+    content = original;
+    content[content.size() - 2] ^= 0x40;
+    patch_file(content);
+    assert_msg(validate_file(reference_identity(), loaded) == PipelineLibraryStatus::Corrupted, "Damaged payload accepted");
+
+    // Missing file
+    remove(library_path);
+    assert_msg(mapped_file::open(*bento::common_allocator(), library_path) == nullptr, "Mapped a missing file");
+}
+
+int main()
+{
+    test_round_trip();
+    test_invalidation();
+    test_corruption();
+    std::cout << "Pipeline library file tests passed" << std::endl;
+    return 0;
+}
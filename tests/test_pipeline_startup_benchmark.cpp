@@ -0,0 +1,87 @@
+// Windows include
+#include <Windows.h>
+#include <chrono>
+#include <iostream>
+#include <stdio.h>
+
+// Bento includes
+#include <bento_base/security.h>
+#include <bento_collection/dynamic_string.h>
+
+// Graphics API include
+#include "d3d12_backend/dx12_backend.h"
+
+using namespace graphics_sandbox;
+using namespace graphics_sandbox::d3d12;
+
+// Kernels created at "startup"
+const uint32_t numKernels = 3;
+const char* shader_file_names[numKernels] = { "BasicComputeShader.compute", "IncrementBuffer.compute", "IncrementBufferRootConstants.compute" };
+const char* shader_kernel_names[numKernels] = { "BasicKernel", "IncrementBuffer", "IncrementBuffer" };
+const char* shader_cache_path = "pipeline_startup_shaders.bin";
+const char* pipeline_library_path = "pipeline_startup_library.bin";
+
+// Creates a device and every kernel like an application starting up, returns the shader creation time in milliseconds
+double startup(const bento::DynamicString& shaderLibrary, bool useShaderCache, bool usePipelineLibrary)
+{
+    GraphicsDevice graphicsDevice = graphics_device::create_graphics_device();
+    ShaderCache* shaderCache = useShaderCache ? shader_cache::create_cache(*bento::common_allocator(), shader_cache_path) : nullptr;
+    graphics_device::set_shader_cache(graphicsDevice, shaderCache);
+    if (usePipelineLibrary)
+        graphics_device::set_pipeline_library(graphicsDevice, pipeline_library_path);
+
+    ComputeShader computeShaders[numKernels];
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t kernelIdx = 0; kernelIdx < numKernels; ++kernelIdx)
+    {
+        ComputeShaderDescriptor csd(*bento::common_allocator());
+        csd.filename = shaderLibrary;
+        csd.filename += "\\";
+        csd.filename += shader_file_names[kernelIdx];
+        csd.kernelname = shader_kernel_names[kernelIdx];
+        computeShaders[kernelIdx] = compute_shader::create_compute_shader(graphicsDevice, csd);
+    }
+    double duration = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    // Shutdown writes the caches
+    for (uint32_t kernelIdx = 0; kernelIdx < numKernels; ++kernelIdx)
+        compute_shader::destroy_compute_shader(computeShaders[kernelIdx]);
+    graphics_device::destroy_graphics_device(graphicsDevice);
+    if (shaderCache != nullptr)
+        shader_cache::destroy_cache(shaderCache);
+    return duration;
+}
+
+int CALLBACK main(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR lpCmdLine, int nCmdShow)
+{
+    // The root directory was not specified in this case
+    if (__argc < 2)
+    {
+        printf("[ERROR] Repository path not specified\n");
+        return -1;
+    }
+
+    // Location of the shader library
+    bento::DynamicString shaderLibrary(*bento::common_allocator(), __argv[1]);
+    shaderLibrary += "\\shaders";
+
+    // Cold start, nothing is cached
+    remove(shader_cache_path);
+    remove(pipeline_library_path);
+    double coldTime = startup(shaderLibrary, true, true);
+
+    // Only the bytecode is cached, the driver still compiles to ISA
+    double bytecodeTime = startup(shaderLibrary, true, false);
+
+    // Warm start, the pipelines come from the library
+    double warmTime = startup(shaderLibrary, true, true);
+
+    std::cout << "Shader creation for " << numKernels << " kernels" << std::endl;
+    std::cout << "    Cold:            " << coldTime << " ms" << std::endl;
+    std::cout << "    Bytecode cached: " << bytecodeTime << " ms" << std::endl;
+    std::cout << "    Warm:            " << warmTime << " ms" << std::endl;
+
+    remove(shader_cache_path);
+    remove(pipeline_library_path);
+    return 0;
+}
@@ -0,0 +1,277 @@
+// System includes
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Bento includes
+#include <bento_base/security.h>
+#include <bento_memory/common.h>
+
+// SDK includes
+#include "gpu_backend/readback_ring.h"
+#include "cpu_backend/cpu_backend.h"
+
+using namespace graphics_sandbox;
+
+// Fake command buffers, the ring only compares them
+const uint64_t CommandBufferA = 0x100;
+const uint64_t CommandBufferB = 0x200;
+
+void test_tickets()
+{
+    ReadbackRing ring(*bento::common_allocator());
+    readback_ring::initialize(ring, 1024);
+    assert_msg(readback_ring::status(ring, 0) == ReadbackStatus::Invalid && readback_ring::status(ring, 1) == ReadbackStatus::Invalid, "Unknown ticket accepted");
+
+    // Two command buffers record readbacks, only the first one is executed
+    uint64_t offset0, offset1, offset2;
+    uint64_t ticket0 = readback_ring::allocate(ring, 100, READBACK_RING_ALIGNMENT, CommandBufferA, nullptr, nullptr, offset0);
+    uint64_t ticket1 = readback_ring::allocate(ring, 100, READBACK_RING_ALIGNMENT, CommandBufferB, nullptr, nullptr, offset1);
+    uint64_t ticket2 = readback_ring::allocate(ring, 100, READBACK_RING_ALIGNMENT, CommandBufferA, nullptr, nullptr, offset2);
+    assert_msg(ticket0 != 0 && ticket1 != 0 && ticket2 != 0 && ticket0 != ticket1 && ticket1 != ticket2, "Wrong tickets");
+    assert_msg(offset0 == 0 && offset1 == 112 && offset2 == 224, "Ranges not aligned or overlapping");
+    assert_msg(readback_ring::status(ring, ticket0) == ReadbackStatus::Recorded, "Ticket not recorded");
+    assert_msg(readback_ring::submit(ring, CommandBufferA, 5) == 0, "Callbacks counted without callbacks");
+    assert_msg(readback_ring::status(ring, ticket0) == ReadbackStatus::InFlight && readback_ring::status(ring, ticket2) == ReadbackStatus::InFlight, "Ticket not in flight");
+    assert_msg(readback_ring::status(ring, ticket1) == ReadbackStatus::Recorded, "Ticket of another command buffer submitted");
+
+    // Completion is only known through the signaled points
+    readback_ring::signal(ring, 4);
+    assert_msg(readback_ring::status(ring, ticket0) == ReadbackStatus::InFlight, "Ticket ready too early");
+    readback_ring::signal(ring, 5);
+    ReadbackTicketState* state;
+    assert_msg(readback_ring::status(ring, ticket0) == ReadbackStatus::Ready && readback_ring::get(ring, ticket0, state) && state->offset == 0 && state->size == 100, "Ticket not ready");
+
+    // Released out of order, the space only comes back once the oldest ticket goes
+    assert_msg(readback_ring::release(ring, ticket2) && !readback_ring::release(ring, ticket2), "Double release not detected");
+    assert_msg(readback_ring::status(ring, ticket2) == ReadbackStatus::Invalid && readback_ring::num_live(ring) == 2, "Released ticket still live");
+    assert_msg(readback_ring::release(ring, ticket0) && ring.space.used > 0, "Space of a ticket freed before the older ones");
+
+    // Releasing a ticket in flight is a cancellation, the space waits for the copy
+    readback_ring::submit(ring, CommandBufferB, 6);
+    assert_msg(readback_ring::release(ring, ticket1) && ring.space.used > 0, "Space freed under a copy in flight");
+    readback_ring::signal(ring, 6);
+    assert_msg(ring.space.used == 0 && readback_ring::num_live(ring) == 0, "Space not reclaimed");
+}
+
+void test_full_ring()
+{
+    ReadbackRing ring(*bento::common_allocator());
+    readback_ring::initialize(ring, 256);
+    uint64_t offset;
+    uint64_t first = readback_ring::allocate(ring, 128, READBACK_RING_ALIGNMENT, CommandBufferA, nullptr, nullptr, offset);
+    uint64_t second = readback_ring::allocate(ring, 128, READBACK_RING_ALIGNMENT, CommandBufferA, nullptr, nullptr, offset);
+    assert_msg(first != 0 && second != 0 && readback_ring::allocate(ring, 16, READBACK_RING_ALIGNMENT, CommandBufferA, nullptr, nullptr, offset) == 0, "Full ring handed out space");
+    assert_msg(ring.failedRequests == 1, "Failure not counted");
+
+    // A failed request doesn't consume a ticket
+    readback_ring::submit(ring, CommandBufferA, 1);
+    readback_ring::signal(ring, 1);
+    readback_ring::release(ring, first);
+    uint64_t third = readback_ring::allocate(ring, 64, READBACK_RING_ALIGNMENT, CommandBufferA, nullptr, nullptr, offset);
+    assert_msg(third == second + 1 && offset == 0, "Space of the released ticket not reused");
+}
+
+void test_cancel()
+{
+    ReadbackRing ring(*bento::common_allocator());
+    readback_ring::initialize(ring, 256);
+
+    // A command buffer records two readbacks and is reset, another one was executed in between
+    uint64_t offset;
+    uint64_t stale = readback_ring::allocate(ring, 64, READBACK_RING_ALIGNMENT, CommandBufferA, nullptr, nullptr, offset);
+    uint64_t executed = readback_ring::allocate(ring, 64, READBACK_RING_ALIGNMENT, CommandBufferB, nullptr, nullptr, offset);
+    uint64_t stale2 = readback_ring::allocate(ring, 64, READBACK_RING_ALIGNMENT, CommandBufferA, nullptr, nullptr, offset);
+    readback_ring::submit(ring, CommandBufferB, 1);
+    readback_ring::cancel(ring, CommandBufferA);
+    assert_msg(readback_ring::status(ring, stale) == ReadbackStatus::Invalid && readback_ring::status(ring, stale2) == ReadbackStatus::Invalid, "Cancelled ticket still valid");
+    assert_msg(readback_ring::status(ring, executed) == ReadbackStatus::InFlight, "Ticket of another command buffer cancelled");
+
+    // The next execution of the reset command buffer doesn't stamp the cancelled tickets
+    uint64_t fresh = readback_ring::allocate(ring, 64, READBACK_RING_ALIGNMENT, CommandBufferA, nullptr, nullptr, offset);
+    assert_msg(readback_ring::submit(ring, CommandBufferA, 2) == 0 && readback_ring::status(ring, fresh) == ReadbackStatus::InFlight, "Fresh ticket not submitted");
+    readback_ring::signal(ring, 2);
+    readback_ring::release(ring, executed);
+    readback_ring::release(ring, fresh);
+    assert_msg(ring.space.used == 0 && readback_ring::num_live(ring) == 0, "Cancelled tickets block the ring");
+
+    // A command buffer destroyed without being executed doesn't block the ring forever
+    uint64_t first = readback_ring::allocate(ring, 128, READBACK_RING_ALIGNMENT, CommandBufferA, nullptr, nullptr, offset);
+    readback_ring::cancel(ring, CommandBufferA);
+    assert_msg(first != 0 && ring.space.used == 0, "Space of a destroyed command buffer not reclaimed");
+    assert_msg(readback_ring::allocate(ring, 256, READBACK_RING_ALIGNMENT, CommandBufferB, nullptr, nullptr, offset) != 0, "Ring still blocked");
+}
+
+void test_random()
+{
+    // Many command buffers in flight, tickets read and released in random order: the live ranges never overlap
+    const uint64_t capacity = 1 << 16;
+    ReadbackRing ring(*bento::common_allocator());
+    readback_ring::initialize(ring, capacity);
+    std::mt19937 generator(3);
+    std::vector<uint64_t> live;
+    std::vector<uint8_t> owner(capacity, 0);
+
+    // Released before their copy was complete, their bytes can only be reused once the point is reached
+    struct CancelledRange { uint64_t point; uint64_t offset; uint64_t size; };
+    std::vector<CancelledRange> cancelled;
+    uint64_t submitted = 0, completed = 0;
+    uint64_t numReleased = 0;
+    for (uint32_t step = 0; step < 200000; ++step)
+    {
+        uint32_t action = generator() % 8;
+        if (action < 4)
+        {
+            uint64_t offset;
+            uint64_t size = 1 + generator() % 2048;
+            uint64_t ticket = readback_ring::allocate(ring, size, READBACK_RING_ALIGNMENT, CommandBufferA, nullptr, nullptr, offset);
+            if (ticket == 0)
+                continue;
+            assert_msg(offset % READBACK_RING_ALIGNMENT == 0 && offset + size <= capacity, "Invalid range");
+            for (uint64_t byteIdx = offset; byteIdx < offset + size; ++byteIdx)
+            {
+                assert_msg(owner[byteIdx] == 0, "Ranges of live tickets overlap");
+                owner[byteIdx] = 1;
+            }
+            live.push_back(ticket);
+        }
+        else if (action == 4)
+            readback_ring::submit(ring, CommandBufferA, ++submitted);
+        else if (action == 5 && completed < submitted)
+        {
+            completed += 1 + generator() % (submitted - completed);
+            readback_ring::signal(ring, completed);
+            for (uint32_t cancelledIdx = 0; cancelledIdx < cancelled.size();)
+            {
+                if (cancelled[cancelledIdx].point <= completed)
+                {
+                    std::fill(owner.begin() + cancelled[cancelledIdx].offset, owner.begin() + cancelled[cancelledIdx].offset + cancelled[cancelledIdx].size, 0);
+                    cancelled[cancelledIdx] = cancelled.back();
+                    cancelled.pop_back();
+                }
+                else
+                    cancelledIdx++;
+            }
+        }
+        else if (!live.empty())
+        {
+            // The ticket's bytes are ours until its copy is done, it is released either way
+            uint32_t liveIdx = generator() % live.size();
+            uint64_t ticket = live[liveIdx];
+            ReadbackTicketState* state;
+            assert_msg(readback_ring::get(ring, ticket, state), "Live ticket lost");
+            ReadbackStatus status = readback_ring::status(ring, ticket);
+            assert_msg(status != ReadbackStatus::Ready || state->point <= completed, "Ticket ready before its point");
+            uint64_t offset = state->offset, size = state->size, point = state->point;
+            assert_msg(readback_ring::release(ring, ticket), "Release failed");
+            if (status == ReadbackStatus::Ready)
+                std::fill(owner.begin() + offset, owner.begin() + offset + size, 0);
+            else
+            {
+                // Every recorded ticket is tagged by the next submission
+                CancelledRange range = { status == ReadbackStatus::Recorded ? submitted + 1 : point, offset, size };
+                cancelled.push_back(range);
+            }
+            live[liveIdx] = live.back();
+            live.pop_back();
+            numReleased++;
+        }
+    }
+    assert_msg(numReleased > 1000 && ring.failedRequests > 0, "The sequence doesn't exercise the ring");
+    std::cout << "Released " << numReleased << " tickets, " << ring.failedRequests << " requests waited for space" << std::endl;
+}
+
+// Receives the readbacks on the timeline's worker
+struct ReadbackReceiver
+{
+    std::atomic<uint32_t> numReceived;
+    std::atomic<uint32_t> numErrors;
+    CommandQueue commandQueue;
+};
+
+void receive_readback(uint64_t ticket, const char* data, uint64_t size, void* userData)
+{
+    ReadbackReceiver* receiver = (ReadbackReceiver*)userData;
+    const uint32_t* values = (const uint32_t*)data;
+    uint32_t first = values[0];
+    for (uint64_t valueIdx = 0; valueIdx < size / sizeof(uint32_t); ++valueIdx)
+        if (values[valueIdx] != first + valueIdx)
+            receiver->numErrors++;
+    cpu::command_queue::release_readback(receiver->commandQueue, ticket);
+    receiver->numReceived++;
+}
+
+void test_cpu_backend()
+{
+    using namespace graphics_sandbox::cpu;
+    const uint32_t numElements = 4096;
+    GraphicsDevice graphicsDevice = graphics_device::create_graphics_device();
+    CommandQueue commandQueue = command_queue::create_command_queue(graphicsDevice);
+    CommandBuffer commandBuffer = command_buffer::create_command_buffer(graphicsDevice);
+
+    GraphicsBuffer uploadBuffer = graphics_resources::create_graphics_buffer(graphicsDevice, numElements * sizeof(uint32_t), sizeof(uint32_t), GraphicsBufferType::Upload);
+    GraphicsBuffer buffer = graphics_resources::create_graphics_buffer(graphicsDevice, numElements * sizeof(uint32_t), sizeof(uint32_t), GraphicsBufferType::Default);
+    std::vector<uint32_t> data(numElements);
+    for (uint32_t elementIdx = 0; elementIdx < numElements; ++elementIdx)
+        data[elementIdx] = elementIdx;
+    graphics_resources::set_data(uploadBuffer, (char*)data.data(), numElements * sizeof(uint32_t));
+
+    // One polled readback and a few streamed through callbacks
+    ReadbackReceiver receiver;
+    receiver.numReceived = 0;
+    receiver.numErrors = 0;
+    receiver.commandQueue = commandQueue;
+    command_buffer::reset(commandBuffer);
+    command_buffer::copy_graphics_buffer(commandBuffer, uploadBuffer, buffer);
+    uint64_t polled = command_queue::request_readback(commandQueue, commandBuffer, buffer, 1000 * sizeof(uint32_t), 24 * sizeof(uint32_t));
+    const uint32_t numStreamed = 8;
+    for (uint32_t chunkIdx = 0; chunkIdx < numStreamed; ++chunkIdx)
+        assert_msg(command_queue::request_readback(commandQueue, commandBuffer, buffer, chunkIdx * 512 * sizeof(uint32_t), 512 * sizeof(uint32_t), receive_readback, &receiver) != 0, "Readback refused");
+    command_buffer::close(commandBuffer);
+
+    uint64_t size;
+    assert_msg(command_queue::readback_status(commandQueue, polled) == ReadbackStatus::Recorded && command_queue::map_readback(commandQueue, polled, size) == nullptr, "Readback available before execution");
+    uint64_t point = command_queue::execute_command_buffer(commandQueue, commandBuffer);
+    assert_msg(command_queue::readback_status(commandQueue, polled) == ReadbackStatus::Ready, "Readback not ready");
+    const uint32_t* values = (const uint32_t*)command_queue::map_readback(commandQueue, polled, size);
+    assert_msg(values != nullptr && size == 24 * sizeof(uint32_t), "Wrong readback range");
+    for (uint32_t valueIdx = 0; valueIdx < 24; ++valueIdx)
+        assert_msg(values[valueIdx] == 1000 + valueIdx, "Wrong readback data");
+    command_queue::release_readback(commandQueue, polled);
+    assert_msg(command_queue::readback_status(commandQueue, polled) == ReadbackStatus::Invalid, "Released readback still valid");
+
+    // The callbacks run on the worker after the point
+    command_queue::wait(commandQueue, point);
+    while (receiver.numReceived < numStreamed)
+        std::this_thread::yield();
+    assert_msg(receiver.numErrors == 0, "Wrong streamed data");
+
+    // A recording that is abandoned gives its tickets back
+    command_buffer::reset(commandBuffer);
+    uint64_t abandoned = command_queue::request_readback(commandQueue, commandBuffer, buffer, 0, 16 * sizeof(uint32_t));
+    command_buffer::reset(commandBuffer);
+    assert_msg(command_queue::readback_status(commandQueue, abandoned) == ReadbackStatus::Invalid, "Readback of a reset command buffer still valid");
+    abandoned = command_queue::request_readback(commandQueue, commandBuffer, buffer, 0, 16 * sizeof(uint32_t));
+    command_buffer::close(commandBuffer);
+    command_buffer::destroy_command_buffer(commandBuffer);
+    assert_msg(command_queue::readback_status(commandQueue, abandoned) == ReadbackStatus::Invalid, "Readback of a destroyed command buffer still valid");
+
+    graphics_resources::destroy_graphics_buffer(buffer);
+    graphics_resources::destroy_graphics_buffer(uploadBuffer);
+    command_queue::destroy_command_queue(commandQueue);
+    graphics_device::destroy_graphics_device(graphicsDevice);
+}
+
+int main()
+{
+    test_tickets();
+    test_full_ring();
+    test_cancel();
+    test_random();
+    test_cpu_backend();
+    std::cout << "Readback ring tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,102 @@
+// System includes
+#include <iostream>
+
+// Bento includes
+#include <bento_base/security.h>
+#include <bento_memory/common.h>
+
+// SDK includes
+#include "gpu_backend/resource_barrier_batch.h"
+
+using namespace graphics_sandbox;
+
+// Arbitrary state bits, the batch never interprets them
+const uint32_t StateCommon = 0;
+const uint32_t StateCopySource = 1;
+const uint32_t StateCopyDest = 2;
+const uint32_t StateUAV = 4;
+const uint32_t StateSRV = 8;
+
+void test_merge_chain()
+{
+    // A->B->C on the same resource becomes A->C
+    ResourceBarrierBatch batch(*bento::common_allocator());
+    resource_barrier_batch::request_transition(batch, 1, StateCommon, StateCopyDest);
+    resource_barrier_batch::request_transition(batch, 1, StateCopyDest, StateUAV);
+    assert_msg(resource_barrier_batch::compact(batch) == 1, "Chain was not merged");
+    assert_msg(batch.barriers[0].stateBefore == StateCommon && batch.barriers[0].stateAfter == StateUAV, "Wrong merged states");
+    resource_barrier_batch::reset(batch);
+    assert_msg(batch.barriers.size() == 0 && batch.emittedBarriers == 1 && batch.requestedBarriers == 2, "Wrong statistics");
+}
+
+void test_cancel_out()
+{
+    // A->B->A disappears, even when the resource is then transitioned again
+    ResourceBarrierBatch batch(*bento::common_allocator());
+    resource_barrier_batch::request_transition(batch, 1, StateCopySource, StateCopyDest);
+    resource_barrier_batch::request_transition(batch, 1, StateCopyDest, StateCopySource);
+    resource_barrier_batch::request_transition(batch, 2, StateCommon, StateSRV);
+    assert_msg(resource_barrier_batch::compact(batch) == 1, "Round trip was not dropped");
+    assert_msg(batch.barriers[0].resource == 2, "Wrong barrier was dropped");
+    resource_barrier_batch::reset(batch);
+
+    resource_barrier_batch::request_transition(batch, 1, StateCopySource, StateCopyDest);
+    resource_barrier_batch::request_transition(batch, 1, StateCopyDest, StateCopySource);
+    resource_barrier_batch::request_transition(batch, 1, StateCopySource, StateUAV);
+    assert_msg(resource_barrier_batch::compact(batch) == 1, "Cancelled transition was not reused");
+    assert_msg(batch.barriers[0].stateBefore == StateCopySource && batch.barriers[0].stateAfter == StateUAV, "Wrong reused states");
+}
+
+void test_dispatch_bindings()
+{
+    // 2 SRVs + 2 UAVs + 1 CBV, plus one duplicated bind, end up in a single flush
+    ResourceBarrierBatch batch(*bento::common_allocator());
+    for (uint64_t resource = 1; resource <= 5; ++resource)
+        resource_barrier_batch::request_transition(batch, resource, StateCommon, resource <= 2 ? StateSRV : StateUAV);
+    resource_barrier_batch::request_transition(batch, 3, StateUAV, StateUAV);
+    assert_msg(resource_barrier_batch::compact(batch) == 5, "Bindings were not batched");
+    resource_barrier_batch::reset(batch);
+    assert_msg(batch.flushes == 1 && batch.emittedBarriers == 5, "Wrong flush statistics");
+
+    // Empty batches are not counted as flushes
+    resource_barrier_batch::compact(batch);
+    resource_barrier_batch::reset(batch);
+    assert_msg(batch.flushes == 1, "Empty flush was counted");
+}
+
+void test_uav_barriers()
+{
+    // Duplicated UAV barriers are merged and the order relative to transitions is preserved
+    ResourceBarrierBatch batch(*bento::common_allocator());
+    resource_barrier_batch::request_uav_barrier(batch, 1);
+    resource_barrier_batch::request_uav_barrier(batch, 1);
+    resource_barrier_batch::request_transition(batch, 1, StateUAV, StateCopySource);
+    resource_barrier_batch::request_uav_barrier(batch, 2);
+    assert_msg(resource_barrier_batch::compact(batch) == 3, "UAV barriers were not merged");
+    assert_msg(batch.barriers[0].type == ResourceBarrierType::UAV && batch.barriers[0].resource == 1, "Wrong barrier order");
+    assert_msg(batch.barriers[1].type == ResourceBarrierType::Transition, "Wrong barrier order");
+    assert_msg(batch.barriers[2].type == ResourceBarrierType::UAV && batch.barriers[2].resource == 2, "Wrong barrier order");
+}
+
+void test_discard()
+{
+    // Barriers of an abandoned recording are dropped without being counted as emitted
+    ResourceBarrierBatch batch(*bento::common_allocator());
+    resource_barrier_batch::request_transition(batch, 1, StateCommon, StateUAV);
+    resource_barrier_batch::request_uav_barrier(batch, 2);
+    resource_barrier_batch::discard(batch);
+    assert_msg(batch.barriers.size() == 0, "Pending barriers were not dropped");
+    assert_msg(batch.emittedBarriers == 0 && batch.flushes == 0, "Discarded barriers were counted");
+    assert_msg(batch.requestedBarriers == 2, "Requests were not counted");
+}
+
+int main(int, char**)
+{
+    test_merge_chain();
+    test_cancel_out();
+    test_dispatch_bindings();
+    test_uav_barriers();
+    test_discard();
+    std::cout << "Resource barrier batch tests succeeded" << std::endl;
+    return 0;
+}
@@ -0,0 +1,113 @@
+// Windows include
+#include <Windows.h>
+#include <iostream>
+#include <vector>
+
+// Bento includes
+#include <bento_base/security.h>
+
+// Graphics API include
+#include "d3d12_backend/dx12_backend.h"
+
+using namespace graphics_sandbox;
+using namespace graphics_sandbox::d3d12;
+
+// Compute shader that we will be executing
+const char* shader_file_name = "IncrementBufferRootConstants.compute";
+const char* shader_kernel_name = "IncrementBuffer";
+const uint32_t workGroupSize = 32;
+const uint32_t numElements = 1024;
+const uint32_t numIterations = 16;
+const uint32_t constantBufferStride = 256;
+
+int CALLBACK main(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR lpCmdLine, int nCmdShow)
+{
+    // The root directory was not specified in this case
+    if (__argc < 2)
+    {
+        printf("[ERROR] Repository path not specified\n");
+        return -1;
+    }
+
+    // Create the graphics device
+    GraphicsDevice graphicsDevice = graphics_device::create_graphics_device(true);
+
+    // Location of the shader library
+    bento::DynamicString shaderLibrary(*bento::common_allocator(), __argv[1]);
+    shaderLibrary += "\\shaders";
+
+    // Create the compute shader, the increment is passed both as a root constant and through a root CBV
+    ComputeShaderDescriptor csd(*bento::common_allocator());
+    csd.filename = shaderLibrary;
+    csd.filename += "\\";
+    csd.filename += shader_file_name;
+    csd.kernelname = shader_kernel_name;
+    csd.srvCount = 0;
+    csd.uavCount = 1;
+    csd.cbvCount = 0;
+    csd.rootConstantSizes.push_back(1);
+    csd.rootCbvCount = 1;
+    ComputeShader computeShader = compute_shader::create_compute_shader(graphicsDevice, csd);
+
+    // Create the command queue and the command buffer
+    CommandQueue commandQueue = command_queue::create_command_queue(graphicsDevice);
+    CommandBuffer commandBuffer = command_buffer::create_command_buffer(graphicsDevice);
+
+    // Create the required graphics buffers
+    GraphicsBuffer uploadBuffer = graphics_resources::create_graphics_buffer(graphicsDevice, sizeof(uint32_t) * numElements, sizeof(uint32_t), GraphicsBufferType::Upload);
+    GraphicsBuffer buffer = graphics_resources::create_graphics_buffer(graphicsDevice, sizeof(uint32_t) * numElements, sizeof(uint32_t), GraphicsBufferType::Default);
+    GraphicsBuffer readbackBuffer = graphics_resources::create_graphics_buffer(graphicsDevice, sizeof(uint32_t) * numElements, sizeof(uint32_t), GraphicsBufferType::Readback);
+    std::vector<uint32_t> inputBufferCPU(numElements);
+    for (uint32_t i = 0; i < numElements; ++i)
+        inputBufferCPU[i] = i;
+    graphics_resources::set_data(uploadBuffer, (char*)inputBufferCPU.data(), numElements * sizeof(uint32_t));
+
+    // A single constant buffer holds the values of every iteration
+    std::vector<uint32_t> constantsCPU(numIterations * constantBufferStride / sizeof(uint32_t), 0);
+    for (uint32_t iter = 0; iter < numIterations; ++iter)
+        constantsCPU[iter * constantBufferStride / sizeof(uint32_t)] = 2 * iter;
+    ConstantBuffer constantBuffer = graphics_resources::create_constant_buffer(graphicsDevice, numIterations * constantBufferStride, constantBufferStride, ConstantBufferType::Static);
+    graphics_resources::upload_constant_buffer(constantBuffer, (const char*)constantsCPU.data(), numIterations * constantBufferStride);
+
+    // Record the iterations, no copy is needed between them
+    command_buffer::reset(commandBuffer);
+    command_buffer::copy_graphics_buffer(commandBuffer, uploadBuffer, buffer);
+    for (uint32_t iter = 0; iter < numIterations; ++iter)
+    {
+        command_buffer::set_compute_constants(commandBuffer, computeShader, 0, &iter, sizeof(uint32_t));
+        command_buffer::set_compute_cbv_address(commandBuffer, computeShader, 0, constantBuffer, iter * constantBufferStride);
+        command_buffer::set_compute_graphics_buffer_uav(commandBuffer, computeShader, 0, buffer);
+        command_buffer::dispatch(commandBuffer, computeShader, numElements / workGroupSize, 1, 1);
+        command_buffer::uav_barrier(commandBuffer, buffer);
+    }
+    command_buffer::copy_graphics_buffer(commandBuffer, buffer, readbackBuffer);
+    command_buffer::close(commandBuffer);
+
+    // Execute the command buffer and wait for it
+    command_queue::execute_command_buffer(commandQueue, commandBuffer);
+    command_queue::flush(commandQueue);
+
+    // Expected added value
+    uint32_t totalValue = 0;
+    for (uint32_t i = 0; i < numIterations; ++i)
+        totalValue += 3 * i;
+
+    // Create a cpu view on the readback buffer
+    uint32_t* outputData = (uint32_t*)graphics_resources::allocate_cpu_buffer(readbackBuffer);
+    for (uint32_t idx = 0; idx < numElements; ++idx)
+        assert_msg(outputData[idx] == (idx + totalValue), "Failure");
+    graphics_resources::release_cpu_buffer(readbackBuffer);
+
+    // Release all the resources
+    graphics_resources::destroy_constant_buffer(constantBuffer);
+    graphics_resources::destroy_graphics_buffer(readbackBuffer);
+    graphics_resources::destroy_graphics_buffer(buffer);
+    graphics_resources::destroy_graphics_buffer(uploadBuffer);
+    compute_shader::destroy_compute_shader(computeShader);
+    command_buffer::destroy_command_buffer(commandBuffer);
+    command_queue::destroy_command_queue(commandQueue);
+    graphics_device::destroy_graphics_device(graphicsDevice);
+
+    std::cout << "Root constants test succeeded" << std::endl;
+    return 0;
+}
@@ -0,0 +1,149 @@
+// System includes
+#include <iostream>
+#include <stdio.h>
+#include <string.h>
+
+// Bento includes
+#include <bento_base/security.h>
+#include <bento_memory/common.h>
+
+// SDK includes
+#include "gpu_backend/shader_cache.h"
+
+using namespace graphics_sandbox;
+
+const char* PackPath = "test_shader_cache.pack";
+const char* Arguments[] = { "-O3", "-enable-16bit-types" };
+
+void write_file(const char* path, const char* content)
+{
+    FILE* file = fopen(path, "wb");
+    assert_msg(file != nullptr, "Failed to write a test file");
+    fwrite(content, 1, strlen(content), file);
+    fclose(file);
+}
+
+void write_sources(const char* constant)
+{
+    write_file("test_shader_cache_main.compute", "#include \"test_shader_cache_common.hlsli\"\n[numthreads(64, 1, 1)]\nvoid Kernel(uint id : SV_DispatchThreadID) {}\n");
+    write_file("test_shader_cache_common.hlsli", "  #  include <test_shader_cache_math.hlsli>\n#include \"test_shader_cache_missing.hlsli\"\n// #include is only parsed at the start of a line\n");
+    write_file("test_shader_cache_math.hlsli", constant);
+}
+
+Hash128 key_for(const char* kernel, uint32_t numArguments, uint64_t compilerVersion)
+{
+    bento::Vector<bento::DynamicString> includeDirectories(*bento::common_allocator());
+    includeDirectories.push_back(bento::DynamicString(*bento::common_allocator(), "."));
+    Hash128 key;
+    assert_msg(shader_cache::compute_key("test_shader_cache_main.compute", includeDirectories, kernel, "cs_6_4", Arguments, numArguments, compilerVersion, key), "Failed to compute the key");
+    return key;
+}
+
+void test_dependencies()
+{
+    write_sources("static const uint Size = 64;\n");
+    bento::Vector<bento::DynamicString> includeDirectories(*bento::common_allocator());
+    includeDirectories.push_back(bento::DynamicString(*bento::common_allocator(), "."));
+    bento::Vector<bento::DynamicString> dependencies(*bento::common_allocator());
+    shader_cache::collect_dependencies("test_shader_cache_main.compute", includeDirectories, dependencies);
+
+    // The missing include is skipped, the angled one is found through the include directory
+    assert_msg(dependencies.size() == 3, "Wrong number of dependencies");
+    assert_msg(strcmp(dependencies[0].c_str(), "test_shader_cache_main.compute") == 0, "The source must come first");
+    assert_msg(strcmp(dependencies[2].c_str(), "./test_shader_cache_math.hlsli") == 0, "Include directory not used");
+}
+
+void test_key()
+{
+    write_sources("static const uint Size = 64;\n");
+    Hash128 reference = key_for("Kernel", 2, 1);
+    assert_msg(hash::equal(reference, key_for("Kernel", 2, 1)), "Key is not deterministic");
+    assert_msg(!hash::equal(reference, key_for("Other", 2, 1)), "Kernel name is not part of the key");
+    assert_msg(!hash::equal(reference, key_for("Kernel", 1, 1)), "Arguments are not part of the key");
+    assert_msg(!hash::equal(reference, key_for("Kernel", 2, 2)), "Compiler version is not part of the key");
+
+    // Editing a file included two levels deep invalidates the key
+    write_sources("static const uint Size = 128;\n");
+    assert_msg(!hash::equal(reference, key_for("Kernel", 2, 1)), "Transitive include is not part of the key");
+}
+
+void test_pack_round_trip()
+{
+    remove(PackPath);
+    Hash128 keys[3];
+    const char* blobs[3] = { "DXIL blob 0", "another DXIL blob", "2" };
+    for (uint32_t blobIdx = 0; blobIdx < 3; ++blobIdx)
+    {
+        hash::begin(keys[blobIdx]);
+        hash::append_uint64(keys[blobIdx], blobIdx);
+    }
+
+    // Cold run, everything misses
+    ShaderCache* cache = shader_cache::create_cache(*bento::common_allocator(), PackPath);
+    const void* data;
+    uint64_t size;
+    for (uint32_t blobIdx = 0; blobIdx < 3; ++blobIdx)
+    {
+        assert_msg(!shader_cache::lookup(cache, keys[blobIdx], data, size), "Hit in an empty cache");
+        shader_cache::store(cache, keys[blobIdx], blobs[blobIdx], strlen(blobs[blobIdx]));
+    }
+    shader_cache::record_compilation(cache, 1000);
+    ShaderCacheStats stats = shader_cache::get_stats(cache);
+    assert_msg(stats.misses == 3 && stats.hits == 0 && stats.stores == 3 && stats.compilationTime == 1000, "Wrong cold statistics");
+    shader_cache::destroy_cache(cache);
+
+    // Warm run, everything comes from the pack
+    cache = shader_cache::create_cache(*bento::common_allocator(), PackPath);
+    for (uint32_t blobIdx = 0; blobIdx < 3; ++blobIdx)
+    {
+        assert_msg(shader_cache::lookup(cache, keys[blobIdx], data, size), "Miss in a warm cache");
+        assert_msg(size == strlen(blobs[blobIdx]) && memcmp(data, blobs[blobIdx], size) == 0, "Wrong blob");
+        assert_msg((uint64_t)data % SHADER_CACHE_BLOB_ALIGNMENT == 0, "Blob is not aligned");
+    }
+
+    // Adding to a loaded pack keeps the previous entries
+    Hash128 extraKey;
+    hash::begin(extraKey);
+    hash::append_string(extraKey, "extra");
+    shader_cache::store(cache, extraKey, "extra", 5);
+    stats = shader_cache::get_stats(cache);
+    assert_msg(stats.hits == 3 && stats.misses == 0 && stats.lookupTime > 0, "Wrong warm statistics");
+    shader_cache::destroy_cache(cache);
+
+    cache = shader_cache::create_cache(*bento::common_allocator(), PackPath);
+    assert_msg(shader_cache::lookup(cache, keys[0], data, size) && shader_cache::lookup(cache, extraKey, data, size), "Merged pack lost entries");
+    shader_cache::destroy_cache(cache);
+}
+
+void test_corrupted_pack()
+{
+    // A truncated or foreign file is ignored and overwritten
+    write_file(PackPath, "GSSC but not really a pack");
+    ShaderCache* cache = shader_cache::create_cache(*bento::common_allocator(), PackPath);
+    Hash128 key;
+    hash::begin(key);
+    const void* data;
+    uint64_t size;
+    assert_msg(!shader_cache::lookup(cache, key, data, size), "Corrupted pack was used");
+    shader_cache::store(cache, key, "blob", 4);
+    shader_cache::destroy_cache(cache);
+
+    cache = shader_cache::create_cache(*bento::common_allocator(), PackPath);
+    assert_msg(shader_cache::lookup(cache, key, data, size), "Corrupted pack was not replaced");
+    shader_cache::destroy_cache(cache);
+}
+
+int main()
+{
+    test_dependencies();
+    test_key();
+    test_pack_round_trip();
+    test_corrupted_pack();
+
+    remove(PackPath);
+    remove("test_shader_cache_main.compute");
+    remove("test_shader_cache_common.hlsli");
+    remove("test_shader_cache_math.hlsli");
+    std::cout << "All shader cache tests passed" << std::endl;
+    return 0;
+}
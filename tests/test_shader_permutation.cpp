@@ -0,0 +1,154 @@
+// System includes
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+// Bento includes
+#include <bento_base/security.h>
+#include <bento_memory/common.h>
+
+// SDK includes
+#include "gpu_backend/shader_permutation.h"
+
+using namespace graphics_sandbox;
+
+bento::Vector<bento::DynamicString> make_defines(std::initializer_list<const char*> defines)
+{
+    bento::Vector<bento::DynamicString> result(*bento::common_allocator());
+    for (const char* define : defines)
+        result.push_back(bento::DynamicString(*bento::common_allocator(), define));
+    return result;
+}
+
+Hash128 key_of(std::initializer_list<const char*> defines)
+{
+    Hash128 key;
+    shader_permutation::compute_key(make_defines(defines), key);
+    return key;
+}
+
+void test_canonical_keys()
+{
+    bento::Vector<bento::DynamicString> canonical(*bento::common_allocator());
+    shader_permutation::canonicalize(make_defines({ "TILE_SIZE=16", "USE_FP16", "ELEMENT_TYPE=float", "TILE_SIZE=32" }), canonical);
+    assert_msg(canonical.size() == 3, "Duplicate define kept");
+    assert_msg(strcmp(canonical[0].c_str(), "ELEMENT_TYPE=float") == 0, "Defines not sorted");
+    assert_msg(strcmp(canonical[1].c_str(), "TILE_SIZE=32") == 0, "Last definition did not win");
+    assert_msg(strcmp(canonical[2].c_str(), "USE_FP16=1") == 0, "Implicit value not made explicit");
+
+    // Same macros, same values
+    assert_msg(hash::equal(key_of({ "A=1", "B=2" }), key_of({ "B=2", "A=1" })), "Order changes the key");
+    assert_msg(hash::equal(key_of({ "A" }), key_of({ "A=1" })), "Implicit value changes the key");
+    assert_msg(hash::equal(key_of({ "A=3", "A=1" }), key_of({ "A=1" })), "Redefinition changes the key");
+    assert_msg(hash::equal(key_of({}), key_of({})), "Empty key is not deterministic");
+
+    // Anything else is a different variant
+    assert_msg(!hash::equal(key_of({ "A=1" }), key_of({ "A=2" })), "Values ignored");
+    assert_msg(!hash::equal(key_of({ "A=1" }), key_of({ "B=1" })), "Names ignored");
+    assert_msg(!hash::equal(key_of({ "A=1" }), key_of({})), "Define ignored");
+    assert_msg(!hash::equal(key_of({ "AB=1" }), key_of({ "A=B1" })), "Name and value boundary ignored");
+    assert_msg(!hash::equal(key_of({ "A=1", "B=1" }), key_of({ "A=1,B=1" })), "Define boundary ignored");
+}
+
+// Stub compiler, a variant is the hash of the define list it was compiled with
+struct StubCompiler
+{
+    std::atomic<uint32_t> numCompilations;
+    std::atomic<uint32_t> numDestructions;
+};
+
+uint64_t stub_create(const ComputeShaderDescriptor& descriptor, void* userData)
+{
+    StubCompiler* compiler = (StubCompiler*)userData;
+    compiler->numCompilations++;
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    Hash128 key;
+    shader_permutation::compute_key(descriptor.defines, key);
+    return key.low | 1;
+}
+
+void stub_destroy(uint64_t, void* userData)
+{
+    ((StubCompiler*)userData)->numDestructions++;
+}
+
+void test_lazy_variants()
+{
+    StubCompiler compiler;
+    compiler.numCompilations = 0;
+    compiler.numDestructions = 0;
+    ComputeShaderDescriptor base(*bento::common_allocator());
+    base.filename = "reduce.compute";
+    base.kernelname = "Reduce";
+    base.defines.push_back(bento::DynamicString(*bento::common_allocator(), "GROUP_SIZE=64"));
+    PermutationSet* set = shader_permutation::create_permutation_set(*bento::common_allocator(), base, stub_create, stub_destroy, &compiler);
+    assert_msg(compiler.numCompilations == 0 && shader_permutation::num_variants(set) == 0, "Variants compiled eagerly");
+
+    // The variant is compiled with the base defines and its own
+    uint64_t floatVariant = shader_permutation::get_variant(set, make_defines({ "ELEMENT_TYPE=float" }));
+    assert_msg(floatVariant == (key_of({ "GROUP_SIZE=64", "ELEMENT_TYPE=float" }).low | 1), "Base defines not applied");
+    assert_msg(compiler.numCompilations == 1, "Variant not compiled once");
+
+    // Equivalent define lists hit the cache
+    assert_msg(shader_permutation::get_variant(set, make_defines({ "ELEMENT_TYPE=float" })) == floatVariant, "Cached variant not reused");
+    assert_msg(shader_permutation::get_variant(set, make_defines({ "ELEMENT_TYPE=half", "ELEMENT_TYPE=float" })) == floatVariant, "Equivalent variant not reused");
+    assert_msg(compiler.numCompilations == 1, "Cached variant recompiled");
+
+    uint64_t halfVariant = shader_permutation::get_variant(set, make_defines({ "ELEMENT_TYPE=half" }));
+    assert_msg(halfVariant != floatVariant && compiler.numCompilations == 2 && shader_permutation::num_variants(set) == 2, "New variant not compiled");
+
+    shader_permutation::destroy_permutation_set(set);
+    assert_msg(compiler.numDestructions == 2, "Variants leaked");
+}
+
+void test_concurrent_requests()
+{
+    // Many threads ask for a few variants at the same time, each one is compiled exactly once
+    const uint32_t numThreads = 8;
+    const uint32_t numTileSizes = 4;
+    StubCompiler compiler;
+    compiler.numCompilations = 0;
+    compiler.numDestructions = 0;
+    ComputeShaderDescriptor base(*bento::common_allocator());
+    PermutationSet* set = shader_permutation::create_permutation_set(*bento::common_allocator(), base, stub_create, stub_destroy, &compiler);
+
+    std::vector<uint64_t> results(numThreads * numTileSizes);
+    std::vector<std::thread> threads;
+    for (uint32_t threadIdx = 0; threadIdx < numThreads; ++threadIdx)
+    {
+        threads.push_back(std::thread([&, threadIdx]()
+        {
+            for (uint32_t tileIdx = 0; tileIdx < numTileSizes; ++tileIdx)
+            {
+                std::string define = "TILE_SIZE=" + std::to_string(8 << ((tileIdx + threadIdx) % numTileSizes));
+                results[threadIdx * numTileSizes + tileIdx] = shader_permutation::get_variant(set, make_defines({ define.c_str() }));
+            }
+        }));
+    }
+    for (uint32_t threadIdx = 0; threadIdx < numThreads; ++threadIdx)
+        threads[threadIdx].join();
+
+    assert_msg(compiler.numCompilations == numTileSizes && shader_permutation::num_variants(set) == numTileSizes, "Variant compiled more than once");
+    for (uint32_t threadIdx = 0; threadIdx < numThreads; ++threadIdx)
+    {
+        for (uint32_t tileIdx = 0; tileIdx < numTileSizes; ++tileIdx)
+        {
+            std::string define = "TILE_SIZE=" + std::to_string(8 << ((tileIdx + threadIdx) % numTileSizes));
+            assert_msg(results[threadIdx * numTileSizes + tileIdx] == (key_of({ define.c_str() }).low | 1), "Wrong variant returned");
+        }
+    }
+    shader_permutation::destroy_permutation_set(set);
+    assert_msg(compiler.numDestructions == numTileSizes, "Variants leaked");
+}
+
+int main()
+{
+    test_canonical_keys();
+    test_lazy_variants();
+    test_concurrent_requests();
+    std::cout << "Shader permutation tests passed" << std::endl;
+    return 0;
+}
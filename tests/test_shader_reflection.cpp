@@ -0,0 +1,118 @@
+// System includes
+#include <iostream>
+#include <string.h>
+
+// Bento includes
+#include <bento_base/security.h>
+#include <bento_memory/common.h>
+
+// SDK includes
+#include "gpu_backend/shader_reflection.h"
+
+using namespace graphics_sandbox;
+
+// Metadata of a kernel with two buffers in, one out, a constant buffer and a root constant range
+void fill_reflection(ShaderReflection& reflection)
+{
+    reflection.groupSize[0] = 64;
+    reflection.groupSize[1] = 2;
+    reflection.groupSize[2] = 1;
+    shader_reflection::add_binding(reflection, ShaderBindingType::SRV, 0, 0, 1);
+    shader_reflection::add_binding(reflection, ShaderBindingType::SRV, 2, 0, 1);
+    shader_reflection::add_binding(reflection, ShaderBindingType::UAV, 0, 0, 1);
+    shader_reflection::add_binding(reflection, ShaderBindingType::CBV, 0, 0, 1, 48);
+    shader_reflection::add_binding(reflection, ShaderBindingType::CBV, 0, 1, 1, 12);
+}
+
+void test_ranges()
+{
+    ShaderReflection reflection(*bento::common_allocator());
+    fill_reflection(reflection);
+    assert_msg(shader_reflection::validate(reflection), "Valid reflection rejected");
+
+    // t1 is not used, but the table still has to reach t2
+    assert_msg(shader_reflection::register_range(reflection, ShaderBindingType::SRV, 0) == 3, "Wrong SRV range");
+    assert_msg(shader_reflection::register_range(reflection, ShaderBindingType::UAV, 0) == 1, "Wrong UAV range");
+    assert_msg(shader_reflection::register_range(reflection, ShaderBindingType::CBV, 0) == 1, "Wrong CBV range");
+    assert_msg(shader_reflection::register_range(reflection, ShaderBindingType::CBV, 1) == 1, "Wrong root constant range");
+    assert_msg(shader_reflection::register_range(reflection, ShaderBindingType::CBV, 2) == 0, "Unexpected root CBV");
+
+    assert_msg(shader_reflection::find_binding(reflection, ShaderBindingType::SRV, 1, 0) == nullptr, "Found an unused register");
+    const ShaderBinding* constants = shader_reflection::find_binding(reflection, ShaderBindingType::CBV, 0, 1);
+    assert_msg(constants != nullptr && constants->size == 12, "Wrong root constant binding");
+}
+
+void test_validation()
+{
+    // Overlapping arrays
+    ShaderReflection reflection(*bento::common_allocator());
+    fill_reflection(reflection);
+    shader_reflection::add_binding(reflection, ShaderBindingType::SRV, 1, 0, 2);
+    assert_msg(!shader_reflection::validate(reflection), "Overlapping bindings accepted");
+
+    // Same register in another space is fine
+    shader_reflection::reset(reflection);
+    fill_reflection(reflection);
+    shader_reflection::add_binding(reflection, ShaderBindingType::SRV, 0, 3, 4);
+    assert_msg(shader_reflection::validate(reflection), "Binding in another space rejected");
+
+    // Thread group limits
+    reflection.groupSize[0] = 1024;
+    assert_msg(!shader_reflection::validate(reflection), "Too many threads per group accepted");
+    reflection.groupSize[0] = 8;
+    reflection.groupSize[1] = 1;
+    reflection.groupSize[2] = 65;
+    assert_msg(!shader_reflection::validate(reflection), "Group depth above the limit accepted");
+    reflection.groupSize[2] = 0;
+    assert_msg(!shader_reflection::validate(reflection), "Empty group accepted");
+}
+
+void test_serialization()
+{
+    ShaderReflection reflection(*bento::common_allocator());
+    fill_reflection(reflection);
+    bento::Vector<char> data(*bento::common_allocator());
+    shader_reflection::serialize(reflection, data);
+    assert_msg(data.size() == sizeof(ShaderReflectionHeader) + 5 * sizeof(ShaderBinding), "Unexpected serialized size");
+
+    // Round trip
+    ShaderReflection loaded(*bento::common_allocator());
+    assert_msg(shader_reflection::deserialize(data.begin(), data.size(), loaded), "Failed to load the reflection");
+    assert_msg(memcmp(loaded.groupSize, reflection.groupSize, sizeof(reflection.groupSize)) == 0, "Wrong group size");
+    assert_msg(loaded.bindings.size() == reflection.bindings.size(), "Wrong binding count");
+    for (uint32_t bindingIdx = 0; bindingIdx < loaded.bindings.size(); ++bindingIdx)
+    {
+        const ShaderBinding& original = reflection.bindings[bindingIdx];
+        const ShaderBinding& binding = loaded.bindings[bindingIdx];
+        assert_msg(binding.type == original.type && binding.registerIndex == original.registerIndex && binding.space == original.space
+            && binding.count == original.count && binding.size == original.size, "Wrong binding");
+    }
+
+    // Truncated data
+    assert_msg(!shader_reflection::deserialize(data.begin(), data.size() - 1, loaded), "Truncated data accepted");
+    assert_msg(loaded.bindings.size() == 0, "Rejected data left bindings behind");
+    assert_msg(!shader_reflection::deserialize(data.begin(), sizeof(ShaderReflectionHeader) - 1, loaded), "Truncated header accepted");
+
+    // Wrong magic, then wrong version
+    data[0] ^= 0xff;
+    assert_msg(!shader_reflection::deserialize(data.begin(), data.size(), loaded), "Wrong magic accepted");
+    data[0] ^= 0xff;
+    ShaderReflectionHeader* header = (ShaderReflectionHeader*)data.begin();
+    header->version = SHADER_REFLECTION_VERSION + 1;
+    assert_msg(!shader_reflection::deserialize(data.begin(), data.size(), loaded), "Wrong version accepted");
+    header->version = SHADER_REFLECTION_VERSION;
+
+    // Structurally sound but invalid metadata
+    ShaderBinding* bindings = (ShaderBinding*)(data.begin() + sizeof(ShaderReflectionHeader));
+    bindings[1].registerIndex = 0;
+    assert_msg(!shader_reflection::deserialize(data.begin(), data.size(), loaded), "Overlapping bindings accepted");
+}
+
+int main()
+{
+    test_ranges();
+    test_validation();
+    test_serialization();
+    std::cout << "Shader reflection tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,185 @@
+// System includes
+#include <iostream>
+
+// Bento includes
+#include <bento_base/security.h>
+
+// SDK includes
+#include "gpu_backend/shadow_state_tracker.h"
+
+using namespace graphics_sandbox;
+
+// Fake objects, the tracker never interprets them
+const uint64_t Heap = 0x10;
+const uint64_t RootSignatureA = 0x20;
+const uint64_t RootSignatureB = 0x30;
+const uint64_t PipelineA = 0x40;
+const uint64_t PipelineB = 0x50;
+
+enum class RecordedCallType
+{
+    Reset,
+    InvalidateRootArguments,
+    DescriptorHeap,
+    RootSignature,
+    PipelineState,
+    RootValue,
+    RootConstant
+};
+
+struct RecordedCall
+{
+    RecordedCallType type;
+    uint32_t rootIndex;
+    uint64_t value;
+    bool emitted;
+};
+
+// Replays a sequence of calls and checks which ones reach the command list
+void replay(ShadowStateTracker& tracker, const RecordedCall* calls, uint32_t numCalls)
+{
+    for (uint32_t callIdx = 0; callIdx < numCalls; ++callIdx)
+    {
+        const RecordedCall& call = calls[callIdx];
+        bool emitted = false;
+        uint32_t constant = (uint32_t)call.value;
+        switch (call.type)
+        {
+        case RecordedCallType::Reset:
+            shadow_state_tracker::reset(tracker);
+            continue;
+        case RecordedCallType::InvalidateRootArguments:
+            shadow_state_tracker::invalidate_root_arguments(tracker);
+            continue;
+        case RecordedCallType::DescriptorHeap:
+            emitted = shadow_state_tracker::set_descriptor_heap(tracker, call.value);
+            break;
+        case RecordedCallType::RootSignature:
+            emitted = shadow_state_tracker::set_root_signature(tracker, call.value);
+            break;
+        case RecordedCallType::PipelineState:
+            emitted = shadow_state_tracker::set_pipeline_state(tracker, call.value);
+            break;
+        case RecordedCallType::RootValue:
+            emitted = shadow_state_tracker::set_root_value(tracker, call.rootIndex, call.value);
+            break;
+        case RecordedCallType::RootConstant:
+            emitted = shadow_state_tracker::set_root_constants(tracker, call.rootIndex, &constant, 1);
+            break;
+        }
+        if (emitted != call.emitted)
+        {
+            std::cout << "Call " << callIdx << " was " << (emitted ? "emitted" : "elided") << std::endl;
+            assert_msg(false, "Unexpected filtering");
+        }
+    }
+}
+
+void test_uav_barrier_loop()
+{
+    ShadowStateTracker tracker;
+    shadow_state_tracker::initialize(tracker);
+
+    // Recording of test_uav_barrier, the same shader is dispatched with the cbv table unchanged and the uav table alternating
+    const RecordedCall calls[] = {
+        { RecordedCallType::Reset, 0, 0, false },
+        { RecordedCallType::DescriptorHeap, 0, Heap, true },
+        { RecordedCallType::RootSignature, 0, RootSignatureA, true },
+        { RecordedCallType::RootValue, 0, 0x1000, true },
+        { RecordedCallType::RootValue, 1, 0x2000, true },
+        { RecordedCallType::PipelineState, 0, PipelineA, true },
+        { RecordedCallType::DescriptorHeap, 0, Heap, false },
+        { RecordedCallType::RootSignature, 0, RootSignatureA, false },
+        { RecordedCallType::RootValue, 0, 0x1100, true },
+        { RecordedCallType::RootValue, 1, 0x2000, false },
+        { RecordedCallType::PipelineState, 0, PipelineA, false },
+        { RecordedCallType::DescriptorHeap, 0, Heap, false },
+        { RecordedCallType::RootSignature, 0, RootSignatureA, false },
+        { RecordedCallType::RootValue, 0, 0x1000, true },
+        { RecordedCallType::RootValue, 1, 0x2000, false },
+        { RecordedCallType::PipelineState, 0, PipelineA, false },
+    };
+    replay(tracker, calls, sizeof(calls) / sizeof(RecordedCall));
+    assert_msg(shadow_state_tracker::total_elided_calls(tracker) == 8, "Wrong number of elided calls");
+    assert_msg(tracker.elidedCalls[(uint32_t)ShadowStateCall::PipelineState] == 2, "Wrong number of elided pipeline states");
+}
+
+void test_root_signature_change()
+{
+    ShadowStateTracker tracker;
+    shadow_state_tracker::initialize(tracker);
+
+    // Switching root signatures invalidates the arguments, not the pipeline state
+    const RecordedCall calls[] = {
+        { RecordedCallType::DescriptorHeap, 0, Heap, true },
+        { RecordedCallType::RootSignature, 0, RootSignatureA, true },
+        { RecordedCallType::RootConstant, 0, 7, true },
+        { RecordedCallType::RootValue, 1, 0x1000, true },
+        { RecordedCallType::PipelineState, 0, PipelineA, true },
+        { RecordedCallType::RootConstant, 0, 7, false },
+        { RecordedCallType::RootConstant, 0, 8, true },
+        { RecordedCallType::RootSignature, 0, RootSignatureB, true },
+        { RecordedCallType::RootConstant, 0, 8, true },
+        { RecordedCallType::RootValue, 1, 0x1000, true },
+        { RecordedCallType::PipelineState, 0, PipelineB, true },
+        { RecordedCallType::PipelineState, 0, PipelineB, false },
+        { RecordedCallType::RootSignature, 0, RootSignatureA, true },
+        { RecordedCallType::RootValue, 1, 0x1000, true },
+        { RecordedCallType::PipelineState, 0, PipelineA, true },
+    };
+    replay(tracker, calls, sizeof(calls) / sizeof(RecordedCall));
+}
+
+void test_reset()
+{
+    ShadowStateTracker tracker;
+    shadow_state_tracker::initialize(tracker);
+
+    // Nothing survives a reset of the command list except the statistics
+    const RecordedCall calls[] = {
+        { RecordedCallType::DescriptorHeap, 0, Heap, true },
+        { RecordedCallType::RootSignature, 0, RootSignatureA, true },
+        { RecordedCallType::PipelineState, 0, PipelineA, true },
+        { RecordedCallType::PipelineState, 0, PipelineA, false },
+        { RecordedCallType::Reset, 0, 0, false },
+        { RecordedCallType::DescriptorHeap, 0, Heap, true },
+        { RecordedCallType::RootSignature, 0, RootSignatureA, true },
+        { RecordedCallType::PipelineState, 0, PipelineA, true },
+    };
+    replay(tracker, calls, sizeof(calls) / sizeof(RecordedCall));
+    assert_msg(shadow_state_tracker::total_elided_calls(tracker) == 1, "Statistics were lost");
+    assert_msg(tracker.requestedCalls[(uint32_t)ShadowStateCall::PipelineState] == 3, "Wrong number of requested calls");
+}
+
+void test_invalidate_root_arguments()
+{
+    ShadowStateTracker tracker;
+    shadow_state_tracker::initialize(tracker);
+
+    // A transition between two dispatches (e.g. a copy into the bound constant buffer) forces the static tables to be set again
+    const RecordedCall calls[] = {
+        { RecordedCallType::DescriptorHeap, 0, Heap, true },
+        { RecordedCallType::RootSignature, 0, RootSignatureA, true },
+        { RecordedCallType::RootValue, 0, 0x1000, true },
+        { RecordedCallType::RootConstant, 1, 7, true },
+        { RecordedCallType::PipelineState, 0, PipelineA, true },
+        { RecordedCallType::InvalidateRootArguments, 0, 0, false },
+        { RecordedCallType::DescriptorHeap, 0, Heap, false },
+        { RecordedCallType::RootSignature, 0, RootSignatureA, false },
+        { RecordedCallType::RootValue, 0, 0x1000, true },
+        { RecordedCallType::RootConstant, 1, 7, true },
+        { RecordedCallType::PipelineState, 0, PipelineA, false },
+        { RecordedCallType::RootValue, 0, 0x1000, false },
+    };
+    replay(tracker, calls, sizeof(calls) / sizeof(RecordedCall));
+}
+
+int main()
+{
+    test_uav_barrier_loop();
+    test_root_signature_change();
+    test_reset();
+    test_invalidate_root_arguments();
+    std::cout << "All shadow state tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,113 @@
+// System includes
+#include <chrono>
+#include <iostream>
+#include <string.h>
+#include <vector>
+
+// Bento includes
+#include <bento_base/security.h>
+#include <bento_memory/common.h>
+
+// SDK includes
+#include "tools/stream_copy.h"
+#include "tools/work_stealing_pool.h"
+
+using namespace graphics_sandbox;
+
+// Ordinary memory stands in for the upload heap, write-combined memory favors the streaming stores even more
+#define BENCHMARK_SIZE (256ull << 20)
+#define NUM_REPETITIONS 5
+#define GUARD_SIZE 64
+
+void fill_pattern(char* data, uint64_t size, uint32_t seed)
+{
+    for (uint64_t byteIdx = 0; byteIdx < size; ++byteIdx)
+        data[byteIdx] = (char)((byteIdx * 31 + seed) >> 3);
+}
+
+void test_copy_path(StreamCopyPath path)
+{
+    // Every destination alignment within a line, a few source alignments and sizes around the vector and line widths
+    const uint64_t sizes[] = { 0, 1, 15, 16, 31, 63, 64, 65, 127, 128, 129, 191, 1000, 4096 + 17 };
+    std::vector<char> source(8192 + 64);
+    std::vector<char> destination(8192 + 128 + 2 * GUARD_SIZE);
+    fill_pattern(source.data(), source.size(), 7);
+    for (uint64_t size : sizes)
+    {
+        for (uint32_t dstOffset = 0; dstOffset < 64; ++dstOffset)
+        {
+            for (uint32_t srcOffset = 0; srcOffset < 8; ++srcOffset)
+            {
+                memset(destination.data(), 0x5a, destination.size());
+                char* target = destination.data() + GUARD_SIZE + dstOffset;
+                stream_copy::copy(target, source.data() + srcOffset, size, path);
+                assert_msg(memcmp(target, source.data() + srcOffset, (size_t)size) == 0, "Wrong copy");
+                for (uint32_t guardIdx = 0; guardIdx < GUARD_SIZE; ++guardIdx)
+                    assert_msg(target[-1 - (int32_t)guardIdx] == 0x5a && target[size + guardIdx] == 0x5a, "Write outside of the destination");
+            }
+        }
+    }
+}
+
+void test_copy_parallel(WorkStealingPool* pool)
+{
+    // Large enough to be split, with an odd size and a misaligned destination
+    uint64_t size = (40ull << 20) + 12345;
+    std::vector<char> source(size);
+    std::vector<char> destination(size + 2 * GUARD_SIZE, 0x5a);
+    fill_pattern(source.data(), size, 3);
+    stream_copy::copy_parallel(pool, destination.data() + GUARD_SIZE + 3, source.data(), size);
+    assert_msg(memcmp(destination.data() + GUARD_SIZE + 3, source.data(), (size_t)size) == 0, "Wrong parallel copy");
+    assert_msg(destination[GUARD_SIZE + 2] == 0x5a && destination[GUARD_SIZE + 3 + size] == 0x5a, "Write outside of the destination");
+}
+
+// Best throughput over a few repetitions, in GB/s
+template<typename CopyFunction>
+double measure(char* destination, const char* source, CopyFunction copyFunction)
+{
+    double bestSeconds = 1e9;
+    for (uint32_t repetition = 0; repetition < NUM_REPETITIONS; ++repetition)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        copyFunction(destination, source, BENCHMARK_SIZE);
+        auto end = std::chrono::high_resolution_clock::now();
+        double seconds = std::chrono::duration<double>(end - start).count();
+        bestSeconds = seconds < bestSeconds ? seconds : bestSeconds;
+    }
+    assert_msg(memcmp(destination, source, BENCHMARK_SIZE) == 0, "Wrong copy");
+    return BENCHMARK_SIZE / bestSeconds / 1e9;
+}
+
+void benchmark(WorkStealingPool* pool)
+{
+    // Touch every page up front, the first copy would measure the page faults otherwise
+    std::vector<char> source(BENCHMARK_SIZE);
+    std::vector<char> destination(BENCHMARK_SIZE, 0);
+    fill_pattern(source.data(), BENCHMARK_SIZE, 11);
+
+    std::cout << "Copying " << (BENCHMARK_SIZE >> 20) << " MB, best path " << stream_copy::path_name(stream_copy::best_path()) << std::endl;
+    double memcpyRate = measure(destination.data(), source.data(), [](char* dst, const char* src, uint64_t size) { memcpy(dst, src, (size_t)size); });
+    std::cout << "memcpy: " << memcpyRate << " GB/s" << std::endl;
+    for (uint32_t pathIdx = (uint32_t)StreamCopyPath::SSE2; pathIdx <= (uint32_t)stream_copy::best_path(); ++pathIdx)
+    {
+        StreamCopyPath path = (StreamCopyPath)pathIdx;
+        memset(destination.data(), 0, BENCHMARK_SIZE);
+        double rate = measure(destination.data(), source.data(), [path](char* dst, const char* src, uint64_t size) { stream_copy::copy(dst, src, size, path); });
+        std::cout << "Streaming " << stream_copy::path_name(path) << ": " << rate << " GB/s" << std::endl;
+    }
+    memset(destination.data(), 0, BENCHMARK_SIZE);
+    double parallelRate = measure(destination.data(), source.data(), [pool](char* dst, const char* src, uint64_t size) { stream_copy::copy_parallel(pool, dst, src, size); });
+    std::cout << "Streaming parallel: " << parallelRate << " GB/s" << std::endl;
+}
+
+int main()
+{
+    for (uint32_t pathIdx = 0; pathIdx <= (uint32_t)stream_copy::best_path(); ++pathIdx)
+        test_copy_path((StreamCopyPath)pathIdx);
+    WorkStealingPool* pool = work_stealing_pool::create_pool(*bento::common_allocator());
+    test_copy_parallel(pool);
+    benchmark(pool);
+    work_stealing_pool::destroy_pool(pool);
+    std::cout << "Stream copy tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,148 @@
+// System includes
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+// Bento includes
+#include <bento_base/security.h>
+#include <bento_memory/common.h>
+
+// SDK includes
+#include "tools/timeline.h"
+
+using namespace graphics_sandbox;
+
+void test_signal_and_wait()
+{
+    Timeline* timeline = timeline::create_timeline(*bento::common_allocator());
+    uint64_t first = timeline::submit(timeline);
+    uint64_t second = timeline::submit(timeline);
+    assert_msg(first == 1 && second == 2 && timeline::last_submitted(timeline) == 2, "Points are not consecutive");
+    assert_msg(!timeline::is_complete(timeline, first), "Point complete before being signaled");
+
+    // Nobody signals, the wait must time out
+    assert_msg(!timeline::wait(timeline, first, 10), "Wait did not time out");
+
+    // A simulated GPU completes the work from another thread
+    std::thread device([&]()
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        timeline::signal(timeline, first);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        timeline::signal(timeline, second);
+    });
+    assert_msg(timeline::wait(timeline, second), "Infinite wait returned early");
+    assert_msg(timeline::is_complete(timeline, first), "Previous point not complete");
+    device.join();
+
+    // Completion never goes backwards
+    timeline::signal(timeline, 1);
+    assert_msg(timeline::completed_value(timeline) == 2, "Completed value went backwards");
+    timeline::destroy_timeline(timeline);
+}
+
+void test_wait_any_all()
+{
+    Timeline* timelines[2] = { timeline::create_timeline(*bento::common_allocator()), timeline::create_timeline(*bento::common_allocator()) };
+    uint64_t points[2] = { timeline::submit(timelines[0]), timeline::submit(timelines[1]) };
+    assert_msg(timeline::wait_any(timelines, points, 2, 10) == UINT32_MAX, "Wait any did not time out");
+
+    // Only the second queue progresses
+    std::thread device([&]()
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        timeline::signal(timelines[1], points[1]);
+    });
+    assert_msg(timeline::wait_any(timelines, points, 2) == 1, "Wrong queue reported");
+    device.join();
+    assert_msg(!timeline::wait_all(timelines, points, 2, 10), "Wait all did not time out");
+
+    timeline::signal(timelines[0], points[0]);
+    assert_msg(timeline::wait_all(timelines, points, 2), "Wait all failed");
+    timeline::destroy_timeline(timelines[0]);
+    timeline::destroy_timeline(timelines[1]);
+}
+
+struct CallbackRecord
+{
+    std::atomic<uint32_t> calls;
+    std::atomic<uint64_t> lastPoint;
+    std::thread::id thread;
+};
+
+void record_callback(uint64_t point, void* userData)
+{
+    CallbackRecord* record = (CallbackRecord*)userData;
+    record->thread = std::this_thread::get_id();
+    record->lastPoint = point;
+    record->calls++;
+}
+
+void test_callbacks()
+{
+    Timeline* timeline = timeline::create_timeline(*bento::common_allocator());
+    CallbackRecord record;
+    record.calls = 0;
+    record.lastPoint = 0;
+
+    uint64_t first = timeline::submit(timeline);
+    uint64_t second = timeline::submit(timeline);
+    timeline::add_callback(timeline, first, record_callback, &record);
+    timeline::add_callback(timeline, second, record_callback, &record);
+    timeline::signal(timeline, first);
+
+    // The callbacks only run once their point is reached, on the worker
+    while (record.calls < 1)
+        std::this_thread::yield();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    assert_msg(record.calls == 1 && record.lastPoint == first, "Callback ran too early");
+    assert_msg(record.thread != std::this_thread::get_id(), "Callback ran on the caller's thread");
+
+    // Destroying the timeline runs the callbacks that are ready
+    timeline::signal(timeline, second);
+    timeline::destroy_timeline(timeline);
+    assert_msg(record.calls == 2 && record.lastPoint == second, "Callback was lost");
+}
+
+// Device that completes every submission 5ms after it is waited on, like a fence event
+struct SimulatedDevice
+{
+    std::atomic<uint32_t> waits;
+};
+
+uint64_t simulated_wait(void* userData, uint64_t value)
+{
+    SimulatedDevice* device = (SimulatedDevice*)userData;
+    device->waits++;
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    return value;
+}
+
+void test_wait_function()
+{
+    SimulatedDevice device;
+    device.waits = 0;
+    Timeline* timeline = timeline::create_timeline(*bento::common_allocator(), simulated_wait, &device);
+
+    // Nobody calls signal, the worker reports the completion
+    uint64_t point = 0;
+    for (uint32_t submitIdx = 0; submitIdx < 10; ++submitIdx)
+        point = timeline::submit(timeline);
+    assert_msg(timeline::wait(timeline, point, 1000), "Worker did not report the completion");
+    assert_msg(device.waits >= 1 && device.waits <= 10, "Wrong number of device waits");
+
+    // The destruction waits for the last submission
+    point = timeline::submit(timeline);
+    timeline::destroy_timeline(timeline);
+}
+
+int main()
+{
+    test_signal_and_wait();
+    test_wait_any_all();
+    test_callbacks();
+    test_wait_function();
+    std::cout << "All timeline tests passed" << std::endl;
+    return 0;
+}
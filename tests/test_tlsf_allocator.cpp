@@ -0,0 +1,197 @@
+// System includes
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Bento includes
+#include <bento_base/security.h>
+#include <bento_memory/common.h>
+
+// SDK includes
+#include "gpu_backend/tlsf_allocator.h"
+
+using namespace graphics_sandbox;
+
+// Heap block and placement alignments of the DX12 backend
+const uint64_t HeapSize = 256ull << 20;
+const uint64_t SmallAlignment = 4096;
+const uint64_t DefaultAlignment = 65536;
+const uint64_t MsaaAlignment = 4ull << 20;
+
+bool overlaps(std::vector<TlsfAllocation> allocations)
+{
+    std::sort(allocations.begin(), allocations.end(), [](const TlsfAllocation& a, const TlsfAllocation& b) { return a.offset < b.offset; });
+    for (size_t allocIdx = 1; allocIdx < allocations.size(); ++allocIdx)
+        if (allocations[allocIdx - 1].offset + allocations[allocIdx - 1].size > allocations[allocIdx].offset)
+            return true;
+    return false;
+}
+
+void test_basic()
+{
+    TlsfAllocator allocator(*bento::common_allocator());
+    tlsf_allocator::initialize(allocator, 1024, 16);
+    assert_msg(tlsf_allocator::validate(allocator) && tlsf_allocator::largest_free_block(allocator) == 1024, "Wrong initial state");
+
+    // Sizes are rounded to the granularity and packed from the start
+    TlsfAllocation a, b, c;
+    assert_msg(tlsf_allocator::allocate(allocator, 10, 1, a) && a.offset == 0 && a.size == 16, "Wrong first allocation");
+    assert_msg(tlsf_allocator::allocate(allocator, 100, 16, b) && b.offset == 16 && b.size == 112, "Wrong second allocation");
+
+    // The front padding of an aligned allocation stays available
+    assert_msg(tlsf_allocator::allocate(allocator, 64, 256, c) && c.offset == 256, "Wrong aligned allocation");
+    TlsfAllocation d;
+    assert_msg(tlsf_allocator::allocate(allocator, 128, 16, d) && d.offset == 128, "Padding was not reused");
+    assert_msg(allocator.used == 16 + 112 + 64 + 128 && allocator.numAllocations == 4 && tlsf_allocator::validate(allocator), "Wrong statistics");
+
+    // Freeing merges the neighbours back into a single block
+    tlsf_allocator::free(allocator, b.block);
+    tlsf_allocator::free(allocator, c.block);
+    tlsf_allocator::free(allocator, a.block);
+    tlsf_allocator::free(allocator, d.block);
+    assert_msg(tlsf_allocator::is_empty(allocator) && tlsf_allocator::largest_free_block(allocator) == 1024 && tlsf_allocator::validate(allocator), "Blocks were not merged");
+
+    // Too large or impossible to align
+    TlsfAllocation e;
+    assert_msg(!tlsf_allocator::allocate(allocator, 1025, 16, e), "Allocation larger than the capacity");
+    assert_msg(tlsf_allocator::allocate(allocator, 1024, 16, e) && e.offset == 0, "Full allocation failed");
+    assert_msg(!tlsf_allocator::allocate(allocator, 16, 16, e), "Allocation in a full allocator");
+}
+
+void test_stress()
+{
+    TlsfAllocator allocator(*bento::common_allocator());
+    tlsf_allocator::initialize(allocator, HeapSize, SmallAlignment);
+    std::mt19937 generator(1234);
+    std::vector<TlsfAllocation> live;
+    uint32_t numFailures = 0;
+    for (uint32_t iteration = 0; iteration < 200000; ++iteration)
+    {
+        // Mostly small buffers, some textures and a few large multisampled targets
+        bool allocate = live.empty() || generator() % 100 < 55;
+        if (allocate)
+        {
+            uint32_t kind = generator() % 100;
+            uint64_t size, alignment;
+            if (kind < 70)
+            {
+                size = 256 + generator() % (256 << 10);
+                alignment = DefaultAlignment;
+            }
+            else if (kind < 95)
+            {
+                size = 4096 + generator() % (4 << 20);
+                alignment = generator() % 2 ? SmallAlignment : DefaultAlignment;
+            }
+            else
+            {
+                size = (4 << 20) + generator() % (16 << 20);
+                alignment = MsaaAlignment;
+            }
+
+            TlsfAllocation allocation;
+            if (tlsf_allocator::allocate(allocator, size, alignment, allocation))
+            {
+                assert_msg(allocation.offset % alignment == 0 && allocation.size >= size && allocation.offset + allocation.size <= HeapSize, "Invalid placement");
+                live.push_back(allocation);
+            }
+            else
+                numFailures++;
+        }
+        else
+        {
+            uint32_t allocIdx = generator() % live.size();
+            tlsf_allocator::free(allocator, live[allocIdx].block);
+            live[allocIdx] = live.back();
+            live.pop_back();
+        }
+
+        if (iteration % 5000 == 0)
+        {
+            assert_msg(tlsf_allocator::validate(allocator), "Inconsistent allocator");
+            assert_msg(!overlaps(live), "Overlapping allocations");
+        }
+    }
+    assert_msg(tlsf_allocator::validate(allocator) && !overlaps(live), "Inconsistent allocator");
+
+    // Fragmentation: how much of the free space is usable as a single block
+    uint64_t freeSpace = HeapSize - allocator.used;
+    std::cout << "Stress: " << live.size() << " live allocations, " << numFailures << " failures, " << (allocator.used * 100 / HeapSize) << "% used, largest free block "
+        << (freeSpace > 0 ? tlsf_allocator::largest_free_block(allocator) * 100 / freeSpace : 100) << "% of the free space" << std::endl;
+
+    for (size_t allocIdx = 0; allocIdx < live.size(); ++allocIdx)
+        tlsf_allocator::free(allocator, live[allocIdx].block);
+    assert_msg(tlsf_allocator::is_empty(allocator) && tlsf_allocator::largest_free_block(allocator) == HeapSize && tlsf_allocator::validate(allocator), "Heap not fully merged");
+}
+
+void test_fragmentation()
+{
+    // Fill the heap with 64KB blocks and free every other one
+    TlsfAllocator allocator(*bento::common_allocator());
+    tlsf_allocator::initialize(allocator, HeapSize, DefaultAlignment);
+    std::vector<TlsfAllocation> blocks;
+    TlsfAllocation allocation;
+    while (tlsf_allocator::allocate(allocator, DefaultAlignment, DefaultAlignment, allocation))
+        blocks.push_back(allocation);
+    assert_msg(blocks.size() == HeapSize / DefaultAlignment, "Heap not filled");
+    for (size_t blockIdx = 0; blockIdx < blocks.size(); blockIdx += 2)
+        tlsf_allocator::free(allocator, blocks[blockIdx].block);
+
+    // Half the heap is free but only in holes of 64KB, they are all reused
+    assert_msg(tlsf_allocator::largest_free_block(allocator) == DefaultAlignment, "Holes were merged");
+    assert_msg(!tlsf_allocator::allocate(allocator, 2 * DefaultAlignment, DefaultAlignment, allocation), "Allocation larger than any hole");
+    for (size_t blockIdx = 0; blockIdx < blocks.size(); blockIdx += 2)
+    {
+        assert_msg(tlsf_allocator::allocate(allocator, 1000, SmallAlignment, allocation), "Hole was not reused");
+        blocks[blockIdx] = allocation;
+    }
+    assert_msg(allocator.used == HeapSize && tlsf_allocator::validate(allocator), "Heap not refilled");
+    for (size_t blockIdx = 0; blockIdx < blocks.size(); ++blockIdx)
+        tlsf_allocator::free(allocator, blocks[blockIdx].block);
+    assert_msg(tlsf_allocator::largest_free_block(allocator) == HeapSize && tlsf_allocator::validate(allocator), "Heap not fully merged");
+}
+
+// Average cost of an allocation and a free with a given number of live allocations, it should not depend on it
+double measure_cycle(uint32_t numLive)
+{
+    TlsfAllocator allocator(*bento::common_allocator());
+    tlsf_allocator::initialize(allocator, 64ull << 30, SmallAlignment);
+    std::mt19937 generator(numLive);
+    std::vector<TlsfAllocation> live;
+    TlsfAllocation allocation;
+    for (uint32_t allocIdx = 0; allocIdx < numLive; ++allocIdx)
+    {
+        tlsf_allocator::allocate(allocator, SmallAlignment * (1 + generator() % 64), SmallAlignment, allocation);
+        live.push_back(allocation);
+    }
+
+    const uint32_t numCycles = 1000000;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (uint32_t cycle = 0; cycle < numCycles; ++cycle)
+    {
+        uint32_t allocIdx = generator() % numLive;
+        tlsf_allocator::free(allocator, live[allocIdx].block);
+        tlsf_allocator::allocate(allocator, SmallAlignment * (1 + generator() % 64), SmallAlignment, live[allocIdx]);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / numCycles;
+}
+
+void test_constant_time()
+{
+    double small = measure_cycle(1000);
+    double large = measure_cycle(100000);
+    std::cout << "Free and allocate: " << small << "ns with 1000 live allocations, " << large << "ns with 100000" << std::endl;
+}
+
+int main()
+{
+    test_basic();
+    test_stress();
+    test_fragmentation();
+    test_constant_time();
+    std::cout << "TLSF allocator tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,174 @@
+// System includes
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Bento includes
+#include <bento_base/security.h>
+#include <bento_memory/common.h>
+
+// SDK includes
+#include "gpu_backend/upload_ring.h"
+
+using namespace graphics_sandbox;
+
+void test_allocate_and_reclaim()
+{
+    UploadRing ring(*bento::common_allocator());
+    upload_ring::initialize(ring, 1024);
+
+    // Constant data is aligned on 256 bytes, the padding is counted as used
+    uint64_t offset;
+    assert_msg(upload_ring::allocate(ring, 100, 256, offset) && offset == 0, "Wrong first offset");
+    assert_msg(upload_ring::allocate(ring, 100, 256, offset) && offset == 256, "Wrong aligned offset");
+    assert_msg(upload_ring::allocate(ring, 8, 4, offset) && offset == 356, "Wrong small offset");
+    assert_msg(ring.used == 364, "Wrong usage");
+
+    // Nothing is freed before the frame's value is reached
+    upload_ring::end_frame(ring, 1);
+    upload_ring::reclaim(ring, 0);
+    assert_msg(ring.used == 364, "Frame freed too early");
+    upload_ring::reclaim(ring, 1);
+    assert_msg(ring.used == 0, "Frame was not freed");
+
+    // An empty frame is not tracked
+    upload_ring::end_frame(ring, 2);
+    uint64_t fenceValue;
+    assert_msg(!upload_ring::oldest_fence_value(ring, fenceValue), "Empty frame tracked");
+}
+
+void test_wraparound()
+{
+    UploadRing ring(*bento::common_allocator());
+    upload_ring::initialize(ring, 1024);
+
+    uint64_t offset;
+    upload_ring::allocate(ring, 512, 256, offset);
+    upload_ring::end_frame(ring, 1);
+    upload_ring::allocate(ring, 384, 256, offset);
+    upload_ring::end_frame(ring, 2);
+
+    // The ring is too full until the first frame is done
+    assert_msg(!upload_ring::allocate(ring, 256, 256, offset), "Allocation overlaps a live frame");
+    uint64_t fenceValue;
+    assert_msg(upload_ring::oldest_fence_value(ring, fenceValue) && fenceValue == 1, "Wrong oldest frame");
+    upload_ring::reclaim(ring, 1);
+
+    // 128 bytes are left at the end, the allocation restarts at 0 and the end is padded
+    assert_msg(upload_ring::allocate(ring, 256, 256, offset) && offset == 0, "Allocation straddles the end of the ring");
+    assert_msg(ring.wraps == 1 && ring.used == 384 + 128 + 256, "Wrong padding");
+
+    // The padding is freed with the frame that wrapped
+    upload_ring::end_frame(ring, 3);
+    upload_ring::reclaim(ring, 2);
+    assert_msg(ring.used == 384, "Wrong usage after the second frame");
+    upload_ring::reclaim(ring, 3);
+    assert_msg(ring.used == 0, "Padding was not freed");
+}
+
+struct LiveAllocation
+{
+    uint64_t offset;
+    uint64_t size;
+    uint8_t pattern;
+};
+
+struct LiveFrame
+{
+    uint64_t fenceValue;
+    std::vector<LiveAllocation> allocations;
+};
+
+// The GPU completes the frames with a random latency, every allocation is filled with a pattern that must still be there when its
+// frame completes
+void test_fuzz()
+{
+    const uint64_t capacity = 1 << 16;
+    UploadRing ring(*bento::common_allocator());
+    upload_ring::initialize(ring, capacity);
+    std::vector<uint8_t> memory(capacity, 0);
+    std::mt19937 generator(42);
+
+    std::vector<LiveFrame> frames;
+    LiveFrame current;
+    uint64_t nextFenceValue = 1, completedValue = 0;
+    uint32_t numWaits = 0, numAllocations = 0;
+    for (uint32_t frame = 0; frame < 4000; ++frame)
+    {
+        uint32_t numFrameAllocations = generator() % 64;
+        for (uint32_t allocIdx = 0; allocIdx < numFrameAllocations; ++allocIdx)
+        {
+            // Mostly constant data, some larger uploads
+            uint64_t size = generator() % 8 == 0 ? 1 + generator() % 4096 : 16 + generator() % 512;
+            uint64_t alignment = generator() % 4 == 0 ? 1ull << (generator() % 9) : 256;
+            uint64_t offset;
+            while (!upload_ring::allocate(ring, size, alignment, offset))
+            {
+                // Wait for the oldest frame, or close the current one if it filled the ring on its own
+                uint64_t fenceValue;
+                if (!upload_ring::oldest_fence_value(ring, fenceValue))
+                {
+                    current.fenceValue = nextFenceValue++;
+                    upload_ring::end_frame(ring, current.fenceValue);
+                    frames.push_back(current);
+                    current.allocations.clear();
+                    continue;
+                }
+                completedValue = fenceValue;
+                numWaits++;
+
+                // The memory of the completed frames must be intact
+                while (!frames.empty() && frames[0].fenceValue <= completedValue)
+                {
+                    for (const LiveAllocation& live : frames[0].allocations)
+                        for (uint64_t byteIdx = 0; byteIdx < live.size; ++byteIdx)
+                            assert_msg(memory[live.offset + byteIdx] == live.pattern, "Live allocation overwritten");
+                    frames.erase(frames.begin());
+                }
+                upload_ring::reclaim(ring, completedValue);
+            }
+
+            assert_msg(offset % alignment == 0 && offset + size <= capacity, "Invalid allocation");
+            LiveAllocation live = { offset, size, (uint8_t)(1 + numAllocations % 255) };
+            for (uint64_t byteIdx = 0; byteIdx < size; ++byteIdx)
+                memory[offset + byteIdx] = live.pattern;
+            current.allocations.push_back(live);
+            numAllocations++;
+        }
+
+        // Close the frame, the GPU is up to three frames behind
+        current.fenceValue = nextFenceValue++;
+        upload_ring::end_frame(ring, current.fenceValue);
+        frames.push_back(current);
+        current.allocations.clear();
+        uint64_t latency = generator() % 4;
+        uint64_t reached = current.fenceValue > latency ? current.fenceValue - latency : 0;
+        if (reached > completedValue)
+        {
+            completedValue = reached;
+            while (!frames.empty() && frames[0].fenceValue <= completedValue)
+            {
+                for (const LiveAllocation& live : frames[0].allocations)
+                    for (uint64_t byteIdx = 0; byteIdx < live.size; ++byteIdx)
+                        assert_msg(memory[live.offset + byteIdx] == live.pattern, "Live allocation overwritten");
+                frames.erase(frames.begin());
+            }
+            upload_ring::reclaim(ring, completedValue);
+        }
+        assert_msg(ring.used <= capacity, "Ring overcommitted");
+    }
+
+    // Once everything completed the ring is empty
+    upload_ring::reclaim(ring, nextFenceValue);
+    assert_msg(ring.used == 0 && ring.frameSize == 0, "Ring not empty");
+    std::cout << "Fuzz: " << numAllocations << " allocations, " << ring.wraps << " wraps, " << numWaits << " waits" << std::endl;
+}
+
+int main()
+{
+    test_allocate_and_reclaim();
+    test_wraparound();
+    test_fuzz();
+    std::cout << "Upload ring tests passed" << std::endl;
+    return 0;
+}